@@ -1,4 +1,6 @@
+#include "caching/clock_cache.h"
 #include "caching/dblru_cache.h"
 #include "caching/no_evict_cache.h"
 #include "caching/shard_cache.h"
 #include "caching/splay_cache.h"
+#include "caching/tinylfu_cache.h"
@@ -0,0 +1,138 @@
+/**
+ * @file clock_cache.h
+ *
+ * All files in META are dual-licensed under the MIT and NCSA licenses. For more
+ * details, consult the file LICENSE.mit and LICENSE.ncsa in the root of the
+ * project.
+ */
+
+#ifndef META_CLOCK_CACHE_H_
+#define META_CLOCK_CACHE_H_
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "util/optional.h"
+
+namespace meta
+{
+namespace caching
+{
+
+/**
+ * A fixed-size cache that approximates LRU with the CLOCK algorithm and
+ * stripes its keyspace over many independently locked segments.
+ *
+ * Unlike an LRU list or a splay tree, a CLOCK cache does not reorganize
+ * itself on a hit: it only sets the entry's reference bit. Each stripe's
+ * critical section is therefore a single hash lookup, and with many more
+ * stripes than threads, concurrent lookups rarely wait on each other.
+ * When a full stripe needs room, its clock hand sweeps over the entries,
+ * clearing reference bits, and evicts the first entry that has not been
+ * used since the hand last passed it.
+ */
+template <class Key, class Value>
+class clock_cache
+{
+  public:
+    /// The default number of stripes
+    const static uint64_t constexpr default_stripes = 64;
+
+    /**
+     * @param max_size The maximum number of entries in the cache
+     * @param stripes The number of independently locked segments
+     */
+    clock_cache(uint64_t max_size, uint64_t stripes = default_stripes);
+
+    /**
+     * clock_cache may be move constructed
+     */
+    clock_cache(clock_cache&&) = default;
+
+    /**
+     * clock_cache may be move assigned
+     * @return the current clock_cache
+     */
+    clock_cache& operator=(clock_cache&&) = default;
+
+    /**
+     * Inserts a given (key, value) pair into the cache, replacing the
+     * value if the key is already present.
+     * @param key
+     * @param value
+     */
+    void insert(const Key& key, const Value& value);
+
+    /**
+     * Finds a value in the cache. If it exists, the optional will be
+     * engaged, otherwise, it will be disengaged.
+     *
+     * @param key the key to find the corresponding value for
+     * @return an optional that may contain the value, if found
+     */
+    util::optional<Value> find(const Key& key);
+
+    /**
+     * @return the number of elements in the cache
+     */
+    uint64_t size() const;
+
+    /**
+     * Empties the cache.
+     */
+    void clear();
+
+  private:
+    /**
+     * One entry in a stripe's clock.
+     */
+    struct slot
+    {
+        /// the key
+        Key key;
+        /// the value
+        Value value;
+        /// whether the entry has been used since the hand last passed it
+        bool referenced;
+    };
+
+    /**
+     * One independently locked segment of the cache.
+     */
+    struct stripe
+    {
+        /// the mutex that synchronizes access to this stripe
+        mutable std::mutex mutex;
+        /// the location of each key in slots
+        std::unordered_map<Key, uint64_t> positions;
+        /// the entries, in clock order
+        std::vector<slot> slots;
+        /// the position of the clock hand in slots
+        uint64_t hand = 0;
+    };
+
+    /**
+     * @param key The key to look for
+     * @return the stripe responsible for key
+     */
+    stripe& stripe_for(const Key& key);
+
+    /// the maximum number of entries in each stripe
+    uint64_t stripe_size_;
+
+    /// the stripes; allocated separately so their locks do not share
+    /// cache lines
+    std::vector<std::unique_ptr<stripe>> stripes_;
+
+    /// the hash function used for determining which stripe a key
+    /// belongs to
+    std::hash<Key> hasher_;
+};
+}
+}
+
+#include "caching/clock_cache.tcc"
+#endif
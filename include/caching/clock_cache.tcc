@@ -0,0 +1,113 @@
+/**
+ * @file clock_cache.tcc
+ */
+
+#include <algorithm>
+
+#include "caching/clock_cache.h"
+#include "util/shim.h"
+
+namespace meta
+{
+namespace caching
+{
+
+template <class Key, class Value>
+clock_cache<Key, Value>::clock_cache(uint64_t max_size, uint64_t stripes)
+{
+    stripes = std::max<uint64_t>(1, std::min(stripes, max_size));
+    stripe_size_ = std::max<uint64_t>(1, max_size / stripes);
+    for (uint64_t i = 0; i < stripes; ++i)
+    {
+        stripes_.emplace_back(make_unique<stripe>());
+        stripes_.back()->slots.reserve(stripe_size_);
+    }
+}
+
+template <class Key, class Value>
+void clock_cache<Key, Value>::insert(const Key& key, const Value& value)
+{
+    auto& s = stripe_for(key);
+    std::lock_guard<std::mutex> lock{s.mutex};
+
+    auto it = s.positions.find(key);
+    if (it != s.positions.end())
+    {
+        s.slots[it->second].value = value;
+        return;
+    }
+
+    // new entries start unreferenced, so a key that is never looked up
+    // again is the first to go when the hand comes around
+    if (s.slots.size() < stripe_size_)
+    {
+        s.positions.emplace(key, s.slots.size());
+        s.slots.push_back({key, value, false});
+        return;
+    }
+
+    while (s.slots[s.hand].referenced)
+    {
+        s.slots[s.hand].referenced = false;
+        s.hand = (s.hand + 1) % s.slots.size();
+    }
+
+    auto& victim = s.slots[s.hand];
+    s.positions.erase(victim.key);
+    s.positions.emplace(key, s.hand);
+    victim = {key, value, false};
+    s.hand = (s.hand + 1) % s.slots.size();
+}
+
+template <class Key, class Value>
+util::optional<Value> clock_cache<Key, Value>::find(const Key& key)
+{
+    auto& s = stripe_for(key);
+    std::lock_guard<std::mutex> lock{s.mutex};
+
+    auto it = s.positions.find(key);
+    if (it == s.positions.end())
+        return util::nullopt;
+
+    auto& entry = s.slots[it->second];
+    entry.referenced = true;
+    return entry.value;
+}
+
+template <class Key, class Value>
+uint64_t clock_cache<Key, Value>::size() const
+{
+    uint64_t size = 0;
+    for (const auto& s : stripes_)
+    {
+        std::lock_guard<std::mutex> lock{s->mutex};
+        size += s->slots.size();
+    }
+    return size;
+}
+
+template <class Key, class Value>
+void clock_cache<Key, Value>::clear()
+{
+    for (auto& s : stripes_)
+    {
+        std::lock_guard<std::mutex> lock{s->mutex};
+        s->positions.clear();
+        s->slots.clear();
+        s->hand = 0;
+    }
+}
+
+template <class Key, class Value>
+auto clock_cache<Key, Value>::stripe_for(const Key& key) -> stripe &
+{
+    // identifiers often hash to themselves, so mix the bits before picking
+    // a stripe to keep runs of nearby keys from landing together
+    uint64_t hash = hasher_(key);
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    return *stripes_[hash % stripes_.size()];
+}
+}
+}
@@ -0,0 +1,266 @@
+/**
+ * @file tinylfu_cache.h
+ *
+ * All files in META are dual-licensed under the MIT and NCSA licenses. For more
+ * details, consult the file LICENSE.mit and LICENSE.ncsa in the root of the
+ * project.
+ */
+
+#ifndef META_TINYLFU_CACHE_H_
+#define META_TINYLFU_CACHE_H_
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "util/optional.h"
+
+namespace cpptoml
+{
+class table;
+}
+
+namespace meta
+{
+namespace caching
+{
+
+/**
+ * @param value A pointer to a cached object with a bytes_used() member
+ * (such as a postings_data)
+ * @return the number of bytes the object occupies
+ */
+template <class T>
+uint64_t bytes_used(const std::shared_ptr<T>& value)
+{
+    return sizeof(T) + (value ? value->bytes_used() : 0);
+}
+
+/**
+ * A cache bounded by the number of bytes its values occupy rather than
+ * by their number, with a TinyLFU admission filter.
+ *
+ * Postings lists vary in size by orders of magnitude, so an entry count
+ * says little about how much memory a cache uses. Here each value is
+ * measured with bytes_used() when it is inserted and entries are evicted
+ * until the new one fits.
+ *
+ * Eviction follows the CLOCK algorithm, but a new entry is only admitted
+ * if it has been requested more often than every entry it would evict.
+ * Request frequencies are estimated by a count-min sketch of small
+ * counters that are periodically halved, so the estimates favor recent
+ * popularity and take very little memory. A term looked up once by an
+ * unusual query therefore cannot push out a list that many queries use.
+ *
+ * Like clock_cache, the keyspace is striped over independently locked
+ * segments, each with an equal share of the budget and its own sketch.
+ *
+ * @see https://arxiv.org/abs/1512.00727
+ */
+template <class Key, class Value>
+class tinylfu_cache
+{
+  public:
+    /// The default number of stripes
+    const static uint64_t constexpr default_stripes = 16;
+
+    /// The default budget, in bytes, if the configuration does not give one
+    const static uint64_t constexpr default_bytes = 1024 * 1024 * 256;
+
+    /**
+     * @param max_bytes The maximum number of bytes of values (and
+     * bookkeeping) to keep in the cache
+     * @param stripes The number of independently locked segments
+     */
+    tinylfu_cache(uint64_t max_bytes, uint64_t stripes = default_stripes);
+
+    /**
+     * Constructs a cache whose budget is given by the "ram-budget" key
+     * (in MB) of the configuration's [cache] group, or default_bytes if
+     * there is none.
+     * @param config The configuration
+     */
+    explicit tinylfu_cache(const cpptoml::table& config);
+
+    /**
+     * tinylfu_cache may be move constructed
+     */
+    tinylfu_cache(tinylfu_cache&&) = default;
+
+    /**
+     * tinylfu_cache may be move assigned
+     * @return the current tinylfu_cache
+     */
+    tinylfu_cache& operator=(tinylfu_cache&&) = default;
+
+    /**
+     * Offers a (key, value) pair to the cache. If the key is already
+     * present its value is replaced without consulting the admission
+     * filter, unless the new value can't fit, in which case the old one
+     * is kept; otherwise the pair is only kept if the admission filter
+     * prefers it to the entries it would displace.
+     * @param key
+     * @param value
+     */
+    void insert(const Key& key, const Value& value);
+
+    /**
+     * Finds a value in the cache. If it exists, the optional will be
+     * engaged, otherwise, it will be disengaged. Either way, the request
+     * counts towards the key's frequency.
+     *
+     * @param key the key to find the corresponding value for
+     * @return an optional that may contain the value, if found
+     */
+    util::optional<Value> find(const Key& key);
+
+    /**
+     * @return the number of elements in the cache
+     */
+    uint64_t size() const;
+
+    /**
+     * @return the number of bytes the cache is using
+     */
+    uint64_t bytes() const;
+
+    /**
+     * Empties the cache. Request frequencies are kept.
+     */
+    void clear();
+
+  private:
+    /**
+     * A count-min sketch of small saturating counters, halved whenever
+     * enough increments have been made.
+     */
+    class frequency_sketch
+    {
+      public:
+        /**
+         * @param width The number of counters in each row (rounded up to a
+         * power of two)
+         */
+        frequency_sketch(uint64_t width);
+
+        /**
+         * @param hash The hash of the key to count
+         */
+        void increment(uint64_t hash);
+
+        /**
+         * @param hash The hash of the key to look up
+         * @return an estimate of how often the key has been counted
+         */
+        uint8_t frequency(uint64_t hash) const;
+
+      private:
+        /**
+         * @param hash The hash of a key
+         * @param row The row of the sketch
+         * @return the index of the key's counter in that row
+         */
+        uint64_t index(uint64_t hash, uint64_t row) const;
+
+        /// The number of rows
+        const static uint64_t depth = 4;
+
+        /// The largest value a counter may reach
+        const static uint8_t max_count = 15;
+
+        /// The counters, one row after another
+        std::vector<uint8_t> counters_;
+
+        /// The number of counters in each row, minus one
+        uint64_t mask_;
+
+        /// The number of increments since the counters were last halved
+        uint64_t additions_;
+
+        /// The number of increments after which the counters are halved
+        uint64_t sample_size_;
+    };
+
+    /**
+     * One entry in a stripe's clock.
+     */
+    struct slot
+    {
+        /// the key
+        Key key;
+        /// the value
+        Value value;
+        /// the number of bytes charged for this entry
+        uint64_t bytes;
+        /// whether the entry has been used since the hand last passed it
+        bool referenced;
+        /// whether the slot currently holds an entry
+        bool live;
+    };
+
+    /**
+     * One independently locked segment of the cache.
+     */
+    struct stripe
+    {
+        /**
+         * @param sketch_width The width of the stripe's frequency sketch
+         */
+        stripe(uint64_t sketch_width) : sketch{sketch_width}
+        {
+            // nothing
+        }
+
+        /// the mutex that synchronizes access to this stripe
+        mutable std::mutex mutex;
+        /// the location of each key in slots
+        std::unordered_map<Key, uint64_t> positions;
+        /// the entries, in clock order
+        std::vector<slot> slots;
+        /// the positions of slots that hold no entry
+        std::vector<uint64_t> free;
+        /// the position of the clock hand in slots
+        uint64_t hand = 0;
+        /// the number of bytes charged to this stripe
+        uint64_t bytes = 0;
+        /// the request frequencies of this stripe's keys
+        frequency_sketch sketch;
+    };
+
+    /**
+     * Creates the stripes.
+     * @param max_bytes The total budget
+     * @param stripes The number of stripes
+     */
+    void init(uint64_t max_bytes, uint64_t stripes);
+
+    /**
+     * @param key The key to hash
+     * @return the (well mixed) hash of the key
+     */
+    uint64_t hash(const Key& key) const;
+
+    /**
+     * Removes the entry in a slot.
+     * @param s The stripe holding the slot
+     * @param pos The position of the slot
+     */
+    void evict(stripe& s, uint64_t pos);
+
+    /// the budget of each stripe, in bytes
+    uint64_t stripe_bytes_;
+
+    /// the stripes; allocated separately so their locks do not share
+    /// cache lines
+    std::vector<std::unique_ptr<stripe>> stripes_;
+
+    /// the hash function for keys
+    std::hash<Key> hasher_;
+};
+}
+}
+
+#include "caching/tinylfu_cache.tcc"
+#endif
@@ -0,0 +1,271 @@
+/**
+ * @file tinylfu_cache.tcc
+ */
+
+#include <algorithm>
+
+#include "cpptoml.h"
+#include "caching/tinylfu_cache.h"
+#include "util/shim.h"
+
+namespace meta
+{
+namespace caching
+{
+
+template <class Key, class Value>
+tinylfu_cache<Key, Value>::frequency_sketch::frequency_sketch(uint64_t width)
+    : mask_{1}, additions_{0}
+{
+    while (mask_ < width)
+        mask_ <<= 1;
+    counters_.resize(depth * mask_, 0);
+    sample_size_ = 10 * mask_;
+    --mask_;
+}
+
+template <class Key, class Value>
+void tinylfu_cache<Key, Value>::frequency_sketch::increment(uint64_t hash)
+{
+    // only raise the smallest counters (conservative update), which keeps
+    // collisions from inflating the estimates of rare keys
+    auto count = frequency(hash);
+    if (count == max_count)
+        return;
+
+    for (uint64_t row = 0; row < depth; ++row)
+    {
+        auto& counter = counters_[index(hash, row)];
+        if (counter == count)
+            ++counter;
+    }
+
+    // halve every counter once in a while, so the sketch forgets keys
+    // that used to be popular
+    if (++additions_ == sample_size_)
+    {
+        for (auto& counter : counters_)
+            counter >>= 1;
+        additions_ /= 2;
+    }
+}
+
+template <class Key, class Value>
+uint8_t
+    tinylfu_cache<Key, Value>::frequency_sketch::frequency(uint64_t hash) const
+{
+    uint8_t count = max_count;
+    for (uint64_t row = 0; row < depth; ++row)
+        count = std::min(count, counters_[index(hash, row)]);
+    return count;
+}
+
+template <class Key, class Value>
+uint64_t tinylfu_cache<Key, Value>::frequency_sketch::index(uint64_t hash,
+                                                           uint64_t row) const
+{
+    // derive each row's hash from the one hash by multiplying with a
+    // different odd constant and keeping the high bits
+    const static uint64_t seeds[] = {0x9e3779b97f4a7c15ULL,
+                                     0xc2b2ae3d27d4eb4fULL,
+                                     0x165667b19e3779f9ULL,
+                                     0xd6e8feb86659fd93ULL};
+    return row * (mask_ + 1) + (((hash * seeds[row]) >> 32) & mask_);
+}
+
+template <class Key, class Value>
+tinylfu_cache<Key, Value>::tinylfu_cache(uint64_t max_bytes, uint64_t stripes)
+{
+    init(max_bytes, stripes);
+}
+
+template <class Key, class Value>
+tinylfu_cache<Key, Value>::tinylfu_cache(const cpptoml::table& config)
+{
+    uint64_t max_bytes = default_bytes;
+    if (auto group = config.get_table("cache"))
+    {
+        if (auto budget = group->get_as<int64_t>("ram-budget"))
+            max_bytes = static_cast<uint64_t>(*budget) * 1024 * 1024;
+    }
+    init(max_bytes, default_stripes);
+}
+
+template <class Key, class Value>
+void tinylfu_cache<Key, Value>::init(uint64_t max_bytes, uint64_t stripes)
+{
+    stripes = std::max<uint64_t>(1, stripes);
+    stripe_bytes_ = max_bytes / stripes;
+
+    // size each sketch for roughly as many keys as the stripe could hold
+    // if its values averaged 1KB
+    auto sketch_width = std::min<uint64_t>(
+        std::max<uint64_t>(stripe_bytes_ / 1024, 256), uint64_t{1} << 20);
+    for (uint64_t i = 0; i < stripes; ++i)
+        stripes_.emplace_back(make_unique<stripe>(sketch_width));
+}
+
+template <class Key, class Value>
+void tinylfu_cache<Key, Value>::insert(const Key& key, const Value& value)
+{
+    auto h = hash(key);
+    auto& s = *stripes_[h % stripes_.size()];
+
+    // charge for the bookkeeping as well: the slot and a hash table node
+    auto size = bytes_used(value) + sizeof(slot) + sizeof(Key)
+                + sizeof(uint64_t) + 2 * sizeof(void*);
+    if (size > stripe_bytes_)
+        return;
+
+    std::lock_guard<std::mutex> lock{s.mutex};
+    auto it = s.positions.find(key);
+    util::optional<uint64_t> existing;
+    if (it != s.positions.end())
+        existing = it->second;
+
+    // pick victims with the clock hand; two sweeps are enough, since the
+    // first clears every reference bit
+    std::vector<uint64_t> victims;
+    uint64_t freed = 0;
+    auto needed = s.bytes + size - (existing ? s.slots[*existing].bytes : 0);
+    auto freq = s.sketch.frequency(h);
+    for (uint64_t steps = 0;
+         needed > stripe_bytes_ + freed && steps < 2 * s.slots.size(); ++steps)
+    {
+        auto pos = s.hand;
+        s.hand = (s.hand + 1) % s.slots.size();
+        auto& e = s.slots[pos];
+        if (!e.live || (existing && pos == *existing))
+            continue;
+        if (e.referenced)
+        {
+            e.referenced = false;
+            continue;
+        }
+
+        // a new key must be more popular than everything it displaces
+        if (!existing && s.sketch.frequency(hash(e.key)) >= freq)
+            break;
+
+        e.live = false;
+        victims.push_back(pos);
+        freed += e.bytes;
+    }
+
+    if (needed > stripe_bytes_ + freed)
+    {
+        // rejected: put back the victims we had picked, and leave a
+        // present key with the value it had
+        for (const auto& pos : victims)
+            s.slots[pos].live = true;
+        return;
+    }
+
+    for (const auto& pos : victims)
+        evict(s, pos);
+
+    if (existing)
+    {
+        auto& e = s.slots[*existing];
+        s.bytes -= e.bytes;
+        e.value = value;
+        e.bytes = size;
+        s.bytes += size;
+        return;
+    }
+
+    // new entries start unreferenced, so a key that is never looked up
+    // again is the first to go when the hand comes around
+    uint64_t pos = s.slots.size();
+    if (!s.free.empty())
+    {
+        pos = s.free.back();
+        s.free.pop_back();
+        s.slots[pos] = {key, value, size, false, true};
+    }
+    else
+    {
+        s.slots.push_back({key, value, size, false, true});
+    }
+    s.positions.emplace(key, pos);
+    s.bytes += size;
+}
+
+template <class Key, class Value>
+util::optional<Value> tinylfu_cache<Key, Value>::find(const Key& key)
+{
+    auto h = hash(key);
+    auto& s = *stripes_[h % stripes_.size()];
+    std::lock_guard<std::mutex> lock{s.mutex};
+
+    s.sketch.increment(h);
+    auto it = s.positions.find(key);
+    if (it == s.positions.end())
+        return util::nullopt;
+
+    auto& entry = s.slots[it->second];
+    entry.referenced = true;
+    return entry.value;
+}
+
+template <class Key, class Value>
+uint64_t tinylfu_cache<Key, Value>::size() const
+{
+    uint64_t size = 0;
+    for (const auto& s : stripes_)
+    {
+        std::lock_guard<std::mutex> lock{s->mutex};
+        size += s->positions.size();
+    }
+    return size;
+}
+
+template <class Key, class Value>
+uint64_t tinylfu_cache<Key, Value>::bytes() const
+{
+    uint64_t bytes = 0;
+    for (const auto& s : stripes_)
+    {
+        std::lock_guard<std::mutex> lock{s->mutex};
+        bytes += s->bytes;
+    }
+    return bytes;
+}
+
+template <class Key, class Value>
+void tinylfu_cache<Key, Value>::clear()
+{
+    for (auto& s : stripes_)
+    {
+        std::lock_guard<std::mutex> lock{s->mutex};
+        s->positions.clear();
+        s->slots.clear();
+        s->free.clear();
+        s->hand = 0;
+        s->bytes = 0;
+    }
+}
+
+template <class Key, class Value>
+uint64_t tinylfu_cache<Key, Value>::hash(const Key& key) const
+{
+    // identifiers often hash to themselves, so mix the bits
+    uint64_t hash = hasher_(key);
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+template <class Key, class Value>
+void tinylfu_cache<Key, Value>::evict(stripe& s, uint64_t pos)
+{
+    auto& e = s.slots[pos];
+    s.positions.erase(e.key);
+    s.bytes -= e.bytes;
+    e.value = Value{};
+    e.live = false;
+    s.free.push_back(pos);
+}
+}
+}
@@ -73,6 +73,14 @@ class classifier
     virtual void reset() = 0;
 
   protected:
+    /**
+     * Training loops call this so that documents deleted from the index
+     * are skipped.
+     * @param docs A list of documents
+     * @return the documents in the list that have not been deleted
+     */
+    std::vector<doc_id> live_docs(const std::vector<doc_id>& docs) const;
+
     /** the index that the classifer is run on */
     std::shared_ptr<index::forward_index> idx_;
 
@@ -12,6 +12,7 @@
 #include <unordered_set>
 #include "index/inverted_index.h"
 #include "index/forward_index.h"
+#include "index/ranker/doc_filter.h"
 #include "index/ranker/ranker.h"
 #include "classify/classifier_factory.h"
 #include "classify/classifier/classifier.h"
@@ -84,7 +85,10 @@ class knn : public classifier
     std::unique_ptr<index::ranker> ranker_;
 
     /** documents that are "legal" to be used in the results */
-    std::unordered_set<doc_id> legal_docs_;
+    std::vector<doc_id> legal_docs_;
+
+    /** restricts searches to legal_docs_ */
+    index::doc_filter filter_;
 
     /** Whether we want the neighbors to be weighted by distance or not */
     const bool weighted_;
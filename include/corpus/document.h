@@ -12,6 +12,7 @@
 
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 #include "meta.h"
 #include "util/optional.h"
@@ -85,6 +86,28 @@ class document
      */
     const std::unordered_map<std::string, double>& counts() const;
 
+    /**
+     * Sets whether the positions of terms are kept when an analyzer
+     * reports them with add_position(). They are not kept by default.
+     * @param record Whether to keep positions
+     */
+    void record_positions(bool record);
+
+    /**
+     * Notes an occurrence of a term at a position in the document, if
+     * positions are being recorded.
+     * @param term The term that occurred
+     * @param position The index of the token the term starts at
+     */
+    void add_position(const std::string& term, uint64_t position);
+
+    /**
+     * @return the positions recorded for each term, in the order they
+     * were added
+     */
+    const std::unordered_map<std::string, std::vector<uint64_t>>&
+        positions() const;
+
     /**
      * Sets the content of the document to be the parameter
      * @param content The string content to assign into this document
@@ -147,6 +170,12 @@ class document
     /// Counts of how many times each token appears
     std::unordered_map<std::string, double> counts_;
 
+    /// Whether add_position() keeps positions
+    bool record_positions_;
+
+    /// The positions at which each token appears, if recorded
+    std::unordered_map<std::string, std::vector<uint64_t>> positions_;
+
     /// What the document contains
     util::optional<std::string> content_;
 
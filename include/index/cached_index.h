@@ -11,6 +11,7 @@
 #define META_CACHED_INDEX_H_
 
 #include <memory>
+#include <type_traits>
 
 namespace cpptoml
 {
@@ -46,6 +47,16 @@ class cached_index : public Index
     template <class... Args>
     cached_index(cpptoml::table& config, Args&&... args);
 
+    /**
+     * Constructs the Index part using the config. Caches that can be
+     * constructed from the config (such as tinylfu_cache, which reads its
+     * budget from it) are; others are default constructed.
+     *
+     * @param config the configuration that specifies how the index (and
+     *  possibly the cache) should be constructed
+     */
+    cached_index(cpptoml::table& config);
+
     using primary_key_type = typename Index::primary_key_type;
     using secondary_key_type = typename Index::secondary_key_type;
     using postings_data_type = typename Index::postings_data_type;
@@ -68,10 +79,26 @@ class cached_index : public Index
     void clear_cache();
 
   private:
+    /// the type of the internal cache
+    using cache_type
+        = Cache<primary_key_type, std::shared_ptr<postings_data_type>>;
+
+    /**
+     * Constructs the cache from the config.
+     * @param config the configuration for the index and the cache
+     */
+    cached_index(cpptoml::table& config, std::true_type);
+
+    /**
+     * Default constructs the cache.
+     * @param config the configuration for the index
+     */
+    cached_index(cpptoml::table& config, std::false_type);
+
     /**
      * The internal cache object.
      */
-    mutable Cache<primary_key_type, std::shared_ptr<postings_data_type>> cache_;
+    mutable cache_type cache_;
 };
 }
 }
@@ -18,6 +18,30 @@ cached_index<Index, Cache>::cached_index(cpptoml::table& config, Args&&... args)
     /* nothing */
 }
 
+template <class Index, template <class, class> class Cache>
+cached_index<Index, Cache>::cached_index(cpptoml::table& config)
+    : cached_index{config, typename std::is_constructible<
+                               cache_type, const cpptoml::table&>::type{}}
+{
+    /* nothing */
+}
+
+template <class Index, template <class, class> class Cache>
+cached_index<Index, Cache>::cached_index(cpptoml::table& config,
+                                         std::true_type)
+    : Index{config}, cache_(static_cast<const cpptoml::table&>(config))
+{
+    /* nothing */
+}
+
+template <class Index, template <class, class> class Cache>
+cached_index<Index, Cache>::cached_index(cpptoml::table& config,
+                                         std::false_type)
+    : Index{config}, cache_()
+{
+    /* nothing */
+}
+
 template <class Index, template <class, class> class Cache>
 auto cached_index<Index, Cache>::search_primary(
     primary_key_type p_id) const -> std::shared_ptr<postings_data_type>
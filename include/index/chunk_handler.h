@@ -15,11 +15,12 @@
 #include <mutex>
 #include <queue>
 #include <stdexcept>
-#include <unordered_set>
 #include <utility>
 #include <vector>
 
 #include "index/chunk.h"
+#include "index/postings_accumulator.h"
+#include "index/postings_data.h"
 #include "util/optional.h"
 
 namespace meta
@@ -38,7 +39,11 @@ class chunk_handler
     using index_pdata_type = typename Index::index_pdata_type;
     using primary_key_type = typename index_pdata_type::primary_key_type;
     using secondary_key_type = typename index_pdata_type::secondary_key_type;
+    using feature_value_type = typename index_pdata_type::feature_value_type;
     using chunk_t = chunk<primary_key_type, secondary_key_type>;
+    using accumulator_type = postings_accumulator<primary_key_type,
+                                                  secondary_key_type,
+                                                  feature_value_type>;
 
     /**
      * The object that is fed postings_data by the index.
@@ -52,11 +57,18 @@ class chunk_handler
          */
         producer(chunk_handler* parent);
 
+        /**
+         * Move constructor.
+         */
+        producer(producer&&) = default;
+
         /**
          * Handler for when a given secondary_key has been processed and is
          * ready to be added to the in-memory chunk.
          * @param key The secondary key used to index the counts container
          * @param counts A collection of (primary_key_type, count) pairs
+         * @throw chunk_handler_exception if feature_value_type is integral
+         * and a count is not a positive integer that fits in it
          */
         template <class Container>
         void operator()(const secondary_key_type& key, const Container& counts);
@@ -73,24 +85,40 @@ class chunk_handler
          */
         void flush_chunk();
 
-        /// Current in-memory chunk
-        std::unordered_set<index_pdata_type> pdata_;
-
-        /// Current size of the in-memory chunk
-        uint64_t chunk_size_;
+        /**
+         * @param key The secondary key the count belongs to
+         * @param count A count produced by an analyzer
+         * @return the count as a feature_value_type
+         * @throw chunk_handler_exception if it can't be stored exactly
+         */
+        template <class Count>
+        static feature_value_type checked_count(const secondary_key_type& key,
+                                                Count count);
 
-        /// Maximum allowed size of a chunk in bytes before it is written
-        const static uint64_t constexpr max_size = 1024 * 1024 * 128; // 128 MB
+        /// Current in-memory chunk
+        accumulator_type postings_;
 
         /// Back-pointer to the handler this producer is operating on
         chunk_handler* parent_;
     };
 
+    /// The default maximum number of chunks merged at once
+    const static uint64_t constexpr default_fan_in = 32;
+
+    /// The default memory budget of each producer, in bytes
+    const static uint64_t constexpr default_ram_budget
+        = 1024 * 1024 * 128; // 128 MB
+
     /**
      * Constructs a chunk_handler that writes to the given prefix.
      * @param prefix The prefix for all chunks to be written
+     * @param fan_in The maximum number of chunks to merge at once (at
+     * least 2)
+     * @param ram_budget The number of bytes each producer may buffer
+     * before writing a chunk
      */
-    chunk_handler(const std::string& prefix);
+    chunk_handler(const std::string& prefix, uint64_t fan_in = default_fan_in,
+                  uint64_t ram_budget = default_ram_budget);
 
     /**
      * Creates a producer for this chunk_handler. Producers are designed to
@@ -106,15 +134,18 @@ class chunk_handler
     uint32_t size() const;
 
     /**
-     * @return the size, in bytes, of the last chunk written to disk after
-     * merging.
+     * Merges the on-disk chunks with a k-way heap merge, handing each
+     * merged postings_data to the sink in primary key order so it can be
+     * written straight into its final format.
+     *
+     * Chunks are read in a single streaming pass when there are at most
+     * fan_in of them. Otherwise, groups of the smallest chunks are first
+     * merged in parallel into larger ones until few enough remain.
+     *
+     * @param sink A callable taking an index_pdata_type&
      */
-    uint64_t final_size() const;
-
-    /**
-     * Merge the remaining on-disk chunks.
-     */
-    void merge_chunks();
+    template <class Sink>
+    void merge_chunks(Sink&& sink);
 
     /**
      * @return the number of unique primary keys seen while merging chunks.
@@ -131,10 +162,27 @@ class chunk_handler
 
   private:
     /**
-     * @param pdata The collection of postings_data objects to combine into a
-     * chunk
+     * Writes a producer's buffered postings to a new chunk, emptying the
+     * buffer.
+     * @param postings The postings to write
+     */
+    void write_chunk(accumulator_type& postings);
+
+    /**
+     * Merges chunks until at most fan_in_ of them remain.
      */
-    void write_chunk(std::vector<index_pdata_type>& pdata);
+    void reduce_chunks();
+
+    /**
+     * Merges a group of chunks in one pass, deleting them afterwards.
+     * @param group The chunks to merge
+     * @param sink A callable taking an index_pdata_type&
+     * @param progress Called with the number of bytes read so far
+     * @return the number of unique primary keys in the group
+     */
+    template <class Sink, class Progress>
+    uint64_t merge_group(const std::vector<chunk_t>& group, Sink&& sink,
+                         Progress&& progress);
 
     /// The prefix for all chunks to be written
     std::string prefix_;
@@ -142,6 +190,12 @@ class chunk_handler
     /// The current chunk number
     std::atomic<uint32_t> chunk_num_{0};
 
+    /// The maximum number of chunks to merge at once
+    const uint64_t fan_in_;
+
+    /// The number of bytes each producer may buffer
+    const uint64_t ram_budget_;
+
     /// Queue of chunks on disk that need to be merged */
     std::priority_queue<chunk_t> chunks_;
 
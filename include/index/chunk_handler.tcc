@@ -4,10 +4,20 @@
  */
 
 #include <algorithm>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <string>
 
 #include "index/chunk_handler.h"
 #include "index/disk_index.h"
+#include "io/compressed_file_reader.h"
+#include "io/compressed_file_writer.h"
 #include "parallel/thread_pool.h"
+#include "util/filesystem.h"
+#include "util/progress.h"
+#include "util/shim.h"
+#include "util/time.h"
 
 namespace meta
 {
@@ -16,7 +26,7 @@ namespace index
 
 template <class Index>
 chunk_handler<Index>::producer::producer(chunk_handler* parent)
-    : chunk_size_{0}, parent_{parent}
+    : parent_{parent}
 {
     // nothing
 }
@@ -27,44 +37,38 @@ void chunk_handler<Index>::producer::operator()(const secondary_key_type& key,
                                                 const Container& counts)
 {
     for (const auto& count : counts)
-    {
-        index_pdata_type pd{count.first};
-        pd.increase_count(key, count.second);
-        auto it = pdata_.find(pd);
-        if (it == pdata_.end())
-        {
-            chunk_size_ += pd.bytes_used();
-            pdata_.emplace(pd);
-        }
-        else
-        {
-            chunk_size_ -= it->bytes_used();
+        postings_.add(count.first, key, checked_count(key, count.second));
 
-            // note: we can modify elements in this set because we do not change
-            // how comparisons are made (the primary_key value)
-            const_cast<index_pdata_type&>(*it).increase_count(key,
-                                                              count.second);
-            chunk_size_ += it->bytes_used();
-        }
+    if (postings_.bytes_used() >= parent_->ram_budget_)
+        flush_chunk();
+}
 
-        if (chunk_size_ >= max_size)
-            flush_chunk();
+template <class Index>
+template <class Count>
+auto chunk_handler<Index>::producer::checked_count(
+    const secondary_key_type& key, Count count) -> feature_value_type
+{
+    // integral counts are term frequencies; truncating a fractional
+    // feature value (or wrapping a negative one) would silently change it
+    using limits = std::numeric_limits<feature_value_type>;
+    if (limits::is_integer
+        && !(count >= 1 && count <= limits::max()
+             && count == std::floor(count)))
+    {
+        throw chunk_handler_exception{
+            "count " + std::to_string(count) + " in document "
+            + std::to_string(static_cast<uint64_t>(key))
+            + " is not a positive integer; fractional feature values "
+              "can only be stored in a forward_index"};
     }
+    return static_cast<feature_value_type>(count);
 }
 
 template <class Index>
 void chunk_handler<Index>::producer::flush_chunk()
 {
-    if (chunk_size_ == 0)
-        return;
-
-    std::vector<index_pdata_type> pdata;
-    for (auto it = pdata_.begin(); it != pdata_.end(); it = pdata_.erase(it))
-        pdata.emplace_back(std::move(*it));
-    pdata_.clear();
-    std::sort(pdata.begin(), pdata.end());
-    parent_->write_chunk(pdata);
-    chunk_size_ = 0;
+    if (!postings_.empty())
+        parent_->write_chunk(postings_);
 }
 
 template <class Index>
@@ -74,10 +78,12 @@ chunk_handler<Index>::producer::~producer()
 }
 
 template <class Index>
-chunk_handler<Index>::chunk_handler(const std::string& prefix)
-    : prefix_{prefix}
+chunk_handler<Index>::chunk_handler(const std::string& prefix, uint64_t fan_in,
+                                    uint64_t ram_budget)
+    : prefix_{prefix}, fan_in_{fan_in}, ram_budget_{ram_budget}
 {
-    // nothing
+    if (fan_in_ < 2)
+        throw chunk_handler_exception{"merge fan-in must be at least 2"};
 }
 
 template <class Index>
@@ -87,102 +93,212 @@ auto chunk_handler<Index>::make_producer() -> producer
 }
 
 template <class Index>
-void chunk_handler<Index>::write_chunk(std::vector<index_pdata_type>& pdata)
+void chunk_handler<Index>::write_chunk(accumulator_type& postings)
 {
-    auto chunk_num = chunk_num_.fetch_add(1);
-
-    util::optional<chunk_t> top;
-    {
-        std::lock_guard<std::mutex> lock{mutables_};
-        if (!chunks_.empty())
-        {
-            top = chunks_.top();
-            chunks_.pop();
-        }
-    }
-
-    if (!top) // pqueue was empty
+    std::string chunk_name = prefix_ + "/chunk-"
+                             + std::to_string(chunk_num_.fetch_add(1));
     {
-        std::string chunk_name = prefix_ + "/chunk-"
-                                 + std::to_string(chunk_num);
         io::compressed_file_writer outfile{chunk_name,
                                            io::default_compression_writer_func};
-        for (auto& p : pdata)
-            outfile << p;
+        postings.drain([&](const index_pdata_type& pdata)
+                       {
+                           outfile << pdata;
+                       });
+    }
+
+    std::lock_guard<std::mutex> lock{mutables_};
+    chunks_.emplace(chunk_name);
+}
+
+template <class Index>
+template <class Sink>
+void chunk_handler<Index>::merge_chunks(Sink&& sink)
+{
+    if (chunks_.empty())
+        throw chunk_handler_exception{"there were no chunks to merge"};
 
-        outfile.close(); // close so we can read the file size in chunk ctr
-        std::ofstream termfile{chunk_name + ".numterms"};
-        termfile << pdata.size();
-        pdata.clear();
+    reduce_chunks();
 
-        std::lock_guard<std::mutex> lock{mutables_};
-        chunks_.emplace(chunk_name);
+    std::vector<chunk_t> group;
+    uint64_t total_bytes = 0;
+    for (; !chunks_.empty(); chunks_.pop())
+    {
+        group.push_back(chunks_.top());
+        total_bytes += group.back().size();
     }
-    else // we can merge with an existing chunk
+
+    uint64_t unique_keys = 0;
+    auto elapsed = common::time([&]()
     {
-        top->memory_merge_with(pdata);
+        printing::progress progress{
+            " > Merging " + std::to_string(group.size()) + " chunks: ",
+            total_bytes, 500, 1024 * 1024 /* 1MB */};
+        unique_keys = merge_group(group, sink, progress);
+    });
 
-        std::lock_guard<std::mutex> lock{mutables_};
-        chunks_.emplace(*top);
-    }
+    auto seconds = std::max<int64_t>(elapsed.count(), 1) / 1000.0;
+    LOG(info) << "Merged " << group.size() << " chunks ("
+              << printing::bytes_to_units(total_bytes) << ") in " << seconds
+              << "s (" << printing::bytes_to_units(total_bytes / seconds)
+              << "/s)" << ENDLG;
+
+    unique_primary_keys_ = unique_keys;
 }
 
 template <class Index>
-void chunk_handler<Index>::merge_chunks()
+void chunk_handler<Index>::reduce_chunks()
 {
-    size_t remaining = chunks_.size() - 1;
-    std::mutex mutex;
-    auto task = [&]()
+    if (chunks_.size() <= fan_in_)
+        return;
+
+    parallel::thread_pool pool;
+    while (chunks_.size() > fan_in_)
     {
-        while (true)
+        // merging k chunks removes k - 1 of them, so only merge as many of
+        // the smallest chunks as it takes to leave fan_in_ behind (or as
+        // many full groups as there are chunks for, if that takes more
+        // than one round); dealing them out round-robin keeps the groups'
+        // sizes balanced
+        auto excess = chunks_.size() - fan_in_;
+        auto num_groups = (excess + fan_in_ - 2) / (fan_in_ - 1);
+        auto num_merged = excess + num_groups;
+        if (num_merged > chunks_.size())
         {
-            util::optional<chunk_t> first;
-            util::optional<chunk_t> second;
-            {
-                std::lock_guard<std::mutex> lock{mutables_};
-                if (chunks_.size() < 2)
-                    return;
-                first = chunks_.top();
-                chunks_.pop();
-                second = chunks_.top();
-                chunks_.pop();
-                LOG(progress) << "> Merging " << first->path() << " ("
-                              << printing::bytes_to_units(first->size())
-                              << ") and " << second->path() << " ("
-                              << printing::bytes_to_units(second->size())
-                              << "), " << --remaining << " remaining        \r"
-                              << ENDLG;
-            }
-            first->merge_with(*second);
+            num_groups = chunks_.size() / fan_in_;
+            num_merged = num_groups * fan_in_;
+        }
+
+        std::vector<std::vector<chunk_t>> groups(num_groups);
+        uint64_t round_bytes = 0;
+        for (uint64_t i = 0; i < num_merged; ++i)
+        {
+            round_bytes += chunks_.top().size();
+            groups[i % num_groups].push_back(chunks_.top());
+            chunks_.pop();
+        }
+
+        std::vector<std::future<std::string>> futures;
+        auto elapsed = common::time([&]()
+        {
+            for (const auto& group : groups)
             {
-                std::lock_guard<std::mutex> lock{mutex};
-                chunks_.push(*first);
+                futures.emplace_back(pool.submit_task([&]()
+                {
+                    std::string chunk_name
+                        = prefix_ + "/chunk-"
+                          + std::to_string(chunk_num_.fetch_add(1));
+                    io::compressed_file_writer outfile{
+                        chunk_name, io::default_compression_writer_func};
+                    merge_group(group, [&](const index_pdata_type& pdata)
+                                {
+                                    outfile << pdata;
+                                },
+                                [](uint64_t) {});
+                    return chunk_name;
+                }));
             }
+
+            for (auto& fut : futures)
+                chunks_.emplace(fut.get());
+        });
+
+        auto seconds = std::max<int64_t>(elapsed.count(), 1) / 1000.0;
+        LOG(progress) << "> Merged " << num_merged << " chunks into "
+                      << num_groups << " ("
+                      << printing::bytes_to_units(round_bytes / seconds)
+                      << "/s), " << chunks_.size() << " remaining\n"
+                      << ENDLG;
+    }
+}
+
+template <class Index>
+template <class Sink, class Progress>
+uint64_t chunk_handler<Index>::merge_group(const std::vector<chunk_t>& group,
+                                           Sink&& sink, Progress&& progress)
+{
+    /// The next postings_data from one chunk
+    struct input
+    {
+        // chunks are read front to back exactly once
+        input(const std::string& path)
+            : reader{path, io::default_compression_reader_func,
+                     io::access_policy::sequential}
+        {
+            reader >> pdata;
         }
+
+        io::compressed_file_reader reader;
+        index_pdata_type pdata;
     };
 
-    parallel::thread_pool pool;
-    auto thread_ids = pool.thread_ids();
-    std::vector<std::future<void>> futures;
-    for (size_t i = 0; i < thread_ids.size(); ++i)
-        futures.emplace_back(pool.submit_task(task));
+    std::vector<std::unique_ptr<input>> inputs;
+    for (const auto& chunk : group)
+        inputs.emplace_back(make_unique<input>(chunk.path()));
 
-    for (auto& fut : futures)
-        fut.get();
+    // a min-heap of the inputs, ordered by their current primary key
+    auto greater = [&](std::size_t a, std::size_t b)
+    {
+        return inputs[b]->pdata.primary_key() < inputs[a]->pdata.primary_key();
+    };
+    std::priority_queue<std::size_t, std::vector<std::size_t>,
+                        decltype(greater)> heap{greater};
+    for (std::size_t i = 0; i < inputs.size(); ++i)
+    {
+        if (inputs[i]->reader)
+            heap.push(i);
+    }
 
-    LOG(progress) << '\n' << ENDLG;
+    uint64_t bits_read = 0;
+    auto advance = [&](std::size_t i)
+    {
+        auto& in = *inputs[i];
+        auto start = in.reader.bit_location();
+        in.reader >> in.pdata;
+        bits_read += in.reader.bit_location() - start;
+        progress(bits_read / 8);
+        if (in.reader)
+            heap.push(i);
+    };
 
-    if (chunks_.empty())
-        throw chunk_handler_exception{"there were no chunks to merge"};
+    uint64_t unique_keys = 0;
+    typename index_pdata_type::count_t counts;
+    while (!heap.empty())
+    {
+        auto first = heap.top();
+        heap.pop();
+        auto merged = std::move(inputs[first]->pdata);
+        advance(first);
 
-    uint64_t unique_keys;
-    std::ifstream termfile{chunks_.top().path() + ".numterms"};
-    termfile >> unique_keys;
-    termfile.close();
-    filesystem::delete_file(chunks_.top().path() + ".numterms");
-    filesystem::rename_file(chunks_.top().path(), prefix_ + "/postings.index");
+        // every secondary key was written to exactly one chunk, so the
+        // counts for a primary key can simply be gathered and sorted once
+        // instead of being merged pairwise
+        if (!heap.empty()
+            && inputs[heap.top()]->pdata.primary_key() == merged.primary_key())
+        {
+            counts = merged.counts();
+            while (!heap.empty()
+                   && inputs[heap.top()]->pdata.primary_key()
+                          == merged.primary_key())
+            {
+                auto next = heap.top();
+                heap.pop();
+                const auto& more = inputs[next]->pdata.counts();
+                counts.insert(counts.end(), more.begin(), more.end());
+                advance(next);
+            }
+            merged.set_counts(counts);
+        }
 
-    unique_primary_keys_ = unique_keys;
+        sink(merged);
+        ++unique_keys;
+    }
+
+    for (auto& in : inputs)
+        in->reader.close();
+    for (const auto& chunk : group)
+        filesystem::delete_file(chunk.path());
+
+    return unique_keys;
 }
 
 template <class Index>
@@ -194,15 +310,6 @@ uint64_t chunk_handler<Index>::unique_primary_keys() const
     return *unique_primary_keys_;
 }
 
-template <class Index>
-uint64_t chunk_handler<Index>::final_size() const
-{
-    if (chunks_.size() != 1)
-        throw chunk_handler_exception{
-            "merge not complete before final_size() called"};
-    return chunks_.top().size();
-}
-
 template <class Index>
 uint32_t chunk_handler<Index>::size() const
 {
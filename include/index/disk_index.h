@@ -27,7 +27,7 @@ namespace meta
 namespace index
 {
 class string_list;
-class vocabulary_map;
+class term_dictionary;
 }
 
 namespace tokenizers
@@ -66,7 +66,8 @@ class disk_index
     std::string index_name() const;
 
     /**
-     * @return the number of documents in this index
+     * @return the number of documents in this index, including any that
+     * have been deleted (doc_ids range from 0 to num_docs() - 1)
      */
     uint64_t num_docs() const;
 
@@ -83,10 +84,46 @@ class disk_index
     std::string doc_path(doc_id d_id) const;
 
     /**
-     * @return a vector of doc_ids that are contained in this index
+     * @return a vector of the doc_ids of the documents in this index that
+     * have not been deleted
      */
     std::vector<doc_id> docs() const;
 
+    /**
+     * Deletes a document from the index. Deletion only sets a bit in a
+     * memory-mapped bitset that is saved with the index; the document's
+     * postings stay on disk (and in the collection statistics) until the
+     * index is rebuilt or merged. A query running at the same time may or
+     * may not see the deletion.
+     * @param d_id The document to delete
+     */
+    void remove_doc(doc_id d_id);
+
+    /**
+     * @param d_id The document to check
+     * @return whether the document has not been deleted
+     */
+    bool is_live(doc_id d_id) const;
+
+    /**
+     * @return the number of deleted documents
+     */
+    uint64_t num_deleted() const;
+
+    /**
+     * @return a number that identifies this index object for the rest of
+     * the process. An index rebuilt, reordered or merged under the same
+     * name is a new object with a new generation, so data derived from
+     * the old one is never mistaken for its own.
+     */
+    uint64_t generation() const;
+
+    /**
+     * @return a handle that expires when this index object is destroyed,
+     * so that data derived from it can be dropped
+     */
+    std::weak_ptr<const void> lifetime() const;
+
     /**
      * @param d_id The document to search for
      * @return the size of the given document (the total number of terms
@@ -10,11 +10,14 @@
 #ifndef META_INDEX_DISK_INDEX_IMPL_H_
 #define META_INDEX_DISK_INDEX_IMPL_H_
 
+#include <atomic>
 #include <mutex>
 
 #include "index/disk_index.h"
 #include "index/string_list.h"
-#include "index/vocabulary_map.h"
+#include "index/term_dictionary.h"
+#include "io/access_policy.h"
+#include "io/mmap_file.h"
 #include "util/disk_vector.h"
 #include "util/invertible_map.h"
 #include "util/optional.h"
@@ -39,7 +42,9 @@ enum index_file
     LABEL_IDS_MAPPING,
     POSTINGS,
     TERM_IDS_MAPPING,
-    TERM_IDS_MAPPING_INVERSE
+    TERM_IDS_MAPPING_INVERSE,
+    DOC_DELETED,
+    TERM_IDS_HASH
 };
 
 /**
@@ -56,6 +61,36 @@ class disk_index::disk_index_impl
      */
     const static std::vector<const char*> files;
 
+    /**
+     * Reads how index files should be memory-mapped from the
+     * configuration's [mmap] group, if there is one.
+     * @param config The configuration to read
+     */
+    void load_access_policies(const cpptoml::table& config);
+
+    /**
+     * Maps a postings file with the configured access policy.
+     * @param path The file to map
+     * @return the mapped file
+     */
+    io::mmap_file map_postings(const std::string& path) const;
+
+    /**
+     * Maps one of the small tables read for every query, such as the
+     * document lengths or term locations, with the configured access
+     * policy.
+     * @param path The file to map
+     * @param size The number of elements in the table, or 0 if it
+     * already exists
+     * @return the mapped table
+     */
+    template <class T>
+    util::disk_vector<T> map_table(const std::string& path,
+                                   uint64_t size = 0) const
+    {
+        return {path, size, metadata_policy_, huge_pages_};
+    }
+
     /**
      * Initializes the following metadata maps:
      * doc_sizes_, labels_, unique_terms_
@@ -81,6 +116,15 @@ class disk_index::disk_index_impl
      */
     void load_unique_terms(uint64_t num_docs = 0);
 
+    /**
+     * Loads the bitset of deleted documents, creating it (with every
+     * document live) if the index is new or predates deletion support.
+     * Must be called after load_doc_sizes().
+     * @param num_docs The number of documents stored in the index, or 0
+     * if an existing index is being loaded
+     */
+    void load_deleted_docs(uint64_t num_docs = 0);
+
     /**
      * Loads the doc_id mapping.
      */
@@ -193,8 +237,24 @@ class disk_index::disk_index_impl
      */
     util::optional<util::disk_vector<uint64_t>> unique_terms_;
 
-    /// Maps string terms to term_ids.
-    util::optional<vocabulary_map> term_id_mapping_;
+    /**
+     * One bit per document, set if the document has been deleted. Bit
+     * d_id % 64 of word d_id / 64 belongs to d_id.
+     */
+    util::optional<util::disk_vector<uint64_t>> deleted_docs_;
+
+    /// The number of bits set in deleted_docs_; documents may be deleted
+    /// while queries read it, so it (like the bitset) is accessed
+    /// atomically
+    std::atomic<uint64_t> num_deleted_{0};
+
+    /// The generation of this index object; it is shared so that
+    /// lifetime() can hand out weak references to it
+    std::shared_ptr<const uint64_t> generation_;
+
+    /// Maps string terms to term_ids and back; it is read-only, so
+    /// lookups need no locking
+    util::optional<term_dictionary> term_id_mapping_;
 
     /// Assigns an integer to each class label (used for liblinear mappings)
     util::invertible_map<class_label, label_id> label_ids_;
@@ -206,6 +266,15 @@ class disk_index::disk_index_impl
      */
     util::optional<io::mmap_file> postings_;
 
+    /// How postings files are read
+    io::access_policy postings_policy_ = io::access_policy::normal;
+
+    /// How the tables read for every query are read
+    io::access_policy metadata_policy_ = io::access_policy::normal;
+
+    /// Whether to ask for transparent huge pages for mapped files
+    bool huge_pages_ = false;
+
     /// mutex for thread-safe operations
     mutable std::mutex mutex_;
 };
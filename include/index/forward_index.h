@@ -26,7 +26,7 @@ class corpus;
 
 namespace index
 {
-template <class, class>
+template <class, class, class>
 class postings_data;
 }
 }
@@ -40,6 +40,11 @@ namespace index
  * The forward_index stores information on a corpus by doc_ids.  Each doc_id key
  * is associated with a distribution of term_ids or term "counts" that occur in
  * that particular document.
+ *
+ * Document vectors are stored as packed, delta-coded postings (see
+ * postings_data::write_packed_counts), and lexicon.index maps each doc_id to
+ * the byte offset of its vector. Use liblinear_data() (or the export-libsvm
+ * tool) to obtain the libsvm text representation of a document.
  */
 class forward_index : public disk_index
 {
@@ -69,10 +74,17 @@ class forward_index : public disk_index
     friend std::shared_ptr<cached_index<Index, Cache>>
         make_index(const std::string& config_file, Args&&... args);
 
+    /**
+     * forward_index is a friend of reorder_docs(), which rebuilds it
+     * with its documents renumbered.
+     */
+    friend void reorder_docs(const std::string& config_file,
+                             const std::vector<doc_id>& order);
+
     using primary_key_type = doc_id;
     using secondary_key_type = term_id;
-    using postings_data_type = postings_data<doc_id, term_id>;
-    using inverted_pdata_type = postings_data<term_id, doc_id>;
+    using postings_data_type = postings_data<doc_id, term_id, double>;
+    using inverted_pdata_type = postings_data<term_id, doc_id, uint32_t>;
     using index_pdata_type = postings_data_type;
     using exception = forward_index_exception;
 
@@ -83,6 +95,14 @@ class forward_index : public disk_index
      */
     forward_index(const cpptoml::table& config);
 
+    /**
+     * @param config The table that specifies how to create the
+     * index.
+     * @param name The directory to store the index in, instead of the one
+     * given by the configuration's "forward-index" key
+     */
+    forward_index(const cpptoml::table& config, const std::string& name);
+
   public:
     /**
      * Move constructs a forward_index.
@@ -119,10 +139,19 @@ class forward_index : public disk_index
 
     /**
      * @param d_id The document id of the doc to convert to liblinear format
-     * @return the string representation liblinear format
+     * @return the string representation liblinear format, labeled with the
+     * document's label_id
      */
     std::string liblinear_data(doc_id d_id) const;
 
+    /**
+     * @param d_id The document id of the doc to use as a query
+     * @return the (term_id, count) pairs of the document, suitable for
+     * ranker::score against an inverted_index built from the same
+     * configuration (the two share term ids)
+     */
+    std::vector<std::pair<term_id, double>> query_terms(doc_id d_id) const;
+
     /**
      * @return the number of unique terms in the index
      */
@@ -141,6 +170,16 @@ class forward_index : public disk_index
      */
     void create_index(const std::string& config_file);
 
+    /**
+     * Creates this index from another forward_index with its documents
+     * renumbered: document order[i] of the source becomes doc_id i. Term
+     * ids are unchanged.
+     * @param source The index to copy
+     * @param order The documents to keep, in their new order
+     */
+    void permute_docs(const forward_index& source,
+                      const std::vector<doc_id>& order);
+
     /**
      * @return whether this index contains all necessary files
      */
@@ -0,0 +1,109 @@
+/**
+ * @file impact_list.h
+ *
+ * All files in META are dual-licensed under the MIT and NCSA licenses. For more
+ * details, consult the file LICENSE.mit and LICENSE.ncsa in the root of the
+ * project.
+ */
+
+#ifndef META_IMPACT_LIST_H_
+#define META_IMPACT_LIST_H_
+
+#include <utility>
+#include <vector>
+
+#include "meta.h"
+
+namespace meta
+{
+
+namespace io
+{
+class block_file_writer;
+class mmap_file;
+}
+
+namespace index
+{
+
+/**
+ * One term's postings in impact order, used for score-at-a-time query
+ * evaluation (see inverted_index::build_impacts).
+ *
+ * Instead of a count, each posting stores its precomputed (quantized)
+ * score contribution, its impact. Postings with equal impacts are grouped
+ * into a segment, and segments are stored from the highest impact to the
+ * lowest. A list is laid out as the number of segments followed by each
+ * segment: its impact, its number of postings, and its doc_ids as
+ * bit-packed blocks of gaps, which restart from zero in every segment.
+ */
+class impact_list
+{
+  public:
+    /// The number of doc_ids in a full block of a segment
+    const static uint64_t block_size = 128;
+
+    /**
+     * The postings of a list that share one impact.
+     */
+    struct segment
+    {
+        /// The quantized score contribution of every posting here
+        uint64_t impact;
+        /// The number of postings
+        uint64_t size;
+        /// The location of the segment's first packed block
+        const uint8_t* blocks;
+    };
+
+    /**
+     * Constructs an empty impact list.
+     */
+    impact_list();
+
+    /**
+     * @param file The impact-ordered postings file
+     * @param byte_offset The location of the list in the file
+     */
+    impact_list(const io::mmap_file& file, uint64_t byte_offset);
+
+    /**
+     * @return the list's segments, from the highest impact to the lowest
+     */
+    const std::vector<segment>& segments() const;
+
+    /**
+     * @return the number of postings in the list
+     */
+    uint64_t size() const;
+
+    /**
+     * Decodes the first n doc_ids of a segment (more may be decoded, up to
+     * the end of the block holding the n-th).
+     * @param seg The segment to decode
+     * @param n The number of doc_ids needed
+     * @param docs Where to write the doc_ids; resized if it is too small
+     */
+    static void decode(const segment& seg, uint64_t n,
+                       std::vector<uint64_t>& docs);
+
+    /**
+     * Writes a list in the format impact_list reads.
+     * @param out The file to write to
+     * @param postings The (impact, doc_id) pairs of the list, which are
+     * sorted in place
+     */
+    static void write(io::block_file_writer& out,
+                      std::vector<std::pair<uint64_t, uint64_t>>& postings);
+
+  private:
+    /// The segments of the list
+    std::vector<segment> segments_;
+
+    /// The number of postings in the list
+    uint64_t size_;
+};
+}
+}
+
+#endif
@@ -11,11 +11,14 @@
 #ifndef META_INVERTED_INDEX_H_
 #define META_INVERTED_INDEX_H_
 
+#include <functional>
 #include <queue>
 #include <stdexcept>
 
 #include "index/disk_index.h"
+#include "index/impact_list.h"
 #include "index/make_index.h"
+#include "index/postings_cursor.h"
 
 namespace meta
 {
@@ -32,8 +35,11 @@ namespace index
 template <class>
 class chunk_handler;
 
-template <class, class>
+template <class, class, class>
 class postings_data;
+
+class ranker;
+class segmented_index;
 }
 }
 
@@ -65,10 +71,27 @@ class inverted_index : public disk_index
 
     using primary_key_type = term_id;
     using secondary_key_type = doc_id;
-    using postings_data_type = postings_data<term_id, doc_id>;
-    using index_pdata_type = postings_data<std::string, doc_id>;
+    /**
+     * Term frequencies are integral, so postings are kept in memory as
+     * compact (32-bit doc_id, 32-bit count) pairs; an index therefore
+     * holds at most 2^32 - 1 documents. Analyzers that emit fractional
+     * feature values (such as libsvm's) can't be indexed this way, and
+     * building fails rather than truncate them.
+     */
+    using postings_data_type = postings_data<term_id, doc_id, uint32_t>;
+    using index_pdata_type = postings_data<std::string, doc_id, uint32_t>;
     using exception = inverted_index_exception;
 
+    /**
+     * A function that is shown every document, after tokenization, while
+     * the index is being created. It is called concurrently from all of
+     * the tokenizing threads, so it must be thread-safe.
+     */
+    using document_observer = std::function<void(const corpus::document&)>;
+
+    /// The default number of bits impacts are quantized to
+    const static uint8_t default_impact_bits = 8;
+
     /**
      * inverted_index is a friend of the factory method used to create
      * it.
@@ -84,6 +107,19 @@ class inverted_index : public disk_index
     friend std::shared_ptr<cached_index<Index, Cache>>
         make_index(const std::string& config_file, Args&&... args);
 
+    /**
+     * inverted_index is a friend of the segmented_index, which creates,
+     * loads and merges inverted_indexes as its segments.
+     */
+    friend class segmented_index;
+
+    /**
+     * inverted_index is a friend of reorder_docs(), which rebuilds it
+     * with its documents renumbered.
+     */
+    friend void reorder_docs(const std::string& config_file,
+                             const std::vector<doc_id>& order);
+
   protected:
     /**
      * @param config The table that specifies how to create the
@@ -91,6 +127,24 @@ class inverted_index : public disk_index
      */
     inverted_index(const cpptoml::table& config);
 
+    /**
+     * @param config The table that specifies how to create the
+     * index.
+     * @param observer A function to show each document to as it is
+     * tokenized, which lets other structures (e.g., a forward_index) be
+     * built in the same pass over the corpus. It is not called if the
+     * index already exists and is simply loaded.
+     */
+    inverted_index(const cpptoml::table& config, document_observer observer);
+
+    /**
+     * @param config The table that specifies how to create the
+     * index.
+     * @param name The directory to store the index in, instead of the one
+     * given by the configuration's "inverted-index" key
+     */
+    inverted_index(const cpptoml::table& config, const std::string& name);
+
   public:
     /**
      * Move constructs a inverted_index.
@@ -129,6 +183,70 @@ class inverted_index : public disk_index
     virtual std::shared_ptr<postings_data_type>
         search_primary(term_id t_id) const;
 
+    /**
+     * @return whether this index's postings are stored in the block format,
+     * which is required for cursor()
+     */
+    bool has_postings_cursors() const;
+
+    /**
+     * Opens a document-at-a-time cursor over a term's postings. Cursors
+     * read the postings file directly and bypass any postings cache.
+     * @param t_id The term_id to search for
+     * @return a cursor over the postings for t_id (empty if the term does
+     * not exist)
+     * @throw inverted_index_exception if the index does not use the block
+     * postings codec
+     */
+    postings_cursor cursor(term_id t_id) const;
+
+    /**
+     * Asks the operating system to start reading a term's postings into
+     * memory without waiting for them, so that scoring a query whose
+     * postings are on disk waits on one batch of reads rather than on a
+     * page fault at a time. Does nothing if the term does not exist.
+     * @param t_id The term whose postings will be read
+     */
+    void prefetch(term_id t_id) const;
+
+    /**
+     * Like prefetch(), but for the term's impact-ordered postings. Does
+     * nothing if the index has no impacts.
+     * @param t_id The term whose impact-ordered postings will be read
+     */
+    void prefetch_impacts(term_id t_id) const;
+
+    /**
+     * Builds an impact-ordered copy of the postings for score-at-a-time
+     * evaluation (see ranker::evaluation_strategy). Each posting's impact
+     * is the ranker's score_one() for a query containing its term once,
+     * quantized linearly to the given number of bits; postings that would
+     * not add to a document's score are left out. This is done when the
+     * index is created if the configuration sets "impact-bits", using its
+     * [ranker] group.
+     * @param r The ranker to compute impacts with
+     * @param bits The number of bits to quantize impacts to (1 to 16)
+     */
+    void build_impacts(ranker& r, uint8_t bits = default_impact_bits);
+
+    /**
+     * @return whether this index has impact-ordered postings
+     */
+    bool has_impacts() const;
+
+    /**
+     * @param t_id The term_id to search for
+     * @return the impact-ordered postings for t_id (empty if the term does
+     * not exist)
+     * @throw inverted_index_exception if the index has no impacts
+     */
+    impact_list impacts(term_id t_id) const;
+
+    /**
+     * @return the score that one unit of impact stands for
+     */
+    double impact_scale() const;
+
     /**
      * @param t_id The term to search for
      * @return the document frequency of a term (number of documents it
@@ -137,11 +255,83 @@ class inverted_index : public disk_index
     uint64_t doc_freq(term_id t_id) const;
 
     /**
+     * @param t_id The term to search for
+     * @return the largest number of times the term appears in any one
+     * document
+     */
+    uint64_t max_term_freq(term_id t_id) const;
+
+    /**
+     * With the block postings codec, this decodes only the block of t_id's
+     * postings that could contain d_id.
      * @param t_id The term_id to search for
      * @param d_id The doc_id to search for
+     * @return the number of times t_id appears in d_id
      */
     uint64_t term_freq(term_id t_id, doc_id d_id) const;
 
+    /**
+     * Finds the documents that contain every one of a set of terms by
+     * leapfrogging postings cursors from the rarest term.
+     * @param t_ids The terms to search for
+     * @return the sorted ids of the documents containing all of t_ids
+     * @throw inverted_index_exception if the index does not use the block
+     * postings codec
+     */
+    std::vector<doc_id> intersect(const std::vector<term_id>& t_ids) const;
+
+    /**
+     * @return whether this index stores the positions of its terms, which
+     * is done when the configuration sets "store-positions". Positions
+     * are reported by the configuration's ngram-word analyzer with ngram
+     * = 1 (which must exist), so only its terms have them.
+     */
+    bool has_positions() const;
+
+    /**
+     * @param t_id The term to search for
+     * @param d_id The document to search in
+     * @return the positions (token offsets) at which t_id occurs in d_id,
+     * in increasing order
+     * @throw inverted_index_exception if the index has no positions
+     */
+    std::vector<uint64_t> positions(term_id t_id, doc_id d_id) const;
+
+    /**
+     * Tokenizes a query for phrase() or near(), keeping the order of its
+     * terms. Only the terms of the unigram word analyzer are kept, since
+     * they are the only ones with positions.
+     * @param query The query to tokenize
+     * @return the query's terms in the order they occur
+     */
+    std::vector<term_id> tokenize_phrase(corpus::document& query);
+
+    /**
+     * Finds the documents that contain a phrase. The candidates are found
+     * with intersect(), and positions are only decoded for them.
+     * @param t_ids The terms of the phrase, in order
+     * @return the sorted ids of the documents in which t_ids occur at
+     * consecutive positions
+     * @throw inverted_index_exception if the index has no positions or
+     * does not use the block postings codec
+     */
+    std::vector<doc_id> phrase(const std::vector<term_id>& t_ids) const;
+
+    /**
+     * Finds the documents in which a set of terms occur close together, in
+     * any order. The candidates are found with intersect(), and positions
+     * are only decoded for them.
+     * @param t_ids The terms to search for
+     * @param window The largest number of consecutive tokens the terms
+     * may span
+     * @return the sorted ids of the documents in which some window
+     * tokens contain every one of t_ids
+     * @throw inverted_index_exception if the index has no positions or
+     * does not use the block postings codec
+     */
+    std::vector<doc_id> near(const std::vector<term_id>& t_ids,
+                             uint64_t window) const;
+
     /**
      * @return the total number of terms in this index
      */
@@ -166,6 +356,21 @@ class inverted_index : public disk_index
      */
     void create_index(const std::string& config_file);
 
+    /**
+     * Creates this index by concatenating other inverted_indexes: their
+     * documents are numbered one index after another, and their postings
+     * are merged with a chunk_handler. Deleted documents (those not kept)
+     * are compacted away: their postings are dropped and the documents
+     * after them are renumbered.
+     * @param segments The indexes to merge, which must have been built
+     * with the same analyzers
+     * @param docs The documents to keep from each segment, in order;
+     * usually each segment's docs()
+     */
+    void merge_segments(
+        const std::vector<std::shared_ptr<inverted_index>>& segments,
+        const std::vector<std::vector<doc_id>>& docs);
+
     /**
      * This function loads a disk index from its filesystem
      * representation.
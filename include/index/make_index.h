@@ -31,6 +31,13 @@ using dblru_inverted_index =
 /// Inverted index using splay cache
 using splay_inverted_index = cached_index<inverted_index, caching::splay_cache>;
 
+/// Inverted index using a lock-striped CLOCK cache, for concurrent queries
+using clock_inverted_index = cached_index<inverted_index, caching::clock_cache>;
+
+/// Inverted index using a byte-budgeted cache with TinyLFU admission
+using tinylfu_inverted_index =
+    cached_index<inverted_index, caching::tinylfu_cache>;
+
 /// In-memory forward index
 using memory_forward_index =
     cached_index<forward_index, caching::no_evict_cache>;
@@ -0,0 +1,86 @@
+/**
+ * @file position_index.h
+ *
+ * All files in META are dual-licensed under the MIT and NCSA licenses. For more
+ * details, consult the file LICENSE.mit and LICENSE.ncsa in the root of the
+ * project.
+ */
+
+#ifndef META_POSITION_INDEX_H_
+#define META_POSITION_INDEX_H_
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "io/mmap_file.h"
+#include "util/disk_vector.h"
+#include "meta.h"
+
+namespace meta
+{
+namespace index
+{
+
+/**
+ * The positions at which terms occur in each document of an inverted
+ * index, read from the files written by position_index_writer.
+ *
+ * Positions are stored by document rather than by term: phrase and
+ * proximity queries find their candidate documents by intersecting the
+ * ordinary postings, and then only need the positions of a few terms in
+ * those documents. Each document's entry is the number of terms it has,
+ * then a (term_id gap, count, byte length) triple per term in term_id
+ * order, then each term's positions as gaps; all values are varints. The
+ * byte lengths let a lookup skip over the positions of other terms.
+ */
+class position_index
+{
+  public:
+    /**
+     * Opens the positions stored with an index.
+     * @param index_name The directory of the index
+     */
+    position_index(const std::string& index_name);
+
+    /**
+     * Finds the positions of several terms in one document.
+     * @param d_id The document
+     * @param t_ids The terms, in increasing order
+     * @param positions Set to the positions of each term, in increasing
+     * order; empty for terms that are not in the document
+     */
+    void positions(doc_id d_id, const std::vector<term_id>& t_ids,
+                   std::vector<std::vector<uint64_t>>& positions) const;
+
+    /**
+     * @param d_id The document
+     * @return the positions of every term in the document, in term_id
+     * order
+     */
+    std::vector<std::pair<term_id, std::vector<uint64_t>>>
+        positions(doc_id d_id) const;
+
+    /**
+     * @param index_name The directory of an index
+     * @return whether positions have been stored with the index
+     */
+    static bool exists(const std::string& index_name);
+
+    /// The name of the positions file within an index
+    const static std::string postings_file;
+
+    /// The name of the file of each document's location in postings_file
+    const static std::string offsets_file;
+
+  private:
+    /// The positions file
+    io::mmap_file file_;
+
+    /// doc_id -> location of its entry in file_, in bytes
+    util::disk_vector<uint64_t> offsets_;
+};
+}
+}
+
+#endif
@@ -0,0 +1,84 @@
+/**
+ * @file position_index_writer.h
+ *
+ * All files in META are dual-licensed under the MIT and NCSA licenses. For more
+ * details, consult the file LICENSE.mit and LICENSE.ncsa in the root of the
+ * project.
+ */
+
+#ifndef META_POSITION_INDEX_WRITER_H_
+#define META_POSITION_INDEX_WRITER_H_
+
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "io/block_file_writer.h"
+#include "meta.h"
+
+namespace meta
+{
+namespace index
+{
+
+/**
+ * Writes the positions files read by position_index while an inverted
+ * index is built.
+ *
+ * Term ids are not known until the index's postings are merged, so, like
+ * the document vectors of a combined forward index build, each document's
+ * positions are first appended to a scratch file with provisional term
+ * ids in whatever order the tokenizing threads finish them. finish() then
+ * rewrites them in doc_id order with the final term ids.
+ */
+class position_index_writer
+{
+  public:
+    /**
+     * @param index_name The directory of the index being built
+     */
+    position_index_writer(const std::string& index_name);
+
+    /**
+     * Records the positions of a document's terms. Safe to call from
+     * several threads.
+     * @param d_id The document
+     * @param positions The positions of each of its terms
+     */
+    void insert(doc_id d_id,
+                const std::unordered_map<std::string,
+                                         std::vector<uint64_t>>& positions);
+
+    /**
+     * Writes the final positions files and removes the scratch file.
+     * @param num_docs The number of documents in the index
+     * @param get_term_id Gives the final term_id of a term
+     */
+    void finish(uint64_t num_docs,
+                const std::function<term_id(const std::string&)>& get_term_id);
+
+  private:
+    /// Marks documents that were never recorded
+    const static uint64_t npos = static_cast<uint64_t>(-1);
+
+    /// The directory of the index
+    std::string index_name_;
+
+    /// Writes the scratch file
+    io::block_file_writer scratch_;
+
+    /// doc_id -> location of its positions in the scratch file
+    std::vector<uint64_t> offsets_;
+
+    /// term -> provisional id
+    std::unordered_map<std::string, uint64_t> term_ids_;
+
+    /// Protects everything above
+    std::mutex mutex_;
+};
+}
+}
+
+#endif
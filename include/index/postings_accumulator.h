@@ -0,0 +1,322 @@
+/**
+ * @file postings_accumulator.h
+ *
+ * All files in META are dual-licensed under the MIT and NCSA licenses. For more
+ * details, consult the file LICENSE.mit and LICENSE.ncsa in the root of the
+ * project.
+ */
+
+#ifndef META_INDEX_POSTINGS_ACCUMULATOR_H_
+#define META_INDEX_POSTINGS_ACCUMULATOR_H_
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "index/postings_data.h"
+
+namespace meta
+{
+namespace index
+{
+
+namespace detail
+{
+/**
+ * Stores the primary keys of a postings_accumulator, indexed by the order
+ * in which they were first seen.
+ */
+template <class Key>
+class key_store
+{
+  public:
+    /**
+     * @param key The key to append
+     */
+    void push_back(const Key& key)
+    {
+        keys_.push_back(key);
+    }
+
+    /**
+     * @return whether the i-th key is equal to key
+     */
+    bool equal(uint64_t i, const Key& key) const
+    {
+        return keys_[i] == key;
+    }
+
+    /**
+     * @return whether the i-th key sorts before the j-th key
+     */
+    bool less(uint64_t i, uint64_t j) const
+    {
+        return keys_[i] < keys_[j];
+    }
+
+    /**
+     * @return a copy of the i-th key
+     */
+    Key at(uint64_t i) const
+    {
+        return keys_[i];
+    }
+
+    /**
+     * @return the number of bytes reserved for keys
+     */
+    uint64_t bytes_used() const
+    {
+        return keys_.capacity() * sizeof(Key);
+    }
+
+    /**
+     * Removes every key, keeping the memory reserved for reuse.
+     */
+    void clear()
+    {
+        keys_.clear();
+    }
+
+  private:
+    /// The keys
+    std::vector<Key> keys_;
+};
+
+/**
+ * Stores string keys back to back in a single character arena, so that
+ * interning a term costs no allocation of its own.
+ */
+template <>
+class key_store<std::string>
+{
+  public:
+    /**
+     * @param key The key to append
+     */
+    void push_back(const std::string& key)
+    {
+        chars_.insert(chars_.end(), key.begin(), key.end());
+        ends_.push_back(chars_.size());
+    }
+
+    /**
+     * @return whether the i-th key is equal to key
+     */
+    bool equal(uint64_t i, const std::string& key) const
+    {
+        return length(i) == key.size()
+               && std::memcmp(data(i), key.data(), key.size()) == 0;
+    }
+
+    /**
+     * @return whether the i-th key sorts before the j-th key
+     */
+    bool less(uint64_t i, uint64_t j) const
+    {
+        // compare the same way std::string does, so chunks are sorted
+        // exactly as the merge expects
+        auto cmp = std::char_traits<char>::compare(
+            data(i), data(j), std::min(length(i), length(j)));
+        return cmp < 0 || (cmp == 0 && length(i) < length(j));
+    }
+
+    /**
+     * @return a copy of the i-th key
+     */
+    std::string at(uint64_t i) const
+    {
+        return {data(i), length(i)};
+    }
+
+    /**
+     * @return the number of bytes reserved for keys
+     */
+    uint64_t bytes_used() const
+    {
+        return chars_.capacity() + ends_.capacity() * sizeof(uint64_t);
+    }
+
+    /**
+     * Removes every key, keeping the memory reserved for reuse.
+     */
+    void clear()
+    {
+        chars_.clear();
+        ends_.clear();
+    }
+
+  private:
+    /// @return the start of the i-th key
+    const char* data(uint64_t i) const
+    {
+        return chars_.data() + (i == 0 ? 0 : ends_[i - 1]);
+    }
+
+    /// @return the length of the i-th key
+    uint64_t length(uint64_t i) const
+    {
+        return ends_[i] - (i == 0 ? 0 : ends_[i - 1]);
+    }
+
+    /// The characters of every key
+    std::vector<char> chars_;
+    /// The offset just past the end of each key in chars_
+    std::vector<uint64_t> ends_;
+};
+}
+
+/**
+ * An in-memory buffer of postings used to build index chunks.
+ *
+ * Each primary key is interned once (strings are packed into a single
+ * character arena) and found again through an open addressing hash
+ * table, so adding a posting never constructs a key. A key's postings are
+ * appended to a chain of slices carved out of large pooled pages; slices
+ * double in size as the list grows, so short lists waste little space and
+ * long lists need few links. The pages are kept when the accumulator is
+ * drained, so steady-state indexing performs no allocation at all.
+ *
+ * A posting with an integral count is packed into a single word (the
+ * secondary key in the high half and the count in the low half); a
+ * fractional count takes a second word of its own.
+ */
+template <class PrimaryKey, class SecondaryKey, class FeatureValue = double>
+class postings_accumulator
+{
+  public:
+    using postings_data_type
+        = postings_data<PrimaryKey, SecondaryKey, FeatureValue>;
+
+    /**
+     * Constructs an empty accumulator.
+     */
+    postings_accumulator();
+
+    /**
+     * Adds a posting.
+     * @param key The primary key the posting belongs to
+     * @param s_id The secondary key of the posting
+     * @param count The count of the posting
+     */
+    void add(const PrimaryKey& key, SecondaryKey s_id, FeatureValue count);
+
+    /**
+     * @return whether no postings have been added since the last drain
+     */
+    bool empty() const;
+
+    /**
+     * @return the number of bytes of memory the buffered postings occupy
+     */
+    uint64_t bytes_used() const;
+
+    /**
+     * Hands every buffered postings list to a function in primary key
+     * order, then empties the accumulator.
+     * @param fn A callable taking a postings_data_type&
+     */
+    template <class Function>
+    void drain(Function&& fn);
+
+  private:
+    /**
+     * The bookkeeping for one primary key.
+     */
+    struct entry
+    {
+        /// The hash of the key
+        uint64_t hash;
+        /// The address of the key's first slice
+        uint64_t head;
+        /// The address to write the key's next posting to
+        uint64_t tail;
+        /// The number of postings for the key
+        uint64_t size;
+        /// The level of the slice tail is in
+        uint32_t level;
+        /// The number of postings that still fit in that slice
+        uint32_t remaining;
+    };
+
+    /**
+     * @param key The key to look for
+     * @param hash The hash of the key
+     * @return the index of the key's entry, which is created if needed
+     */
+    uint64_t find_or_insert(const PrimaryKey& key, uint64_t hash);
+
+    /**
+     * Doubles the size of the hash table.
+     */
+    void grow_table();
+
+    /**
+     * @param level The level of a slice
+     * @return the number of postings a slice of that level holds
+     */
+    static uint32_t slice_capacity(uint32_t level);
+
+    /**
+     * Reserves a slice of the given level.
+     * @param level The level of the slice
+     * @return the address of the slice
+     */
+    uint64_t allocate(uint32_t level);
+
+    /**
+     * @param address The address of a word in the page pool
+     * @return the word
+     */
+    uint64_t& word(uint64_t address);
+
+    /**
+     * Writes a posting to the page pool.
+     * @param address The address of the posting
+     * @param s_id The secondary key of the posting
+     * @param count The count of the posting
+     */
+    void store(uint64_t address, SecondaryKey s_id, FeatureValue count);
+
+    /**
+     * @param address The address of a posting in the page pool
+     * @return the posting
+     */
+    typename postings_data_type::pair_t load(uint64_t address);
+
+    /// The number of 64-bit words each posting takes
+    const static uint64_t posting_words
+        = std::is_integral<FeatureValue>::value ? 1 : 2;
+
+    /// The number of 64-bit words in each page
+    const static uint64_t page_words = uint64_t{1} << 16;
+
+    /// The largest slice level
+    const static uint32_t max_level = 8;
+
+    /// The interned primary keys, in the same order as entries_
+    detail::key_store<PrimaryKey> keys_;
+
+    /// The entry for each primary key
+    std::vector<entry> entries_;
+
+    /// Open addressing hash table of entry index + 1 (0 marks a free slot)
+    std::vector<uint32_t> table_;
+
+    /// The pooled pages postings are written to
+    std::vector<std::unique_ptr<uint64_t[]>> pages_;
+
+    /// The number of pages in use
+    uint64_t used_pages_;
+
+    /// The first unused word of the last page in use
+    uint64_t page_offset_;
+};
+}
+}
+
+#include "index/postings_accumulator.tcc"
+#endif
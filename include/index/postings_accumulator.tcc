@@ -0,0 +1,238 @@
+/**
+ * @file postings_accumulator.tcc
+ */
+
+#include <algorithm>
+#include <functional>
+#include <numeric>
+
+#include "index/postings_accumulator.h"
+
+namespace meta
+{
+namespace index
+{
+
+template <class PrimaryKey, class SecondaryKey, class FeatureValue>
+postings_accumulator<PrimaryKey, SecondaryKey,
+                     FeatureValue>::postings_accumulator()
+    : table_(1024, 0), used_pages_{0}, page_offset_{page_words}
+{
+    // nothing
+}
+
+template <class PrimaryKey, class SecondaryKey, class FeatureValue>
+void postings_accumulator<PrimaryKey, SecondaryKey, FeatureValue>::add(
+    const PrimaryKey& key, SecondaryKey s_id, FeatureValue count)
+{
+    auto idx = find_or_insert(key, std::hash<PrimaryKey>{}(key));
+
+    // the last word of a full slice links it to the next one
+    if (entries_[idx].remaining == 0)
+    {
+        auto level = entries_[idx].level;
+        level = level < max_level ? level + 1 : max_level;
+        auto slice = allocate(level);
+        auto& e = entries_[idx];
+        word(e.tail) = slice;
+        e.tail = slice;
+        e.level = level;
+        e.remaining = slice_capacity(level);
+    }
+
+    auto& e = entries_[idx];
+    store(e.tail, s_id, count);
+    e.tail += posting_words;
+    --e.remaining;
+    ++e.size;
+}
+
+template <class PrimaryKey, class SecondaryKey, class FeatureValue>
+uint64_t postings_accumulator<PrimaryKey, SecondaryKey, FeatureValue>::
+    find_or_insert(const PrimaryKey& key, uint64_t hash)
+{
+    auto mask = table_.size() - 1;
+    for (auto slot = hash & mask;; slot = (slot + 1) & mask)
+    {
+        if (table_[slot] == 0)
+        {
+            auto slice = allocate(0);
+            keys_.push_back(key);
+            entries_.push_back({hash, slice, slice, 0, 0, slice_capacity(0)});
+            table_[slot] = static_cast<uint32_t>(entries_.size());
+
+            // keep the table at most half full so probes stay short
+            if (entries_.size() * 2 > table_.size())
+                grow_table();
+            return entries_.size() - 1;
+        }
+
+        auto idx = table_[slot] - 1;
+        if (entries_[idx].hash == hash && keys_.equal(idx, key))
+            return idx;
+    }
+}
+
+template <class PrimaryKey, class SecondaryKey, class FeatureValue>
+void postings_accumulator<PrimaryKey, SecondaryKey, FeatureValue>::grow_table()
+{
+    std::vector<uint32_t> table(table_.size() * 2, 0);
+    auto mask = table.size() - 1;
+    for (uint64_t idx = 0; idx < entries_.size(); ++idx)
+    {
+        auto slot = entries_[idx].hash & mask;
+        while (table[slot] != 0)
+            slot = (slot + 1) & mask;
+        table[slot] = static_cast<uint32_t>(idx + 1);
+    }
+    table_.swap(table);
+}
+
+template <class PrimaryKey, class SecondaryKey, class FeatureValue>
+uint32_t postings_accumulator<PrimaryKey, SecondaryKey, FeatureValue>::
+    slice_capacity(uint32_t level)
+{
+    return uint32_t{2} << level;
+}
+
+template <class PrimaryKey, class SecondaryKey, class FeatureValue>
+uint64_t postings_accumulator<PrimaryKey, SecondaryKey, FeatureValue>::allocate(
+    uint32_t level)
+{
+    // a slice holds (secondary key, count) postings plus a link word
+    auto words = posting_words * slice_capacity(level) + 1;
+    if (page_offset_ + words > page_words)
+    {
+        if (used_pages_ == pages_.size())
+            pages_.emplace_back(new uint64_t[page_words]);
+        ++used_pages_;
+        page_offset_ = 0;
+    }
+
+    auto address = (used_pages_ - 1) * page_words + page_offset_;
+    page_offset_ += words;
+    return address;
+}
+
+template <class PrimaryKey, class SecondaryKey, class FeatureValue>
+uint64_t& postings_accumulator<PrimaryKey, SecondaryKey, FeatureValue>::word(
+    uint64_t address)
+{
+    return pages_[address / page_words][address % page_words];
+}
+
+template <class PrimaryKey, class SecondaryKey, class FeatureValue>
+void postings_accumulator<PrimaryKey, SecondaryKey, FeatureValue>::store(
+    uint64_t address, SecondaryKey s_id, FeatureValue count)
+{
+    if (posting_words == 1)
+    {
+        word(address) = (uint64_t{s_id} << 32) | static_cast<uint64_t>(count);
+    }
+    else
+    {
+        word(address) = uint64_t{s_id};
+        std::memcpy(&word(address + 1), &count, sizeof(count));
+    }
+}
+
+template <class PrimaryKey, class SecondaryKey, class FeatureValue>
+auto postings_accumulator<PrimaryKey, SecondaryKey, FeatureValue>::load(
+    uint64_t address) -> typename postings_data_type::pair_t
+{
+    if (posting_words == 1)
+    {
+        auto packed = word(address);
+        return {SecondaryKey{packed >> 32},
+                static_cast<FeatureValue>(packed & 0xffffffff)};
+    }
+
+    FeatureValue count;
+    std::memcpy(&count, &word(address + 1), sizeof(count));
+    return {SecondaryKey{word(address)}, count};
+}
+
+template <class PrimaryKey, class SecondaryKey, class FeatureValue>
+bool postings_accumulator<PrimaryKey, SecondaryKey, FeatureValue>::empty() const
+{
+    return entries_.empty();
+}
+
+template <class PrimaryKey, class SecondaryKey, class FeatureValue>
+uint64_t
+    postings_accumulator<PrimaryKey, SecondaryKey, FeatureValue>::bytes_used()
+        const
+{
+    return used_pages_ * page_words * sizeof(uint64_t) + keys_.bytes_used()
+           + entries_.capacity() * sizeof(entry)
+           + table_.capacity() * sizeof(uint32_t);
+}
+
+template <class PrimaryKey, class SecondaryKey, class FeatureValue>
+template <class Function>
+void postings_accumulator<PrimaryKey, SecondaryKey, FeatureValue>::drain(
+    Function&& fn)
+{
+    std::vector<uint64_t> order(entries_.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&](uint64_t a, uint64_t b)
+              {
+                  return keys_.less(a, b);
+              });
+
+    using pair_t = typename postings_data_type::pair_t;
+    auto by_key = [](const pair_t& a, const pair_t& b)
+    {
+        return a.first < b.first;
+    };
+
+    postings_data_type pdata;
+    typename postings_data_type::count_t counts;
+    for (const auto& idx : order)
+    {
+        const auto& e = entries_[idx];
+        counts.clear();
+        auto address = e.head;
+        auto level = uint32_t{0};
+        auto remaining = slice_capacity(level);
+        for (uint64_t i = 0; i < e.size;
+             ++i, --remaining, address += posting_words)
+        {
+            if (remaining == 0)
+            {
+                address = word(address);
+                level = level < max_level ? level + 1 : max_level;
+                remaining = slice_capacity(level);
+            }
+            counts.push_back(load(address));
+        }
+
+        // producers usually see secondary keys in increasing order, but
+        // repeated keys still have to be combined
+        if (!std::is_sorted(counts.begin(), counts.end(), by_key))
+            std::stable_sort(counts.begin(), counts.end(), by_key);
+        auto last = counts.begin();
+        for (auto it = counts.begin() + 1; it < counts.end(); ++it)
+        {
+            if (it->first == last->first)
+                last->second += it->second;
+            else
+                *++last = *it;
+        }
+        counts.erase(last + 1, counts.end());
+
+        // counts and the postings_data trade buffers, so neither is
+        // reallocated once both have grown to the longest list
+        pdata.set_primary_key(keys_.at(idx));
+        pdata.swap_sorted_counts(counts);
+        fn(pdata);
+    }
+
+    keys_.clear();
+    entries_.clear();
+    std::fill(table_.begin(), table_.end(), 0);
+    used_pages_ = 0;
+    page_offset_ = page_words;
+}
+}
+}
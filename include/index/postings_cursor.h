@@ -0,0 +1,206 @@
+/**
+ * @file postings_cursor.h
+ *
+ * All files in META are dual-licensed under the MIT and NCSA licenses. For more
+ * details, consult the file LICENSE.mit and LICENSE.ncsa in the root of the
+ * project.
+ */
+
+#ifndef META_POSTINGS_CURSOR_H_
+#define META_POSTINGS_CURSOR_H_
+
+#include <vector>
+
+#include "meta.h"
+
+namespace meta
+{
+
+namespace io
+{
+class mmap_file;
+}
+
+namespace index
+{
+
+/**
+ * An iterator over one term's postings list in the block postings format
+ * (see postings_data::write_packed), used for document-at-a-time query
+ * evaluation.
+ *
+ * Blocks are decoded lazily: skip_to() searches the list's skip table for
+ * the block that may hold the target and decodes only that block, so
+ * jumping through a long list touches very little of it. The cursor also
+ * exposes the largest count and smallest document length in each block,
+ * from which rankers can compute block-max score bounds.
+ */
+class postings_cursor
+{
+  public:
+    /**
+     * Constructs a cursor over an empty postings list.
+     */
+    postings_cursor();
+
+    /**
+     * @param file The block postings file
+     * @param byte_offset The location of the postings list in the file
+     */
+    postings_cursor(const io::mmap_file& file, uint64_t byte_offset);
+
+    /**
+     * @return the doc_id returned by doc() once the cursor is exhausted;
+     * it compares greater than every real doc_id
+     */
+    static doc_id end_doc();
+
+    /**
+     * @return the number of postings in the list (the term's document
+     * frequency)
+     */
+    uint64_t size() const;
+
+    /**
+     * @return the largest count in the entire list
+     */
+    uint64_t max_freq() const;
+
+    /**
+     * @return the length of the shortest document in the entire list
+     */
+    uint64_t min_doc_size() const;
+
+    /**
+     * @return whether the cursor points at a posting
+     */
+    bool valid() const;
+
+    /**
+     * @return the doc_id of the current posting, or end_doc() if the
+     * cursor is exhausted
+     */
+    doc_id doc() const;
+
+    /**
+     * @return the count of the current posting (the term's frequency in
+     * doc())
+     */
+    uint64_t freq() const;
+
+    /**
+     * Moves to the next posting.
+     */
+    void next();
+
+    /**
+     * Moves to the first posting whose doc_id is at least d_id. The
+     * cursor never moves backwards.
+     * @param d_id The doc_id to move to
+     */
+    void skip_to(doc_id d_id);
+
+    /**
+     * Moves the block header (but not the current posting) to the first
+     * block that may contain d_id, without decoding any postings. After
+     * this, the block_* functions describe that block. If every block
+     * ends before d_id, the header stays on the last block.
+     * @param d_id The doc_id to look for
+     */
+    void shallow_skip_to(doc_id d_id);
+
+    /**
+     * @return the last doc_id in the current header's block
+     */
+    doc_id block_last_doc() const;
+
+    /**
+     * @return the largest count in the current header's block
+     */
+    uint64_t block_max_freq() const;
+
+    /**
+     * @return the length of the shortest document in the current header's
+     * block
+     */
+    uint64_t block_min_doc_size() const;
+
+  private:
+    /**
+     * Block header fields; see postings_data::write_packed.
+     */
+    struct header
+    {
+        /// The index of this block in the list
+        uint64_t index;
+        /// The last doc_id of the previous block (gaps start from here)
+        uint64_t base;
+        /// The last doc_id of this block
+        uint64_t last;
+        /// The largest count in this block
+        uint64_t max_freq;
+        /// The smallest document length in this block
+        uint64_t min_doc_size;
+        /// The location of this block's packed postings
+        const uint8_t* payload;
+    };
+
+    /**
+     * Looks up a block header using the skip table.
+     * @param index The index of the block
+     * @return the block's header
+     */
+    header read_header(uint64_t index) const;
+
+    /**
+     * @param index The index of a block
+     * @return the last doc_id in the block (only valid for lists with a
+     * skip table)
+     */
+    uint64_t last_doc(uint64_t index) const;
+
+    /**
+     * @return the number of blocks in the list
+     */
+    uint64_t num_blocks() const;
+
+    /**
+     * Decodes the block described by header_ and points the cursor at its
+     * first posting.
+     */
+    void decode();
+
+    /// The number of postings in the list
+    uint64_t size_;
+    /// The largest count in the list
+    uint64_t max_freq_;
+    /// The smallest document length in the list
+    uint64_t min_doc_size_;
+
+    /// The packed last doc_ids of each block, or nullptr for a single block
+    const uint8_t* last_docs_;
+    /// The packed byte offsets of each block from blocks_
+    const uint8_t* offsets_;
+    /// The location of the first block
+    const uint8_t* blocks_;
+
+    /// The header of the block the cursor is looking ahead to
+    header header_;
+    /// The header of the block that is currently decoded
+    header decoded_;
+
+    /// The doc_ids of the decoded block
+    std::vector<uint64_t> docs_;
+    /// The counts of the decoded block
+    std::vector<uint64_t> counts_;
+    /// The number of postings in the decoded block
+    uint64_t block_postings_;
+    /// The position of the current posting in the decoded block
+    uint64_t pos_;
+    /// Whether every posting has been visited
+    bool exhausted_;
+};
+}
+}
+
+#endif
@@ -11,27 +11,64 @@
 #define META_POSTINGS_DATA_
 
 #include <fstream>
+#include <functional>
 #include <limits>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
 #include <utility>
 #include <vector>
 
 #include "meta.h"
+#include "io/block_file_reader.h"
+#include "io/block_file_writer.h"
 #include "io/compressed_file_reader.h"
 #include "io/compressed_file_writer.h"
-#include "util/sparse_vector.h"
 
 namespace meta
 {
 namespace index
 {
 
-template <class, class>
+template <class, class, class>
 class postings_data;
 
-template <class PrimaryKey, class SecondaryKey>
+template <class PrimaryKey, class SecondaryKey, class FeatureValue>
 io::compressed_file_reader& operator>>(io::compressed_file_reader&,
-                                       postings_data<PrimaryKey,
-                                                     SecondaryKey>&);
+                                       postings_data<PrimaryKey, SecondaryKey,
+                                                     FeatureValue>&);
+
+/**
+ * A posting with an integral count, packed into eight bytes by narrowing
+ * both the SecondaryKey and the count to 32 bits (a std::pair of a
+ * SecondaryKey and a double takes sixteen). Its members are named like
+ * those of std::pair so that either kind of posting can be read the same
+ * way; the key has to be converted back explicitly, e.g. doc_id{p.first}.
+ */
+struct compact_posting
+{
+    /**
+     * compact_posting is default-constructable.
+     */
+    compact_posting() = default;
+
+    /**
+     * @param key The SecondaryKey of the posting, which must fit in 32 bits
+     * @param count The count of the posting
+     */
+    template <class SecondaryKey, class Count>
+    compact_posting(SecondaryKey key, Count count)
+        : first{static_cast<uint32_t>(key)},
+          second{static_cast<uint32_t>(count)}
+    {
+        // nothing
+    }
+
+    /// The SecondaryKey
+    uint32_t first;
+    /// The count
+    uint32_t second;
+};
 
 /**
  * A class to represent the per-PrimaryKey data in an index's postings
@@ -40,16 +77,27 @@ io::compressed_file_reader& operator>>(io::compressed_file_reader&,
  *
  * For example, for an inverted index, PrimaryKey = term_id, SecondaryKey =
  * doc_id. For a forward_index, PrimaryKey = doc_id, SecondaryKey = term_id.
+ *
+ * FeatureValue is the type of the counts. Lists of integral counts (the
+ * term frequencies of an inverted index) use uint32_t, and are kept as
+ * compact_postings; double is only needed where an analyzer may emit
+ * fractional values, as for the feature vectors of a forward_index.
  */
-template <class PrimaryKey, class SecondaryKey>
+template <class PrimaryKey, class SecondaryKey, class FeatureValue = double>
 class postings_data
 {
   public:
     using primary_key_type = PrimaryKey;
     using secondary_key_type = SecondaryKey;
-    using pair_t = std::pair<SecondaryKey, double>;
+    using feature_value_type = FeatureValue;
+    using pair_t = typename std::conditional<
+        std::is_integral<FeatureValue>::value, compact_posting,
+        std::pair<SecondaryKey, FeatureValue>>::type;
     using count_t = std::vector<pair_t>;
 
+    /// The number of postings in each block of the block postings format
+    const static uint64_t block_size = 128;
+
     /**
      * PrimaryKeys may only be integral types or strings; SecondaryKeys may
      * only be integral types.
@@ -63,6 +111,14 @@ class postings_data
          || std::is_base_of<util::numeric, SecondaryKey>::value),
         "primary and secondary keys in postings data must be numeric types");
 
+    /**
+     * Integral counts are stored in 32 bits; fractional ones are written as
+     * the bits of a double.
+     */
+    static_assert(std::is_same<FeatureValue, uint32_t>::value
+                  || std::is_same<FeatureValue, double>::value,
+                  "postings data counts must be uint32_t or double");
+
     /**
      * uint64_t and double must take up the same number of bytes since they are
      * being casted to each other when compressing.
@@ -93,14 +149,14 @@ class postings_data
      * @param amount The number of times to increase the count for a given
      * SecondaryKey
      */
-    void increase_count(SecondaryKey s_id, double amount);
+    void increase_count(SecondaryKey s_id, FeatureValue amount);
 
     /**
      * @param s_id The SecondaryKey id to query
      * @return the number of times SecondaryKey occurred in this
      * postings_data
      */
-    double count(SecondaryKey s_id) const;
+    FeatureValue count(SecondaryKey s_id) const;
 
     /**
      * @return the per-SecondaryKey frequency information for this
@@ -113,6 +169,14 @@ class postings_data
      */
     void set_counts(const count_t& counts);
 
+    /**
+     * Exchanges this postings_data's counts with counts that are already
+     * sorted by SecondaryKey, without copying or sorting them. The old
+     * counts are left in the argument so that their memory can be reused.
+     * @param counts The sorted counts to take; receives the old counts
+     */
+    void swap_sorted_counts(count_t& counts);
+
     /**
      * @param other The postings_data to compare with
      * @return whether this postings_data is less than (has a smaller
@@ -126,15 +190,16 @@ class postings_data
      * @param pd The postings data object to write the stream info to
      */
     friend void stream_helper(io::compressed_file_reader& in,
-                              postings_data<PrimaryKey, SecondaryKey>& pd)
+                              postings_data& pd)
     {
         pd.counts_.clear();
         uint32_t num_pairs = in.next();
+        pd.counts_.reserve(num_pairs);
         for (uint32_t i = 0; i < num_pairs; ++i)
         {
             SecondaryKey s_id = SecondaryKey{in.next()};
             uint64_t count = in.next();
-            pd.counts_.emplace_back(s_id, static_cast<double>(count));
+            pd.counts_.emplace_back(s_id, static_cast<FeatureValue>(count));
         }
     }
 
@@ -145,8 +210,7 @@ class postings_data
      * @return the input stream
      */
     friend io::compressed_file_reader& operator>>
-        <>(io::compressed_file_reader& in,
-           postings_data<PrimaryKey, SecondaryKey>& pd);
+        <>(io::compressed_file_reader& in, postings_data& pd);
 
     /**
      * Writes semi-compressed postings data to a compressed file.
@@ -155,8 +219,7 @@ class postings_data
      * @return the output stream
      */
     friend io::compressed_file_writer& operator<<(
-        io::compressed_file_writer& out,
-        const postings_data<PrimaryKey, SecondaryKey>& pd)
+        io::compressed_file_writer& out, const postings_data& pd)
     {
         if (pd.counts_.empty())
             return out;
@@ -191,6 +254,59 @@ class postings_data
      */
     void read_compressed(io::compressed_file_reader& reader);
 
+    /**
+     * Writes this postings_data in the block postings format. The list
+     * begins with the number of postings and the largest count and
+     * smallest SecondaryKey length over the whole list. Postings are then
+     * grouped into blocks of block_size; if there is more than one block, a
+     * skip table follows: a bit-packed array of the last SecondaryKey in
+     * each block and a bit-packed array of each block's byte offset from
+     * the end of the table. Both arrays are fixed-width, so a reader can
+     * binary search them to jump straight to the block containing a key.
+     *
+     * Each block holds the largest count and smallest length within it,
+     * then its SecondaryKey gaps (relative to the last key of the previous
+     * block) and its counts, each bit-packed as count - 1. The count and
+     * length statistics let rankers bound the score of any posting in a
+     * list or block without decoding it.
+     *
+     * @param writer The file to write to
+     * @param length A function giving the length of the object identified
+     * by a SecondaryKey (e.g., a document's length); if empty, all lengths
+     * are recorded as zero
+     * @throw postings_data_exception if a count is not a positive integer
+     */
+    void write_packed(io::block_file_writer& writer,
+                      const std::function<uint64_t(SecondaryKey)>& length
+                      = {}) const;
+
+    /**
+     * Reads postings_data written by write_packed() into this object. We
+     * assume that the reader is already at the correct location in the
+     * file.
+     * @param reader The file to read from
+     */
+    void read_packed(io::block_file_reader& reader);
+
+    /**
+     * Writes this postings_data as a single packed vector, which suits
+     * short lists such as document vectors: a header giving the number of
+     * postings and whether any count is fractional, then the bit-packed
+     * SecondaryKey gaps and the bit-packed counts. Positive integral
+     * counts are stored as count - 1; if any count is fractional or zero,
+     * all are stored as count_bits() of their value instead.
+     * @param writer The file to write to
+     */
+    void write_packed_counts(io::block_file_writer& writer) const;
+
+    /**
+     * Reads postings_data written by write_packed_counts() into this
+     * object. We assume that the reader is already at the correct location
+     * in the file.
+     * @param reader The file to read from
+     */
+    void read_packed_counts(io::block_file_reader& reader);
+
     /**
      * @param out The output stream to write to
      */
@@ -222,31 +338,44 @@ class postings_data
      */
     uint64_t bytes_used() const;
 
+    /**
+     * Thrown when postings can't be written in a requested format.
+     */
+    class postings_data_exception : public std::runtime_error
+    {
+      public:
+        using std::runtime_error::runtime_error;
+    };
+
   private:
     /// Primary id this postings_data represents
     PrimaryKey p_id_;
 
-    /// The (secondary_key_type, count) pairs
-    util::sparse_vector<SecondaryKey, double> counts_;
+    /// The (secondary_key_type, count) pairs, sorted by secondary key
+    count_t counts_;
 
     /// delimiter used when writing to compressed files
     const static uint64_t delimiter_ = std::numeric_limits<uint64_t>::max();
 };
 
+namespace detail
+{
 /**
- * Reads semi-compressed postings data from a compressed file.
- * @param in The stream to read from
- * @param pd The postings data object to write the stream info to
- * @return the input stream
+ * Reads a numeric primary key from a compressed file.
  */
-template <class PrimaryKey, class SecondaryKey>
-io::compressed_file_reader& operator>>(io::compressed_file_reader& in,
-                                       postings_data<PrimaryKey,
-                                                     SecondaryKey>& pd)
+template <class PrimaryKey>
+void read_primary_key(io::compressed_file_reader& in, PrimaryKey& key)
 {
-    pd.p_id_ = in.next();
-    stream_helper(in, pd);
-    return in;
+    key = PrimaryKey{in.next()};
+}
+
+/**
+ * Reads a string primary key from a compressed file.
+ */
+inline void read_primary_key(io::compressed_file_reader& in, std::string& key)
+{
+    key = in.next_string();
+}
 }
 
 /**
@@ -255,11 +384,12 @@ io::compressed_file_reader& operator>>(io::compressed_file_reader& in,
  * @param pd The postings data object to write the stream info to
  * @return the input stream
  */
-template <>
-inline io::compressed_file_reader& operator>>
-    <>(io::compressed_file_reader& in, postings_data<std::string, doc_id>& pd)
+template <class PrimaryKey, class SecondaryKey, class FeatureValue>
+io::compressed_file_reader& operator>>(io::compressed_file_reader& in,
+                                       postings_data<PrimaryKey, SecondaryKey,
+                                                     FeatureValue>& pd)
 {
-    pd.p_id_ = in.next_string();
+    detail::read_primary_key(in, pd.p_id_);
     stream_helper(in, pd);
     return in;
 }
@@ -270,21 +400,24 @@ inline io::compressed_file_reader& operator>>
  * @return whether this postings_data has the same PrimaryKey as
  * the paramter
  */
-template <class PrimaryKey, class SecondaryKey>
-bool operator==(const postings_data<PrimaryKey, SecondaryKey>& lhs,
-                const postings_data<PrimaryKey, SecondaryKey>& rhs);
+template <class PrimaryKey, class SecondaryKey, class FeatureValue>
+bool operator==(
+    const postings_data<PrimaryKey, SecondaryKey, FeatureValue>& lhs,
+    const postings_data<PrimaryKey, SecondaryKey, FeatureValue>& rhs);
 }
 }
 
 namespace std
 {
-template <class PrimaryKey, class SecondaryKey>
+template <class PrimaryKey, class SecondaryKey, class FeatureValue>
 /**
- * Hash specialization for postings_data<PrimaryKey, SecondaryKey>
+ * Hash specialization for postings_data<PrimaryKey, SecondaryKey,
+ * FeatureValue>
  */
-struct hash<meta::index::postings_data<PrimaryKey, SecondaryKey>>
+struct hash<meta::index::postings_data<PrimaryKey, SecondaryKey, FeatureValue>>
 {
-    using pdata_t = meta::index::postings_data<PrimaryKey, SecondaryKey>;
+    using pdata_t
+        = meta::index::postings_data<PrimaryKey, SecondaryKey, FeatureValue>;
     /**
      * @param pd The postings_data to hash
      * @return the hash of the given postings_data
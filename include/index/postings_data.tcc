@@ -4,22 +4,67 @@
  */
 
 #include <algorithm>
+#include <cmath>
 #include <cstring>
 #include "index/postings_data.h"
+#include "io/block_codec.h"
 
 namespace meta
 {
 namespace index
 {
 
-template <class PrimaryKey, class SecondaryKey>
-postings_data<PrimaryKey, SecondaryKey>::postings_data(PrimaryKey p_id)
+namespace detail
+{
+/**
+ * @param count An integral count
+ * @return the count as it is written to a compressed file
+ */
+inline uint64_t count_bits(uint32_t count)
+{
+    return count;
+}
+
+/**
+ * @param count A fractional count
+ * @return the bits of the count, as they are written to a compressed file
+ */
+inline uint64_t count_bits(double count)
+{
+    uint64_t bits;
+    std::memcpy(&bits, &count, sizeof(count));
+    return bits;
+}
+
+/**
+ * @param bits An integral count read from a compressed file
+ * @param count Where to put the count
+ */
+inline void from_count_bits(uint64_t bits, uint32_t& count)
+{
+    count = static_cast<uint32_t>(bits);
+}
+
+/**
+ * @param bits The bits of a fractional count read from a compressed file
+ * @param count Where to put the count
+ */
+inline void from_count_bits(uint64_t bits, double& count)
+{
+    std::memcpy(&count, &bits, sizeof(count));
+}
+}
+
+template <class PrimaryKey, class SecondaryKey, class FeatureValue>
+postings_data<PrimaryKey, SecondaryKey, FeatureValue>::postings_data(
+    PrimaryKey p_id)
     : p_id_{p_id}
 {/* nothing */
 }
 
-template <class PrimaryKey, class SecondaryKey>
-void postings_data<PrimaryKey, SecondaryKey>::merge_with(postings_data& other)
+template <class PrimaryKey, class SecondaryKey, class FeatureValue>
+void postings_data<PrimaryKey, SecondaryKey, FeatureValue>::merge_with(
+    postings_data& other)
 {
     auto searcher = [](const pair_t& p, const SecondaryKey& s) {
         return p.first < s;
@@ -31,8 +76,9 @@ void postings_data<PrimaryKey, SecondaryKey>::merge_with(postings_data& other)
     uint64_t orig_length = counts_.size();
     for (auto& p : other.counts_)
     {
-        auto it = std::lower_bound(
-            counts_.begin(), counts_.begin() + orig_length, p.first, searcher);
+        auto it = std::lower_bound(counts_.begin(),
+                                   counts_.begin() + orig_length,
+                                   SecondaryKey{p.first}, searcher);
         if (it == counts_.end() || it->first != p.first)
             counts_.emplace_back(std::move(p));
         else
@@ -50,109 +96,112 @@ void postings_data<PrimaryKey, SecondaryKey>::merge_with(postings_data& other)
     }
 }
 
-template <class PrimaryKey, class SecondaryKey>
-void postings_data
-    <PrimaryKey, SecondaryKey>::increase_count(SecondaryKey s_id, double amount)
+template <class PrimaryKey, class SecondaryKey, class FeatureValue>
+void postings_data<PrimaryKey, SecondaryKey, FeatureValue>::increase_count(
+    SecondaryKey s_id, FeatureValue amount)
+{
+    auto it = std::lower_bound(counts_.begin(), counts_.end(), s_id,
+                               [](const pair_t& p, const SecondaryKey& s)
+                               {
+        return p.first < s;
+    });
+
+    if (it == counts_.end() || it->first != s_id)
+        counts_.emplace(it, s_id, amount);
+    else
+        it->second += amount;
+}
+
+template <class PrimaryKey, class SecondaryKey, class FeatureValue>
+FeatureValue postings_data<PrimaryKey, SecondaryKey, FeatureValue>::count(
+    SecondaryKey s_id) const
 {
-    counts_[s_id] += amount;
+    auto it = std::lower_bound(counts_.begin(), counts_.end(), s_id,
+                               [](const pair_t& p, const SecondaryKey& s)
+                               {
+        return p.first < s;
+    });
+
+    if (it == counts_.end() || it->first != s_id)
+        return FeatureValue{};
+    return it->second;
 }
 
-template <class PrimaryKey, class SecondaryKey>
-double postings_data<PrimaryKey, SecondaryKey>::count(SecondaryKey s_id) const
+template <class PrimaryKey, class SecondaryKey, class FeatureValue>
+auto postings_data<PrimaryKey, SecondaryKey, FeatureValue>::counts() const
+    -> const count_t &
 {
-    return counts_.at(s_id);
+    return counts_;
 }
 
-template <class PrimaryKey, class SecondaryKey>
-const std::vector<std::pair<SecondaryKey, double>>& postings_data
-    <PrimaryKey, SecondaryKey>::counts() const
+template <class PrimaryKey, class SecondaryKey, class FeatureValue>
+void postings_data<PrimaryKey, SecondaryKey, FeatureValue>::set_counts(
+    const count_t& counts)
 {
-    return counts_.contents();
+    counts_ = counts;
+    std::sort(counts_.begin(), counts_.end(),
+              [](const pair_t& a, const pair_t& b)
+              {
+        return a.first < b.first;
+    });
 }
 
-template <class PrimaryKey, class SecondaryKey>
-void postings_data<PrimaryKey, SecondaryKey>::set_counts(const count_t& counts)
+template <class PrimaryKey, class SecondaryKey, class FeatureValue>
+void postings_data<PrimaryKey, SecondaryKey, FeatureValue>::swap_sorted_counts(
+    count_t& counts)
 {
-    // no sort needed: sparse_vector::contents() sorts the parameter
-    counts_.contents(counts);
+    counts_.swap(counts);
 }
 
-template <class PrimaryKey, class SecondaryKey>
-void postings_data
-    <PrimaryKey, SecondaryKey>::set_primary_key(PrimaryKey new_key)
+template <class PrimaryKey, class SecondaryKey, class FeatureValue>
+void postings_data<PrimaryKey, SecondaryKey, FeatureValue>::set_primary_key(
+    PrimaryKey new_key)
 {
     p_id_ = new_key;
 }
 
-template <class PrimaryKey, class SecondaryKey>
-bool postings_data<PrimaryKey, SecondaryKey>::operator<(const postings_data
-                                                        & other) const
+template <class PrimaryKey, class SecondaryKey, class FeatureValue>
+bool postings_data<PrimaryKey, SecondaryKey, FeatureValue>::operator<(
+    const postings_data& other) const
 {
     return primary_key() < other.primary_key();
 }
 
-template <class PrimaryKey, class SecondaryKey>
-bool operator==(const postings_data<PrimaryKey, SecondaryKey>& lhs,
-                const postings_data<PrimaryKey, SecondaryKey>& rhs)
+template <class PrimaryKey, class SecondaryKey, class FeatureValue>
+bool operator==(
+    const postings_data<PrimaryKey, SecondaryKey, FeatureValue>& lhs,
+    const postings_data<PrimaryKey, SecondaryKey, FeatureValue>& rhs)
 {
     return lhs.primary_key() == rhs.primary_key();
 }
 
-template <class PrimaryKey, class SecondaryKey>
-PrimaryKey postings_data<PrimaryKey, SecondaryKey>::primary_key() const
+template <class PrimaryKey, class SecondaryKey, class FeatureValue>
+PrimaryKey
+    postings_data<PrimaryKey, SecondaryKey, FeatureValue>::primary_key() const
 {
     return p_id_;
 }
 
-template <class PrimaryKey, class SecondaryKey>
-void postings_data
-    <PrimaryKey, SecondaryKey>::write_compressed(io::compressed_file_writer
-                                                 & writer) const
+template <class PrimaryKey, class SecondaryKey, class FeatureValue>
+void postings_data<PrimaryKey, SecondaryKey, FeatureValue>::write_compressed(
+    io::compressed_file_writer& writer) const
 {
-    count_t mutable_counts{counts_.contents()};
-    writer.write(mutable_counts[0].first);
-    if (std::is_same<PrimaryKey, term_id>::value
-        || std::is_same<PrimaryKey, std::string>::value)
-    {
-        writer.write(static_cast<uint64_t>(mutable_counts[0].second));
-    }
-    else
-    {
-        uint64_t to_write;
-        std::memcpy(&to_write, &mutable_counts[0].second,
-                    sizeof(mutable_counts[0].second));
-        writer.write(to_write);
-    }
-
     // use gap encoding on the SecondaryKeys (we know they are integral types)
-    uint64_t cur_id = mutable_counts[0].first;
-    for (size_t i = 1; i < mutable_counts.size(); ++i)
+    uint64_t cur_id = 0;
+    for (const auto& count : counts_)
     {
-        uint64_t temp_id = mutable_counts[i].first;
-        mutable_counts[i].first = mutable_counts[i].first - cur_id;
-        cur_id = temp_id;
-
-        writer.write(mutable_counts[i].first);
-        if (std::is_same<PrimaryKey, term_id>::value
-            || std::is_same<PrimaryKey, std::string>::value)
-        {
-            writer.write(static_cast<uint64_t>(mutable_counts[i].second));
-        }
-        else
-        {
-            uint64_t to_write;
-            std::memcpy(&to_write, &mutable_counts[i].second,
-                        sizeof(mutable_counts[i].second));
-            writer.write(to_write);
-        }
+        uint64_t id = count.first;
+        writer.write(id - cur_id);
+        writer.write(detail::count_bits(count.second));
+        cur_id = id;
     }
 
     // mark end of postings_data
     writer.write(delimiter_);
 }
 
-template <class PrimaryKey, class SecondaryKey>
-void postings_data<PrimaryKey, SecondaryKey>::read_compressed(
+template <class PrimaryKey, class SecondaryKey, class FeatureValue>
+void postings_data<PrimaryKey, SecondaryKey, FeatureValue>::read_compressed(
         io::compressed_file_reader& reader)
 {
     counts_.clear();
@@ -169,13 +218,8 @@ void postings_data<PrimaryKey, SecondaryKey>::read_compressed(
         // we're using gap encoding
         last_id += this_id;
         SecondaryKey key{last_id};
-        uint64_t next = reader.next();
-        double count;
-        if (std::is_same<PrimaryKey, term_id>::value)
-            count = static_cast<double>(next);
-        else
-            std::memcpy(&count, &next, sizeof(next));
-
+        FeatureValue count;
+        detail::from_count_bits(reader.next(), count);
         counts_.emplace_back(key, count);
     }
 
@@ -184,6 +228,186 @@ void postings_data<PrimaryKey, SecondaryKey>::read_compressed(
     counts_.shrink_to_fit();
 }
 
+template <class PrimaryKey, class SecondaryKey, class FeatureValue>
+const uint64_t
+    postings_data<PrimaryKey, SecondaryKey, FeatureValue>::block_size;
+
+template <class PrimaryKey, class SecondaryKey, class FeatureValue>
+void postings_data<PrimaryKey, SecondaryKey, FeatureValue>::write_packed(
+    io::block_file_writer& writer,
+    const std::function<uint64_t(SecondaryKey)>& length /* = {} */) const
+{
+    const auto& counts = counts_;
+    writer.write(counts.size());
+    if (counts.empty())
+        return;
+
+    auto doc_length = [&](SecondaryKey key) -> uint64_t
+    {
+        return length ? length(key) : 0;
+    };
+
+    // encode the blocks first so that the skip table can point into them
+    std::vector<uint64_t> gaps(block_size);
+    std::vector<uint64_t> freqs(block_size);
+    std::vector<uint64_t> last_ids;
+    std::vector<uint64_t> offsets;
+    std::vector<uint8_t> blocks;
+    uint64_t max_count = 0;
+    uint64_t min_length = std::numeric_limits<uint64_t>::max();
+    uint64_t last_id = 0;
+    for (uint64_t start = 0; start < counts.size(); start += block_size)
+    {
+        auto n = std::min(block_size, counts.size() - start);
+        uint64_t block_max_count = 0;
+        uint64_t block_min_length = std::numeric_limits<uint64_t>::max();
+        for (uint64_t i = 0; i < n; ++i)
+        {
+            uint64_t id = counts[start + i].first;
+            auto value = counts[start + i].second;
+            if (!(value >= 1 && value == std::floor(value)))
+                throw postings_data_exception{
+                    "block postings counts must be positive integers, not "
+                    + std::to_string(value)};
+            auto count = static_cast<uint64_t>(value);
+            gaps[i] = id - last_id;
+            freqs[i] = count - 1;
+            last_id = id;
+            block_max_count = std::max(block_max_count, count);
+            block_min_length = std::min(block_min_length,
+                                        doc_length(SecondaryKey{id}));
+        }
+
+        offsets.push_back(blocks.size());
+        last_ids.push_back(last_id);
+        io::block_codec::write_varint(blocks, block_max_count);
+        io::block_codec::write_varint(blocks, block_min_length);
+        io::block_codec::pack(blocks, gaps.data(), n);
+        io::block_codec::pack(blocks, freqs.data(), n);
+        max_count = std::max(max_count, block_max_count);
+        min_length = std::min(min_length, block_min_length);
+    }
+
+    writer.write(max_count);
+    writer.write(min_length);
+    if (last_ids.size() > 1)
+    {
+        writer.write_block(last_ids.data(), last_ids.size());
+        writer.write_block(offsets.data(), offsets.size());
+    }
+    writer.write_bytes(blocks);
+}
+
+template <class PrimaryKey, class SecondaryKey, class FeatureValue>
+void postings_data<PrimaryKey, SecondaryKey, FeatureValue>::read_packed(
+    io::block_file_reader& reader)
+{
+    counts_.clear();
+    auto size = reader.next();
+    if (size == 0)
+        return;
+    counts_.reserve(size);
+    reader.next(); // largest count; only needed for score bounds
+    reader.next(); // smallest document length; likewise
+
+    // the skip table is only needed for random access
+    auto num_blocks = (size + block_size - 1) / block_size;
+    if (num_blocks > 1)
+    {
+        reader.skip_block(num_blocks);
+        reader.skip_block(num_blocks);
+    }
+
+    std::vector<uint64_t> gaps(block_size);
+    std::vector<uint64_t> freqs(block_size);
+    uint64_t last_id = 0;
+    for (uint64_t start = 0; start < size; start += block_size)
+    {
+        auto n = std::min(block_size, size - start);
+        reader.next(); // largest count in the block; only for score bounds
+        reader.next(); // smallest document length in the block; likewise
+        reader.next_block(n, gaps.data());
+        reader.next_block(n, freqs.data());
+        for (uint64_t i = 0; i < n; ++i)
+        {
+            last_id += gaps[i];
+            counts_.emplace_back(SecondaryKey{last_id},
+                                 static_cast<FeatureValue>(freqs[i] + 1));
+        }
+    }
+
+    // compress vector to conserve memory (it shouldn't be modified again after
+    // this)
+    counts_.shrink_to_fit();
+}
+
+template <class PrimaryKey, class SecondaryKey, class FeatureValue>
+void postings_data<PrimaryKey, SecondaryKey, FeatureValue>::write_packed_counts(
+    io::block_file_writer& writer) const
+{
+    // count - 1 would wrap for a zero count and drop a fraction, so lists
+    // with either keep their counts' bits instead
+    const auto& counts = counts_;
+    bool fractional = std::any_of(counts.begin(), counts.end(),
+                                  [](const pair_t& c)
+                                  {
+        return c.second < 1 || c.second != std::floor(c.second);
+    });
+
+    writer.write(counts.size() * 2 + fractional);
+    if (counts.empty())
+        return;
+
+    std::vector<uint64_t> values(counts.size());
+    uint64_t last_id = 0;
+    for (uint64_t i = 0; i < counts.size(); ++i)
+    {
+        uint64_t id = counts[i].first;
+        values[i] = id - last_id;
+        last_id = id;
+    }
+    writer.write_block(values.data(), values.size());
+
+    for (uint64_t i = 0; i < counts.size(); ++i)
+    {
+        if (fractional)
+            values[i] = detail::count_bits(counts[i].second);
+        else
+            values[i] = static_cast<uint64_t>(counts[i].second) - 1;
+    }
+    writer.write_block(values.data(), values.size());
+}
+
+template <class PrimaryKey, class SecondaryKey, class FeatureValue>
+void postings_data<PrimaryKey, SecondaryKey, FeatureValue>::read_packed_counts(
+    io::block_file_reader& reader)
+{
+    counts_.clear();
+    auto header = reader.next();
+    auto size = header / 2;
+    bool fractional = header % 2;
+    if (size == 0)
+        return;
+
+    std::vector<uint64_t> gaps(size);
+    std::vector<uint64_t> values(size);
+    reader.next_block(size, gaps.data());
+    reader.next_block(size, values.data());
+
+    counts_.reserve(size);
+    uint64_t last_id = 0;
+    for (uint64_t i = 0; i < size; ++i)
+    {
+        last_id += gaps[i];
+        FeatureValue count;
+        if (fractional)
+            detail::from_count_bits(values[i], count);
+        else
+            count = static_cast<FeatureValue>(values[i] + 1);
+        counts_.emplace_back(SecondaryKey{last_id}, count);
+    }
+}
+
 namespace
 {
 template <class T>
@@ -201,8 +425,9 @@ uint64_t length(const T& elem, typename std::enable_if<
 }
 }
 
-template <class PrimaryKey, class SecondaryKey>
-uint64_t postings_data<PrimaryKey, SecondaryKey>::bytes_used() const
+template <class PrimaryKey, class SecondaryKey, class FeatureValue>
+uint64_t
+    postings_data<PrimaryKey, SecondaryKey, FeatureValue>::bytes_used() const
 {
     return sizeof(pair_t) * counts_.size() + length(p_id_);
 }
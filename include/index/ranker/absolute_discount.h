@@ -46,6 +46,11 @@ class absolute_discount : public language_model_ranker
      */
     double doc_constant(const score_data& sd) const override;
 
+    /**
+     * @return a key holding this ranker's parameters; see ranker
+     */
+    std::string cache_key() const override;
+
   private:
     /// the absolute discounting parameter
     const double delta_;
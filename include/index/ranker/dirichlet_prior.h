@@ -9,8 +9,10 @@
 #ifndef META_DIRICHLET_PRIOR_H_
 #define META_DIRICHLET_PRIOR_H_
 
+#include "index/ranker/kernel_ranker.h"
 #include "index/ranker/lm_ranker.h"
 #include "index/ranker/ranker_factory.h"
+#include "index/ranker/simd_score.h"
 
 namespace meta
 {
@@ -20,7 +22,8 @@ namespace index
 /**
  * Implements Bayesian smoothing with a Dirichlet prior.
  */
-class dirichlet_prior : public language_model_ranker
+class dirichlet_prior
+    : public kernel_ranker<dirichlet_prior, language_model_ranker>
 {
   public:
     /// Identifier for this ranker.
@@ -46,6 +49,79 @@ class dirichlet_prior : public language_model_ranker
      */
     double doc_constant(const score_data& sd) const override;
 
+    /**
+     * Scores a query term's postings; see kernel_ranker. The document
+     * length cancels out of the smoothed probability ratio, leaving
+     * query_term_weight * log(1 + doc_term_count / (mu * p(t|C))).
+     */
+    struct kernel
+    {
+        /// the query term weight
+        double weight;
+        /// 1 / (mu * p(t|C))
+        double scale;
+        /// the length of the query
+        double query_length;
+
+        /**
+         * @param doc_term_count The number of times the term appears in
+         * the document
+         * @return the term's contribution to the document's score
+         */
+        double operator()(double doc_term_count, float) const
+        {
+            return weight * simd::log1p(doc_term_count * scale);
+        }
+
+        /**
+         * Scores as much of a block of postings as can be vectorized.
+         * @param counts The number of times the term appears in each
+         * document
+         * @param norms Each document's normalizer()
+         * @param scores Set to each posting's score
+         * @param n The number of postings
+         * @return the number of postings scored
+         */
+        uint64_t score_block(const double* counts, const float*,
+                             double* scores, uint64_t n) const
+        {
+            return simd::dirichlet_prior_block(weight, scale, counts, scores,
+                                               n);
+        }
+
+        /**
+         * @param norm The document's normalizer()
+         * @return the document's initial score
+         */
+        double initial(float norm) const
+        {
+            return query_length * norm;
+        }
+    };
+
+    /**
+     * @param sd score_data for the current query term
+     * @return the kernel for scoring the term's postings
+     */
+    kernel prepare(const score_data& sd) const;
+
+    /**
+     * @param doc_size The length of a document
+     * @return log(mu / (doc_size + mu)), the log of doc_constant()
+     */
+    float normalizer(uint64_t doc_size, double) const;
+
+    /**
+     * @return true: the document length cancels out of score_one(), and
+     * initial_score() shrinks as documents get longer
+     */
+    bool supports_pruning() const override;
+
+    /**
+     * @return a key holding this ranker's parameters; see ranker
+     */
+    std::string cache_key() const override;
+
   private:
     /// the Dirichlet prior parameter
     const double mu_;
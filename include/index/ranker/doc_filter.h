@@ -0,0 +1,137 @@
+/**
+ * @file doc_filter.h
+ *
+ * All files in META are dual-licensed under the MIT and NCSA licenses. For more
+ * details, consult the file LICENSE.mit and LICENSE.ncsa in the root of the
+ * project.
+ */
+
+#ifndef META_DOC_FILTER_H_
+#define META_DOC_FILTER_H_
+
+#include <stdexcept>
+#include <vector>
+
+#include "meta.h"
+
+namespace meta
+{
+namespace index
+{
+
+/**
+ * A set of documents that a search is restricted to, such as the training
+ * documents of a k-NN classifier or the documents of one tenant.
+ *
+ * Unlike a filtering function, which ranker::score() calls on every
+ * candidate after it has been scored, a doc_filter is applied before
+ * anything is accumulated: postings of documents outside the set are
+ * never scored, pruned evaluation jumps straight to the next allowed
+ * document, and only allowed documents are considered for the results.
+ *
+ * A filter is stored either as a dense bitset over the index's doc_ids,
+ * which is best when much of the collection is allowed, or as a sorted
+ * list of doc_ids, which is intersected with the postings so that a
+ * search costs in proportion to the size of the list rather than that of
+ * the collection. make() picks whichever is smaller.
+ */
+class doc_filter
+{
+  public:
+    /**
+     * @return the doc_id returned by next() when there is no later
+     * allowed document
+     */
+    static doc_id end_doc();
+
+    /**
+     * @param num_docs The number of documents in the index
+     * @param ids The allowed documents, in any order
+     * @return a filter that stores the documents as a bitset
+     * @throw doc_filter_exception if any id is not less than num_docs
+     */
+    static doc_filter bitset(uint64_t num_docs, const std::vector<doc_id>& ids);
+
+    /**
+     * @param ids The allowed documents, in any order
+     * @return a filter that stores the documents as a sorted list
+     */
+    static doc_filter sorted_ids(std::vector<doc_id> ids);
+
+    /**
+     * @param num_docs The number of documents in the index
+     * @param ids The allowed documents, in any order
+     * @return a bitset filter if at least one in 64 documents is allowed,
+     * and a sorted list filter otherwise
+     */
+    static doc_filter make(uint64_t num_docs, std::vector<doc_id> ids);
+
+    /**
+     * Creates a filter that allows no documents.
+     */
+    doc_filter();
+
+    /**
+     * @param d_id A document
+     * @return whether the document is allowed
+     */
+    bool contains(doc_id d_id) const;
+
+    /**
+     * @param d_id A document
+     * @return the first allowed document no less than d_id, or end_doc()
+     */
+    doc_id next(doc_id d_id) const;
+
+    /**
+     * Calls a function with each allowed document in a range, in order.
+     * @param first The first doc_id of the range
+     * @param last One past the last doc_id of the range
+     * @param fn The function to call
+     */
+    template <class Function>
+    void for_each(doc_id first, doc_id last, Function&& fn) const;
+
+    /**
+     * @return the number of allowed documents
+     */
+    uint64_t size() const;
+
+    /**
+     * @return whether the filter is stored as a bitset
+     */
+    bool is_bitset() const;
+
+    /**
+     * @return the allowed documents in sorted order, if the filter is
+     * stored as a sorted list (and an empty list otherwise)
+     */
+    const std::vector<doc_id>& ids() const;
+
+    /**
+     * Thrown when a filter can't be built.
+     */
+    class doc_filter_exception : public std::runtime_error
+    {
+      public:
+        using std::runtime_error::runtime_error;
+    };
+
+  private:
+    /// Whether the filter is stored in words_ rather than ids_
+    bool dense_;
+
+    /// The number of allowed documents
+    uint64_t size_;
+
+    /// The bits of the allowed documents, if dense_
+    std::vector<uint64_t> words_;
+
+    /// The allowed documents in sorted order, if !dense_
+    std::vector<doc_id> ids_;
+};
+}
+}
+
+#include "index/ranker/doc_filter.tcc"
+#endif
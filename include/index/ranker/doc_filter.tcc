@@ -0,0 +1,41 @@
+/**
+ * @file doc_filter.tcc
+ */
+
+#include <algorithm>
+
+#include "index/ranker/doc_filter.h"
+
+namespace meta
+{
+namespace index
+{
+
+template <class Function>
+void doc_filter::for_each(doc_id first, doc_id last, Function&& fn) const
+{
+    if (!dense_)
+    {
+        auto it = std::lower_bound(ids_.begin(), ids_.end(), first);
+        for (; it != ids_.end() && *it < last; ++it)
+            fn(*it);
+        return;
+    }
+
+    uint64_t end = std::min<uint64_t>(last, words_.size() * 64);
+    for (uint64_t id = first; id < end;)
+    {
+        auto word = words_[id / 64] >> (id % 64);
+        if (word == 0)
+        {
+            // move on to the start of the next word
+            id = (id / 64 + 1) * 64;
+            continue;
+        }
+        if (word & 1)
+            fn(doc_id{id});
+        ++id;
+    }
+}
+}
+}
@@ -9,8 +9,10 @@
 #ifndef META_JELINEK_MERCER_H_
 #define META_JELINEK_MERCER_H_
 
+#include "index/ranker/kernel_ranker.h"
 #include "index/ranker/lm_ranker.h"
 #include "index/ranker/ranker_factory.h"
+#include "index/ranker/simd_score.h"
 
 namespace meta
 {
@@ -23,7 +25,8 @@ namespace index
  * and the collection term probability. The model parameter lambda is the
  * weighting of this interpolation.
  */
-class jelinek_mercer : public language_model_ranker
+class jelinek_mercer
+    : public kernel_ranker<jelinek_mercer, language_model_ranker>
 {
   public:
     /// The identifier for this ranker.
@@ -49,6 +52,78 @@ class jelinek_mercer : public language_model_ranker
      */
     double doc_constant(const score_data& sd) const override;
 
+    /**
+     * Scores a query term's postings; see kernel_ranker. The smoothed
+     * probability ratio simplifies to
+     * 1 + (1 - lambda) * doc_term_count / (lambda * p(t|C) * doc_size).
+     */
+    struct kernel
+    {
+        /// the query term weight
+        double weight;
+        /// (1 - lambda) / (lambda * p(t|C))
+        double scale;
+        /// the initial score, which is the same for every document
+        double initial_score;
+
+        /**
+         * @param doc_term_count The number of times the term appears in
+         * the document
+         * @param norm The document's normalizer()
+         * @return the term's contribution to the document's score
+         */
+        double operator()(double doc_term_count, float norm) const
+        {
+            return weight * simd::log1p(doc_term_count * norm * scale);
+        }
+
+        /**
+         * Scores as much of a block of postings as can be vectorized.
+         * @param counts The number of times the term appears in each
+         * document
+         * @param norms Each document's normalizer()
+         * @param scores Set to each posting's score
+         * @param n The number of postings
+         * @return the number of postings scored
+         */
+        uint64_t score_block(const double* counts, const float* norms,
+                             double* scores, uint64_t n) const
+        {
+            return simd::jelinek_mercer_block(weight, scale, counts, norms,
+                                              scores, n);
+        }
+
+        /**
+         * @return the initial score of every document
+         */
+        double initial(float) const
+        {
+            return initial_score;
+        }
+    };
+
+    /**
+     * @param sd score_data for the current query term
+     * @return the kernel for scoring the term's postings
+     */
+    kernel prepare(const score_data& sd) const;
+
+    /**
+     * @param doc_size The length of a document
+     * @return 1 / doc_size, or 0 for an empty document
+     */
+    float normalizer(uint64_t doc_size, double) const;
+
+    /**
+     * @return true, as initial_score() is constant for this smoothing method
+     */
+    bool supports_pruning() const override;
+
+    /**
+     * @return a key holding this ranker's parameters; see ranker
+     */
+    std::string cache_key() const override;
+
   private:
     /// the JM parameter
     const double lambda_;
@@ -0,0 +1,125 @@
+/**
+ * @file kernel_ranker.h
+ *
+ * All files in META are dual-licensed under the MIT and NCSA licenses. For more
+ * details, consult the file LICENSE.mit and LICENSE.ncsa in the root of the
+ * project.
+ */
+
+#ifndef META_KERNEL_RANKER_H_
+#define META_KERNEL_RANKER_H_
+
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "index/ranker/ranker.h"
+
+namespace meta
+{
+namespace index
+{
+
+/**
+ * A base for rankers whose exhaustive evaluation runs as a tight loop over
+ * each query term's postings, with no virtual calls and no index lookups
+ * per posting.
+ *
+ * The scoring function is split into the parts that depend only on the
+ * query term, only on the document's length, and on the term's count in
+ * the document. Derived (the ranker itself) provides:
+ *
+ *  - `float normalizer(uint64_t doc_size, double avg_dl) const`, the
+ *    length-dependent part. It is computed once for every document of an
+ *    index object and kept in a dense array, which is rebuilt only when
+ *    the average document length used changes, and dropped when the
+ *    index is destroyed.
+ *  - `kernel prepare(const score_data& sd) const`, which computes the
+ *    term-dependent part once per query term. The kernel it returns has
+ *    `double operator()(double doc_term_count, float norm) const`, the
+ *    term's contribution to a document's score, and
+ *    `double initial(float norm) const`, the document's initial score.
+ *    It also has `uint64_t score_block(const double* counts,
+ *    const float* norms, double* scores, uint64_t n) const`, which scores
+ *    as long a prefix of a block of postings as it can with vector
+ *    instructions (see simd_score.h) and returns its length; the kernel
+ *    itself scores the rest.
+ *
+ * score_one() and initial_score() are defined in terms of the same
+ * functions, so every evaluation strategy computes the same scores.
+ *
+ * @tparam Derived The ranker deriving from this class
+ * @tparam Base The class to derive from: ranker or language_model_ranker
+ */
+template <class Derived, class Base = ranker>
+class kernel_ranker : public Base
+{
+  public:
+    /**
+     * @param sd The score_data for the query
+     * @return the contribution of a matched query term to the document's
+     * score
+     */
+    double score_one(const score_data& sd) override;
+
+    /**
+     * @param sd The score_data for the query
+     * @return the constant contribution to the document's score
+     */
+    double initial_score(const score_data& sd) const override;
+
+  protected:
+    /**
+     * Scores a term's postings with the kernel from Derived::prepare(), a
+     * block at a time: each block's counts and normalizers are gathered
+     * into arrays, scored together, and then added to the accumulators.
+     * @param sd The score_data for the query, with the term's fields set
+     * @param counts The term's postings
+     * @param results The score of each document so far
+     */
+    void score_postings(score_data& sd,
+                        const std::vector<compact_posting>& counts,
+                        std::vector<double>& results) override;
+
+  private:
+    /// The number of postings scored together
+    const static constexpr uint64_t block_size = 64;
+
+    /**
+     * The normalizer() of every document of an index.
+     */
+    struct normalizer_table
+    {
+        /// expires when the index the table was built for is destroyed
+        std::weak_ptr<const void> index;
+        /// the average document length it was built with
+        double avg_dl;
+        /// doc_id -> normalizer
+        std::vector<float> norms;
+    };
+
+    /**
+     * @param sd The score_data for the query
+     * @return the normalizers for the index being scored, built first if
+     * there are none or they are out of date
+     */
+    std::shared_ptr<const normalizer_table> normalizers(const score_data& sd);
+
+    /// index generation -> its normalizers; several may be in use at once
+    /// when a ranker scores the segments of a segmented_index. Keying on
+    /// the generation rather than the name keeps an index rebuilt under
+    /// the same name from being scored with the old one's table.
+    std::unordered_map<uint64_t, std::shared_ptr<const normalizer_table>>
+        normalizers_;
+
+    /// Protects normalizers_, as score_batch() scores queries concurrently;
+    /// it is taken once per query (see score_data::ranker_data)
+    std::mutex mutex_;
+};
+}
+}
+
+#include "index/ranker/kernel_ranker.tcc"
+#endif
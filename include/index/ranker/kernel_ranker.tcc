@@ -0,0 +1,107 @@
+/**
+ * @file kernel_ranker.tcc
+ */
+
+#include <algorithm>
+#include <limits>
+
+#include "index/inverted_index.h"
+#include "index/postings_data.h"
+#include "index/ranker/kernel_ranker.h"
+#include "index/score_data.h"
+
+namespace meta
+{
+namespace index
+{
+
+template <class Derived, class Base>
+const constexpr uint64_t kernel_ranker<Derived, Base>::block_size;
+
+template <class Derived, class Base>
+double kernel_ranker<Derived, Base>::score_one(const score_data& sd)
+{
+    const auto& derived = static_cast<const Derived&>(*this);
+    auto kernel = derived.prepare(sd);
+    return kernel(sd.doc_term_count, derived.normalizer(sd.doc_size,
+                                                        sd.avg_dl));
+}
+
+template <class Derived, class Base>
+double kernel_ranker<Derived, Base>::initial_score(const score_data& sd) const
+{
+    const auto& derived = static_cast<const Derived&>(*this);
+    auto kernel = derived.prepare(sd);
+    return kernel.initial(derived.normalizer(sd.doc_size, sd.avg_dl));
+}
+
+template <class Derived, class Base>
+void kernel_ranker<Derived, Base>::score_postings(
+    score_data& sd, const std::vector<compact_posting>& counts,
+    std::vector<double>& results)
+{
+    const auto kernel = static_cast<const Derived&>(*this).prepare(sd);
+    if (!sd.ranker_data)
+        sd.ranker_data = normalizers(sd);
+    const auto& norms
+        = static_cast<const normalizer_table*>(sd.ranker_data.get())->norms;
+
+    double block_counts[block_size];
+    float block_norms[block_size];
+    double block_scores[block_size];
+    for (uint64_t start = 0; start < counts.size(); start += block_size)
+    {
+        auto n = std::min<uint64_t>(block_size, counts.size() - start);
+        for (uint64_t i = 0; i < n; ++i)
+        {
+            const auto& dpair = counts[start + i];
+            block_counts[i] = dpair.second;
+            block_norms[i] = norms[dpair.first];
+        }
+
+        auto done = kernel.score_block(block_counts, block_norms,
+                                       block_scores, n);
+        for (uint64_t i = done; i < n; ++i)
+            block_scores[i] = kernel(block_counts[i], block_norms[i]);
+
+        for (uint64_t i = 0; i < n; ++i)
+        {
+            auto& score = results[counts[start + i].first];
+            if (score == std::numeric_limits<double>::lowest())
+                score = kernel.initial(block_norms[i]);
+            score += block_scores[i];
+        }
+    }
+}
+
+template <class Derived, class Base>
+auto kernel_ranker<Derived, Base>::normalizers(const score_data& sd)
+    -> std::shared_ptr<const normalizer_table>
+{
+    std::lock_guard<std::mutex> lock{mutex_};
+    auto& table = normalizers_[sd.idx.generation()];
+    if (table && table->avg_dl == sd.avg_dl)
+        return table;
+
+    // drop the tables of indexes that no longer exist
+    for (auto it = normalizers_.begin(); it != normalizers_.end();)
+    {
+        if (it->second && it->second->index.expired())
+            it = normalizers_.erase(it);
+        else
+            ++it;
+    }
+
+    const auto& derived = static_cast<const Derived&>(*this);
+    auto fresh = std::make_shared<normalizer_table>();
+    fresh->index = sd.idx.lifetime();
+    fresh->avg_dl = sd.avg_dl;
+    fresh->norms.resize(sd.idx.num_docs());
+    for (uint64_t id = 0; id < fresh->norms.size(); ++id)
+        fresh->norms[id] = derived.normalizer(sd.idx.doc_size(doc_id{id}),
+                                              sd.avg_dl);
+    table = fresh;
+    return table;
+}
+}
+}
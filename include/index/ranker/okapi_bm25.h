@@ -9,8 +9,9 @@
 #ifndef META_OKAPI_BM25_H_
 #define META_OKAPI_BM25_H_
 
-#include "index/ranker/ranker.h"
+#include "index/ranker/kernel_ranker.h"
 #include "index/ranker/ranker_factory.h"
+#include "index/ranker/simd_score.h"
 
 namespace meta
 {
@@ -20,7 +21,7 @@ namespace index
 /**
  * The Okapi BM25 scoring function.
  */
-class okapi_bm25 : public ranker
+class okapi_bm25 : public kernel_ranker<okapi_bm25>
 {
   public:
     /// The identifier for this ranker.
@@ -44,9 +45,71 @@ class okapi_bm25 : public ranker
                double k3 = default_k3);
 
     /**
-     * @param sd score_data for the current query
+     * Scores a query term's postings; see kernel_ranker.
      */
-    double score_one(const score_data& sd) override;
+    struct kernel
+    {
+        /// IDF * QTF * (k1 + 1)
+        double weight;
+
+        /**
+         * @param doc_term_count The number of times the term appears in
+         * the document
+         * @param norm The document's normalizer()
+         * @return the term's contribution to the document's score
+         */
+        double operator()(double doc_term_count, float norm) const
+        {
+            return weight * doc_term_count / (norm + doc_term_count);
+        }
+
+        /**
+         * Scores as much of a block of postings as can be vectorized.
+         * @param counts The number of times the term appears in each
+         * document
+         * @param norms Each document's normalizer()
+         * @param scores Set to each posting's score
+         * @param n The number of postings
+         * @return the number of postings scored
+         */
+        uint64_t score_block(const double* counts, const float* norms,
+                             double* scores, uint64_t n) const
+        {
+            return simd::bm25_block(weight, counts, norms, scores, n);
+        }
+
+        /**
+         * @return 0, as BM25 has no document-dependent constant
+         */
+        double initial(float) const
+        {
+            return 0;
+        }
+    };
+
+    /**
+     * @param sd score_data for the current query term
+     * @return the kernel for scoring the term's postings
+     */
+    kernel prepare(const score_data& sd) const;
+
+    /**
+     * @param doc_size The length of a document
+     * @param avg_dl The average document length
+     * @return k1 * ((1 - b) + b * doc_size / avg_dl)
+     */
+    float normalizer(uint64_t doc_size, double avg_dl) const;
+
+    /**
+     * @return true, since BM25's term frequency component grows with
+     * doc_term_count and shrinks as doc_size grows
+     */
+    bool supports_pruning() const override;
+
+    /**
+     * @return a key holding this ranker's parameters; see ranker
+     */
+    std::string cache_key() const override;
 
   private:
     /// Doc term smoothing
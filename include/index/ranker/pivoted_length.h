@@ -9,8 +9,9 @@
 #ifndef META_PIVOTED_LENGTH_H_
 #define META_PIVOTED_LENGTH_H_
 
-#include "index/ranker/ranker.h"
+#include "index/ranker/kernel_ranker.h"
 #include "index/ranker/ranker_factory.h"
+#include "index/ranker/simd_score.h"
 
 namespace meta
 {
@@ -22,7 +23,7 @@ namespace index
  * @see Amit Singal, Chris Buckley, and Mandar Mitra. Pivoted document length
  * normalization. SIGIR '96, pages 21-29.
  */
-class pivoted_length : public ranker
+class pivoted_length : public kernel_ranker<pivoted_length>
 {
   public:
     /// Identifier for this ranker.
@@ -37,9 +38,72 @@ class pivoted_length : public ranker
     pivoted_length(double s = default_s);
 
     /**
-     * @param sd the score_data for this query
+     * Scores a query term's postings; see kernel_ranker.
      */
-    double score_one(const score_data& sd) override;
+    struct kernel
+    {
+        /// query_term_weight * IDF
+        double weight;
+
+        /**
+         * @param doc_term_count The number of times the term appears in
+         * the document
+         * @param norm The document's normalizer()
+         * @return the term's contribution to the document's score
+         */
+        double operator()(double doc_term_count, float norm) const
+        {
+            return (1 + simd::log(1 + simd::log(doc_term_count))) / norm
+                   * weight;
+        }
+
+        /**
+         * Scores as much of a block of postings as can be vectorized.
+         * @param counts The number of times the term appears in each
+         * document
+         * @param norms Each document's normalizer()
+         * @param scores Set to each posting's score
+         * @param n The number of postings
+         * @return the number of postings scored
+         */
+        uint64_t score_block(const double* counts, const float* norms,
+                             double* scores, uint64_t n) const
+        {
+            return simd::pivoted_length_block(weight, counts, norms, scores,
+                                              n);
+        }
+
+        /**
+         * @return 0, as there is no document-dependent constant
+         */
+        double initial(float) const
+        {
+            return 0;
+        }
+    };
+
+    /**
+     * @param sd the score_data for the current query term
+     * @return the kernel for scoring the term's postings
+     */
+    kernel prepare(const score_data& sd) const;
+
+    /**
+     * @param doc_size The length of a document
+     * @param avg_dl The average document length
+     * @return (1 - s) + s * doc_size / avg_dl
+     */
+    float normalizer(uint64_t doc_size, double avg_dl) const;
+
+    /**
+     * @return true; longer documents are only ever penalized more
+     */
+    bool supports_pruning() const override;
+
+    /**
+     * @return a key holding this ranker's parameters; see ranker
+     */
+    std::string cache_key() const override;
 
   private:
     /// s parameter for pivoted_length normalization
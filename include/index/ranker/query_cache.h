@@ -0,0 +1,171 @@
+/**
+ * @file query_cache.h
+ *
+ * All files in META are dual-licensed under the MIT and NCSA licenses. For more
+ * details, consult the file LICENSE.mit and LICENSE.ncsa in the root of the
+ * project.
+ */
+
+#ifndef META_QUERY_CACHE_H_
+#define META_QUERY_CACHE_H_
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "caching/tinylfu_cache.h"
+#include "meta.h"
+
+namespace meta
+{
+
+namespace corpus
+{
+class document;
+}
+
+namespace index
+{
+
+class inverted_index;
+class ranker;
+
+/**
+ * A cache of the final top-k results of queries, so that a query that has
+ * been answered before is answered again without scoring it.
+ *
+ * Queries are keyed on their analyzed form: the ids and weights of their
+ * terms in sorted order (terms the index does not have only count towards
+ * the query's length), along with the ranker's cache_key(), the number of
+ * results, the index's generation() and its number of deleted documents.
+ * Queries that differ only in the order or spelling of their text
+ * therefore share an entry, while deleting documents, or loading an index
+ * that was rebuilt, merged or reordered in place, makes every earlier
+ * entry unreachable; such entries are left for the budget to evict.
+ * Queries scored by rankers with an empty cache_key() are never cached.
+ *
+ * Entries are kept in a tinylfu_cache bounded by the bytes they occupy,
+ * so a burst of one-off queries cannot push out the popular ones.
+ *
+ * The cache is safe to share between threads, but each thread must score
+ * with its own ranker.
+ */
+class query_cache
+{
+  public:
+    /// The results of a query
+    using result_list = std::vector<std::pair<doc_id, double>>;
+
+    /// The default budget, in bytes
+    const static uint64_t constexpr default_bytes = 1024 * 1024 * 64;
+
+    /**
+     * Counts of how the cache has been used.
+     */
+    struct statistics
+    {
+        /// The number of queries answered from the cache
+        uint64_t hits;
+        /// The number of queries that were scored
+        uint64_t misses;
+        /// The total time taken to answer hits
+        std::chrono::nanoseconds hit_time;
+        /// The total time taken to answer misses (including caching them)
+        std::chrono::nanoseconds miss_time;
+
+        /**
+         * @return the fraction of queries answered from the cache
+         */
+        double hit_rate() const;
+    };
+
+    /**
+     * @param max_bytes The maximum number of bytes of results (and
+     * bookkeeping) to keep
+     */
+    query_cache(uint64_t max_bytes = default_bytes);
+
+    /**
+     * Answers a query from the cache, or scores it and caches the
+     * results.
+     * @param r The ranker to score the query with
+     * @param idx The index to score the query against
+     * @param query The query, which is tokenized if it has not been
+     * @param num_results The number of results to return
+     * @return the results of r.score(idx, query, num_results)
+     */
+    result_list score(ranker& r, inverted_index& idx, corpus::document& query,
+                      uint64_t num_results = 10);
+
+    /**
+     * @return the number of hits and misses so far, and the time taken
+     * to answer them
+     */
+    statistics stats() const;
+
+    /**
+     * @return the number of queries in the cache
+     */
+    uint64_t size() const;
+
+    /**
+     * @return the number of bytes the cache is using
+     */
+    uint64_t bytes() const;
+
+    /**
+     * Empties the cache. The statistics are kept.
+     */
+    void clear();
+
+  private:
+    /**
+     * The cached results of one query.
+     */
+    struct entry
+    {
+        /// the results
+        result_list results;
+        /// the length of the entry's key
+        uint64_t key_bytes;
+
+        /**
+         * @return the number of bytes the results and key occupy
+         */
+        uint64_t bytes_used() const;
+    };
+
+    /**
+     * @param ranker_key The ranker's cache_key()
+     * @param idx The index the query is scored against
+     * @param query The tokenized query
+     * @param num_results The number of results
+     * @return the key of the query's entry
+     */
+    static std::string make_key(const std::string& ranker_key,
+                                inverted_index& idx,
+                                const corpus::document& query,
+                                uint64_t num_results);
+
+    /// the cached results, by query key
+    caching::tinylfu_cache<std::string, std::shared_ptr<const entry>> cache_;
+
+    /// the number of queries answered from the cache
+    std::atomic<uint64_t> hits_;
+
+    /// the number of queries that were scored
+    std::atomic<uint64_t> misses_;
+
+    /// the total time taken to answer hits, in nanoseconds
+    std::atomic<uint64_t> hit_nanos_;
+
+    /// the total time taken to answer misses, in nanoseconds
+    std::atomic<uint64_t> miss_nanos_;
+};
+}
+}
+
+#endif
@@ -9,6 +9,12 @@
 #ifndef META_RANKER_H_
 #define META_RANKER_H_
 
+#include <chrono>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <string>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -24,9 +30,16 @@ class document;
 
 namespace index
 {
+struct compact_posting;
+class doc_filter;
 class inverted_index;
 struct score_data;
 }
+
+namespace parallel
+{
+class thread_pool;
+}
 }
 
 namespace meta
@@ -42,6 +55,55 @@ class ranker
 {
   public:
     /**
+     * The ways in which score() may evaluate a query.
+     */
+    enum class evaluation_strategy
+    {
+        /// Score every document containing a query term (term-at-a-time)
+        exhaustive,
+        /// Document-at-a-time with WAND dynamic pruning
+        wand,
+        /// Document-at-a-time with Block-Max WAND dynamic pruning
+        block_max_wand,
+        /// Score-at-a-time over impact-ordered postings, within a budget
+        score_at_a_time
+    };
+
+    /**
+     * Statistics of a whole collection, for scoring one part of it (such
+     * as a segment of a segmented_index) as if it were all of it.
+     */
+    struct collection_stats
+    {
+        /// the number of documents in the collection
+        uint64_t num_docs;
+        /// the total number of terms in the collection
+        uint64_t total_terms;
+        /// the (document frequency, corpus count) of each query term
+        std::unordered_map<std::string, std::pair<uint64_t, uint64_t>> terms;
+    };
+
+    /**
+     * Scores the documents in an index against a query.
+     *
+     * If a pruned evaluation strategy has been selected, the ranker
+     * supports_pruning(), and the index stores its postings in the block
+     * format, the query is evaluated document-at-a-time and documents
+     * that provably cannot enter the top num_results are skipped. In that
+     * case only documents containing at least one query term are
+     * returned; otherwise, every document is scored exhaustively.
+     *
+     * If score-at-a-time evaluation has been selected and the index has
+     * impact-ordered postings (see inverted_index::build_impacts), the
+     * query's postings are instead visited from the highest impact to the
+     * lowest, summing quantized scores into integer accumulators, until
+     * they run out or the postings or time budget is spent. Scores are
+     * then approximate, and only documents containing a query term are
+     * returned. This assumes that initial_score() is the same for every
+     * document and that score_one() scales with the query term weight
+     * independently of the document, as for okapi_bm25, pivoted_length
+     * and jelinek_mercer.
+     *
      * @param idx The index this ranker is operating on
      * @param query The current query
      * @param num_results The number of results to return in the vector
@@ -55,6 +117,106 @@ class ranker
               return true;
           });
 
+    /**
+     * Scores the documents in an index against a query using another
+     * collection's statistics, so that the scores of documents in
+     * different indexes that are parts of that collection are comparable.
+     * Score-at-a-time evaluation falls back to exhaustive evaluation, as
+     * impacts are computed from the index's own statistics.
+     *
+     * @param idx The index this ranker is operating on
+     * @param query The current query
+     * @param stats The statistics of the collection idx is part of; it
+     * must have an entry for every term of the (tokenized) query
+     * @param num_results The number of results to return in the vector
+     * @param filter A filtering function to apply to each doc_id; returns true
+     * if the document should be included in results
+     */
+    std::vector<std::pair<doc_id, double>>
+    score(inverted_index& idx, corpus::document& query,
+          const collection_stats& stats, uint64_t num_results = 10,
+          const std::function<bool(doc_id d_id)>& filter = [](doc_id) {
+              return true;
+          });
+
+    /**
+     * Scores the documents in an index against a query given by the ids
+     * of its terms, as score() does for a document holding those terms.
+     * Nothing is analyzed and no term is looked up in the vocabulary, so
+     * this suits queries built from indexed documents (see
+     * forward_index::query_terms()).
+     *
+     * @param idx The index this ranker is operating on
+     * @param query The id and weight of each of the query's terms, which
+     * must be distinct
+     * @param num_results The number of results to return in the vector
+     * @param filter A filtering function to apply to each doc_id; returns true
+     * if the document should be included in results
+     */
+    std::vector<std::pair<doc_id, double>>
+    score(inverted_index& idx,
+          const std::vector<std::pair<term_id, double>>& query,
+          uint64_t num_results = 10,
+          const std::function<bool(doc_id d_id)>& filter = [](doc_id) {
+              return true;
+          });
+
+    /**
+     * Scores the documents in an index against a query, as score() does,
+     * considering only the documents a doc_filter allows. Postings of
+     * other documents are skipped before they are scored, so a search
+     * restricted to a small sorted list of documents costs in proportion
+     * to the list rather than to the whole collection.
+     *
+     * @param idx The index this ranker is operating on
+     * @param query The current query
+     * @param allowed The documents that may be returned
+     * @param num_results The number of results to return in the vector
+     */
+    std::vector<std::pair<doc_id, double>>
+    score(inverted_index& idx, corpus::document& query,
+          const doc_filter& allowed, uint64_t num_results = 10);
+
+    /**
+     * Scores the documents in an index against a query given by the ids
+     * of its terms, considering only the documents a doc_filter allows.
+     *
+     * @param idx The index this ranker is operating on
+     * @param query The id and weight of each of the query's terms, which
+     * must be distinct
+     * @param allowed The documents that may be returned
+     * @param num_results The number of results to return in the vector
+     */
+    std::vector<std::pair<doc_id, double>>
+    score(inverted_index& idx,
+          const std::vector<std::pair<term_id, double>>& query,
+          const doc_filter& allowed, uint64_t num_results = 10);
+
+    /**
+     * Scores a batch of queries concurrently, as if by calling score() on
+     * each of them.
+     *
+     * Queries are tokenized up front (analyzers are not thread-safe), then
+     * handed out one at a time to num_threads workers, so a few slow
+     * queries do not hold up the rest. Each worker keeps its own score
+     * accumulator, so the ranker itself may be shared.
+     *
+     * @param idx The index this ranker is operating on
+     * @param queries The queries to score
+     * @param num_results The number of results to return for each query
+     * @param num_threads The number of threads to use, or 0 for one per
+     * hardware thread
+     * @param filter A filtering function to apply to each doc_id; returns true
+     * if the document should be included in results
+     * @return the results for each query, in the same order as queries
+     */
+    std::vector<std::vector<std::pair<doc_id, double>>>
+    score_batch(inverted_index& idx, std::vector<corpus::document>& queries,
+                uint64_t num_results = 10, uint64_t num_threads = 0,
+                const std::function<bool(doc_id d_id)>& filter = [](doc_id) {
+                    return true;
+                });
+
     /**
      * Computes the contribution to the score of a document for a matched
      * query term.
@@ -69,14 +231,296 @@ class ranker
      */
     virtual double initial_score(const score_data& sd) const;
 
+    /**
+     * Whether this ranker's scores can be bounded from above for pruned
+     * evaluation. Rankers that return true must guarantee that score_one()
+     * never decreases as doc_term_count grows or increases as doc_size
+     * grows, and that initial_score() never increases as doc_size grows.
+     * @return whether the pruned evaluation strategies may be used
+     */
+    virtual bool supports_pruning() const;
+
+    /**
+     * Identifies the results this ranker returns, for caching them (see
+     * query_cache). Two rankers with the same non-empty key must return
+     * the same results for every query against the same index.
+     * @return a key made up of the ranker's id and parameters and the way
+     * it evaluates queries, or an empty string (the default) if its
+     * results should not be cached
+     */
+    virtual std::string cache_key() const;
+
+    /**
+     * @param strategy The way score() should evaluate queries
+     */
+    void strategy(evaluation_strategy strategy);
+
+    /**
+     * @return the way score() evaluates queries
+     */
+    evaluation_strategy strategy() const;
+
+    /**
+     * Limits score-at-a-time evaluation to a number of postings per
+     * query, after which the remaining (lowest impact) postings are
+     * skipped.
+     * @param max_postings The number of postings, or 0 for no limit
+     */
+    void postings_budget(uint64_t max_postings);
+
+    /**
+     * Limits score-at-a-time evaluation to an amount of time per query.
+     * The time is checked between segments of equal impact.
+     * @param max_time The time limit, or 0 for no limit
+     */
+    void time_budget(std::chrono::microseconds max_time);
+
+    /**
+     * Scores each query on several threads by splitting the doc_id space
+     * into one range per thread. Each range is scored with its own
+     * accumulator and top-k heap, and its postings cursors skip straight
+     * to its first document, so each thread decodes only its part of
+     * every list; the heaps are merged at the end.
+     *
+     * This applies to exhaustive and (Block-Max) WAND evaluation of
+     * indexes with postings cursors; score-at-a-time evaluation is not
+     * split. The filter passed to score() must be safe to call from
+     * several threads.
+     *
+     * @param num_threads The number of ranges, or 0 or 1 to score each
+     * query on the calling thread
+     */
+    void query_threads(uint64_t num_threads);
+
+    /**
+     * @return the number of threads each query is scored on
+     */
+    uint64_t query_threads() const;
+
     /**
      * Default destructor.
      */
     virtual ~ranker() = default;
 
+  protected:
+    /**
+     * Builds a cache_key() for a ranker.
+     * @param id The ranker's id
+     * @param params The ranker's parameters
+     * @return a key holding the id, the parameters' bits and this
+     * ranker's evaluation strategy and budgets
+     */
+    std::string make_cache_key(const std::string& id,
+                               std::initializer_list<double> params) const;
+
+    /**
+     * Adds one query term's contribution to the scores of the documents
+     * in its postings list during exhaustive evaluation. A document's
+     * initial_score() is added the first time it is seen. The default
+     * calls initial_score() and score_one() for each posting; rankers may
+     * override it with a loop that does less work per posting (see
+     * kernel_ranker).
+     * @param sd The score_data for the query, with the term's fields set
+     * @param counts The term's postings
+     * @param results The score of each document so far, or the lowest
+     * double for documents that have not been seen yet
+     */
+    virtual void score_postings(score_data& sd,
+                                const std::vector<compact_posting>& counts,
+                                std::vector<double>& results);
+
   private:
-    /// results per doc_id
-    std::vector<double> results_;
+    /**
+     * A query term with the statistics it is scored with.
+     */
+    struct query_term
+    {
+        /// the term's id
+        term_id t_id;
+        /// the term's weight in the query
+        double weight;
+        /// the number of documents the term appears in
+        uint64_t doc_count;
+        /// the number of times the term appears in the collection
+        uint64_t corpus_count;
+    };
+
+    /**
+     * A tokenized query, as every evaluation strategy sees it.
+     */
+    struct query_terms
+    {
+        /// the query's terms
+        std::vector<query_term> terms;
+        /// the query's length (the sum of its terms' weights)
+        uint64_t length;
+    };
+
+    /**
+     * @param idx The index the query will be scored against
+     * @param query A tokenized query
+     * @param stats Collection statistics to use instead of the index's,
+     * if any
+     * @return the query's terms and their statistics
+     */
+    static query_terms make_query(inverted_index& idx,
+                                  const corpus::document& query,
+                                  const collection_stats* stats);
+
+    /**
+     * @param idx The index the query will be scored against
+     * @param query The id and weight of each of the query's terms
+     * @return the query's terms and their statistics
+     */
+    static query_terms
+        make_query(inverted_index& idx,
+                   const std::vector<std::pair<term_id, double>>& query);
+
+    /**
+     * Space for accumulating document scores, reused across queries.
+     */
+    struct accumulators
+    {
+        /// the score of each document, for exhaustive evaluation
+        std::vector<double> scores;
+        /// the quantized score of each document, for score-at-a-time
+        /// evaluation; kept zeroed between queries
+        std::vector<uint32_t> impacts;
+    };
+
+    /**
+     * Scores an already tokenized query with the configured strategy.
+     * @param idx The index this ranker is operating on
+     * @param query The current query
+     * @param num_results The number of results to return
+     * @param filter The filtering function for doc_ids
+     * @param allowed The documents that may be scored, or nullptr for all
+     * @param results Scratch space for accumulating document scores
+     * @param stats Collection statistics to use instead of the index's,
+     * if any
+     */
+    std::vector<std::pair<doc_id, double>>
+    score_tokenized(inverted_index& idx, const query_terms& query,
+                    uint64_t num_results,
+                    const std::function<bool(doc_id d_id)>& filter,
+                    const doc_filter* allowed, accumulators& results,
+                    const collection_stats* stats = nullptr);
+
+    /**
+     * Scores documents term-at-a-time, accumulating every document's score.
+     * @param idx The index this ranker is operating on
+     * @param query The current query
+     * @param num_results The number of results to return
+     * @param filter The filtering function for doc_ids
+     * @param allowed The documents that may be scored, or nullptr for all
+     * @param results Scratch space for accumulating document scores
+     * @param stats Collection statistics to use instead of the index's,
+     * if any
+     */
+    std::vector<std::pair<doc_id, double>>
+    score_exhaustive(inverted_index& idx, const query_terms& query,
+                     uint64_t num_results,
+                     const std::function<bool(doc_id d_id)>& filter,
+                     const doc_filter* allowed, std::vector<double>& results,
+                     const collection_stats* stats);
+
+    /**
+     * Scores a range of doc_ids term-at-a-time, reading each term's
+     * postings in the range with a cursor.
+     * @param idx The index this ranker is operating on, which must have
+     * postings cursors
+     * @param query The current query
+     * @param num_results The number of results to return
+     * @param filter The filtering function for doc_ids
+     * @param allowed The documents that may be scored, or nullptr for all
+     * @param results The accumulators; only those in the range are used,
+     * and they must be the lowest double beforehand
+     * @param stats Collection statistics to use instead of the index's,
+     * if any
+     * @param first The first doc_id to score
+     * @param last One past the last doc_id to score
+     */
+    std::vector<std::pair<doc_id, double>>
+    score_exhaustive(inverted_index& idx, const query_terms& query,
+                     uint64_t num_results,
+                     const std::function<bool(doc_id d_id)>& filter,
+                     const doc_filter* allowed, std::vector<double>& results,
+                     const collection_stats* stats, doc_id first,
+                     doc_id last);
+
+    /**
+     * Scores documents document-at-a-time using (Block-Max) WAND.
+     * @param idx The index this ranker is operating on
+     * @param query The current query
+     * @param num_results The number of results to return
+     * @param filter The filtering function for doc_ids
+     * @param allowed The documents that may be scored, or nullptr for all
+     * @param stats Collection statistics to use instead of the index's,
+     * if any
+     * @param first The first doc_id to score
+     * @param last One past the last doc_id to score
+     */
+    std::vector<std::pair<doc_id, double>>
+    score_pruned(inverted_index& idx, const query_terms& query,
+                 uint64_t num_results,
+                 const std::function<bool(doc_id d_id)>& filter,
+                 const doc_filter* allowed, const collection_stats* stats,
+                 doc_id first, doc_id last);
+
+    /**
+     * Scores ranges of doc_ids concurrently (see query_threads()) and
+     * merges their results.
+     * @param idx The index this ranker is operating on
+     * @param query The current query
+     * @param num_results The number of results to return
+     * @param filter The filtering function for doc_ids
+     * @param allowed The documents that may be scored, or nullptr for all
+     * @param pruned Whether to use (Block-Max) WAND within each range
+     * @param results Scratch space for accumulating document scores; each
+     * range only uses its own part
+     * @param stats Collection statistics to use instead of the index's,
+     * if any
+     */
+    std::vector<std::pair<doc_id, double>>
+    score_partitioned(inverted_index& idx, const query_terms& query,
+                      uint64_t num_results,
+                      const std::function<bool(doc_id d_id)>& filter,
+                      const doc_filter* allowed, bool pruned,
+                      std::vector<double>& results,
+                      const collection_stats* stats);
+
+    /**
+     * Scores documents score-at-a-time from impact-ordered postings.
+     * @param idx The index this ranker is operating on
+     * @param query The current query
+     * @param num_results The number of results to return
+     * @param filter The filtering function for doc_ids
+     * @param allowed The documents that may be scored, or nullptr for all
+     * @param results Scratch space for accumulating quantized scores
+     */
+    std::vector<std::pair<doc_id, double>>
+    score_impacts(inverted_index& idx, const query_terms& query,
+                  uint64_t num_results,
+                  const std::function<bool(doc_id d_id)>& filter,
+                  const doc_filter* allowed, std::vector<uint32_t>& results);
+
+    /// results per doc_id, reused across calls to score()
+    accumulators results_;
+
+    /// The way score() evaluates queries
+    evaluation_strategy strategy_ = evaluation_strategy::exhaustive;
+
+    /// The number of postings score-at-a-time evaluation may visit, or 0
+    uint64_t postings_budget_ = 0;
+
+    /// The time score-at-a-time evaluation may take, or 0
+    std::chrono::microseconds time_budget_{0};
+
+    /// The number of threads each query is scored on
+    uint64_t query_threads_ = 0;
+
+    /// The threads that score ranges of doc_ids, if query_threads_ > 1
+    std::shared_ptr<parallel::thread_pool> pool_;
 };
 }
 }
@@ -48,7 +48,10 @@ class ranker_factory : public util::factory<ranker_factory,
 };
 
 /**
- * Convenience method for creating a ranker using the factory.
+ * Convenience method for creating a ranker using the factory. The optional
+ * "evaluation" key selects how queries are evaluated: "exhaustive" (the
+ * default), "wand", or "block-max-wand", and "query-threads" sets
+ * ranker::query_threads().
  */
 std::unique_ptr<ranker> make_ranker(const cpptoml::table&);
 
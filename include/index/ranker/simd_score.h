@@ -0,0 +1,155 @@
+/**
+ * @file simd_score.h
+ *
+ * All files in META are dual-licensed under the MIT and NCSA licenses. For more
+ * details, consult the file LICENSE.mit and LICENSE.ncsa in the root of the
+ * project.
+ */
+
+#ifndef META_SIMD_SCORE_H_
+#define META_SIMD_SCORE_H_
+
+#include <cstdint>
+#include <cstring>
+
+namespace meta
+{
+namespace index
+{
+
+/**
+ * Vectorized scoring of blocks of postings for the rankers built on
+ * kernel_ranker.
+ *
+ * Each block function scores as long a prefix of a block as it can with
+ * AVX2, four postings at a time, and returns its length; the caller
+ * scores the rest with the ranker's scalar kernel. Whether the processor
+ * supports AVX2 is checked at run time, so the functions return 0 when it
+ * does not, or when META was built without AVX2 support.
+ *
+ * The vector code performs the same operations in the same order as the
+ * scalar kernels, including the logarithm below, so both give identical
+ * results as long as neither is contracted into fused multiply-adds; the
+ * build turns contraction off for the rankers and their users.
+ */
+namespace simd
+{
+
+/**
+ * @return whether the block functions use AVX2 on this processor
+ */
+bool has_avx2();
+
+/**
+ * The natural logarithm, as computed by the vector kernels. It reduces x
+ * to 2^e * m with m in [sqrt(2) / 2, sqrt(2)) and sums the atanh series
+ * for log(m) to double precision, so its results are within a couple of
+ * ulps of std::log.
+ * @param x A positive, normal number
+ * @return log(x)
+ */
+inline double log(double x)
+{
+    uint64_t bits;
+    std::memcpy(&bits, &x, sizeof(x));
+
+    // the biased exponent, as a double
+    uint64_t e_bits = (bits >> 52) | 0x4330000000000000ull;
+    double e;
+    std::memcpy(&e, &e_bits, sizeof(e));
+    e = (e - 4503599627370496.0) - 1023.0;
+
+    // the mantissa, in [1, 2)
+    bits = (bits & 0x000FFFFFFFFFFFFFull) | 0x3FF0000000000000ull;
+    double m;
+    std::memcpy(&m, &bits, sizeof(m));
+    if (m > 1.4142135623730951)
+    {
+        m = m * 0.5;
+        e = e + 1.0;
+    }
+
+    double s = (m - 1.0) / (m + 1.0);
+    double z = s * s;
+    double p = 1.0 / 21;
+    p = p * z + 1.0 / 19;
+    p = p * z + 1.0 / 17;
+    p = p * z + 1.0 / 15;
+    p = p * z + 1.0 / 13;
+    p = p * z + 1.0 / 11;
+    p = p * z + 1.0 / 9;
+    p = p * z + 1.0 / 7;
+    p = p * z + 1.0 / 5;
+    p = p * z + 1.0 / 3;
+    p = p * z + 1.0;
+    return e * 0.6931471805599453 + 2.0 * s * p;
+}
+
+/**
+ * log(1 + x), accurate for small x.
+ * @param x A positive number
+ * @return log(1 + x)
+ */
+inline double log1p(double x)
+{
+    double u = 1.0 + x;
+    if (u == 1.0)
+        return x;
+    return log(u) * x / (u - 1.0);
+}
+
+/**
+ * Scores a block of postings with okapi_bm25's kernel.
+ * @param weight The kernel's weight
+ * @param counts The number of times the term appears in each document
+ * @param norms Each document's normalizer
+ * @param scores Set to each posting's score
+ * @param n The number of postings
+ * @return the number of postings scored, from the start of the block
+ */
+uint64_t bm25_block(double weight, const double* counts, const float* norms,
+                    double* scores, uint64_t n);
+
+/**
+ * Scores a block of postings with pivoted_length's kernel.
+ * @param weight The kernel's weight
+ * @param counts The number of times the term appears in each document
+ * @param norms Each document's normalizer
+ * @param scores Set to each posting's score
+ * @param n The number of postings
+ * @return the number of postings scored, from the start of the block
+ */
+uint64_t pivoted_length_block(double weight, const double* counts,
+                              const float* norms, double* scores, uint64_t n);
+
+/**
+ * Scores a block of postings with dirichlet_prior's kernel.
+ * @param weight The kernel's weight
+ * @param scale The kernel's scale
+ * @param counts The number of times the term appears in each document
+ * @param scores Set to each posting's score
+ * @param n The number of postings
+ * @return the number of postings scored, from the start of the block
+ */
+uint64_t dirichlet_prior_block(double weight, double scale,
+                               const double* counts, double* scores,
+                               uint64_t n);
+
+/**
+ * Scores a block of postings with jelinek_mercer's kernel.
+ * @param weight The kernel's weight
+ * @param scale The kernel's scale
+ * @param counts The number of times the term appears in each document
+ * @param norms Each document's normalizer
+ * @param scores Set to each posting's score
+ * @param n The number of postings
+ * @return the number of postings scored, from the start of the block
+ */
+uint64_t jelinek_mercer_block(double weight, double scale,
+                              const double* counts, const float* norms,
+                              double* scores, uint64_t n);
+}
+}
+}
+
+#endif
@@ -0,0 +1,95 @@
+/**
+ * @file reorder.h
+ *
+ * All files in META are dual-licensed under the MIT and NCSA licenses. For more
+ * details, consult the file LICENSE.mit and LICENSE.ncsa in the root of the
+ * project.
+ */
+
+#ifndef META_INDEX_REORDER_H_
+#define META_INDEX_REORDER_H_
+
+#include <string>
+#include <vector>
+
+#include "meta.h"
+
+namespace meta
+{
+namespace index
+{
+
+class disk_index;
+class inverted_index;
+
+/**
+ * Options for bisection_order().
+ */
+struct bisection_options
+{
+    /// The number of rounds of swaps at each level of the recursion
+    uint64_t iterations = 20;
+    /// Partitions with at most this many documents are not split
+    uint64_t min_partition_size = 16;
+    /// Terms in fewer documents than this are ignored
+    uint64_t min_doc_freq = 2;
+};
+
+/**
+ * Orders the live documents of an index by their paths, so that documents
+ * from the same directory (or, for URLs, the same site) end up next to
+ * each other. The host of a URL is compared with its labels reversed
+ * ("www.example.com" as "com.example.www"), so that a site's subdomains
+ * stay together. This is much cheaper than bisection_order() and works
+ * well for crawled collections.
+ * @param idx The index to order
+ * @return the live documents, in their new order
+ */
+std::vector<doc_id> path_order(const disk_index& idx);
+
+/**
+ * Orders the live documents of an index by recursive graph bisection
+ * (Dhulipala et al., "Compressing Graphs and Indexes with Recursive Graph
+ * Bisection", KDD 2016).
+ *
+ * The documents are split in half, and pairs of documents are swapped
+ * between the halves while doing so lowers the estimated cost of coding
+ * the gaps in every postings list (the sum, over terms and halves, of the
+ * term's degree in the half times the log of the half's size over that
+ * degree); then each half is ordered the same way. Documents sharing many
+ * terms end up close together, which shrinks the gaps between them in
+ * postings lists under any codec.
+ *
+ * Each level reads every posting of the terms it considers a few times
+ * per iteration, so this is an offline pass; the document-term graph is
+ * kept in memory with four bytes per posting.
+ * @param idx The index to order
+ * @param options How hard to try
+ * @return the live documents, in their new order
+ */
+std::vector<doc_id> bisection_order(inverted_index& idx,
+                                    const bisection_options& options
+                                    = bisection_options{});
+
+/**
+ * Renumbers the documents of the indexes described by a configuration
+ * so that order[i] becomes doc_id i: the inverted index is rebuilt with
+ * its postings, document metadata, doc_id mapping, positions and impacts
+ * permuted, and so is the forward index if it has been built. Documents
+ * that are not in the order (such as deleted ones) are dropped.
+ *
+ * The new indexes are written next to the old ones and moved into their
+ * place once they are complete, so indexes loaded before the call must
+ * be reloaded afterwards.
+ * @param config_file The configuration of the indexes
+ * @param order The live documents of the inverted index, each once, in
+ * their new order
+ * @throw inverted_index::inverted_index_exception if order holds a
+ * document more than once, or one that is not a live document
+ */
+void reorder_docs(const std::string& config_file,
+                  const std::vector<doc_id>& order);
+}
+}
+
+#endif
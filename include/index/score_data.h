@@ -10,16 +10,12 @@
 #ifndef META_SCORE_DATA_H_
 #define META_SCORE_DATA_H_
 
+#include <memory>
+
 #include "meta.h"
 
 namespace meta
 {
-
-namespace corpus
-{
-class document;
-}
-
 namespace index
 {
 class inverted_index;
@@ -48,8 +44,8 @@ struct score_data
     uint64_t num_docs;
     /// total number of terms in the index
     uint64_t total_terms;
-    /// the current query
-    const corpus::document& query;
+    /// the length of the current query (the sum of its term weights)
+    uint64_t query_length;
 
     // term-based info
 
@@ -73,21 +69,28 @@ struct score_data
     /// number of unique terms in the doc
     uint64_t doc_unique_terms;
 
+    // ranker-specific info
+
+    /// data a ranker derives from the index for the whole query (such as
+    /// kernel_ranker's document normalizers), set the first time it is
+    /// needed so that it is only looked up once per query
+    std::shared_ptr<const void> ranker_data;
+
     /**
      * Constructor to initialize most elements.
      * @param p_idx The index that is being used
      * @param p_avg_dl The average doc length in the index
      * @param p_num_docs The number of docs in the index
      * @param p_total_terms The total number of terms in the index
-     * @param p_query The current query
+     * @param p_query_length The length of the current query
      */
     score_data(inverted_index& p_idx, double p_avg_dl, uint64_t p_num_docs,
-               uint64_t p_total_terms, const corpus::document& p_query)
+               uint64_t p_total_terms, uint64_t p_query_length)
         : idx(p_idx), // gcc no non-const ref init from brace init list
           avg_dl{p_avg_dl},
           num_docs{p_num_docs},
           total_terms{p_total_terms},
-          query(p_query) // gcc no non-const ref init from brace init list
+          query_length{p_query_length}
     {
         /* nothing */
     }
@@ -0,0 +1,229 @@
+/**
+ * @file segmented_index.h
+ *
+ * All files in META are dual-licensed under the MIT and NCSA licenses. For more
+ * details, consult the file LICENSE.mit and LICENSE.ncsa in the root of the
+ * project.
+ */
+
+#ifndef META_SEGMENTED_INDEX_H_
+#define META_SEGMENTED_INDEX_H_
+
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "meta.h"
+
+namespace meta
+{
+
+namespace corpus
+{
+class document;
+}
+
+namespace index
+{
+
+class inverted_index;
+class ranker;
+
+/**
+ * An inverted index that grows by adding segments, so that indexing new
+ * documents costs time proportional to their number rather than to the
+ * size of the whole collection.
+ *
+ * Each segment is a self-contained inverted_index (with its own
+ * vocabulary, postings and document metadata) stored in a subdirectory.
+ * Documents are numbered across segments in the order the segments were
+ * added. Queries are scored on every segment with the statistics of the
+ * whole collection, so scores from different segments are comparable,
+ * and the results are merged.
+ *
+ * To keep the number of segments (and so the cost of a query) small,
+ * segments are merged in the background, with a log-structured policy:
+ * whenever merge_factor adjacent segments have sizes within the same
+ * power of merge_factor, they are merged into one with a chunk_handler.
+ * Only adjacent segments are merged, so a document's id only changes
+ * when a merge drops deleted documents that came before it. Each such
+ * merge starts a new epoch(), and remove() rejects ids from an earlier
+ * one, so an id that has come to name a different document can't delete
+ * it.
+ */
+class segmented_index
+{
+  public:
+    /**
+     * Basic exception for segmented_index interactions.
+     */
+    class segmented_index_exception : public std::runtime_error
+    {
+      public:
+        using std::runtime_error::runtime_error;
+    };
+
+    using exception = segmented_index_exception;
+
+    /// The default number of similarly sized segments that are merged
+    const static uint64_t default_merge_factor = 10;
+
+    /**
+     * Opens the segmented index in the directory given by the
+     * configuration's "inverted-index" key, or creates an empty one.
+     * @param config_file The configuration file for the index
+     * @param merge_factor The number of similarly sized segments to merge
+     * at once (at least 2)
+     */
+    segmented_index(const std::string& config_file,
+                    uint64_t merge_factor = default_merge_factor);
+
+    /**
+     * Waits for any background merge to finish.
+     */
+    ~segmented_index();
+
+    /**
+     * Indexes a corpus as a new segment, then merges segments in the
+     * background if the merge policy calls for it.
+     * @param corpus_config A configuration file whose corpus holds the
+     * documents to add; its analyzers should be the same as the index's
+     */
+    void add(const std::string& corpus_config);
+
+    /**
+     * Deletes a document. Its postings are dropped the next time its
+     * segment is merged, which renumbers the documents after it.
+     * @param d_id The document to delete
+     * @param epoch The epoch() read before d_id was obtained (e.g.,
+     * before the query that returned it was scored)
+     * @throw segmented_index_exception if a merge has renumbered the
+     * documents since then, or if d_id is out of range
+     */
+    void remove(doc_id d_id, uint64_t epoch);
+
+    /**
+     * @return the current numbering of the documents, which changes each
+     * time a merge renumbers them
+     */
+    uint64_t epoch() const;
+
+    /**
+     * Scores the documents in every segment against a query.
+     * @param r The ranker to score the query with
+     * @param query The current query
+     * @param num_results The number of results to return
+     * @param filter A filtering function to apply to each doc_id; returns true
+     * if the document should be included in results
+     * @return the top documents, with their ids in the segmented index
+     */
+    std::vector<std::pair<doc_id, double>>
+    score(ranker& r, corpus::document& query, uint64_t num_results = 10,
+          const std::function<bool(doc_id d_id)>& filter = [](doc_id) {
+              return true;
+          });
+
+    /**
+     * @return the number of documents in the index
+     */
+    uint64_t num_docs() const;
+
+    /**
+     * @return the number of segments the index is currently split into
+     */
+    uint64_t num_segments() const;
+
+    /**
+     * @param d_id The document to look up
+     * @return the path to the document
+     */
+    std::string doc_path(doc_id d_id) const;
+
+    /**
+     * Blocks until no merge is running or waiting to run.
+     * @throw segmented_index_exception (or whatever else a merge threw) if
+     * a background merge failed
+     */
+    void wait_for_merges();
+
+  private:
+    /**
+     * @return a copy of the current list of segments, which stays usable
+     * while segments are merged
+     */
+    std::vector<std::shared_ptr<inverted_index>> snapshot() const;
+
+    /**
+     * Opens an existing segment, or creates a new one from a corpus.
+     * @param name The segment's directory name
+     * @param config_file The configuration to create the segment from, if
+     * it does not exist yet
+     * @return the segment
+     */
+    std::shared_ptr<inverted_index>
+        open_segment(const std::string& name, const std::string& config_file);
+
+    /**
+     * Starts a background merge if one is not already running. Must be
+     * called with mutex_ held.
+     */
+    void schedule_merge();
+
+    /**
+     * Finds the first run of segments the merge policy says to merge.
+     * Must be called with mutex_ held.
+     * @param first Set to the position of the first segment of the run
+     * @return whether a run was found
+     */
+    bool find_merge(uint64_t& first) const;
+
+    /**
+     * Merges segments until the merge policy is satisfied; run in the
+     * background.
+     */
+    void merge();
+
+    /**
+     * Writes the list of segments to disk. Must be called with mutex_
+     * held.
+     */
+    void save_manifest() const;
+
+    /// The directory the index is stored in
+    std::string name_;
+
+    /// The configuration file the index was opened with
+    std::string config_file_;
+
+    /// The number of similarly sized segments to merge at once
+    uint64_t merge_factor_;
+
+    /// The segments, in document order
+    std::vector<std::shared_ptr<inverted_index>> segments_;
+
+    /// The directory names of the segments
+    std::vector<std::string> segment_names_;
+
+    /// The number to give the next segment's directory
+    uint64_t next_segment_;
+
+    /// The number of merges that have renumbered documents
+    uint64_t epoch_;
+
+    /// Whether a background merge is running
+    bool merging_;
+
+    /// The background merge, if one has been started
+    std::future<void> merge_task_;
+
+    /// Protects the segment list and the merge state
+    mutable std::mutex mutex_;
+};
+}
+}
+
+#endif
@@ -0,0 +1,125 @@
+/**
+ * @file term_dictionary.h
+ *
+ * All files in META are dual-licensed under the MIT and NCSA licenses. For more
+ * details, consult the file LICENSE.mit and LICENSE.ncsa in the root of the
+ * project.
+ */
+
+#ifndef META_TERM_DICTIONARY_H_
+#define META_TERM_DICTIONARY_H_
+
+#include <string>
+#include <utility>
+
+#include "io/mmap_file.h"
+#include "util/disk_vector.h"
+#include "util/minimal_perfect_hash.h"
+#include "util/optional.h"
+#include "meta.h"
+
+namespace meta
+{
+namespace index
+{
+
+/**
+ * A read-only term dictionary, mapping terms to term_ids and back. It
+ * reads the files written by term_dictionary_writer.
+ *
+ * Terms are numbered in sorted order and stored front-coded in blocks of
+ * block_size: the first term of each block is stored whole, and each of
+ * the others as the length of the prefix it shares with the term before
+ * it followed by the rest of it. The ".index" file holds the number of
+ * terms and then the byte position of each block, so a term_id's term is
+ * found by decoding at most one block. Since the terms are sorted, the
+ * same blocks also answer ordered queries with a binary search over the
+ * blocks' first terms.
+ *
+ * Exact lookups instead use the ".hash" file: a minimal_perfect_hash of
+ * the terms' distinct hashes, followed by the term_id stored in each of
+ * its slots. The term found in the slot is checked against the one being
+ * looked up, so a lookup costs a hash, a probe or two of the function's
+ * bits and the decoding of one block. The rare slots whose hash is shared
+ * by several terms are marked with shared_hash, and lookups that land on
+ * one search the blocks instead.
+ *
+ * Nothing is modified after construction, so every operation is safe to
+ * call from several threads without locking.
+ */
+class term_dictionary
+{
+  public:
+    /// The number of terms in each front-coded block
+    const static constexpr uint64_t block_size = 16;
+
+    /// Set in a slot of the ".hash" file whose hash several terms share
+    const static constexpr uint64_t shared_hash = uint64_t{1} << 63;
+
+    /**
+     * Opens a dictionary.
+     * @param path The path to the dictionary's blocks; the other files
+     * are at the same path with ".index" and ".hash" appended
+     */
+    term_dictionary(const std::string& path);
+
+    /**
+     * @param term The term to look up
+     * @return its term_id, if it is in the dictionary
+     */
+    util::optional<term_id> find(const std::string& term) const;
+
+    /**
+     * @param t_id A term_id, which must be less than size()
+     * @return the term with that id
+     */
+    std::string find_term(term_id t_id) const;
+
+    /**
+     * @param term A string
+     * @return the id of the first term that does not compare less than
+     * it, or size() if there is none
+     */
+    term_id lower_bound(const std::string& term) const;
+
+    /**
+     * @param prefix A string
+     * @return the range [first, last) of the ids of the terms that start
+     * with the prefix
+     */
+    std::pair<term_id, term_id> prefix_range(const std::string& prefix) const;
+
+    /**
+     * @return the number of terms in the dictionary
+     */
+    uint64_t size() const;
+
+    /**
+     * @param term A term
+     * @return the hash of the term stored in the ".hash" file
+     */
+    static uint64_t hash(const std::string& term);
+
+  private:
+    /**
+     * @param block A block
+     * @return its first term
+     */
+    std::string first_term(uint64_t block) const;
+
+    /// The front-coded blocks
+    io::mmap_file blocks_;
+
+    /// The number of terms, then the byte position of each block
+    util::disk_vector<uint64_t> index_;
+
+    /// The minimal perfect hash, then the term_id in each of its slots
+    util::disk_vector<uint64_t> hash_;
+
+    /// The minimal perfect hash stored at the start of hash_
+    util::minimal_perfect_hash mphf_;
+};
+}
+}
+
+#endif
@@ -0,0 +1,93 @@
+/**
+ * @file term_dictionary_writer.h
+ *
+ * All files in META are dual-licensed under the MIT and NCSA licenses. For more
+ * details, consult the file LICENSE.mit and LICENSE.ncsa in the root of the
+ * project.
+ */
+
+#ifndef META_TERM_DICTIONARY_WRITER_H_
+#define META_TERM_DICTIONARY_WRITER_H_
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "io/block_file_writer.h"
+
+namespace meta
+{
+namespace index
+{
+
+/**
+ * Writes the files read by term_dictionary in a single pass over the
+ * terms, which must be inserted in sorted order; each is given the next
+ * term_id. Only the position of each block and the hash of each term are
+ * kept in memory, and the minimal perfect hash is built from the hashes
+ * when the writer is finished.
+ *
+ * *This class is not internally synchronized.*
+ */
+class term_dictionary_writer
+{
+  public:
+    /**
+     * @param path The path to write the dictionary's blocks to; the other
+     * files are written at the same path with ".index" and ".hash"
+     * appended
+     */
+    term_dictionary_writer(const std::string& path);
+
+    /**
+     * Finishes the dictionary if finish() has not been called.
+     */
+    ~term_dictionary_writer();
+
+    /**
+     * Appends a term to the dictionary.
+     * @param term The term, which must be greater than the last one
+     * @throw term_dictionary_writer_exception if it is not
+     */
+    void insert(const std::string& term);
+
+    /**
+     * Writes the block index and the minimal perfect hash.
+     */
+    void finish();
+
+    /**
+     * An exception that can be thrown while writing the dictionary.
+     */
+    class term_dictionary_writer_exception : public std::runtime_error
+    {
+      public:
+        using std::runtime_error::runtime_error;
+    };
+
+  private:
+    /// The path to the blocks file
+    std::string path_;
+
+    /// Writes the blocks file
+    io::block_file_writer file_;
+
+    /// The number of terms, then the byte position of each block
+    std::vector<uint64_t> index_;
+
+    /// The hash of each term, by term_id
+    std::vector<uint64_t> hashes_;
+
+    /// The last term inserted
+    std::string last_;
+
+    /// Scratch space for writing a term's bytes
+    std::vector<uint8_t> bytes_;
+
+    /// Whether finish() has been called
+    bool finished_;
+};
+}
+}
+
+#endif
@@ -0,0 +1,152 @@
+/**
+ * @file access_policy.h
+ *
+ * All files in META are dual-licensed under the MIT and NCSA licenses. For more
+ * details, consult the file LICENSE.mit and LICENSE.ncsa in the root of the
+ * project.
+ */
+
+#ifndef META_IO_ACCESS_POLICY_H_
+#define META_IO_ACCESS_POLICY_H_
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace meta
+{
+namespace io
+{
+
+/**
+ * How a memory-mapped file is going to be read, so the kernel can page it
+ * in accordingly.
+ */
+enum class access_policy
+{
+    /// Leave paging to the kernel's defaults
+    normal,
+    /// Read front to back once, as when merging chunks: read ahead
+    /// aggressively and drop pages behind the reader
+    sequential,
+    /// Read in small, scattered pieces, as postings lists are: don't read
+    /// ahead, but let prefetch() ask for a known range up front
+    random,
+    /// Small and read everywhere, as document lengths are: fault the whole
+    /// file in when it is mapped
+    populate
+};
+
+/**
+ * Basic exception for access_policy interactions.
+ */
+class access_policy_exception : public std::runtime_error
+{
+  public:
+    using std::runtime_error::runtime_error;
+};
+
+/**
+ * @param name "normal", "sequential", "random" or "populate"
+ * @return the access_policy with the given name
+ */
+inline access_policy access_policy_from_string(const std::string& name)
+{
+    if (name == "normal")
+        return access_policy::normal;
+    if (name == "sequential")
+        return access_policy::sequential;
+    if (name == "random")
+        return access_policy::random;
+    if (name == "populate")
+        return access_policy::populate;
+    throw access_policy_exception{"unknown mmap access policy: " + name};
+}
+
+namespace mmap_advice
+{
+/**
+ * @param policy How the mapping will be read
+ * @return the extra mmap() flags the policy needs
+ */
+inline int map_flags(access_policy policy)
+{
+#ifdef MAP_POPULATE
+    if (policy == access_policy::populate)
+        return MAP_POPULATE;
+#else
+    (void)policy;
+#endif
+    return 0;
+}
+
+/**
+ * Tells the kernel how a new mapping will be read. Advice is only a hint,
+ * so failures (and platforms without a given kind of advice) are ignored.
+ *
+ * Transparent huge pages are requested with MADV_HUGEPAGE rather than
+ * MAP_HUGETLB, which needs a hugetlbfs file and so cannot map an index
+ * file; kernels that can't back a file mapping with huge pages ignore it.
+ *
+ * @param start The start of the mapping
+ * @param length The length of the mapping in bytes
+ * @param policy How the mapping will be read
+ * @param huge_pages Whether to ask for transparent huge pages
+ */
+inline void advise(void* start, uint64_t length, access_policy policy,
+                   bool huge_pages)
+{
+    if (start == nullptr || length == 0)
+        return;
+
+    switch (policy)
+    {
+        case access_policy::sequential:
+            madvise(start, length, MADV_SEQUENTIAL);
+            break;
+        case access_policy::random:
+            madvise(start, length, MADV_RANDOM);
+            break;
+        case access_policy::populate:
+            madvise(start, length, MADV_WILLNEED);
+            break;
+        case access_policy::normal:
+            break;
+    }
+
+#ifdef MADV_HUGEPAGE
+    if (huge_pages)
+        madvise(start, length, MADV_HUGEPAGE);
+#else
+    (void)huge_pages;
+#endif
+}
+
+/**
+ * Asks the kernel to start reading part of a mapping in, without waiting
+ * for it. The range is widened to whole pages and clipped to the mapping.
+ *
+ * @param start The start of the mapping
+ * @param size The length of the mapping in bytes
+ * @param offset The first byte of the range
+ * @param length The length of the range in bytes
+ */
+inline void prefetch(const void* start, uint64_t size, uint64_t offset,
+                     uint64_t length)
+{
+    if (start == nullptr || offset >= size || length == 0)
+        return;
+
+    uint64_t end = length > size - offset ? size : offset + length;
+    uint64_t page = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+    offset -= offset % page;
+    auto first = const_cast<char*>(static_cast<const char*>(start)) + offset;
+    madvise(first, end - offset, MADV_WILLNEED);
+}
+}
+}
+}
+
+#endif
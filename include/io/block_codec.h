@@ -0,0 +1,107 @@
+/**
+ * @file block_codec.h
+ *
+ * All files in META are dual-licensed under the MIT and NCSA licenses. For more
+ * details, consult the file LICENSE.mit and LICENSE.ncsa in the root of the
+ * project.
+ */
+
+#ifndef META_IO_BLOCK_CODEC_H_
+#define META_IO_BLOCK_CODEC_H_
+
+#include <cstdint>
+#include <vector>
+
+namespace meta
+{
+namespace io
+{
+
+/**
+ * Word-aligned integer coding routines used by the block postings format.
+ *
+ * Integers are stored either as LEB128-style variable byte integers (for
+ * headers and other scalars) or in bit-packed blocks: a single byte
+ * giving the bit width w of the largest value in the block, followed by
+ * the values packed w bits apiece into little-endian 64-bit words. Blocks
+ * are unpacked by a routine specialized for each possible width, so
+ * decoding a block is a tight shift-and-mask loop instead of a
+ * bit-at-a-time walk.
+ */
+namespace block_codec
+{
+
+/**
+ * @param value The value to measure
+ * @return the number of bits needed to represent value
+ */
+uint8_t bit_width(uint64_t value);
+
+/**
+ * @param values The values to be packed
+ * @param n The number of values
+ * @return the smallest bit width that can represent every value
+ */
+uint8_t bit_width(const uint64_t* values, uint64_t n);
+
+/**
+ * @param n The number of values in a block
+ * @param width The bit width of the block
+ * @return the number of bytes the packed payload (excluding the width
+ * byte) takes up
+ */
+uint64_t packed_bytes(uint64_t n, uint8_t width);
+
+/**
+ * Appends a variable byte encoded integer to a buffer.
+ * @param out The buffer to append to
+ * @param value The value to encode
+ */
+void write_varint(std::vector<uint8_t>& out, uint64_t value);
+
+/**
+ * Decodes a variable byte encoded integer.
+ * @param in The position to decode from; advanced past the integer
+ * @return the decoded value
+ */
+uint64_t read_varint(const uint8_t*& in);
+
+/**
+ * Appends a bit-packed block of integers to a buffer.
+ * @param out The buffer to append to
+ * @param values The values to pack
+ * @param n The number of values
+ */
+void pack(std::vector<uint8_t>& out, const uint64_t* values, uint64_t n);
+
+/**
+ * Decodes a bit-packed block of integers.
+ * @param in The position of the block's width byte
+ * @param n The number of values in the block
+ * @param out Where to write the decoded values (must hold n values)
+ * @return the position just past the end of the block
+ */
+const uint8_t* unpack(const uint8_t* in, uint64_t n, uint64_t* out);
+
+/**
+ * Decodes a single value of a bit-packed block. Since every value in a
+ * block has the same width, this is a constant time operation, which lets
+ * packed blocks double as random-access arrays.
+ * @param in The position of the block's width byte
+ * @param i The index of the value to decode
+ * @return the i-th value of the block
+ */
+uint64_t packed_at(const uint8_t* in, uint64_t i);
+
+/**
+ * @param in The position of the block's width byte
+ * @param n The number of values in the block
+ * @return the position just past the end of the block, without decoding
+ * any of its values
+ */
+const uint8_t* skip(const uint8_t* in, uint64_t n);
+}
+}
+}
+
+#endif
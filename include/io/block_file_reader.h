@@ -0,0 +1,121 @@
+/**
+ * @file block_file_reader.h
+ *
+ * All files in META are dual-licensed under the MIT and NCSA licenses. For more
+ * details, consult the file LICENSE.mit and LICENSE.ncsa in the root of the
+ * project.
+ */
+
+#ifndef META_BLOCK_FILE_READER_H_
+#define META_BLOCK_FILE_READER_H_
+
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+namespace meta
+{
+namespace io
+{
+
+class mmap_file;
+
+/**
+ * Reads a file written by a block_file_writer. Reading never copies the
+ * file: values are decoded straight out of the memory-mapped region.
+ */
+class block_file_reader
+{
+  public:
+    /**
+     * Constructor; reads from an already memory-mapped file.
+     * @param file The file to read from
+     */
+    block_file_reader(const mmap_file& file);
+
+    /**
+     * Constructor to create a new mmap file for reading.
+     * @param filename The filename for the new file to read from
+     */
+    block_file_reader(const std::string& filename);
+
+    /**
+     * Destructor.
+     */
+    ~block_file_reader();
+
+    /**
+     * Sets the cursor to the specified position in the file.
+     * @param byte_offset Byte offset into the file
+     */
+    void seek(uint64_t byte_offset);
+
+    /**
+     * @return whether there is more data in the file
+     */
+    bool has_next() const;
+
+    /**
+     * @return the next variable byte encoded number
+     */
+    uint64_t next();
+
+    /**
+     * Decodes the next bit-packed block.
+     * @param n The number of values in the block
+     * @param out Where to write the values (must hold n values)
+     */
+    void next_block(uint64_t n, uint64_t* out);
+
+    /**
+     * Moves past the next bit-packed block without decoding it.
+     * @param n The number of values in the block
+     */
+    void skip_block(uint64_t n);
+
+    /**
+     * Moves the cursor forward.
+     * @param bytes The number of bytes to skip
+     */
+    void skip_bytes(uint64_t bytes);
+
+    /**
+     * @return the current byte location in this file
+     */
+    uint64_t byte_location() const;
+
+    /**
+     * Closes this file if it is owned by this reader.
+     */
+    void close();
+
+  private:
+    /**
+     * Pointer to the mmap_file we are reading: nullptr if we don't own it,
+     * initialized if we do
+     */
+    std::unique_ptr<mmap_file> file_;
+
+    /// Pointer to the beginning of the file
+    const uint8_t* start_;
+
+    /// The number of bytes in this file
+    uint64_t size_;
+
+    /// The current read position
+    const uint8_t* cursor_;
+
+  public:
+    /**
+     * Basic exception for block_file_reader interactions.
+     */
+    class block_file_reader_exception : public std::runtime_error
+    {
+      public:
+        using std::runtime_error::runtime_error;
+    };
+};
+}
+}
+
+#endif
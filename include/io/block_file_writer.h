@@ -0,0 +1,104 @@
+/**
+ * @file block_file_writer.h
+ *
+ * All files in META are dual-licensed under the MIT and NCSA licenses. For more
+ * details, consult the file LICENSE.mit and LICENSE.ncsa in the root of the
+ * project.
+ */
+
+#ifndef META_BLOCK_FILE_WRITER_H_
+#define META_BLOCK_FILE_WRITER_H_
+
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace meta
+{
+namespace io
+{
+
+/**
+ * Writes a byte-aligned file of variable byte integers and bit-packed
+ * blocks of integers (see io::block_codec).
+ */
+class block_file_writer
+{
+  public:
+    /**
+     * Constructor; opens a file for writing, truncating it if it already
+     * exists.
+     * @param filename The path to the file
+     */
+    block_file_writer(const std::string& filename);
+
+    /**
+     * block_file_writer may be move constructed.
+     */
+    block_file_writer(block_file_writer&&);
+
+    /**
+     * Destructor; closes the file.
+     */
+    ~block_file_writer();
+
+    /**
+     * @return the number of bytes written so far
+     */
+    uint64_t byte_location() const;
+
+    /**
+     * Writes a variable byte encoded integer.
+     * @param value The number to write
+     */
+    void write(uint64_t value);
+
+    /**
+     * Writes a block of integers, bit-packed to the width of the largest
+     * one.
+     * @param values The numbers to write
+     * @param n The number of values to write
+     */
+    void write_block(const uint64_t* values, uint64_t n);
+
+    /**
+     * Writes raw, already encoded bytes.
+     * @param bytes The bytes to write
+     */
+    void write_bytes(const std::vector<uint8_t>& bytes);
+
+    /**
+     * Closes this file.
+     */
+    void close();
+
+  private:
+    /**
+     * Writes the buffer to the file.
+     */
+    void flush();
+
+    /// Where to write the data
+    FILE* outfile_;
+
+    /// Encoded data that is not yet written to disk
+    std::vector<uint8_t> buffer_;
+
+    /// The number of bytes written (for seeking)
+    uint64_t byte_location_;
+
+  public:
+    /**
+     * Basic exception for block_file_writer interactions.
+     */
+    class block_file_writer_exception : public std::runtime_error
+    {
+      public:
+        using std::runtime_error::runtime_error;
+    };
+};
+}
+}
+
+#endif
@@ -15,6 +15,8 @@
 #include <stdexcept>
 #include <string>
 
+#include "io/access_policy.h"
+
 namespace meta
 {
 namespace io
@@ -55,9 +57,11 @@ class compressed_file_reader
      * @param mapping A function to map the original numbers to their
      * compressed id, usually to take advantage of a skewed distribution of
      * towards many small numbers
+     * @param policy How the file is going to be read
      */
     compressed_file_reader(const std::string& filename,
-                           std::function<uint64_t(uint64_t)> mapping);
+                           std::function<uint64_t(uint64_t)> mapping,
+                           access_policy policy = access_policy::normal);
 
     /**
      * Destructor.
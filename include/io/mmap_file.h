@@ -13,6 +13,8 @@
 #include <stdexcept>
 #include <string>
 
+#include "io/access_policy.h"
+
 namespace meta
 {
 namespace io
@@ -27,8 +29,12 @@ class mmap_file
     /**
      * Constructor.
      * @param path Path to the text file to open
+     * @param policy How the file is going to be read
+     * @param huge_pages Whether to ask for transparent huge pages
      */
-    mmap_file(const std::string& path);
+    mmap_file(const std::string& path,
+              access_policy policy = access_policy::normal,
+              bool huge_pages = false);
 
     /**
      * Move constructor.
@@ -69,6 +75,15 @@ class mmap_file
      */
     char* begin() const;
 
+    /**
+     * Asks the operating system to start reading a range of the file into
+     * memory, so that reading it later does not wait on one page fault at
+     * a time. Ranges beyond the end of the file are ignored.
+     * @param offset The first byte of the range
+     * @param length The length of the range in bytes
+     */
+    void prefetch(uint64_t offset, uint64_t length) const;
+
   private:
     /// Filename of the text file
     std::string path_;
@@ -18,7 +18,8 @@ namespace testing
 {
 
 /**
- * Tests compressed_file_reader and compressed_file_writer.
+ * Tests compressed_file_reader and compressed_file_writer, as well as
+ * block_file_reader and block_file_writer.
  */
 int compression_tests();
 }
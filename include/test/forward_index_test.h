@@ -55,6 +55,14 @@ void check_bcancer_doc_id(Index& idx);
 template <class Index>
 void check_ceeaus_doc_id(Index& idx);
 
+/**
+ * Asserts that every document's libsvm export parses back into the same
+ * counts as its packed vector.
+ * @param idx The index to use
+ */
+template <class Index>
+void check_libsvm_export(Index& idx);
+
 /**
  * Runs the ceeaus forward index tests.
  */
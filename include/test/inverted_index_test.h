@@ -12,10 +12,21 @@
 
 #include <fstream>
 #include <iostream>
+#include <map>
+#include <sstream>
 #include "test/unit_test.h"
+#include "corpus/document.h"
+#include "index/chunk_handler.h"
+#include "index/forward_index.h"
 #include "index/inverted_index.h"
+#include "index/postings_accumulator.h"
 #include "index/postings_data.h"
+#include "index/ranker/okapi_bm25.h"
+#include "index/reorder.h"
+#include "index/segmented_index.h"
 #include "caching/all.h"
+#include "io/libsvm_parser.h"
+#include "util/filesystem.h"
 #include "cpptoml.h"
 
 namespace meta
@@ -25,8 +36,15 @@ namespace testing
 /**
  * Creates test-config.toml with the desired settings.
  * @param corpus_type line or file corpus
+ * @param postings_codec The format to write the inverted index postings in
+ * @param combined_build Whether a forward index should be built in the same
+ * pass as its inverted index
+ * @param store_positions Whether the inverted index should store term
+ * positions
  */
-void create_config(const std::string& corpus_type);
+void create_config(const std::string& corpus_type,
+                   const std::string& postings_codec = "gamma",
+                   bool combined_build = false, bool store_positions = false);
 
 /**
  * Checks that ceeaus index was built correctly.
@@ -42,6 +60,52 @@ void check_ceeaus_expected(Index& idx);
 template <class Index>
 void check_term_id(Index& idx);
 
+/**
+ * Checks the stored term and corpus statistics against the fully decoded
+ * postings lists.
+ * @param idx The index to check
+ */
+template <class Index>
+void check_term_stats(Index& idx);
+
+/**
+ * Checks that postings cursors, term_freq, and intersect agree with the
+ * fully decoded postings lists.
+ * @param idx The index to check (which must use the block postings codec)
+ */
+template <class Index>
+void check_cursors(Index& idx);
+
+/**
+ * Checks the stored positions against the postings, and that phrase and
+ * proximity queries find the documents they should.
+ * @param idx The index to check
+ */
+template <class Index>
+void check_positions(Index& idx);
+
+/**
+ * Checks that a postings_accumulator combines out of order and duplicate
+ * postings across many slice levels, and reuses its pages once drained.
+ */
+template <class FeatureValue>
+void check_postings_accumulator();
+
+/**
+ * Checks that postings written by write_packed_counts() read back exactly,
+ * including zero and fractional counts, and that write_packed() rejects
+ * counts other than positive integers.
+ * @param values The counts to write
+ */
+template <class FeatureValue>
+void check_packed_counts(const std::vector<FeatureValue>& values);
+
+/**
+ * Checks that a tinylfu_cache stays within its byte budget and admits
+ * new keys only if they are requested more often than those they evict.
+ */
+void check_tinylfu_cache();
+
 /**
  * Runs the inverted index tests.
  * @return the number of tests failed
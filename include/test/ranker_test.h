@@ -27,6 +27,83 @@ namespace testing
 template <class Ranker, class Index>
 void test_rank(Ranker& r, Index& idx);
 
+/**
+ * Queries a block postings index with its own docs to ensure that the
+ * pruned evaluation strategies score the same top documents as exhaustive
+ * evaluation.
+ * @param r The ranker to test
+ * @param idx The index to use
+ * @param encoding The encoding of the documents
+ */
+template <class Ranker, class Index>
+void test_pruned_rank(Ranker& r, Index& idx, const std::string& encoding);
+
+/**
+ * Queries an index with its own docs to ensure that score-at-a-time
+ * evaluation over impact-ordered postings approximates the exhaustive
+ * scores to within the quantization error, and that it respects a postings
+ * budget.
+ * @param r The ranker to test
+ * @param idx The index to use
+ * @param encoding The encoding of the documents
+ */
+template <class Ranker, class Index>
+void test_impact_rank(Ranker& r, Index& idx, const std::string& encoding);
+
+/**
+ * Scores an index's own docs as a concurrent batch to ensure that the
+ * results match scoring each query one at a time.
+ * @param r The ranker to test
+ * @param idx The index to use
+ * @param encoding The encoding of the documents
+ */
+template <class Ranker, class Index>
+void test_batch_rank(Ranker& r, Index& idx, const std::string& encoding);
+
+/**
+ * Queries an index with its own docs to ensure that scoring each query on
+ * several threads, one range of doc_ids each, scores the same top
+ * documents as scoring it on one.
+ * @param r The ranker to test
+ * @param idx The index to use (which must use the block postings codec)
+ * @param encoding The encoding of the documents
+ */
+template <class Ranker, class Index>
+void test_partitioned_rank(Ranker& r, Index& idx, const std::string& encoding);
+
+/**
+ * Queries an index with the term ids of its own docs to ensure that
+ * scoring them matches scoring the documents' text.
+ * @param r The ranker to test
+ * @param idx The index to use
+ * @param encoding The encoding of the documents
+ */
+template <class Ranker, class Index>
+void test_term_id_rank(Ranker& r, Index& idx, const std::string& encoding);
+
+/**
+ * Queries an index with its own docs restricted by doc_filters, stored
+ * both as a sorted list and as a bitset, to ensure that the results match
+ * those of an equivalent filtering function.
+ * @param r The ranker to test
+ * @param idx The index to use
+ * @param encoding The encoding of the documents
+ */
+template <class Ranker, class Index>
+void test_filtered_rank(Ranker& r, Index& idx, const std::string& encoding);
+
+/**
+ * Queries an index with its own docs through a query_cache to ensure that
+ * cached results match scoring each query directly, that repeated queries
+ * are answered from the cache, and that rankers with different parameters
+ * do not share entries.
+ * @param r The ranker to test
+ * @param idx The index to use
+ * @param encoding The encoding of the documents
+ */
+template <class Ranker, class Index>
+void test_cached_rank(Ranker& r, Index& idx, const std::string& encoding);
+
 /**
  * Runs all the ranking tests.
  * @return the number of tests failed
@@ -0,0 +1,30 @@
+/**
+ * @file term_dictionary_test.h
+ *
+ * All files in META are dual-licensed under the MIT and NCSA licenses. For more
+ * details, consult the file LICENSE.mit and LICENSE.ncsa in the root of the
+ * project.
+ */
+
+#ifndef META_TERM_DICTIONARY_TEST_H_
+#define META_TERM_DICTIONARY_TEST_H_
+
+#include "index/term_dictionary.h"
+#include "index/term_dictionary_writer.h"
+#include "test/unit_test.h"
+#include "util/minimal_perfect_hash.h"
+
+namespace meta
+{
+namespace testing
+{
+
+/**
+ * Runs the term dictionary tests.
+ * @return the number of tests failed
+ */
+int term_dictionary_tests();
+}
+}
+
+#endif
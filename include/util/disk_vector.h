@@ -16,6 +16,7 @@
 #include <stdio.h>
 #include <sys/mman.h>
 #include <unistd.h>
+#include "io/access_policy.h"
 #include "meta.h"
 
 namespace meta
@@ -41,8 +42,12 @@ class disk_vector
      * new one is created.
      * @param size The number of elements that will be in this vector. If not
      * specified, the disk_vector assumes that the file already exists.
+     * @param policy How the vector is going to be read
+     * @param huge_pages Whether to ask for transparent huge pages
      */
-    disk_vector(const std::string& path, uint64_t size = 0);
+    disk_vector(const std::string& path, uint64_t size = 0,
+                io::access_policy policy = io::access_policy::normal,
+                bool huge_pages = false);
 
     /**
      * Move constructor.
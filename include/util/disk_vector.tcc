@@ -11,7 +11,10 @@ namespace util
 {
 
 template <class T>
-disk_vector<T>::disk_vector(const std::string& path, uint64_t size /* = 0 */)
+disk_vector<T>::disk_vector(const std::string& path, uint64_t size /* = 0 */,
+                            io::access_policy policy
+                            /* = io::access_policy::normal */,
+                            bool huge_pages /* = false */)
     : path_{path}, start_{nullptr}, size_{size}, file_desc_{-1}
 {
     file_desc_ = open(path_.c_str(), O_RDWR | O_CREAT, S_IRUSR | S_IWUSR);
@@ -38,11 +41,23 @@ disk_vector<T>::disk_vector(const std::string& path, uint64_t size /* = 0 */)
     else
         size_ = actual_size / sizeof(T);
 
-    start_ = (T*)mmap(nullptr, sizeof(T) * size_, PROT_READ | PROT_WRITE,
-                      MAP_SHARED, file_desc_, 0);
+    // an empty file can't be mapped, and there is nothing to read anyway
+    if (size_ == 0)
+    {
+        close(file_desc_);
+        return;
+    }
 
-    if (start_ == nullptr)
+    auto start = mmap(nullptr, sizeof(T) * size_, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | io::mmap_advice::map_flags(policy),
+                      file_desc_, 0);
+    if (start == MAP_FAILED)
+    {
+        close(file_desc_);
         throw disk_vector_exception{"error memory-mapping the file " + path_};
+    }
+    start_ = static_cast<T*>(start);
+    io::mmap_advice::advise(start_, sizeof(T) * size_, policy, huge_pages);
 }
 
 template <class T>
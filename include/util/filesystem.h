@@ -13,7 +13,9 @@
 #include <string>
 #include <fstream>
 #include <vector>
+#include <dirent.h>
 #include <sys/stat.h>
+#include <unistd.h>
 #include "io/mmap_file.h"
 #include "util/printing.h"
 #include "util/progress.h"
@@ -44,6 +46,29 @@ inline void rename_file(const std::string& old_name,
     rename(old_name.c_str(), new_name.c_str());
 }
 
+/**
+ * Deletes a file or a directory and everything in it.
+ * @param path The file or directory to delete
+ */
+inline void remove_all(const std::string& path)
+{
+    if (auto dir = opendir(path.c_str()))
+    {
+        while (auto entry = readdir(dir))
+        {
+            std::string name{entry->d_name};
+            if (name != "." && name != "..")
+                remove_all(path + "/" + name);
+        }
+        closedir(dir);
+        rmdir(path.c_str());
+    }
+    else
+    {
+        delete_file(path);
+    }
+}
+
 /**
  * Attempts to create the directory
  * @param dir_name The name of the new directory
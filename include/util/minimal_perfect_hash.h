@@ -0,0 +1,115 @@
+/**
+ * @file minimal_perfect_hash.h
+ *
+ * All files in META are dual-licensed under the MIT and NCSA licenses. For more
+ * details, consult the file LICENSE.mit and LICENSE.ncsa in the root of the
+ * project.
+ */
+
+#ifndef META_UTIL_MINIMAL_PERFECT_HASH_H_
+#define META_UTIL_MINIMAL_PERFECT_HASH_H_
+
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+namespace meta
+{
+namespace util
+{
+
+/**
+ * A minimal perfect hash function over a fixed set of 64-bit keys: it maps
+ * the n keys it was built for to distinct slots in [0, n). Keys outside
+ * the set map to an arbitrary slot (or to n), so callers must check what
+ * they find there.
+ *
+ * The function is built by the "fingerprinting" method of Limasset et
+ * al.'s BBHash: each key is hashed into a bit array of gamma bits per
+ * key, the bits hit by exactly one key are kept, and the colliding keys
+ * are hashed again into a smaller array at the next level. A key's slot
+ * is the number of kept bits before its own, which is found with a small
+ * table of popcounts computed when the function is loaded. It takes about
+ * gamma * e^(1 / gamma) bits per key (3.3 for the default gamma of 2),
+ * and most lookups probe only the first level or two.
+ *
+ * The function is stored as a flat array of uint64_t words so that it
+ * can be kept on disk and used in place: the number of keys, the number of
+ * levels, the number of words in each level, and then each level's bits.
+ * Lookups do not modify it and are safe to make from several threads.
+ */
+class minimal_perfect_hash
+{
+  public:
+    /**
+     * Builds a function over a set of keys.
+     * @param keys The keys, which must be distinct
+     * @param gamma The number of bits per key at each level; larger
+     * values build faster and look up faster, but take more space
+     * @return the words of the built function
+     * @throw minimal_perfect_hash_exception if the keys are not distinct
+     */
+    static std::vector<uint64_t> build(std::vector<uint64_t> keys,
+                                       double gamma = 2.0);
+
+    /**
+     * Views a built function.
+     * @param data The words returned by build(); they must outlive this
+     * object
+     */
+    minimal_perfect_hash(const uint64_t* data);
+
+    /**
+     * @param key A key
+     * @return the key's slot, if it is one of the keys the function was
+     * built for; otherwise, any slot or size()
+     */
+    uint64_t operator()(uint64_t key) const;
+
+    /**
+     * @return the number of keys the function was built for
+     */
+    uint64_t size() const;
+
+    /**
+     * @return the number of words the function occupies
+     */
+    uint64_t num_words() const;
+
+    /**
+     * Thrown when a function can't be built.
+     */
+    class minimal_perfect_hash_exception : public std::runtime_error
+    {
+      public:
+        using std::runtime_error::runtime_error;
+    };
+
+  private:
+    /**
+     * @param key A key
+     * @param level A level of the function
+     * @param bits The number of bits in the level
+     * @return the key's bit at that level
+     */
+    static uint64_t position(uint64_t key, uint64_t level, uint64_t bits);
+
+    /// The number of words between the entries of ranks_
+    const static constexpr uint64_t rank_stride = 8;
+
+    /// The number of keys
+    uint64_t size_;
+
+    /// The function's bits, all levels concatenated
+    const uint64_t* bits_;
+
+    /// The word of bits_ at which each level starts, plus the end
+    std::vector<uint64_t> level_starts_;
+
+    /// The number of set bits before every rank_stride-th word of bits_
+    std::vector<uint64_t> ranks_;
+};
+}
+}
+
+#endif
@@ -47,6 +47,12 @@ void ngram_word_analyzer::tokenize(corpus::document& doc)
             combined = tokens[i - j] + "_" + combined;
 
         doc.increment(combined, 1);
+
+        // only unigrams report positions: the n-grams of every size
+        // would otherwise share them, and phrase queries expect one term
+        // per position
+        if (n_value() == 1)
+            doc.add_position(combined, i);
     }
 }
 
@@ -3,6 +3,8 @@
  * @author Sean Massung
  */
 
+#include <algorithm>
+#include <iterator>
 #include <random>
 #include <numeric>
 #include "logging/logger.h"
@@ -23,7 +25,10 @@ confusion_matrix classifier::test(const std::vector<doc_id>& docs)
 {
     confusion_matrix matrix;
     for (auto& d_id : docs)
-        matrix.add(classify(d_id), idx_->label(d_id));
+    {
+        if (idx_->is_live(d_id))
+            matrix.add(classify(d_id), idx_->label(d_id));
+    }
 
     return matrix;
 }
@@ -33,7 +38,7 @@ confusion_matrix
                                bool even_split /* = false */, int seed)
 {
     // docs might be ordered by class, so make sure things are shuffled
-    std::vector<doc_id> docs{input_docs};
+    auto docs = live_docs(input_docs);
     if (even_split)
         create_even_split(docs, seed);
     std::mt19937 gen(seed);
@@ -56,6 +61,22 @@ confusion_matrix
     return matrix;
 }
 
+std::vector<doc_id>
+    classifier::live_docs(const std::vector<doc_id>& docs) const
+{
+    if (idx_->num_deleted() == 0)
+        return docs;
+
+    std::vector<doc_id> live;
+    live.reserve(docs.size());
+    std::copy_if(docs.begin(), docs.end(), std::back_inserter(live),
+                 [&](doc_id d_id)
+                 {
+        return idx_->is_live(d_id);
+    });
+    return live;
+}
+
 void classifier::create_even_split(std::vector<doc_id>& docs, int seed) const
 {
     LOG(info) << "Creating an even split of class labels" << ENDLG;
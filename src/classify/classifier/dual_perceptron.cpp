@@ -21,8 +21,9 @@ namespace classify
 
 const std::string dual_perceptron::id = "dual-perceptron";
 
-void dual_perceptron::train(const std::vector<doc_id>& docs)
+void dual_perceptron::train(const std::vector<doc_id>& input_docs)
 {
+    auto docs = live_docs(input_docs);
     weights_ = {};
     for (const auto& d_id : docs)
         weights_[idx_->label(d_id)] = {};
@@ -8,8 +8,6 @@
 
 #include "cpptoml.h"
 #include "classify/classifier/knn.h"
-#include "corpus/document.h"
-#include "index/postings_data.h"
 #include "index/ranker/ranker_factory.h"
 
 namespace meta
@@ -30,27 +28,23 @@ knn::knn(std::shared_ptr<index::inverted_index> idx,
 { /* nothing */
 }
 
-void knn::train(const std::vector<doc_id>& docs)
+void knn::train(const std::vector<doc_id>& input_docs)
 {
-    legal_docs_.insert(docs.begin(), docs.end());
+    auto docs = live_docs(input_docs);
+    legal_docs_.insert(legal_docs_.end(), docs.begin(), docs.end());
+    filter_ = index::doc_filter::make(inv_idx_->num_docs(), legal_docs_);
 }
 
 class_label knn::classify(doc_id d_id)
 {
-    if (k_ > legal_docs_.size())
+    if (k_ > filter_.size())
         throw knn_exception{
             "k must be smaller than the "
             "number of documents in the index (training documents)"};
 
-    corpus::document query{"[no path]", d_id};
-    for (const auto& count : idx_->search_primary(d_id)->counts())
-        query.increment(idx_->term_text(count.first), count.second);
-
-    auto scored = ranker_->score(*inv_idx_, query, inv_idx_->num_docs(),
-                                 [&](doc_id d_id)
-                                 {
-        return legal_docs_.find(d_id) != legal_docs_.end();
-    });
+    // only the k + 1 nearest neighbors get a vote
+    auto scored = ranker_->score(*inv_idx_, idx_->query_terms(d_id), filter_,
+                                 uint64_t{k_} + 1);
 
     std::unordered_map<class_label, double> counts;
     uint16_t i = 0;
@@ -116,6 +110,7 @@ class_label knn::select_best_label(
 void knn::reset()
 {
     legal_docs_.clear();
+    filter_ = index::doc_filter{};
 }
 
 template <>
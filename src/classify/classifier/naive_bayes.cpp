@@ -36,8 +36,9 @@ void naive_bayes::reset()
     class_probs_.clear();
 }
 
-void naive_bayes::train(const std::vector<doc_id>& docs)
+void naive_bayes::train(const std::vector<doc_id>& input_docs)
 {
+    auto docs = live_docs(input_docs);
     for (auto& d_id : docs)
     {
         auto pdata = idx_->search_primary(d_id);
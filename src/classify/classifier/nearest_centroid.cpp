@@ -24,8 +24,9 @@ nearest_centroid::nearest_centroid(std::shared_ptr<index::inverted_index> idx,
 { /* nothing */
 }
 
-void nearest_centroid::train(const std::vector<doc_id>& docs)
+void nearest_centroid::train(const std::vector<doc_id>& input_docs)
 {
+    auto docs = live_docs(input_docs);
     double num_docs = idx_->num_docs();
     std::unordered_map<class_label, uint32_t> docs_per_class;
 
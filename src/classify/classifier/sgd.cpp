@@ -49,8 +49,9 @@ double sgd::predict(const counts_t& doc) const
     return dot;
 }
 
-void sgd::train(const std::vector<doc_id>& docs)
+void sgd::train(const std::vector<doc_id>& input_docs)
 {
+    auto docs = live_docs(input_docs);
     std::vector<size_t> indices(docs.size());
     std::vector<int> labels(docs.size());
     for (size_t i = 0; i < docs.size(); ++i)
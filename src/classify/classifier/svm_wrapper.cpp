@@ -89,8 +89,9 @@ confusion_matrix svm_wrapper::test(const std::vector<doc_id>& docs)
     return matrix;
 }
 
-void svm_wrapper::train(const std::vector<doc_id>& docs)
+void svm_wrapper::train(const std::vector<doc_id>& input_docs)
 {
+    auto docs = live_docs(input_docs);
     std::ofstream out("svm-train");
     for (auto& d_id : docs)
         out << idx_->liblinear_data(d_id) << "\n";
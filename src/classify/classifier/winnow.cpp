@@ -41,8 +41,9 @@ void winnow::zero_weights(const std::vector<doc_id>& docs)
         weights_[idx_->label(d_id)] = {};
 }
 
-void winnow::train(const std::vector<doc_id>& docs)
+void winnow::train(const std::vector<doc_id>& input_docs)
 {
+    auto docs = live_docs(input_docs);
     zero_weights(docs);
     std::vector<uint64_t> indices(docs.size());
     std::iota(indices.begin(), indices.end(), 0);
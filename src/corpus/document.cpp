@@ -14,7 +14,12 @@ namespace corpus
 
 document::document(const std::string& path, doc_id d_id,
                    const class_label& label)
-    : path_{path}, d_id_{d_id}, label_{label}, length_{0}, encoding_{"utf-8"}
+    : path_{path},
+      d_id_{d_id},
+      label_{label},
+      length_{0},
+      record_positions_{false},
+      encoding_{"utf-8"}
 {
     size_t idx = path.find_last_of("/") + 1;
     name_ = path.substr(idx);
@@ -61,6 +66,23 @@ const std::unordered_map<std::string, double>& document::counts() const
     return counts_;
 }
 
+void document::record_positions(bool record)
+{
+    record_positions_ = record;
+}
+
+void document::add_position(const std::string& term, uint64_t position)
+{
+    if (record_positions_)
+        positions_[term].push_back(position);
+}
+
+const std::unordered_map<std::string, std::vector<uint64_t>>&
+    document::positions() const
+{
+    return positions_;
+}
+
 void document::content(const std::string& content,
                        const std::string& encoding /* = "utf-8" */)
 {
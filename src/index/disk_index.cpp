@@ -3,15 +3,19 @@
  * @author Sean Massung
  */
 
-#include <numeric>
+#include <atomic>
+#include <bitset>
+#include <stdexcept>
 
 #include "index/disk_index.h"
 #include "index/disk_index_impl.h"
 #include "index/string_list.h"
 #include "index/string_list_writer.h"
-#include "index/vocabulary_map.h"
+#include "index/term_dictionary.h"
 #include "analyzers/analyzer.h"
+#include "cpptoml.h"
 #include "util/disk_vector.h"
+#include "util/filesystem.h"
 #include "util/mapping.h"
 #include "util/optional.h"
 #include "util/pimpl.tcc"
@@ -21,9 +25,17 @@ namespace meta
 namespace index
 {
 
-disk_index::disk_index(const cpptoml::table&, const std::string& name)
+namespace
+{
+/// The generation the next index object gets
+std::atomic<uint64_t> next_generation{0};
+}
+
+disk_index::disk_index(const cpptoml::table& config, const std::string& name)
 {
     impl_->index_name_ = name;
+    impl_->generation_ = std::make_shared<const uint64_t>(++next_generation);
+    impl_->load_access_policies(config);
 }
 
 std::string disk_index::index_name() const
@@ -33,8 +45,6 @@ std::string disk_index::index_name() const
 
 term_id disk_index::get_term_id(const std::string& term)
 {
-    std::lock_guard<std::mutex> lock{impl_->mutex_};
-
     auto termID = impl_->term_id_mapping_->find(term);
     if (termID)
         return term_id{*termID};
@@ -106,17 +116,63 @@ std::string disk_index::doc_path(doc_id d_id) const
 
 std::vector<doc_id> disk_index::docs() const
 {
-    std::vector<doc_id> ret(impl_->doc_id_mapping_->size());
-    std::iota(ret.begin(), ret.end(), 0);
+    std::vector<doc_id> ret;
+    ret.reserve(num_docs() - num_deleted());
+    for (doc_id d_id{0}; d_id < num_docs(); ++d_id)
+    {
+        if (is_live(d_id))
+            ret.push_back(d_id);
+    }
     return ret;
 }
 
+void disk_index::remove_doc(doc_id d_id)
+{
+    uint64_t id{d_id};
+    if (id >= num_docs())
+        throw std::out_of_range{"doc_id out of range: " + std::to_string(id)};
+
+    // queries read the bitset while documents are deleted, so every access
+    // to it is atomic; the count is published after the bit, so a reader
+    // that sees the new count also sees the bit
+    auto& word = (*impl_->deleted_docs_)[id / 64];
+    auto bit = uint64_t{1} << (id % 64);
+    if (!(__atomic_fetch_or(&word, bit, __ATOMIC_RELAXED) & bit))
+        impl_->num_deleted_.fetch_add(1, std::memory_order_release);
+}
+
+bool disk_index::is_live(doc_id d_id) const
+{
+    if (impl_->num_deleted_.load(std::memory_order_acquire) == 0)
+        return true;
+    uint64_t id{d_id};
+    auto& word = (*impl_->deleted_docs_)[id / 64];
+    return !(__atomic_load_n(&word, __ATOMIC_RELAXED)
+             & (uint64_t{1} << (id % 64)));
+}
+
+uint64_t disk_index::num_deleted() const
+{
+    return impl_->num_deleted_.load(std::memory_order_acquire);
+}
+
+uint64_t disk_index::generation() const
+{
+    return *impl_->generation_;
+}
+
+std::weak_ptr<const void> disk_index::lifetime() const
+{
+    return impl_->generation_;
+}
+
 // disk_index_impl
 
 const std::vector<const char*> disk_index::disk_index_impl::files
     = {"/docids.mapping", "/docids.mapping_index", "/docsizes.counts",
        "/docs.labels",    "/docs.uniqueterms",     "/labelids.mapping",
-       "/postings.index", "/termids.mapping",      "/termids.mapping.inverse"};
+       "/postings.index", "/termids.dict",         "/termids.dict.index",
+       "/docs.deleted",   "/termids.dict.hash"};
 
 label_id disk_index::disk_index_impl::get_label_id(const class_label& lbl)
 {
@@ -132,29 +188,76 @@ label_id disk_index::disk_index_impl::get_label_id(const class_label& lbl)
         return label_ids_.get_value(lbl);
 }
 
+void disk_index::disk_index_impl::load_access_policies(
+    const cpptoml::table& config)
+{
+    auto group = config.get_table("mmap");
+    if (!group)
+        return;
+
+    if (auto postings = group->get_as<std::string>("postings"))
+        postings_policy_ = io::access_policy_from_string(*postings);
+    if (auto metadata = group->get_as<std::string>("metadata"))
+        metadata_policy_ = io::access_policy_from_string(*metadata);
+    if (auto huge_pages = group->get_as<bool>("huge-pages"))
+        huge_pages_ = *huge_pages;
+}
+
+io::mmap_file
+    disk_index::disk_index_impl::map_postings(const std::string& path) const
+{
+    return io::mmap_file{path, postings_policy_, huge_pages_};
+}
+
 void disk_index::disk_index_impl::initialize_metadata(uint64_t num_docs)
 {
     load_doc_sizes(num_docs);
     load_labels(num_docs);
     load_unique_terms(num_docs);
+    load_deleted_docs(num_docs);
 }
 
 void disk_index::disk_index_impl::load_doc_sizes(uint64_t num_docs)
 {
-    doc_sizes_
-        = util::disk_vector<double>{index_name_ + files[DOC_SIZES], num_docs};
+    doc_sizes_ = map_table<double>(index_name_ + files[DOC_SIZES], num_docs);
 }
 
 void disk_index::disk_index_impl::load_labels(uint64_t num_docs)
 {
-    labels_ = util::disk_vector<label_id>{index_name_ + files[DOC_LABELS],
-                                          num_docs};
+    labels_ = map_table<label_id>(index_name_ + files[DOC_LABELS], num_docs);
 }
 
 void disk_index::disk_index_impl::load_unique_terms(uint64_t num_docs)
 {
-    unique_terms_ = util::disk_vector<uint64_t>{
-        index_name_ + files[DOC_UNIQUETERMS], num_docs};
+    unique_terms_ = map_table<uint64_t>(index_name_ + files[DOC_UNIQUETERMS],
+                                        num_docs);
+}
+
+void disk_index::disk_index_impl::load_deleted_docs(uint64_t num_docs)
+{
+    auto path = index_name_ + files[DOC_DELETED];
+
+    // a new index starts out with nothing deleted, whatever an earlier
+    // build in the same directory left behind
+    if (num_docs != 0)
+        filesystem::delete_file(path);
+    else
+        num_docs = doc_sizes_->size();
+
+    num_deleted_ = 0;
+    auto num_words = (num_docs + 63) / 64;
+    if (num_words == 0)
+        return;
+
+    auto existed = filesystem::file_exists(path);
+    deleted_docs_ = map_table<uint64_t>(path, num_words);
+    for (uint64_t i = 0; i < num_words; ++i)
+    {
+        // disk_vector extends a new file by writing a byte at its end
+        if (!existed)
+            (*deleted_docs_)[i] = 0;
+        num_deleted_ += std::bitset<64>{(*deleted_docs_)[i]}.count();
+    }
 }
 
 void disk_index::disk_index_impl::load_doc_id_mapping()
@@ -164,7 +267,7 @@ void disk_index::disk_index_impl::load_doc_id_mapping()
 
 void disk_index::disk_index_impl::load_term_id_mapping()
 {
-    term_id_mapping_ = vocabulary_map{index_name_ + files[TERM_IDS_MAPPING]};
+    term_id_mapping_ = term_dictionary{index_name_ + files[TERM_IDS_MAPPING]};
 }
 
 void disk_index::disk_index_impl::load_label_id_mapping()
@@ -174,7 +277,7 @@ void disk_index::disk_index_impl::load_label_id_mapping()
 
 void disk_index::disk_index_impl::load_postings()
 {
-    postings_ = io::mmap_file{index_name_ + files[POSTINGS]};
+    postings_ = map_postings(index_name_ + files[POSTINGS]);
 }
 
 void disk_index::disk_index_impl::save_label_id_mapping()
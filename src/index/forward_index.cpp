@@ -3,7 +3,16 @@
  * @author Sean Massung
  */
 
+#include <algorithm>
+#include <atomic>
+#include <iomanip>
+#include <limits>
+#include <mutex>
+#include <sstream>
+#include <unordered_map>
+
 #include "cpptoml.h"
+#include "corpus/document.h"
 #include "index/chunk_handler.h"
 #include "index/disk_index_impl.h"
 #include "index/forward_index.h"
@@ -11,7 +20,9 @@
 #include "index/postings_data.h"
 #include "index/string_list.h"
 #include "index/string_list_writer.h"
-#include "index/vocabulary_map.h"
+#include "index/term_dictionary.h"
+#include "io/block_file_reader.h"
+#include "io/block_file_writer.h"
 #include "io/libsvm_parser.h"
 #include "parallel/thread_pool.h"
 #include "util/disk_vector.h"
@@ -49,23 +60,44 @@ class forward_index::impl
 
     /**
      * Initializes this index's metadata structures.
+     * @param num_docs The number of documents in the index, or zero to
+     * take the size from the existing metadata files
      */
-    void init_metadata();
+    void init_metadata(uint64_t num_docs = 0);
 
     /**
+     * Converts a single libsvm-formatted corpus file into packed postings,
+     * filling in the document metadata as it goes.
      * @param config the configuration settings for this index
      */
     void create_libsvm_postings(const cpptoml::table& config);
 
     /**
-     * Initializes structures based on a libsvm-formatted file.
+     * Transposes the inverted index's postings into chunks of document
+     * vectors, then merges the chunks straight into packed vectors.
+     * @param inv_idx The inverted index to uninvert
+     * @param config The configuration, which may set the merge fan-in and
+     * the memory budget for chunks
      */
-    void create_libsvm_metadata();
+    void uninvert(const inverted_index& inv_idx,
+                  const cpptoml::table& config);
 
     /**
-     * @param inv_idx The inverted index to uninvert
+     * Builds the inverted index, collecting document vectors in vectors_
+     * as the corpus is tokenized. If the inverted index already exists,
+     * no documents are tokenized and vectors_ is left empty.
+     * @param config_file The configuration file used to create the index
+     * @return the inverted index
      */
-    void uninvert(const inverted_index& inv_idx);
+    std::shared_ptr<inverted_index>
+        create_combined(const std::string& config_file);
+
+    /**
+     * Rewrites the document vectors collected by create_combined() with
+     * the inverted index's term_ids, producing the final postings.
+     * @param inv_idx The inverted index built alongside this one
+     */
+    void remap_vectors(inverted_index& inv_idx);
 
     /**
      * @param name The name of the inverted index to copy data from
@@ -79,16 +111,9 @@ class forward_index::impl
      */
     bool is_libsvm_format(const cpptoml::table& config) const;
 
-    /**
-     * Calculates which documents start at which bytes in the postings file.
-     */
-    void set_doc_byte_locations();
-
-    /**
-     * Converts postings.index into a libsvm formatted file
-     * @param num_docs The total number of documents
-     */
-    void compressed_postings_to_libsvm(uint64_t num_docs);
+    /// the name of the file marking the postings as packed document
+    /// vectors; indexes without it use the old libsvm text postings
+    const static std::string packed_marker;
 
     /// the total number of unique terms if term_id_mapping_ is unused
     uint64_t total_unique_terms_;
@@ -96,14 +121,166 @@ class forward_index::impl
     /// doc_id -> postings file byte location
     util::optional<util::disk_vector<uint64_t>> doc_byte_locations_;
 
+    /// Document vectors collected during a combined build
+    class provisional_vectors;
+    /// Set only while a combined build is in progress
+    std::unique_ptr<provisional_vectors> vectors_;
+
   private:
     /// Pointer to the forward_index this is an implementation of
     forward_index* idx_;
 };
 
+const std::string forward_index::impl::packed_marker = "/postings.packed";
+
+/**
+ * Document vectors written while the inverted index is being built. Term
+ * ids are not final until the inverted index's postings are merged, so
+ * each tokenizing thread gives terms provisional ids of its own, in order
+ * of first appearance, and appends its vectors to its own scratch file.
+ * Nothing is shared between the threads until remap_vectors() merges the
+ * vocabularies.
+ */
+class forward_index::impl::provisional_vectors
+{
+  public:
+    /**
+     * The vocabulary and scratch file of one tokenizing thread.
+     */
+    struct shard
+    {
+        /**
+         * @param filename The scratch file to write the vectors to
+         */
+        shard(const std::string& filename)
+            : filename{filename}, writer{filename}
+        {
+            // nothing
+        }
+
+        /// The scratch file
+        std::string filename;
+        /// Writes the scratch file
+        io::block_file_writer writer;
+        /// (doc_id, location of its vector in the scratch file)
+        std::vector<std::pair<doc_id, uint64_t>> offsets;
+        /// term -> provisional id
+        std::unordered_map<std::string, uint64_t> term_ids;
+    };
+
+    /**
+     * @param prefix The prefix of the scratch files to write the vectors to
+     */
+    provisional_vectors(const std::string& prefix)
+        : prefix_{prefix}, id_{++next_id_}
+    {
+        // nothing
+    }
+
+    /**
+     * Records a tokenized document. Safe to call from several threads.
+     * @param doc The document to record
+     */
+    void insert(const corpus::document& doc)
+    {
+        auto& local = local_shard();
+        postings_data_type::count_t counts;
+        counts.reserve(doc.counts().size());
+        for (const auto& count : doc.counts())
+        {
+            auto id
+                = local.term_ids.emplace(count.first, local.term_ids.size());
+            counts.emplace_back(term_id{id.first->second}, count.second);
+        }
+
+        postings_data_type pdata{doc.id()};
+        pdata.set_counts(counts);
+        local.offsets.emplace_back(doc.id(), local.writer.byte_location());
+        pdata.write_packed_counts(local.writer);
+    }
+
+    /**
+     * Closes the scratch files; call once every document is recorded.
+     */
+    void close()
+    {
+        for (auto& sh : shards_)
+            sh->writer.close();
+    }
+
+    /**
+     * @return whether no documents were recorded
+     */
+    bool empty() const
+    {
+        for (const auto& sh : shards_)
+        {
+            if (!sh->offsets.empty())
+                return false;
+        }
+        return true;
+    }
+
+    /**
+     * Deletes the scratch files.
+     */
+    void remove_files()
+    {
+        for (const auto& sh : shards_)
+            filesystem::delete_file(sh->filename);
+    }
+
+    /**
+     * @return the per-thread vocabularies and scratch files
+     */
+    const std::vector<std::unique_ptr<shard>>& shards() const
+    {
+        return shards_;
+    }
+
+  private:
+    /**
+     * @return the calling thread's shard, created the first time the
+     * thread records a document
+     */
+    shard& local_shard()
+    {
+        // the lock is only taken once per thread; after that each thread
+        // remembers which shard of which build is its own
+        thread_local std::pair<uint64_t, shard*> cached{0, nullptr};
+        if (cached.first != id_)
+        {
+            std::lock_guard<std::mutex> lock{shards_mutex_};
+            shards_.emplace_back(make_unique<shard>(
+                prefix_ + "." + std::to_string(shards_.size())));
+            cached = {id_, shards_.back().get()};
+        }
+        return *cached.second;
+    }
+
+    /// The prefix of the scratch files
+    std::string prefix_;
+    /// Distinguishes this build's shards from those of earlier builds
+    uint64_t id_;
+    /// The source of id_
+    static std::atomic<uint64_t> next_id_;
+    /// Protects shards_
+    std::mutex shards_mutex_;
+    /// One shard per tokenizing thread
+    std::vector<std::unique_ptr<shard>> shards_;
+};
+
+std::atomic<uint64_t> forward_index::impl::provisional_vectors::next_id_{0};
+
 forward_index::forward_index(const cpptoml::table& config)
-    : disk_index{config, *config.get_as<std::string>("forward-index")},
-      fwd_impl_{this}
+    : forward_index{config, *config.get_as<std::string>("forward-index")}
+{
+    /* nothing */
+}
+
+forward_index::forward_index(const cpptoml::table& config,
+                             const std::string& name)
+    : disk_index{config, name}, fwd_impl_{this}
 {
     /* nothing */
 }
@@ -119,7 +296,8 @@ forward_index& forward_index::operator=(forward_index&&) = default;
 
 bool forward_index::valid() const
 {
-    if (!filesystem::file_exists(index_name() + "/corpus.uniqueterms"))
+    if (!filesystem::file_exists(index_name() + "/corpus.uniqueterms")
+        || !filesystem::file_exists(index_name() + impl::packed_marker))
     {
         LOG(info)
             << "Existing forward index detected as invalid; recreating"
@@ -141,19 +319,20 @@ bool forward_index::valid() const
 
 std::string forward_index::liblinear_data(doc_id d_id) const
 {
-    if (d_id >= num_docs())
-        throw forward_index_exception{"invalid doc_id in search_primary"};
-
-    uint64_t begin = (*fwd_impl_->doc_byte_locations_)[d_id];
-    uint64_t length = 0;
-    while (impl_->postings()[begin + length] != '\n')
-    {
-        ++length;
-        if (begin + length >= impl_->postings().size())
-            throw forward_index_exception{"out of bounds!"};
-    }
+    auto pdata = search_primary(d_id);
+
+    std::ostringstream out;
+    out << std::setprecision(std::numeric_limits<double>::max_digits10)
+        << impl_->doc_label_id(d_id);
+    for (const auto& count : pdata->counts())
+        out << ' ' << (count.first + 1) << ':' << count.second;
+    return out.str();
+}
 
-    return std::string{impl_->postings().begin() + begin, length};
+std::vector<std::pair<term_id, double>>
+    forward_index::query_terms(doc_id d_id) const
+{
+    return search_primary(d_id)->counts();
 }
 
 void forward_index::load_index()
@@ -188,24 +367,34 @@ void forward_index::create_index(const std::string& config_file)
                   << ENDLG;
 
         fwd_impl_->create_libsvm_postings(config);
-        fwd_impl_->create_libsvm_metadata();
+        impl_->load_postings();
         impl_->save_label_id_mapping();
     }
     else
     {
-        LOG(info) << "Creating index by uninverting: " << index_name() << ENDLG;
+        std::shared_ptr<inverted_index> inv_idx;
+        auto combined = config.get_as<bool>("combined-build");
+        if (combined && *combined)
+        {
+            LOG(info) << "Creating index together with inverted index: "
+                      << index_name() << ENDLG;
+            inv_idx = fwd_impl_->create_combined(config_file);
+        }
+        else
         {
-            // Ensure all files are flushed before uninverting
-            make_index<inverted_index>(config_file);
+            LOG(info) << "Creating index by uninverting: " << index_name()
+                      << ENDLG;
+            inv_idx = make_index<inverted_index>(config_file);
         }
-        auto inv_idx = make_index<inverted_index>(config_file);
 
         fwd_impl_->create_uninverted_metadata(inv_idx->index_name());
         impl_->load_label_id_mapping();
-        fwd_impl_->uninvert(*inv_idx);
-        fwd_impl_->init_metadata();
+        fwd_impl_->init_metadata(inv_idx->num_docs());
+        if (fwd_impl_->vectors_)
+            fwd_impl_->remap_vectors(*inv_idx);
+        else
+            fwd_impl_->uninvert(*inv_idx, config);
         impl_->load_postings();
-        fwd_impl_->set_doc_byte_locations();
         impl_->load_term_id_mapping();
         fwd_impl_->total_unique_terms_ = impl_->total_unique_terms();
     }
@@ -215,10 +404,68 @@ void forward_index::create_index(const std::string& config_file)
 
     std::ofstream unique_terms_file{index_name() + "/corpus.uniqueterms"};
     unique_terms_file << fwd_impl_->total_unique_terms_;
+    std::ofstream marker{index_name() + impl::packed_marker};
 
     LOG(info) << "Done creating index: " << index_name() << ENDLG;
 }
 
+void forward_index::permute_docs(const forward_index& source,
+                                 const std::vector<doc_id>& order)
+{
+    filesystem::copy_file(source.index_name() + "/config.toml",
+                          index_name() + "/config.toml");
+
+    LOG(info) << "Reordering documents of " << source.index_name()
+              << " into: " << index_name() << ENDLG;
+
+    // term ids don't change, so the vocabulary (if there is one) is copied
+    auto term_files = {TERM_IDS_MAPPING, TERM_IDS_MAPPING_INVERSE,
+                       TERM_IDS_HASH};
+    for (const auto& file : term_files)
+    {
+        auto name = source.index_name() + impl_->files[file];
+        if (filesystem::file_exists(name))
+            filesystem::copy_file(name, index_name() + impl_->files[file]);
+    }
+
+    fwd_impl_->init_metadata(order.size());
+    {
+        auto docid_writer = impl_->make_doc_id_writer(order.size());
+        io::block_file_writer out{index_name() + impl_->files[POSTINGS]};
+        printing::progress progress{" > Writing document vectors: ",
+                                    order.size()};
+        for (doc_id d_id{0}; d_id < order.size(); ++d_id)
+        {
+            progress(d_id);
+            auto old_id = order[d_id];
+            docid_writer.insert(d_id, source.doc_path(old_id));
+            impl_->set_length(d_id, source.doc_size(old_id));
+            impl_->set_unique_terms(d_id,
+                                    source.disk_index::unique_terms(old_id));
+            impl_->set_label(d_id, source.label(old_id));
+
+            postings_data_type pdata{d_id};
+            pdata.set_counts(source.search_primary(old_id)->counts());
+            (*fwd_impl_->doc_byte_locations_)[d_id] = out.byte_location();
+            pdata.write_packed_counts(out);
+        }
+    }
+
+    impl_->save_label_id_mapping();
+    impl_->load_postings();
+    impl_->load_doc_id_mapping();
+    if (filesystem::file_exists(index_name()
+                                + impl_->files[TERM_IDS_MAPPING]))
+        impl_->load_term_id_mapping();
+
+    fwd_impl_->total_unique_terms_ = source.unique_terms();
+    std::ofstream unique_terms_file{index_name() + "/corpus.uniqueterms"};
+    unique_terms_file << fwd_impl_->total_unique_terms_;
+    std::ofstream marker{index_name() + impl::packed_marker};
+
+    LOG(info) << "Done reordering documents: " << index_name() << ENDLG;
+}
+
 void forward_index::impl::create_libsvm_postings(const cpptoml::table& config)
 {
     auto prefix = config.get_as<std::string>("prefix");
@@ -233,57 +480,21 @@ void forward_index::impl::create_libsvm_postings(const cpptoml::table& config)
     std::string existing_file = *prefix + "/" + *dataset + "/" + *dataset
                                 + ".dat";
 
-    filesystem::copy_file(existing_file,
-                          idx_->index_name() + idx_->impl_->files[POSTINGS]);
-
-    init_metadata();
-
-    // now, assign byte locations for libsvm doc starting points
-    idx_->impl_->load_postings();
-    set_doc_byte_locations();
-}
-
-void forward_index::impl::set_doc_byte_locations()
-{
-    doc_id d_id{0};
-    uint8_t last_byte = '\n';
-    printing::progress progress{" > Setting document locations: ",
-                                idx_->impl_->postings().size()};
-    for (uint64_t idx = 0; idx < idx_->impl_->postings().size(); ++idx)
-    {
-        progress(idx);
-        if (last_byte == '\n')
-        {
-            (*doc_byte_locations_)[d_id] = idx;
-            ++d_id;
-        }
-        last_byte = idx_->impl_->postings()[idx];
-    }
-}
-
-void forward_index::impl::init_metadata()
-{
-    uint64_t num_docs = filesystem::num_lines(idx_->index_name()
-                                              + idx_->impl_->files[POSTINGS]);
-    idx_->impl_->initialize_metadata(num_docs);
-    doc_byte_locations_ = util::disk_vector<uint64_t>(
-        idx_->index_name() + "/lexicon.index", num_docs);
-}
-
-void forward_index::impl::create_libsvm_metadata()
-{
+    uint64_t num_docs = filesystem::num_lines(existing_file);
+    init_metadata(num_docs);
     total_unique_terms_ = 0;
 
-    printing::progress progress{" > Creating metadata: ",
-                                doc_byte_locations_->size()};
+    printing::progress progress{" > Creating postings: ", num_docs};
 
-    doc_id d_id{0};
-    std::ifstream in{idx_->index_name() + idx_->impl_->files[POSTINGS]};
+    // the text is parsed exactly once, here; lookups decode packed vectors
+    io::block_file_writer out{idx_->index_name()
+                              + idx_->impl_->files[POSTINGS]};
+    auto docid_writer = idx_->impl_->make_doc_id_writer(num_docs);
+    std::ifstream in{existing_file};
     std::string line;
-    auto docid_writer = idx_->impl_->make_doc_id_writer(idx_->num_docs());
-    while (in.good())
+    doc_id d_id{0};
+    while (std::getline(in, line))
     {
-        std::getline(in, line);
         if (line.empty())
             break;
 
@@ -292,31 +503,114 @@ void forward_index::impl::create_libsvm_metadata()
         class_label lbl = io::libsvm_parser::label(line);
         idx_->impl_->set_label(d_id, lbl);
 
-        uint64_t num_unique = 0;
+        postings_data_type pdata{d_id};
+        pdata.set_counts(io::libsvm_parser::counts(line));
+
         uint64_t length = 0;
-        for (const auto& count_pair : io::libsvm_parser::counts(line))
+        for (const auto& count : pdata.counts())
         {
-            ++num_unique;
-            if (count_pair.first > total_unique_terms_)
-                total_unique_terms_ = count_pair.first;
-            length += static_cast<uint64_t>(count_pair.second);
+            total_unique_terms_ = std::max<uint64_t>(total_unique_terms_,
+                                                     count.first + 1);
+            length += static_cast<uint64_t>(count.second);
         }
 
         docid_writer.insert(d_id, "[no path]");
         idx_->impl_->set_length(d_id, length);
-        idx_->impl_->set_unique_terms(d_id, num_unique);
+        idx_->impl_->set_unique_terms(d_id, pdata.counts().size());
 
+        (*doc_byte_locations_)[d_id] = out.byte_location();
+        pdata.write_packed_counts(out);
         ++d_id;
     }
+}
+
+void forward_index::impl::init_metadata(uint64_t num_docs /* = 0 */)
+{
+    idx_->impl_->initialize_metadata(num_docs);
+    doc_byte_locations_ = idx_->impl_->map_table<uint64_t>(
+        idx_->index_name() + "/lexicon.index", num_docs);
+}
+
+std::shared_ptr<inverted_index>
+    forward_index::impl::create_combined(const std::string& config_file)
+{
+    vectors_ = make_unique<provisional_vectors>(idx_->index_name()
+                                                + "/postings.provisional");
+    auto vectors = vectors_.get();
+    auto inv_idx = make_index<inverted_index>(
+        config_file, [=](const corpus::document& doc)
+        {
+            vectors->insert(doc);
+        });
+
+    vectors_->close();
+    if (vectors_->empty())
+    {
+        LOG(info) << "Inverted index already exists; uninverting it instead"
+                  << ENDLG;
+        vectors_->remove_files();
+        vectors_ = nullptr;
+    }
+    return inv_idx;
+}
+
+void forward_index::impl::remap_vectors(inverted_index& inv_idx)
+{
+    // merge the threads' vocabularies into the inverted index's, and
+    // find where each document's vector was written
+    const auto& shards = vectors_->shards();
+    std::vector<std::vector<term_id>> final_ids(shards.size());
+    std::vector<std::pair<uint64_t, uint64_t>> locations(
+        inv_idx.num_docs(), {shards.size(), 0});
+    std::vector<std::unique_ptr<io::block_file_reader>> inputs;
+    for (uint64_t i = 0; i < shards.size(); ++i)
+    {
+        const auto& sh = *shards[i];
+        final_ids[i].resize(sh.term_ids.size());
+        for (const auto& term : sh.term_ids)
+            final_ids[i][term.second] = inv_idx.get_term_id(term.first);
+        for (const auto& offset : sh.offsets)
+            locations[offset.first] = {i, offset.second};
+        inputs.emplace_back(make_unique<io::block_file_reader>(sh.filename));
+    }
+
+    {
+        io::block_file_writer output{idx_->index_name()
+                                     + idx_->impl_->files[POSTINGS]};
+        printing::progress progress{" > Writing document vectors: ",
+                                    inv_idx.num_docs()};
+        postings_data_type::count_t counts;
+        for (doc_id d_id{0}; d_id < inv_idx.num_docs(); ++d_id)
+        {
+            progress(d_id);
+            postings_data_type pdata{d_id};
+            counts.clear();
+            auto shard = locations[d_id].first;
+            if (shard < shards.size())
+            {
+                inputs[shard]->seek(locations[d_id].second);
+                pdata.read_packed_counts(*inputs[shard]);
+                for (const auto& count : pdata.counts())
+                    counts.emplace_back(final_ids[shard][count.first],
+                                        count.second);
+            }
+            pdata.set_counts(counts);
+
+            (*doc_byte_locations_)[d_id] = output.byte_location();
+            pdata.write_packed_counts(output);
+        }
+    }
 
-    ++total_unique_terms_; // since we subtracted one from the ids earlier
+    inputs.clear();
+    vectors_->remove_files();
+    vectors_ = nullptr;
 }
 
 void forward_index::impl::create_uninverted_metadata(const std::string& name)
 {
-    auto files = {DOC_IDS_MAPPING,  DOC_IDS_MAPPING_INDEX,   DOC_SIZES,
-                  DOC_LABELS,       DOC_UNIQUETERMS,         LABEL_IDS_MAPPING,
-                  TERM_IDS_MAPPING, TERM_IDS_MAPPING_INVERSE};
+    auto files = {DOC_IDS_MAPPING,  DOC_IDS_MAPPING_INDEX,    DOC_SIZES,
+                  DOC_LABELS,       DOC_UNIQUETERMS,          LABEL_IDS_MAPPING,
+                  TERM_IDS_MAPPING, TERM_IDS_MAPPING_INVERSE, TERM_IDS_HASH};
 
     for (const auto& file : files)
         filesystem::copy_file(name + idx_->impl_->files[file],
@@ -344,80 +638,64 @@ uint64_t forward_index::unique_terms() const
 auto forward_index::search_primary(
     doc_id d_id) const -> std::shared_ptr<postings_data_type>
 {
+    if (d_id >= num_docs())
+        throw forward_index_exception{"invalid doc_id in search_primary"};
+
     auto pdata = std::make_shared<postings_data_type>(d_id);
-    auto line = liblinear_data(d_id);
-    pdata->set_counts(io::libsvm_parser::counts(line));
+    io::block_file_reader reader{impl_->postings()};
+    reader.seek(fwd_impl_->doc_byte_locations_->at(d_id));
+    pdata->read_packed_counts(reader);
     return pdata;
 }
 
-void forward_index::impl::uninvert(const inverted_index& inv_idx)
+void forward_index::impl::uninvert(const inverted_index& inv_idx,
+                                   const cpptoml::table& config)
 {
-    io::compressed_file_reader inv_reader{inv_idx.index_name()
-                                          + idx_->impl_->files[POSTINGS],
-                                          io::default_compression_reader_func};
-
-    term_id t_id{0};
-    chunk_handler<forward_index> handler{idx_->index_name()};
+    using handler_type = chunk_handler<forward_index>;
+    auto fan_in = config.get_as<int64_t>("merge-fan-in");
+    auto budget = config.get_as<int64_t>("indexer-ram-budget");
+    handler_type handler{
+        idx_->index_name(),
+        fan_in ? static_cast<uint64_t>(*fan_in) : handler_type::default_fan_in,
+        budget ? static_cast<uint64_t>(*budget) * 1024 * 1024
+               : handler_type::default_ram_budget};
     {
         auto producer = handler.make_producer();
-        while (inv_reader.has_next())
+        std::vector<std::pair<doc_id, uint32_t>> counts;
+        for (term_id t_id{0}; t_id < inv_idx.unique_terms(); ++t_id)
         {
-            inverted_pdata_type pdata{t_id};
-            pdata.read_compressed(inv_reader);
-            producer(pdata.primary_key(), pdata.counts());
-            ++t_id;
+            auto pdata = inv_idx.search_primary(t_id);
+            counts.clear();
+            for (const auto& count : pdata->counts())
+                counts.emplace_back(doc_id{count.first}, count.second);
+            producer(pdata->primary_key(), counts);
         }
     }
 
-    handler.merge_chunks();
-    compressed_postings_to_libsvm(inv_idx.num_docs());
-}
-
-void forward_index::impl::compressed_postings_to_libsvm(uint64_t num_docs)
-{
-    idx_->impl_->load_labels();
-
-    auto filename = idx_->index_name() + idx_->impl_->files[POSTINGS];
-    filesystem::rename_file(filename, filename + ".tmp");
-    std::ofstream output{filename};
-    io::compressed_file_reader input{filename + ".tmp",
-                                     io::default_compression_reader_func};
+    io::block_file_writer output{idx_->index_name()
+                                 + idx_->impl_->files[POSTINGS]};
 
-    // handler for writing gaps of blank documents
-    doc_id last_id{0};
-    auto write_gap = [&](doc_id next_id)
+    // documents with no terms never appear in the merged chunks, but they
+    // still need (empty) vectors of their own
+    doc_id next_id{0};
+    auto write_gap = [&](doc_id end)
     {
-        while (next_id > last_id + 1)
+        for (; next_id < end; ++next_id)
         {
-            ++last_id;
-            index_pdata_type empty;
-            empty.set_primary_key(
-                static_cast<doc_id>(idx_->impl_->doc_label_id(last_id)));
-            empty.write_libsvm(output);
+            (*doc_byte_locations_)[next_id] = output.byte_location();
+            index_pdata_type{next_id}.write_packed_counts(output);
         }
     };
 
-    // read from input, write to output, changing doc_id to class_label for the
-    // correct libsvm format
-    index_pdata_type pdata;
-    while (input >> pdata)
+    handler.merge_chunks([&](const index_pdata_type& pdata)
     {
         doc_id d_id = pdata.primary_key();
-
-        // write empty document lines for any documents in a gap
         write_gap(d_id);
-
-        // write current document
-        pdata.set_primary_key(
-            static_cast<doc_id>(idx_->impl_->doc_label_id(d_id)));
-        pdata.write_libsvm(output);
-        last_id = d_id;
-    }
-
-    // write any trailing empty documents
-    write_gap(doc_id{num_docs});
-
-    filesystem::delete_file(filename + ".tmp");
+        (*doc_byte_locations_)[d_id] = output.byte_location();
+        pdata.write_packed_counts(output);
+        next_id = d_id + 1;
+    });
+    write_gap(doc_id{inv_idx.num_docs()});
 }
 }
 }
@@ -0,0 +1,120 @@
+/**
+ * @file impact_list.cpp
+ */
+
+#include <algorithm>
+
+#include "index/impact_list.h"
+#include "io/block_codec.h"
+#include "io/block_file_writer.h"
+#include "io/mmap_file.h"
+
+namespace meta
+{
+namespace index
+{
+
+const uint64_t impact_list::block_size;
+
+impact_list::impact_list() : size_{0}
+{
+    // nothing
+}
+
+impact_list::impact_list(const io::mmap_file& file, uint64_t byte_offset)
+    : impact_list{}
+{
+    auto start = reinterpret_cast<const uint8_t*>(file.begin()) + byte_offset;
+    auto num_segments = io::block_codec::read_varint(start);
+    segments_.reserve(num_segments);
+    for (uint64_t i = 0; i < num_segments; ++i)
+    {
+        segment seg;
+        seg.impact = io::block_codec::read_varint(start);
+        seg.size = io::block_codec::read_varint(start);
+        seg.blocks = start;
+        for (uint64_t pos = 0; pos < seg.size; pos += block_size)
+            start = io::block_codec::skip(
+                start, std::min(block_size, seg.size - pos));
+
+        segments_.push_back(seg);
+        size_ += seg.size;
+    }
+}
+
+auto impact_list::segments() const -> const std::vector<segment> &
+{
+    return segments_;
+}
+
+uint64_t impact_list::size() const
+{
+    return size_;
+}
+
+void impact_list::decode(const segment& seg, uint64_t n,
+                         std::vector<uint64_t>& docs)
+{
+    n = std::min(n, seg.size);
+    if (docs.size() < n + block_size)
+        docs.resize(n + block_size);
+
+    auto in = seg.blocks;
+    uint64_t last = 0;
+    for (uint64_t pos = 0; pos < n; pos += block_size)
+    {
+        auto count = std::min(block_size, seg.size - pos);
+        in = io::block_codec::unpack(in, count, &docs[pos]);
+        for (uint64_t i = pos; i < pos + count; ++i)
+        {
+            docs[i] += last;
+            last = docs[i];
+        }
+    }
+}
+
+void impact_list::write(io::block_file_writer& out,
+                        std::vector<std::pair<uint64_t, uint64_t>>& postings)
+{
+    // highest impacts first, and doc_ids ascending within each impact
+    std::sort(postings.begin(), postings.end(),
+              [](const std::pair<uint64_t, uint64_t>& a,
+                 const std::pair<uint64_t, uint64_t>& b)
+              {
+        return a.first != b.first ? a.first > b.first : a.second < b.second;
+    });
+
+    uint64_t num_segments = 0;
+    for (uint64_t i = 0; i < postings.size(); ++i)
+    {
+        if (i == 0 || postings[i].first != postings[i - 1].first)
+            ++num_segments;
+    }
+    out.write(num_segments);
+
+    std::vector<uint64_t> gaps(block_size);
+    for (uint64_t begin = 0; begin < postings.size();)
+    {
+        auto impact = postings[begin].first;
+        auto end = begin;
+        while (end < postings.size() && postings[end].first == impact)
+            ++end;
+
+        out.write(impact);
+        out.write(end - begin);
+        uint64_t last = 0;
+        for (uint64_t pos = begin; pos < end; pos += block_size)
+        {
+            auto n = std::min(block_size, end - pos);
+            for (uint64_t i = 0; i < n; ++i)
+            {
+                gaps[i] = postings[pos + i].second - last;
+                last = postings[pos + i].second;
+            }
+            out.write_block(gaps.data(), n);
+        }
+        begin = end;
+    }
+}
+}
+}
@@ -4,16 +4,31 @@
  * @author Chase Geigle
  */
 
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
 #include "corpus/corpus.h"
 #include "index/chunk_handler.h"
 #include "index/disk_index_impl.h"
 #include "index/inverted_index.h"
+#include "index/position_index.h"
+#include "index/position_index_writer.h"
+#include "index/postings_cursor.h"
+#include "index/ranker/ranker_factory.h"
+#include "index/score_data.h"
 #include "index/string_list.h"
 #include "index/string_list_writer.h"
-#include "index/vocabulary_map.h"
-#include "index/vocabulary_map_writer.h"
+#include "index/term_dictionary.h"
+#include "index/term_dictionary_writer.h"
+#include "io/block_codec.h"
+#include "io/block_file_reader.h"
+#include "io/block_file_writer.h"
+#include "io/mmap_file.h"
 #include "parallel/thread_pool.h"
 #include "analyzers/analyzer.h"
+#include "analyzers/ngram/ngram_word_analyzer.h"
 #include "util/mapping.h"
 #include "util/pimpl.tcc"
 #include "util/progress.h"
@@ -34,6 +49,17 @@ class inverted_index::impl
     inverted_index* idx_;
 
   public:
+    /**
+     * The formats the postings file may be written in.
+     */
+    enum class postings_codec
+    {
+        /// Elias-gamma coded integers (the original format)
+        gamma,
+        /// Bit-packed blocks of postings (see postings_data::write_packed)
+        block
+    };
+
     /**
      * Constructs an inverted_index impl.
      * @param parent The parent of this impl
@@ -59,38 +85,170 @@ class inverted_index::impl
                         const std::string& lexicon_file);
 
     /**
-     * Compresses the large postings file.
+     * Merges the chunks written while tokenizing straight into the
+     * compressed postings file, building the vocabulary and lexicon as
+     * each term's postings are written.
+     * @param handler The chunk handler holding the chunks
+     */
+    void merge_postings(chunk_handler<inverted_index>& handler);
+
+    /**
+     * Writes every merged postings_data to the given writer, recording
+     * where each one begins.
+     * @param handler The chunk handler holding the chunks
+     * @param out The writer for the compressed postings file
+     */
+    template <class Writer>
+    void merge_postings(chunk_handler<inverted_index>& handler, Writer& out);
+
+    /**
+     * Builds impact-ordered postings if the configuration asks for them,
+     * using the ranker it specifies.
+     * @param config The configuration the index was created with
+     */
+    void build_configured_impacts(const cpptoml::table& config);
+
+    /**
+     * Opens the impact-ordered postings, if they have been built.
+     */
+    void load_impacts();
+
+    /**
+     * Starts collecting term positions as documents are tokenized, if the
+     * configuration asks for them.
+     * @param config The configuration the index is being created with
+     */
+    void begin_positions(const cpptoml::table& config);
+
+    /**
+     * Writes the positions collected since begin_positions(), now that
+     * the final term_ids are known, and opens them.
+     */
+    void finish_positions();
+
+    /**
+     * Opens the stored positions, if there are any.
      */
-    void compress(const std::string& filename, uint64_t num_unique_terms);
+    void load_positions();
+
+    /**
+     * Writes the term statistics table and opens it.
+     * @param stats The document frequency, corpus frequency and largest
+     * term frequency of each term, one after another
+     */
+    void save_term_stats(const std::vector<uint64_t>& stats);
+
+    /**
+     * Opens the term statistics table, computing it from the postings
+     * first if the index was built without one.
+     */
+    void load_term_stats();
+
+    /**
+     * @param t_id A term
+     * @param field Which of the term's statistics to read
+     * @return the statistic, or 0 if the term is not in the index
+     */
+    uint64_t term_stat(term_id t_id, uint64_t field) const;
+
+    /**
+     * @param config The configuration to read the codec from
+     * @return the postings codec specified by the configuration
+     */
+    static postings_codec load_codec(const cpptoml::table& config);
+
+    /// The format of the postings file
+    postings_codec codec_;
+
+    /// The maximum number of chunks to merge at once
+    uint64_t merge_fan_in_;
+
+    /// The number of bytes each tokenizing thread may buffer
+    uint64_t ram_budget_;
 
     /// The analyzer used to tokenize documents.
     std::unique_ptr<analyzers::analyzer> analyzer_;
 
+    /// Shown each document as it is tokenized, if set
+    document_observer observer_;
+
     /**
-     * PrimaryKey -> postings location.
+     * PrimaryKey -> postings location, in bits from the start of the
+     * postings file (block postings always start on a byte boundary).
      * Each index corresponds to a PrimaryKey (uint64_t).
      */
     util::optional<util::disk_vector<uint64_t>> term_bit_locations_;
 
-    /// the total number of term occurrences in the entire corpus
-    uint64_t total_corpus_terms_;
+    /**
+     * The statistics rankers need, so that none of them has to decode a
+     * postings list to find them: the total number of term occurrences
+     * and the number of documents they were counted over, then the
+     * document frequency, corpus frequency and largest term frequency of
+     * each term.
+     */
+    util::optional<util::disk_vector<uint64_t>> term_stats_;
+
+    /// The impact-ordered postings file, if there is one
+    std::unique_ptr<io::mmap_file> impact_file_;
+
+    /// PrimaryKey -> impact-ordered postings location, in bytes
+    util::optional<util::disk_vector<uint64_t>> impact_locations_;
+
+    /// The score that one unit of impact stands for
+    double impact_scale_;
+
+    /// Collects positions while the index is built, if they are stored
+    std::unique_ptr<position_index_writer> position_writer_;
+
+    /// The stored positions, if there are any
+    std::unique_ptr<position_index> positions_;
 };
 
 inverted_index::impl::impl(inverted_index* idx, const cpptoml::table& config)
     : idx_{idx},
+      codec_{load_codec(config)},
+      merge_fan_in_{chunk_handler<inverted_index>::default_fan_in},
+      ram_budget_{chunk_handler<inverted_index>::default_ram_budget},
       analyzer_{analyzers::analyzer::load(config)},
-      total_corpus_terms_{0}
+      impact_scale_{0}
 {
-    // nothing
+    if (auto fan_in = config.get_as<int64_t>("merge-fan-in"))
+        merge_fan_in_ = static_cast<uint64_t>(*fan_in);
+    if (auto budget = config.get_as<int64_t>("indexer-ram-budget"))
+        ram_budget_ = static_cast<uint64_t>(*budget) * 1024 * 1024;
+}
+
+auto inverted_index::impl::load_codec(const cpptoml::table& config)
+    -> postings_codec
+{
+    auto codec = config.get_as<std::string>("postings-codec");
+    if (!codec || *codec == "gamma")
+        return postings_codec::gamma;
+    if (*codec == "block")
+        return postings_codec::block;
+    throw inverted_index_exception{"unknown postings-codec: " + *codec};
 }
 
 inverted_index::inverted_index(const cpptoml::table& config)
-    : disk_index{config, *config.get_as<std::string>("inverted-index")},
-      inv_impl_{this, config}
+    : inverted_index{config, *config.get_as<std::string>("inverted-index")}
 {
     // nothing
 }
 
+inverted_index::inverted_index(const cpptoml::table& config,
+                               const std::string& name)
+    : disk_index{config, name}, inv_impl_{this, config}
+{
+    // nothing
+}
+
+inverted_index::inverted_index(const cpptoml::table& config,
+                               document_observer observer)
+    : inverted_index{config}
+{
+    inv_impl_->observer_ = std::move(observer);
+}
+
 inverted_index::inverted_index(inverted_index&&) = default;
 inverted_index& inverted_index::operator=(inverted_index&&) = default;
 inverted_index::~inverted_index() = default;
@@ -110,6 +268,47 @@ bool inverted_index::valid() const
     return true;
 }
 
+namespace
+{
+/**
+ * Postings hold 32-bit doc_ids in memory (see compact_posting), which
+ * limits how many documents an index can have.
+ * @param num_docs The number of documents an index is to be built with
+ */
+void check_num_docs(uint64_t num_docs)
+{
+    if (num_docs > std::numeric_limits<uint32_t>::max())
+        throw inverted_index::inverted_index_exception{
+            "an inverted index can hold at most "
+            + std::to_string(std::numeric_limits<uint32_t>::max())
+            + " documents"};
+}
+
+/**
+ * Asks the operating system to start reading one term's postings in.
+ * @param file The mapped postings
+ * @param locations Where each term's postings begin in the file, in
+ * units that are divided by scale to get a byte offset
+ * @param idx The term
+ * @param scale The number of location units in a byte
+ */
+void prefetch_postings(const io::mmap_file& file,
+                       const util::disk_vector<uint64_t>& locations,
+                       uint64_t idx, uint64_t scale)
+{
+    if (idx >= locations.size())
+        return;
+
+    // a term's postings end where the next term's begin
+    auto begin = locations[idx] / scale;
+    auto end = file.size();
+    if (idx + 1 < locations.size())
+        end = std::min(end, (locations[idx + 1] + scale - 1) / scale);
+    if (end > begin)
+        file.prefetch(begin, end - begin);
+}
+}
+
 void inverted_index::create_index(const std::string& config_file)
 {
     // save the config file so we can recreate the analyzer
@@ -121,46 +320,152 @@ void inverted_index::create_index(const std::string& config_file)
     auto docs = corpus::corpus::load(config_file);
 
     uint64_t num_docs = docs->size();
+    check_num_docs(num_docs);
     impl_->initialize_metadata(num_docs);
 
-    chunk_handler<inverted_index> handler{index_name()};
+    chunk_handler<inverted_index> handler{
+        index_name(), inv_impl_->merge_fan_in_, inv_impl_->ram_budget_};
+    inv_impl_->begin_positions(cpptoml::parse_file(config_file));
     inv_impl_->tokenize_docs(docs.get(), handler);
 
     impl_->load_doc_id_mapping();
 
-    handler.merge_chunks();
+    inv_impl_->merge_postings(handler);
 
-    LOG(info) << "Created uncompressed postings file " << index_name()
-              << impl_->files[POSTINGS] << " ("
-              << printing::bytes_to_units(handler.final_size()) << ")" << ENDLG;
+    impl_->load_term_id_mapping();
+    inv_impl_->finish_positions();
 
-    uint64_t num_unique_terms = handler.unique_primary_keys();
-    inv_impl_->compress(index_name() + impl_->files[POSTINGS],
-                        num_unique_terms);
+    impl_->save_label_id_mapping();
+    impl_->load_postings();
+
+    inv_impl_->build_configured_impacts(cpptoml::parse_file(config_file));
+
+    LOG(info) << "Done creating index: " << index_name() << ENDLG;
+}
+
+void inverted_index::merge_segments(
+    const std::vector<std::shared_ptr<inverted_index>>& segments,
+    const std::vector<std::vector<doc_id>>& docs)
+{
+    // keep the configuration so the analyzer and codec can be recreated
+    filesystem::copy_file(segments.front()->index_name() + "/config.toml",
+                          index_name() + "/config.toml");
+
+    LOG(info) << "Merging " << segments.size()
+              << " segments into: " << index_name() << ENDLG;
+
+    // documents that are not kept are dropped here, and the documents
+    // after them renumbered to close the gaps
+    uint64_t num_docs = 0;
+    for (const auto& kept : docs)
+        num_docs += kept.size();
+    check_num_docs(num_docs);
+    impl_->initialize_metadata(num_docs);
+
+    // positions are only kept if every segment has them
+    auto positions = std::all_of(segments.begin(), segments.end(),
+                                 [](const std::shared_ptr<inverted_index>& seg)
+                                 {
+        return seg->has_positions();
+    });
+    if (positions)
+        inv_impl_->position_writer_
+            = make_unique<position_index_writer>(index_name());
+
+    chunk_handler<inverted_index> handler{
+        index_name(), inv_impl_->merge_fan_in_, inv_impl_->ram_budget_};
+    {
+        auto docid_writer = impl_->make_doc_id_writer(num_docs);
+        std::unordered_map<std::string, std::vector<uint64_t>> doc_positions;
+        auto producer = handler.make_producer();
+        std::vector<std::pair<std::string, double>> counts(1);
+        std::vector<util::optional<doc_id>> new_ids;
+        uint64_t next_id = 0;
+        for (uint64_t i = 0; i < segments.size(); ++i)
+        {
+            const auto& segment = segments[i];
+            new_ids.assign(segment->num_docs(), util::nullopt);
+            for (const auto& d_id : docs[i])
+            {
+                doc_id id{next_id++};
+                new_ids[d_id] = id;
+                docid_writer.insert(id, segment->doc_path(d_id));
+                impl_->set_length(id, segment->doc_size(d_id));
+                impl_->set_unique_terms(id, segment->unique_terms(d_id));
+                impl_->set_label(id, segment->label(d_id));
+
+                if (positions)
+                {
+                    doc_positions.clear();
+                    for (auto& term :
+                         segment->inv_impl_->positions_->positions(d_id))
+                        doc_positions[segment->term_text(term.first)]
+                            = std::move(term.second);
+                    inv_impl_->position_writer_->insert(id, doc_positions);
+                }
+            }
+
+            // the producer takes postings in any order, so each list can
+            // be fed to it one posting at a time
+            printing::progress progress{" > Reading segment: ",
+                                        segment->unique_terms()};
+            for (term_id t_id{0}; t_id < segment->unique_terms(); ++t_id)
+            {
+                progress(t_id);
+                counts[0].first = segment->term_text(t_id);
+                auto pdata = segment->inverted_index::search_primary(t_id);
+                for (const auto& count : pdata->counts())
+                {
+                    if (!new_ids[count.first])
+                        continue;
+                    counts[0].second = count.second;
+                    producer(*new_ids[count.first], counts);
+                }
+            }
+        }
+    }
+
+    impl_->load_doc_id_mapping();
+
+    inv_impl_->merge_postings(handler);
 
     impl_->load_term_id_mapping();
+    inv_impl_->finish_positions();
 
     impl_->save_label_id_mapping();
     impl_->load_postings();
 
-    LOG(info) << "Done creating index: " << index_name() << ENDLG;
+    inv_impl_->build_configured_impacts(
+        cpptoml::parse_file(index_name() + "/config.toml"));
+
+    LOG(info) << "Done merging segments: " << index_name() << ENDLG;
 }
 
 void inverted_index::load_index()
 {
     LOG(info) << "Loading index from disk: " << index_name() << ENDLG;
 
+    // the codec is a property of the files on disk, so always take it from
+    // the configuration the index was built with
     auto config = cpptoml::parse_file(index_name() + "/config.toml");
+    inv_impl_->codec_ = impl::load_codec(config);
 
     impl_->initialize_metadata();
     impl_->load_doc_id_mapping();
     impl_->load_term_id_mapping();
 
     inv_impl_->term_bit_locations_
-        = util::disk_vector<uint64_t>(index_name() + "/lexicon.index");
+        = impl_->map_table<uint64_t>(index_name() + "/lexicon.index");
 
     impl_->load_label_id_mapping();
     impl_->load_postings();
+    inv_impl_->load_term_stats();
+
+    inv_impl_->load_impacts();
+    if (!has_impacts())
+        inv_impl_->build_configured_impacts(config);
+
+    inv_impl_->load_positions();
 }
 
 void inverted_index::impl::tokenize_docs(corpus::corpus* docs,
@@ -188,6 +493,8 @@ void inverted_index::impl::tokenize_docs(corpus::corpus* docs,
                 progress(doc->id());
             }
 
+            if (position_writer_)
+                doc->record_positions(true);
             analyzer->tokenize(*doc);
 
             // warn if there is an empty document
@@ -204,6 +511,10 @@ void inverted_index::impl::tokenize_docs(corpus::corpus* docs,
             idx_->impl_->set_length(doc->id(), doc->length());
             idx_->impl_->set_unique_terms(doc->id(), doc->counts().size());
             idx_->impl_->set_label(doc->id(), doc->label());
+            if (observer_)
+                observer_(*doc);
+            if (position_writer_)
+                position_writer_->insert(doc->id(), doc->positions());
             // update chunk
             producer(doc->id(), doc->counts());
         }
@@ -218,80 +529,597 @@ void inverted_index::impl::tokenize_docs(corpus::corpus* docs,
         fut.get();
 }
 
-void inverted_index::impl::compress(const std::string& filename,
-                                    uint64_t num_unique_terms)
+namespace
 {
-    std::string cfilename{filename + ".compressed"};
+/// The number of words before the first term's statistics
+const constexpr uint64_t stats_header = 2;
+
+/// The number of statistics stored for each term
+const constexpr uint64_t stats_width = 3;
+
+/// The position of each of a term's statistics
+enum term_stat_field : uint64_t
+{
+    DOC_FREQ,
+    CORPUS_FREQ,
+    MAX_FREQ
+};
+
+/**
+ * Appends a term's statistics to a buffered table.
+ */
+template <class PostingsData>
+void append_term_stats(const PostingsData& pdata, std::vector<uint64_t>& stats)
+{
+    uint64_t corpus_freq = 0;
+    uint64_t max_freq = 0;
+    for (const auto& count : pdata.counts())
+    {
+        corpus_freq += count.second;
+        max_freq = std::max<uint64_t>(max_freq, count.second);
+    }
+    stats.push_back(pdata.counts().size());
+    stats.push_back(corpus_freq);
+    stats.push_back(max_freq);
+}
+
+uint64_t bit_location(const io::compressed_file_writer& out)
+{
+    return out.bit_location();
+}
+
+uint64_t bit_location(const io::block_file_writer& out)
+{
+    return out.byte_location() * 8;
+}
+
+template <class PostingsData>
+void write_postings(const PostingsData& pdata, io::compressed_file_writer& out,
+                    const disk_index&)
+{
+    pdata.write_compressed(out);
+}
+
+template <class PostingsData>
+void write_postings(const PostingsData& pdata, io::block_file_writer& out,
+                    const disk_index& idx)
+{
+    // document lengths are recorded alongside the counts so that rankers
+    // can bound the scores of whole postings lists and blocks
+    pdata.write_packed(out, [&](doc_id d_id)
+    {
+        return idx.doc_size(d_id);
+    });
+}
+}
+
+void inverted_index::impl::merge_postings(
+    chunk_handler<inverted_index>& handler)
+{
+    auto filename = idx_->index_name() + idx_->impl_->files[POSTINGS];
 
     // create scope so the writer closes and we can calculate the size of the
-    // file as well as rename it
+    // file
+    if (codec_ == postings_codec::block)
+    {
+        io::block_file_writer out{filename};
+        merge_postings(handler, out);
+    }
+    else
     {
-        io::compressed_file_writer out{cfilename,
+        io::compressed_file_writer out{filename,
                                        io::default_compression_writer_func};
+        merge_postings(handler, out);
+    }
+
+    LOG(info) << "Created compressed postings file ("
+              << printing::bytes_to_units(filesystem::file_size(filename))
+              << ")" << ENDLG;
+}
+
+template <class Writer>
+void inverted_index::impl::merge_postings(
+    chunk_handler<inverted_index>& handler, Writer& out)
+{
+    term_dictionary_writer vocab{idx_->index_name()
+                                 + idx_->impl_->files[TERM_IDS_MAPPING]};
+
+    // the number of terms is not known until the merge is done, so the
+    // locations and statistics are buffered and written afterwards
+    std::vector<uint64_t> locations;
+    std::vector<uint64_t> stats;
+    handler.merge_chunks([&](const index_pdata_type& pdata)
+    {
+        vocab.insert(pdata.primary_key());
+        locations.push_back(bit_location(out));
+        append_term_stats(pdata, stats);
+        write_postings(pdata, out, *idx_);
+    });
+    vocab.finish();
+
+    term_bit_locations_ = util::disk_vector<uint64_t>(
+        idx_->index_name() + "/lexicon.index", locations.size());
+    for (uint64_t t_id = 0; t_id < locations.size(); ++t_id)
+        (*term_bit_locations_)[t_id] = locations[t_id];
+
+    save_term_stats(stats);
+}
+
+void inverted_index::impl::save_term_stats(const std::vector<uint64_t>& stats)
+{
+    // deleted documents still count until their postings are dropped
+    uint64_t total_terms = 0;
+    for (doc_id d_id{0}; d_id < idx_->num_docs(); ++d_id)
+        total_terms += idx_->doc_size(d_id);
+
+    term_stats_ = util::nullopt;
+    util::disk_vector<uint64_t> table{idx_->index_name() + "/termstats.index",
+                                      stats_header + stats.size()};
+    table[0] = total_terms;
+    table[1] = idx_->num_docs();
+    for (uint64_t i = 0; i < stats.size(); ++i)
+        table[stats_header + i] = stats[i];
+    term_stats_ = std::move(table);
+}
+
+void inverted_index::impl::load_term_stats()
+{
+    auto filename = idx_->index_name() + "/termstats.index";
+    if (filesystem::file_exists(filename))
+    {
+        term_stats_ = idx_->impl_->map_table<uint64_t>(filename);
+        auto size = stats_header + stats_width * term_bit_locations_->size();
+        if (term_stats_->size() == size
+            && (*term_stats_)[1] == idx_->num_docs())
+            return;
+    }
+
+    // indexes built before the table existed get one the first time they
+    // are loaded
+    LOG(info) << "Computing term statistics: " << idx_->index_name() << ENDLG;
+    std::vector<uint64_t> stats;
+    stats.reserve(stats_width * term_bit_locations_->size());
+    printing::progress progress{" > Counting terms: ",
+                                term_bit_locations_->size()};
+    for (term_id t_id{0}; t_id < term_bit_locations_->size(); ++t_id)
+    {
+        progress(t_id);
+        append_term_stats(*idx_->inverted_index::search_primary(t_id), stats);
+    }
+    save_term_stats(stats);
+}
+
+uint64_t inverted_index::impl::term_stat(term_id t_id, uint64_t field) const
+{
+    uint64_t idx{t_id};
+    if (idx >= term_bit_locations_->size())
+        return 0;
+    return (*term_stats_)[stats_header + stats_width * idx + field];
+}
+
+void inverted_index::impl::build_configured_impacts(
+    const cpptoml::table& config)
+{
+    auto bits = config.get_as<int64_t>("impact-bits");
+    if (!bits)
+        return;
+
+    auto group = config.get_table("ranker");
+    if (!group)
+        throw inverted_index_exception{
+            "impact-bits requires a [ranker] group to compute impacts with"};
+
+    if (*bits < 1 || *bits > 16)
+        throw inverted_index_exception{"impact-bits must be between 1 and 16"};
+
+    auto ranker = make_ranker(*group);
+    idx_->build_impacts(*ranker, static_cast<uint8_t>(*bits));
+}
+
+void inverted_index::impl::load_impacts()
+{
+    auto prefix = idx_->index_name() + "/impacts";
+    if (!filesystem::file_exists(prefix + ".postings")
+        || !filesystem::file_exists(prefix + ".index"))
+        return;
+
+    impact_file_ = make_unique<io::mmap_file>(
+        idx_->impl_->map_postings(prefix + ".postings"));
+    impact_locations_ = idx_->impl_->map_table<uint64_t>(prefix + ".index");
+
+    // the header is the number of bits followed by the scale's bits
+    auto start = reinterpret_cast<const uint8_t*>(impact_file_->begin());
+    io::block_codec::read_varint(start);
+    auto scale_bits = io::block_codec::read_varint(start);
+    std::memcpy(&impact_scale_, &scale_bits, sizeof(impact_scale_));
+}
+
+void inverted_index::impl::begin_positions(const cpptoml::table& config)
+{
+    auto store = config.get_as<bool>("store-positions");
+    if (!store || !*store)
+        return;
 
-        vocabulary_map_writer vocab{idx_->index_name()
-                                    + idx_->impl_->files[TERM_IDS_MAPPING]};
-
-        postings_data<std::string, doc_id> pdata;
-        auto length = filesystem::file_size(filename) * 8; // number of bits
-        io::compressed_file_reader in{filename,
-                                      io::default_compression_reader_func};
-
-        // allocate memory for the term_id -> term location mapping now
-        // that we know how many terms there are
-        term_bit_locations_ = util::disk_vector<uint64_t>(
-            idx_->index_name() + "/lexicon.index", num_unique_terms);
-
-        printing::progress progress{
-            " > Compressing postings: ", length, 500, 8 * 1024 /* 1KB */
-        };
-        // note: we will be accessing pdata in sorted order
-        term_id t_id{0};
-        while (in.has_next())
+    // positions come from the one analyzer that reports them; without it
+    // documents would be indexed with no positions at all
+    uint64_t unigram_analyzers = 0;
+    if (auto groups = config.get_table_array("analyzers"))
+    {
+        for (const auto& group : groups->get())
         {
-            in >> pdata;
-            progress(in.bit_location());
-            vocab.insert(pdata.primary_key());
-            (*term_bit_locations_)[t_id] = out.bit_location();
-            pdata.write_compressed(out);
-            ++t_id;
+            auto method = group->get_as<std::string>("method");
+            auto ngram = group->get_as<int64_t>("ngram");
+            if (method && *method == analyzers::ngram_word_analyzer::id
+                && ngram && *ngram == 1)
+                ++unigram_analyzers;
         }
     }
+    if (unigram_analyzers != 1)
+        throw inverted_index_exception{
+            "store-positions requires exactly one ngram-word analyzer with "
+            "ngram = 1 to report term positions"};
 
-    LOG(info) << "Created compressed postings file ("
-              << printing::bytes_to_units(filesystem::file_size(cfilename))
-              << ")" << ENDLG;
+    position_writer_ = make_unique<position_index_writer>(idx_->index_name());
+}
+
+void inverted_index::impl::finish_positions()
+{
+    if (!position_writer_)
+        return;
+
+    position_writer_->finish(idx_->num_docs(), [&](const std::string& term)
+                             {
+        return idx_->get_term_id(term);
+    });
+    position_writer_ = nullptr;
+    load_positions();
+}
+
+void inverted_index::impl::load_positions()
+{
+    if (position_index::exists(idx_->index_name()))
+        positions_ = make_unique<position_index>(idx_->index_name());
+}
+
+void inverted_index::build_impacts(ranker& r, uint8_t bits /* = 8 */)
+{
+    if (bits == 0 || bits > 16)
+        throw inverted_index_exception{
+            "impacts must be quantized to between 1 and 16 bits"};
+
+    // an impact is the score of a posting for a query holding its term
+    // once; the ranker scales impacts by the real query weights
+    score_data sd{*this, avg_doc_length(), num_docs(), total_corpus_terms(),
+                  1};
+    sd.query_term_weight = 1;
+
+    std::vector<double> scores;
+    auto score_term = [&](term_id t_id)
+    {
+        // bypass any postings cache, since every list is read only once
+        auto pdata = inverted_index::search_primary(t_id);
+        sd.t_id = t_id;
+        sd.doc_count = doc_freq(t_id);
+        sd.corpus_term_count = total_num_occurences(t_id);
 
-    filesystem::delete_file(filename);
-    filesystem::rename_file(cfilename, filename);
+        scores.clear();
+        for (const auto& count : pdata->counts())
+        {
+            sd.d_id = count.first;
+            sd.doc_term_count = count.second;
+            sd.doc_size = doc_size(sd.d_id);
+            sd.doc_unique_terms = unique_terms(sd.d_id);
+            scores.push_back(r.score_one(sd));
+        }
+        return pdata;
+    };
+
+    // the quantization is uniform over [0, max_score], so the largest
+    // score is needed before any impact can be written
+    double max_score = 0;
+    {
+        printing::progress progress{" > Bounding impacts: ", unique_terms()};
+        for (term_id t_id{0}; t_id < unique_terms(); ++t_id)
+        {
+            progress(t_id);
+            score_term(t_id);
+            for (const auto& score : scores)
+                max_score = std::max(max_score, score);
+        }
+    }
+
+    uint64_t max_impact = (uint64_t{1} << bits) - 1;
+    double scale = max_score > 0 ? max_score / max_impact : 1.0;
+    auto prefix = index_name() + "/impacts";
+    inv_impl_->impact_file_ = nullptr;
+    inv_impl_->impact_locations_ = util::nullopt;
+    {
+        io::block_file_writer out{prefix + ".postings"};
+        uint64_t scale_bits;
+        std::memcpy(&scale_bits, &scale, sizeof(scale));
+        out.write(bits);
+        out.write(scale_bits);
+
+        util::disk_vector<uint64_t> locations{prefix + ".index",
+                                              unique_terms()};
+        std::vector<std::pair<uint64_t, uint64_t>> postings;
+        printing::progress progress{" > Writing impacts: ", unique_terms()};
+        for (term_id t_id{0}; t_id < unique_terms(); ++t_id)
+        {
+            progress(t_id);
+            auto pdata = score_term(t_id);
+            postings.clear();
+            for (uint64_t i = 0; i < scores.size(); ++i)
+            {
+                // postings that score nothing can't change a ranking
+                if (scores[i] <= 0)
+                    continue;
+                auto impact = static_cast<uint64_t>(
+                    std::max(1.0, std::round(scores[i] / scale)));
+                postings.emplace_back(std::min(impact, max_impact),
+                                      pdata->counts()[i].first);
+            }
+            locations[t_id] = out.byte_location();
+            impact_list::write(out, postings);
+        }
+    }
+
+    inv_impl_->load_impacts();
+    LOG(info) << "Created impact-ordered postings file ("
+              << printing::bytes_to_units(
+                     filesystem::file_size(prefix + ".postings")) << ")"
+              << ENDLG;
+}
+
+bool inverted_index::has_impacts() const
+{
+    return inv_impl_->impact_file_ != nullptr;
+}
+
+impact_list inverted_index::impacts(term_id t_id) const
+{
+    if (!has_impacts())
+        throw inverted_index_exception{
+            "impact-ordered postings have not been built"};
+
+    uint64_t idx{t_id};
+    if (idx >= inv_impl_->impact_locations_->size())
+        return impact_list{};
+
+    return impact_list{*inv_impl_->impact_file_,
+                       inv_impl_->impact_locations_->at(idx)};
+}
+
+double inverted_index::impact_scale() const
+{
+    return inv_impl_->impact_scale_;
 }
 
 uint64_t inverted_index::term_freq(term_id t_id, doc_id d_id) const
 {
+    if (has_postings_cursors())
+    {
+        // the skip table lets us decode only the block that could hold d_id
+        auto postings = cursor(t_id);
+        postings.skip_to(d_id);
+        return postings.doc() == d_id ? postings.freq() : 0;
+    }
+
     auto pdata = search_primary(t_id);
     return pdata->count(d_id);
 }
 
-uint64_t inverted_index::total_corpus_terms()
+std::vector<doc_id>
+    inverted_index::intersect(const std::vector<term_id>& t_ids) const
 {
-    if (inv_impl_->total_corpus_terms_ == 0)
+    std::vector<postings_cursor> cursors;
+    for (const auto& t_id : t_ids)
+        cursors.push_back(cursor(t_id));
+    if (cursors.empty())
+        return {};
+
+    // drive the intersection from the rarest term so that the longer lists
+    // are mostly skipped rather than scanned
+    std::sort(cursors.begin(), cursors.end(),
+              [](const postings_cursor& a, const postings_cursor& b)
+              { return a.size() < b.size(); });
+
+    std::vector<doc_id> results;
+    auto candidate = cursors[0].doc();
+    while (candidate != postings_cursor::end_doc())
     {
-        for (auto& id : docs())
-            inv_impl_->total_corpus_terms_ += doc_size(id);
+        bool match = true;
+        for (uint64_t i = 1; i < cursors.size(); ++i)
+        {
+            cursors[i].skip_to(candidate);
+            if (cursors[i].doc() != candidate)
+            {
+                match = false;
+                cursors[0].skip_to(cursors[i].doc());
+                break;
+            }
+        }
+
+        if (match)
+        {
+            results.push_back(candidate);
+            cursors[0].next();
+        }
+        candidate = cursors[0].doc();
     }
+    return results;
+}
 
-    return inv_impl_->total_corpus_terms_;
+bool inverted_index::has_positions() const
+{
+    return inv_impl_->positions_ != nullptr;
 }
 
-uint64_t inverted_index::total_num_occurences(term_id t_id) const
+std::vector<uint64_t> inverted_index::positions(term_id t_id,
+                                                doc_id d_id) const
 {
-    auto pdata = search_primary(t_id);
+    if (!has_positions())
+        throw inverted_index_exception{"index has no positions"};
+
+    std::vector<std::vector<uint64_t>> positions;
+    inv_impl_->positions_->positions(d_id, {t_id}, positions);
+    return positions.front();
+}
+
+std::vector<term_id> inverted_index::tokenize_phrase(corpus::document& query)
+{
+    query.record_positions(true);
+    tokenize(query);
+
+    std::vector<std::pair<uint64_t, term_id>> occurrences;
+    for (const auto& term : query.positions())
+    {
+        auto t_id = get_term_id(term.first);
+        for (const auto& pos : term.second)
+            occurrences.emplace_back(pos, t_id);
+    }
+    std::sort(occurrences.begin(), occurrences.end());
+
+    std::vector<term_id> t_ids;
+    t_ids.reserve(occurrences.size());
+    for (const auto& occurrence : occurrences)
+        t_ids.push_back(occurrence.second);
+    return t_ids;
+}
+
+namespace
+{
+/**
+ * Calls a function with the positions of a set of terms in each live
+ * document that contains all of them.
+ */
+template <class Function>
+void for_each_candidate(const inverted_index& idx,
+                        const position_index& positions,
+                        const std::vector<term_id>& terms, Function&& fn)
+{
+    std::vector<std::vector<uint64_t>> term_positions;
+    for (const auto& d_id : idx.intersect(terms))
+    {
+        if (!idx.is_live(d_id))
+            continue;
+        positions.positions(d_id, terms, term_positions);
+        fn(d_id, term_positions);
+    }
+}
+}
+
+std::vector<doc_id>
+    inverted_index::phrase(const std::vector<term_id>& t_ids) const
+{
+    if (!has_positions())
+        throw inverted_index_exception{"index has no positions"};
+    if (t_ids.empty())
+        return {};
+
+    auto terms = t_ids;
+    std::sort(terms.begin(), terms.end());
+    terms.erase(std::unique(terms.begin(), terms.end()), terms.end());
 
-    double sum = 0;
-    for (auto& c : pdata->counts())
-        sum += c.second;
+    // where each word of the phrase is in terms
+    std::vector<uint64_t> slots;
+    for (const auto& t_id : t_ids)
+        slots.push_back(std::lower_bound(terms.begin(), terms.end(), t_id)
+                        - terms.begin());
 
-    return sum;
+    std::vector<doc_id> results;
+    for_each_candidate(
+        *this, *inv_impl_->positions_, terms,
+        [&](doc_id d_id, const std::vector<std::vector<uint64_t>>& positions)
+        {
+            for (const auto& start : positions[slots[0]])
+            {
+                bool match = true;
+                for (uint64_t i = 1; i < slots.size() && match; ++i)
+                {
+                    const auto& list = positions[slots[i]];
+                    match = std::binary_search(list.begin(), list.end(),
+                                               start + i);
+                }
+
+                if (match)
+                {
+                    results.push_back(d_id);
+                    return;
+                }
+            }
+        });
+    return results;
+}
+
+std::vector<doc_id> inverted_index::near(const std::vector<term_id>& t_ids,
+                                         uint64_t window) const
+{
+    if (!has_positions())
+        throw inverted_index_exception{"index has no positions"};
+    if (t_ids.empty() || window == 0)
+        return {};
+
+    auto terms = t_ids;
+    std::sort(terms.begin(), terms.end());
+    terms.erase(std::unique(terms.begin(), terms.end()), terms.end());
+    if (window < terms.size())
+        return {};
+
+    std::vector<doc_id> results;
+    std::vector<std::pair<uint64_t, uint64_t>> occurrences;
+    std::vector<uint64_t> in_window(terms.size());
+    for_each_candidate(
+        *this, *inv_impl_->positions_, terms,
+        [&](doc_id d_id, const std::vector<std::vector<uint64_t>>& positions)
+        {
+            occurrences.clear();
+            for (uint64_t i = 0; i < positions.size(); ++i)
+            {
+                for (const auto& pos : positions[i])
+                    occurrences.emplace_back(pos, i);
+            }
+            std::sort(occurrences.begin(), occurrences.end());
+
+            // slide a window over the occurrences, shrinking it from the
+            // left while it still holds every term
+            std::fill(in_window.begin(), in_window.end(), 0);
+            uint64_t distinct = 0;
+            uint64_t left = 0;
+            for (const auto& occurrence : occurrences)
+            {
+                if (in_window[occurrence.second]++ == 0)
+                    ++distinct;
+                while (distinct == terms.size())
+                {
+                    const auto& first = occurrences[left];
+                    if (occurrence.first - first.first < window)
+                    {
+                        results.push_back(d_id);
+                        return;
+                    }
+                    if (--in_window[first.second] == 0)
+                        --distinct;
+                    ++left;
+                }
+            }
+        });
+    return results;
+}
+
+uint64_t inverted_index::total_corpus_terms()
+{
+    return (*inv_impl_->term_stats_)[0];
+}
+
+uint64_t inverted_index::total_num_occurences(term_id t_id) const
+{
+    return inv_impl_->term_stat(t_id, CORPUS_FREQ);
+}
+
+uint64_t inverted_index::max_term_freq(term_id t_id) const
+{
+    return inv_impl_->term_stat(t_id, MAX_FREQ);
 }
 
 double inverted_index::avg_doc_length()
@@ -306,7 +1134,39 @@ void inverted_index::tokenize(corpus::document& doc)
 
 uint64_t inverted_index::doc_freq(term_id t_id) const
 {
-    return search_primary(t_id)->counts().size();
+    return inv_impl_->term_stat(t_id, DOC_FREQ);
+}
+
+bool inverted_index::has_postings_cursors() const
+{
+    return inv_impl_->codec_ == impl::postings_codec::block;
+}
+
+void inverted_index::prefetch(term_id t_id) const
+{
+    prefetch_postings(impl_->postings(), *inv_impl_->term_bit_locations_,
+                      uint64_t{t_id}, 8);
+}
+
+void inverted_index::prefetch_impacts(term_id t_id) const
+{
+    if (has_impacts())
+        prefetch_postings(*inv_impl_->impact_file_,
+                          *inv_impl_->impact_locations_, uint64_t{t_id}, 1);
+}
+
+postings_cursor inverted_index::cursor(term_id t_id) const
+{
+    if (!has_postings_cursors())
+        throw inverted_index_exception{
+            "postings cursors require the block postings-codec"};
+
+    uint64_t idx{t_id};
+    if (idx >= inv_impl_->term_bit_locations_->size())
+        return postings_cursor{};
+
+    return postings_cursor{impl_->postings(),
+                           inv_impl_->term_bit_locations_->at(idx) / 8};
 }
 
 auto inverted_index::search_primary(
@@ -318,12 +1178,25 @@ auto inverted_index::search_primary(
     if (idx >= inv_impl_->term_bit_locations_->size())
         return std::make_shared<postings_data_type>(t_id);
 
-    io::compressed_file_reader reader{impl_->postings(),
-                                      io::default_compression_reader_func};
-    reader.seek(inv_impl_->term_bit_locations_->at(idx));
+    // the whole list is about to be read, which the random access policy
+    // would otherwise fault in one page at a time
+    prefetch(t_id);
 
     auto pdata = std::make_shared<postings_data_type>(t_id);
-    pdata->read_compressed(reader);
+    auto bit_location = inv_impl_->term_bit_locations_->at(idx);
+    if (inv_impl_->codec_ == impl::postings_codec::block)
+    {
+        io::block_file_reader reader{impl_->postings()};
+        reader.seek(bit_location / 8);
+        pdata->read_packed(reader);
+    }
+    else
+    {
+        io::compressed_file_reader reader{impl_->postings(),
+                                          io::default_compression_reader_func};
+        reader.seek(bit_location);
+        pdata->read_compressed(reader);
+    }
 
     return pdata;
 }
@@ -0,0 +1,114 @@
+/**
+ * @file position_index.cpp
+ */
+
+#include "index/position_index.h"
+#include "io/block_codec.h"
+#include "util/filesystem.h"
+
+namespace meta
+{
+namespace index
+{
+
+const std::string position_index::postings_file = "/positions.postings";
+const std::string position_index::offsets_file = "/positions.index";
+
+position_index::position_index(const std::string& index_name)
+    : file_{index_name + postings_file}, offsets_{index_name + offsets_file}
+{
+    // nothing
+}
+
+bool position_index::exists(const std::string& index_name)
+{
+    return filesystem::file_exists(index_name + postings_file)
+           && filesystem::file_exists(index_name + offsets_file);
+}
+
+void position_index::positions(
+    doc_id d_id, const std::vector<term_id>& t_ids,
+    std::vector<std::vector<uint64_t>>& positions) const
+{
+    positions.resize(t_ids.size());
+    for (auto& list : positions)
+        list.clear();
+
+    auto in = reinterpret_cast<const uint8_t*>(file_.begin())
+              + offsets_.at(d_id);
+    auto num_terms = io::block_codec::read_varint(in);
+
+    // walk the term table, remembering where each wanted term's positions
+    // start, then decode only those
+    std::vector<std::pair<uint64_t, uint64_t>> wanted; // (index, count)
+    std::vector<uint64_t> starts;
+    uint64_t t_id = 0;
+    uint64_t bytes = 0;
+    uint64_t next = 0;
+    for (uint64_t i = 0; i < num_terms; ++i)
+    {
+        t_id += io::block_codec::read_varint(in);
+        auto count = io::block_codec::read_varint(in);
+        auto length = io::block_codec::read_varint(in);
+        while (next < t_ids.size() && t_ids[next] < t_id)
+            ++next;
+        if (next < t_ids.size() && t_ids[next] == t_id)
+        {
+            wanted.emplace_back(next, count);
+            starts.push_back(bytes);
+            ++next;
+        }
+        bytes += length;
+    }
+
+    for (uint64_t i = 0; i < wanted.size(); ++i)
+    {
+        auto pos = in + starts[i];
+        auto& list = positions[wanted[i].first];
+        list.resize(wanted[i].second);
+        uint64_t last = 0;
+        for (auto& p : list)
+        {
+            last += io::block_codec::read_varint(pos);
+            p = last;
+        }
+    }
+
+    // a term may be asked for more than once
+    for (uint64_t i = 1; i < t_ids.size(); ++i)
+    {
+        if (t_ids[i] == t_ids[i - 1])
+            positions[i] = positions[i - 1];
+    }
+}
+
+std::vector<std::pair<term_id, std::vector<uint64_t>>>
+    position_index::positions(doc_id d_id) const
+{
+    auto in = reinterpret_cast<const uint8_t*>(file_.begin())
+              + offsets_.at(d_id);
+    auto num_terms = io::block_codec::read_varint(in);
+
+    std::vector<std::pair<term_id, std::vector<uint64_t>>> terms(num_terms);
+    uint64_t t_id = 0;
+    for (auto& term : terms)
+    {
+        t_id += io::block_codec::read_varint(in);
+        term.first = term_id{t_id};
+        term.second.resize(io::block_codec::read_varint(in));
+        io::block_codec::read_varint(in); // byte length
+    }
+
+    for (auto& term : terms)
+    {
+        uint64_t last = 0;
+        for (auto& p : term.second)
+        {
+            last += io::block_codec::read_varint(in);
+            p = last;
+        }
+    }
+    return terms;
+}
+}
+}
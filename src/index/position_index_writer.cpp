@@ -0,0 +1,120 @@
+/**
+ * @file position_index_writer.cpp
+ */
+
+#include <algorithm>
+
+#include "index/position_index.h"
+#include "index/position_index_writer.h"
+#include "io/block_codec.h"
+#include "io/block_file_reader.h"
+#include "util/disk_vector.h"
+#include "util/filesystem.h"
+#include "util/progress.h"
+
+namespace meta
+{
+namespace index
+{
+
+namespace
+{
+/// The name of the scratch file within the index
+const std::string scratch_file = "/positions.provisional";
+}
+
+const uint64_t position_index_writer::npos;
+
+position_index_writer::position_index_writer(const std::string& index_name)
+    : index_name_{index_name}, scratch_{index_name + scratch_file}
+{
+    // nothing
+}
+
+void position_index_writer::insert(
+    doc_id d_id,
+    const std::unordered_map<std::string, std::vector<uint64_t>>& positions)
+{
+    std::lock_guard<std::mutex> lock{mutex_};
+    if (d_id >= offsets_.size())
+        offsets_.resize(d_id + 1, npos);
+    offsets_[d_id] = scratch_.byte_location();
+
+    scratch_.write(positions.size());
+    for (const auto& term : positions)
+    {
+        auto id = term_ids_.emplace(term.first, term_ids_.size());
+        scratch_.write(id.first->second);
+        scratch_.write(term.second.size());
+        for (const auto& pos : term.second)
+            scratch_.write(pos);
+    }
+}
+
+void position_index_writer::finish(
+    uint64_t num_docs,
+    const std::function<term_id(const std::string&)>& get_term_id)
+{
+    scratch_.close();
+
+    std::vector<term_id> final_ids(term_ids_.size());
+    for (const auto& term : term_ids_)
+        final_ids[term.second] = get_term_id(term.first);
+
+    {
+        io::block_file_reader input{index_name_ + scratch_file};
+        io::block_file_writer output{index_name_
+                                     + position_index::postings_file};
+        util::disk_vector<uint64_t> offsets{
+            index_name_ + position_index::offsets_file, num_docs};
+
+        printing::progress progress{" > Writing positions: ", num_docs};
+        std::vector<std::pair<term_id, std::vector<uint64_t>>> terms;
+        std::vector<uint8_t> bytes;
+        for (doc_id d_id{0}; d_id < num_docs; ++d_id)
+        {
+            progress(d_id);
+            terms.clear();
+            if (d_id < offsets_.size() && offsets_[d_id] != npos)
+            {
+                input.seek(offsets_[d_id]);
+                terms.resize(input.next());
+                for (auto& term : terms)
+                {
+                    term.first = final_ids[input.next()];
+                    term.second.resize(input.next());
+                    for (auto& pos : term.second)
+                        pos = input.next();
+                    std::sort(term.second.begin(), term.second.end());
+                }
+                std::sort(terms.begin(), terms.end());
+            }
+
+            offsets[d_id] = output.byte_location();
+            output.write(terms.size());
+
+            bytes.clear();
+            uint64_t last_id = 0;
+            for (const auto& term : terms)
+            {
+                auto begin = bytes.size();
+                uint64_t last = 0;
+                for (const auto& pos : term.second)
+                {
+                    io::block_codec::write_varint(bytes, pos - last);
+                    last = pos;
+                }
+
+                output.write(term.first - last_id);
+                output.write(term.second.size());
+                output.write(bytes.size() - begin);
+                last_id = term.first;
+            }
+            output.write_bytes(bytes);
+        }
+    }
+
+    filesystem::delete_file(index_name_ + scratch_file);
+}
+}
+}
@@ -0,0 +1,242 @@
+/**
+ * @file postings_cursor.cpp
+ */
+
+#include <algorithm>
+#include <limits>
+
+#include "index/postings_cursor.h"
+#include "index/postings_data.h"
+#include "io/block_codec.h"
+#include "io/mmap_file.h"
+
+namespace meta
+{
+namespace index
+{
+
+namespace
+{
+/// The number of postings in a full block
+const uint64_t block_size
+    = postings_data<term_id, doc_id, uint32_t>::block_size;
+}
+
+postings_cursor::postings_cursor()
+    : size_{0},
+      max_freq_{0},
+      min_doc_size_{0},
+      last_docs_{nullptr},
+      offsets_{nullptr},
+      blocks_{nullptr},
+      header_{},
+      decoded_{},
+      block_postings_{0},
+      pos_{0},
+      exhausted_{true}
+{
+    // nothing
+}
+
+postings_cursor::postings_cursor(const io::mmap_file& file,
+                                 uint64_t byte_offset)
+    : postings_cursor{}
+{
+    auto start = reinterpret_cast<const uint8_t*>(file.begin()) + byte_offset;
+    size_ = io::block_codec::read_varint(start);
+    if (size_ == 0)
+        return;
+
+    max_freq_ = io::block_codec::read_varint(start);
+    min_doc_size_ = io::block_codec::read_varint(start);
+    if (num_blocks() > 1)
+    {
+        last_docs_ = start;
+        offsets_ = io::block_codec::skip(last_docs_, num_blocks());
+        start = io::block_codec::skip(offsets_, num_blocks());
+    }
+    blocks_ = start;
+
+    docs_.resize(block_size);
+    counts_.resize(block_size);
+    exhausted_ = false;
+    header_ = read_header(0);
+    decode();
+}
+
+doc_id postings_cursor::end_doc()
+{
+    return doc_id{std::numeric_limits<uint64_t>::max()};
+}
+
+uint64_t postings_cursor::size() const
+{
+    return size_;
+}
+
+uint64_t postings_cursor::max_freq() const
+{
+    return max_freq_;
+}
+
+uint64_t postings_cursor::min_doc_size() const
+{
+    return min_doc_size_;
+}
+
+bool postings_cursor::valid() const
+{
+    return !exhausted_;
+}
+
+doc_id postings_cursor::doc() const
+{
+    if (exhausted_)
+        return end_doc();
+    return doc_id{docs_[pos_]};
+}
+
+uint64_t postings_cursor::freq() const
+{
+    return counts_[pos_];
+}
+
+void postings_cursor::next()
+{
+    if (exhausted_ || ++pos_ < block_postings_)
+        return;
+
+    if (decoded_.index + 1 == num_blocks())
+    {
+        exhausted_ = true;
+        return;
+    }
+
+    // the header may have been moved further ahead by shallow_skip_to, so
+    // always continue from the block that was last decoded
+    header_ = read_header(decoded_.index + 1);
+    decode();
+}
+
+void postings_cursor::skip_to(doc_id d_id)
+{
+    uint64_t target{d_id};
+    if (exhausted_ || target <= docs_[pos_])
+        return;
+
+    if (target > decoded_.last)
+    {
+        // a shallow skip past target would have passed over postings we
+        // still need, so start looking from the decoded block again
+        if (target <= header_.base)
+            header_ = decoded_;
+
+        shallow_skip_to(d_id);
+        if (header_.last < target)
+        {
+            exhausted_ = true;
+            return;
+        }
+        decode();
+    }
+
+    auto begin = docs_.begin();
+    pos_ = std::lower_bound(begin + pos_, begin + block_postings_, target)
+           - begin;
+}
+
+void postings_cursor::shallow_skip_to(doc_id d_id)
+{
+    uint64_t target{d_id};
+    auto last_block = num_blocks() - 1;
+    if (header_.last >= target || header_.index >= last_block)
+        return;
+
+    // gallop forward from the current block, since targets tend to be
+    // close by, then binary search the range that was overshot
+    auto low = header_.index + 1;
+    auto high = low;
+    for (uint64_t step = 1; high < last_block && last_doc(high) < target;
+         step *= 2)
+    {
+        low = high + 1;
+        high = std::min(last_block, high + step);
+    }
+
+    while (low < high)
+    {
+        auto mid = low + (high - low) / 2;
+        if (last_doc(mid) < target)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    header_ = read_header(low);
+}
+
+doc_id postings_cursor::block_last_doc() const
+{
+    return doc_id{header_.last};
+}
+
+uint64_t postings_cursor::block_max_freq() const
+{
+    return header_.max_freq;
+}
+
+uint64_t postings_cursor::block_min_doc_size() const
+{
+    return header_.min_doc_size;
+}
+
+auto postings_cursor::read_header(uint64_t index) const -> header
+{
+    header h;
+    h.index = index;
+    h.base = index == 0 ? 0 : last_doc(index - 1);
+
+    // single-block lists have no skip table; their last doc_id is filled
+    // in when the block is decoded
+    h.last = last_docs_ ? last_doc(index) : 0;
+    auto start = blocks_;
+    if (offsets_)
+        start += io::block_codec::packed_at(offsets_, index);
+
+    h.max_freq = io::block_codec::read_varint(start);
+    h.min_doc_size = io::block_codec::read_varint(start);
+    h.payload = start;
+    return h;
+}
+
+uint64_t postings_cursor::last_doc(uint64_t index) const
+{
+    return io::block_codec::packed_at(last_docs_, index);
+}
+
+uint64_t postings_cursor::num_blocks() const
+{
+    return (size_ + block_size - 1) / block_size;
+}
+
+void postings_cursor::decode()
+{
+    block_postings_ = std::min(block_size, size_ - header_.index * block_size);
+    auto counts = io::block_codec::unpack(header_.payload, block_postings_,
+                                          docs_.data());
+    io::block_codec::unpack(counts, block_postings_, counts_.data());
+
+    auto last = header_.base;
+    for (uint64_t i = 0; i < block_postings_; ++i)
+    {
+        last += docs_[i];
+        docs_[i] = last;
+        ++counts_[i];
+    }
+    if (!last_docs_)
+        header_.last = last;
+
+    decoded_ = header_;
+    pos_ = 0;
+}
+}
+}
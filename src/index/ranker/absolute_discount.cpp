@@ -34,6 +34,11 @@ double absolute_discount::doc_constant(const score_data& sd) const
     return delta_ * unique / sd.doc_size;
 }
 
+std::string absolute_discount::cache_key() const
+{
+    return make_cache_key(id, {delta_});
+}
+
 template <>
 std::unique_ptr<ranker>
     make_ranker<absolute_discount>(const cpptoml::table& config)
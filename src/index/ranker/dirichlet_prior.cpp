@@ -3,6 +3,8 @@
  * @author Sean Massung
  */
 
+#include <cmath>
+
 #include "cpptoml.h"
 #include "index/ranker/dirichlet_prior.h"
 #include "index/score_data.h"
@@ -32,6 +34,28 @@ double dirichlet_prior::doc_constant(const score_data& sd) const
     return mu_ / (sd.doc_size + mu_);
 }
 
+auto dirichlet_prior::prepare(const score_data& sd) const -> kernel
+{
+    double pc = static_cast<double>(sd.corpus_term_count) / sd.total_terms;
+    return {sd.query_term_weight, 1.0 / (mu_ * pc),
+            static_cast<double>(sd.query_length)};
+}
+
+float dirichlet_prior::normalizer(uint64_t doc_size, double) const
+{
+    return std::log(mu_ / (doc_size + mu_));
+}
+
+bool dirichlet_prior::supports_pruning() const
+{
+    return true;
+}
+
+std::string dirichlet_prior::cache_key() const
+{
+    return make_cache_key(id, {mu_});
+}
+
 template <>
 std::unique_ptr<ranker>
     make_ranker<dirichlet_prior>(const cpptoml::table& config)
@@ -0,0 +1,115 @@
+/**
+ * @file doc_filter.cpp
+ */
+
+#include <algorithm>
+#include <bitset>
+#include <limits>
+#include <string>
+
+#include "index/ranker/doc_filter.h"
+
+namespace meta
+{
+namespace index
+{
+
+doc_id doc_filter::end_doc()
+{
+    return doc_id{std::numeric_limits<uint64_t>::max()};
+}
+
+doc_filter doc_filter::bitset(uint64_t num_docs,
+                              const std::vector<doc_id>& ids)
+{
+    doc_filter filter;
+    filter.dense_ = true;
+    filter.words_.assign((num_docs + 63) / 64, 0);
+    for (const auto& id : ids)
+    {
+        if (id >= num_docs)
+            throw doc_filter_exception{"doc_id " + std::to_string(id)
+                                       + " is outside the index"};
+        filter.words_[id / 64] |= uint64_t{1} << (id % 64);
+    }
+
+    for (const auto& word : filter.words_)
+        filter.size_ += std::bitset<64>{word}.count();
+    return filter;
+}
+
+doc_filter doc_filter::sorted_ids(std::vector<doc_id> ids)
+{
+    std::sort(ids.begin(), ids.end());
+    ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+
+    doc_filter filter;
+    filter.size_ = ids.size();
+    filter.ids_ = std::move(ids);
+    return filter;
+}
+
+doc_filter doc_filter::make(uint64_t num_docs, std::vector<doc_id> ids)
+{
+    // a bitset takes one bit per document and a list 64 bits per allowed
+    // document; scanning either costs about as much as its size
+    if (ids.size() * 64 >= num_docs)
+        return bitset(num_docs, ids);
+    return sorted_ids(std::move(ids));
+}
+
+doc_filter::doc_filter() : dense_{false}, size_{0}
+{
+    // nothing
+}
+
+bool doc_filter::contains(doc_id d_id) const
+{
+    if (!dense_)
+        return std::binary_search(ids_.begin(), ids_.end(), d_id);
+
+    return d_id / 64 < words_.size()
+           && (words_[d_id / 64] >> (d_id % 64)) & 1;
+}
+
+doc_id doc_filter::next(doc_id d_id) const
+{
+    if (!dense_)
+    {
+        auto it = std::lower_bound(ids_.begin(), ids_.end(), d_id);
+        return it == ids_.end() ? end_doc() : *it;
+    }
+
+    uint64_t word = d_id / 64;
+    if (word >= words_.size())
+        return end_doc();
+
+    // clear the bits of the documents before d_id, then find the lowest
+    // set bit at or after it
+    auto bits = words_[word] & (~uint64_t{0} << (d_id % 64));
+    while (bits == 0)
+    {
+        if (++word == words_.size())
+            return end_doc();
+        bits = words_[word];
+    }
+    auto lowest = bits & (~bits + 1);
+    return doc_id{word * 64 + std::bitset<64>{lowest - 1}.count()};
+}
+
+uint64_t doc_filter::size() const
+{
+    return size_;
+}
+
+bool doc_filter::is_bitset() const
+{
+    return dense_;
+}
+
+const std::vector<doc_id>& doc_filter::ids() const
+{
+    return ids_;
+}
+}
+}
@@ -3,6 +3,8 @@
  * @author Sean Massung
  */
 
+#include <cmath>
+
 #include "cpptoml.h"
 #include "index/ranker/jelinek_mercer.h"
 #include "index/score_data.h"
@@ -32,6 +34,28 @@ double jelinek_mercer::doc_constant(const score_data&) const
     return lambda_;
 }
 
+auto jelinek_mercer::prepare(const score_data& sd) const -> kernel
+{
+    double pc = static_cast<double>(sd.corpus_term_count) / sd.total_terms;
+    return {sd.query_term_weight, (1.0 - lambda_) / (lambda_ * pc),
+            sd.query_length * std::log(lambda_)};
+}
+
+float jelinek_mercer::normalizer(uint64_t doc_size, double) const
+{
+    return doc_size == 0 ? 0.0f : 1.0f / doc_size;
+}
+
+bool jelinek_mercer::supports_pruning() const
+{
+    return true;
+}
+
+std::string jelinek_mercer::cache_key() const
+{
+    return make_cache_key(id, {lambda_});
+}
+
 template <>
 std::unique_ptr<ranker>
     make_ranker<jelinek_mercer>(const cpptoml::table& config)
@@ -4,7 +4,6 @@
  */
 
 #include <cmath>
-#include "corpus/document.h"
 #include "index/score_data.h"
 #include "index/ranker/lm_ranker.h"
 
@@ -25,7 +24,7 @@ double language_model_ranker::score_one(const score_data& sd)
 
 double language_model_ranker::initial_score(const score_data& sd) const
 {
-    return sd.query.length() * std::log(doc_constant(sd));
+    return sd.query_length * std::log(doc_constant(sd));
 }
 
 }
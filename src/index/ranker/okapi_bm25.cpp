@@ -20,22 +20,34 @@ okapi_bm25::okapi_bm25(double k1, double b, double k3) : k1_{k1}, b_{b}, k3_{k3}
     /* nothing */
 }
 
-double okapi_bm25::score_one(const score_data& sd)
+auto okapi_bm25::prepare(const score_data& sd) const -> kernel
 {
-    double doc_len = sd.idx.doc_size(sd.d_id);
-
     // add 1.0 to the IDF to ensure that the result is positive
     double IDF = std::log(
         1.0 + (sd.num_docs - sd.doc_count + 0.5) / (sd.doc_count + 0.5));
 
-    double TF = ((k1_ + 1.0) * sd.doc_term_count)
-                / ((k1_ * ((1.0 - b_) + b_ * doc_len / sd.avg_dl))
-                   + sd.doc_term_count);
-
     double QTF = ((k3_ + 1.0) * sd.query_term_weight)
                  / (k3_ + sd.query_term_weight);
 
-    return TF * IDF * QTF;
+    // the TF component, (k1 + 1) * tf / (normalizer + tf), is finished
+    // off by the kernel
+    return {(k1_ + 1.0) * IDF * QTF};
+}
+
+float okapi_bm25::normalizer(uint64_t doc_size, double avg_dl) const
+{
+    double doc_len = doc_size;
+    return k1_ * ((1.0 - b_) + b_ * doc_len / avg_dl);
+}
+
+bool okapi_bm25::supports_pruning() const
+{
+    return true;
+}
+
+std::string okapi_bm25::cache_key() const
+{
+    return make_cache_key(id, {k1_, b_, k3_});
 }
 
 template <>
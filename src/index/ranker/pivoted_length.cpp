@@ -3,6 +3,8 @@
  * @author Sean Massung
  */
 
+#include <cmath>
+
 #include "index/inverted_index.h"
 #include "index/ranker/pivoted_length.h"
 #include "index/score_data.h"
@@ -19,14 +21,26 @@ pivoted_length::pivoted_length(double s) : s_{s}
     /* nothing */
 }
 
-double pivoted_length::score_one(const score_data& sd)
+auto pivoted_length::prepare(const score_data& sd) const -> kernel
 {
-    double doc_len = sd.idx.doc_size(sd.d_id);
-    double TF = 1 + log(1 + log(sd.doc_term_count));
-    double norm = (1 - s_) + s_ * (doc_len / sd.avg_dl);
-    double IDF = log((sd.num_docs + 1) / (0.5 + sd.doc_count));
+    double IDF = std::log((sd.num_docs + 1) / (0.5 + sd.doc_count));
+    return {sd.query_term_weight * IDF};
+}
+
+float pivoted_length::normalizer(uint64_t doc_size, double avg_dl) const
+{
+    double doc_len = doc_size;
+    return (1 - s_) + s_ * (doc_len / avg_dl);
+}
 
-    return TF / norm * sd.query_term_weight * IDF;
+bool pivoted_length::supports_pruning() const
+{
+    return true;
+}
+
+std::string pivoted_length::cache_key() const
+{
+    return make_cache_key(id, {s_});
 }
 
 template <>
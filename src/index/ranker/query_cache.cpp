@@ -0,0 +1,151 @@
+/**
+ * @file query_cache.cpp
+ */
+
+#include <algorithm>
+#include <cstring>
+
+#include "corpus/document.h"
+#include "index/inverted_index.h"
+#include "index/ranker/query_cache.h"
+#include "index/ranker/ranker.h"
+
+namespace meta
+{
+namespace index
+{
+
+const constexpr uint64_t query_cache::default_bytes;
+
+namespace
+{
+/**
+ * Appends the bytes of a word to a key.
+ */
+template <class T>
+void append(std::string& key, T word)
+{
+    char bytes[sizeof(word)];
+    std::memcpy(bytes, &word, sizeof(word));
+    key.append(bytes, sizeof(word));
+}
+}
+
+double query_cache::statistics::hit_rate() const
+{
+    auto total = hits + misses;
+    return total == 0 ? 0.0 : static_cast<double>(hits) / total;
+}
+
+query_cache::query_cache(uint64_t max_bytes /* = default_bytes */)
+    : cache_{max_bytes}, hits_{0}, misses_{0}, hit_nanos_{0}, miss_nanos_{0}
+{
+    // nothing
+}
+
+auto query_cache::score(ranker& r, inverted_index& idx,
+                        corpus::document& query, uint64_t num_results)
+    -> result_list
+{
+    auto start = std::chrono::steady_clock::now();
+    auto elapsed = [&]()
+    {
+        return static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - start).count());
+    };
+
+    auto ranker_key = r.cache_key();
+    if (ranker_key.empty())
+    {
+        auto results = r.score(idx, query, num_results);
+        ++misses_;
+        miss_nanos_ += elapsed();
+        return results;
+    }
+
+    if (query.counts().empty())
+        idx.tokenize(query);
+
+    auto key = make_key(ranker_key, idx, query, num_results);
+    if (auto found = cache_.find(key))
+    {
+        auto results = (*found)->results;
+        ++hits_;
+        hit_nanos_ += elapsed();
+        return results;
+    }
+
+    auto cached = std::make_shared<entry>();
+    cached->results = r.score(idx, query, num_results);
+    cached->key_bytes = key.size();
+    cache_.insert(key, cached);
+
+    ++misses_;
+    miss_nanos_ += elapsed();
+    return cached->results;
+}
+
+std::string query_cache::make_key(const std::string& ranker_key,
+                                  inverted_index& idx,
+                                  const corpus::document& query,
+                                  uint64_t num_results)
+{
+    // terms the index doesn't have don't match anything, so they only
+    // affect the scores through the query's length
+    std::vector<std::pair<term_id, double>> terms;
+    terms.reserve(query.counts().size());
+    for (const auto& count : query.counts())
+    {
+        auto t_id = idx.get_term_id(count.first);
+        if (t_id < idx.unique_terms())
+            terms.emplace_back(t_id, count.second);
+    }
+    std::sort(terms.begin(), terms.end());
+
+    std::string key;
+    append(key, idx.generation());
+    append(key, idx.num_deleted());
+    append(key, num_results);
+    append(key, query.length());
+    append(key, static_cast<uint64_t>(terms.size()));
+    for (const auto& term : terms)
+    {
+        uint64_t t_id{term.first};
+        append(key, t_id);
+        append(key, term.second);
+    }
+    key.append(ranker_key);
+    return key;
+}
+
+auto query_cache::stats() const -> statistics
+{
+    return {hits_.load(), misses_.load(),
+            std::chrono::nanoseconds{hit_nanos_.load()},
+            std::chrono::nanoseconds{miss_nanos_.load()}};
+}
+
+uint64_t query_cache::size() const
+{
+    return cache_.size();
+}
+
+uint64_t query_cache::bytes() const
+{
+    return cache_.bytes();
+}
+
+void query_cache::clear()
+{
+    cache_.clear();
+}
+
+uint64_t query_cache::entry::bytes_used() const
+{
+    // the key is stored in both the cache's slot and its hash table
+    return results.capacity() * sizeof(result_list::value_type)
+           + 2 * key_bytes;
+}
+}
+}
@@ -3,17 +3,40 @@
  * @author Sean Massung
  */
 
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <queue>
+#include <thread>
+
 #include "corpus/document.h"
+#include "index/impact_list.h"
 #include "index/inverted_index.h"
+#include "index/postings_cursor.h"
 #include "index/postings_data.h"
+#include "index/ranker/doc_filter.h"
 #include "index/ranker/ranker.h"
 #include "index/score_data.h"
+#include "parallel/thread_pool.h"
 
 namespace meta
 {
 namespace index
 {
 
+namespace
+{
+/**
+ * The filtering function of queries restricted only by a doc_filter.
+ */
+bool allow_all(doc_id)
+{
+    return true;
+}
+}
+
 std::vector<std::pair<doc_id, double>>
 ranker::score(inverted_index& idx, corpus::document& query,
               uint64_t num_results /* = 10 */,
@@ -22,36 +45,425 @@ ranker::score(inverted_index& idx, corpus::document& query,
     if (query.counts().empty())
         idx.tokenize(query);
 
-    score_data sd{idx,            idx.avg_doc_length(),
-                  idx.num_docs(), idx.total_corpus_terms(),
-                  query};
+    return score_tokenized(idx, make_query(idx, query, nullptr), num_results,
+                           filter, nullptr, results_);
+}
+
+std::vector<std::pair<doc_id, double>>
+ranker::score(inverted_index& idx, corpus::document& query,
+              const collection_stats& stats, uint64_t num_results /* = 10 */,
+              const std::function<bool(doc_id d_id)>& filter /* return true */)
+{
+    if (query.counts().empty())
+        idx.tokenize(query);
+
+    return score_tokenized(idx, make_query(idx, query, &stats), num_results,
+                           filter, nullptr, results_, &stats);
+}
+
+std::vector<std::pair<doc_id, double>>
+ranker::score(inverted_index& idx,
+              const std::vector<std::pair<term_id, double>>& query,
+              uint64_t num_results /* = 10 */,
+              const std::function<bool(doc_id d_id)>& filter /* return true */)
+{
+    return score_tokenized(idx, make_query(idx, query), num_results, filter,
+                           nullptr, results_);
+}
+
+std::vector<std::pair<doc_id, double>>
+ranker::score(inverted_index& idx, corpus::document& query,
+              const doc_filter& allowed, uint64_t num_results /* = 10 */)
+{
+    if (query.counts().empty())
+        idx.tokenize(query);
+
+    return score_tokenized(idx, make_query(idx, query, nullptr), num_results,
+                           allow_all, &allowed, results_);
+}
+
+std::vector<std::pair<doc_id, double>>
+ranker::score(inverted_index& idx,
+              const std::vector<std::pair<term_id, double>>& query,
+              const doc_filter& allowed, uint64_t num_results /* = 10 */)
+{
+    return score_tokenized(idx, make_query(idx, query), num_results,
+                           allow_all, &allowed, results_);
+}
+
+std::vector<std::vector<std::pair<doc_id, double>>>
+ranker::score_batch(inverted_index& idx,
+                    std::vector<corpus::document>& queries,
+                    uint64_t num_results /* = 10 */,
+                    uint64_t num_threads /* = 0 */,
+                    const std::function<bool(doc_id d_id)>& filter
+                    /* return true */)
+{
+    if (queries.empty())
+        return {};
+
+    for (auto& query : queries)
+    {
+        if (query.counts().empty())
+            idx.tokenize(query);
+    }
+
+    if (num_threads == 0)
+        num_threads = std::max(1u, std::thread::hardware_concurrency());
+    num_threads = std::min<uint64_t>(num_threads, queries.size());
+
+    std::vector<std::vector<std::pair<doc_id, double>>> results(
+        queries.size());
+    std::atomic<uint64_t> next_query{0};
+    auto task = [&]()
+    {
+        accumulators scratch;
+        for (auto i = next_query++; i < queries.size(); i = next_query++)
+            results[i] = score_tokenized(
+                idx, make_query(idx, queries[i], nullptr), num_results, filter,
+                nullptr, scratch);
+    };
+
+    parallel::thread_pool pool{num_threads};
+    std::vector<std::future<void>> futures;
+    for (uint64_t i = 0; i < num_threads; ++i)
+        futures.emplace_back(pool.submit_task(task));
+
+    for (auto& fut : futures)
+        fut.get();
+
+    return results;
+}
+
+auto ranker::make_query(inverted_index& idx, const corpus::document& query,
+                        const collection_stats* stats) -> query_terms
+{
+    query_terms terms;
+    terms.length = query.length();
+    for (const auto& count : query.counts())
+    {
+        term_id t_id{idx.get_term_id(count.first)};
+        if (stats)
+        {
+            const auto& term = stats->terms.at(count.first);
+            terms.terms.push_back({t_id, count.second, term.first,
+                                   term.second});
+        }
+        else
+        {
+            terms.terms.push_back({t_id, count.second, idx.doc_freq(t_id),
+                                   idx.total_num_occurences(t_id)});
+        }
+    }
+    return terms;
+}
+
+auto ranker::make_query(inverted_index& idx,
+                        const std::vector<std::pair<term_id, double>>& query)
+    -> query_terms
+{
+    query_terms terms;
+    terms.length = 0;
+    for (const auto& term : query)
+    {
+        terms.terms.push_back({term.first, term.second,
+                               idx.doc_freq(term.first),
+                               idx.total_num_occurences(term.first)});
+        terms.length += term.second;
+    }
+    return terms;
+}
+
+std::vector<std::pair<doc_id, double>>
+ranker::score_tokenized(inverted_index& idx, const query_terms& query,
+                        uint64_t num_results,
+                        const std::function<bool(doc_id d_id)>& filter,
+                        const doc_filter* allowed, accumulators& results,
+                        const collection_stats* stats /* = nullptr */)
+{
+    // every strategy applies the filter to each candidate, so deleted
+    // documents are skipped by folding them into it
+    std::function<bool(doc_id)> live_filter;
+    if (idx.num_deleted() > 0)
+    {
+        live_filter = [&](doc_id d_id)
+        {
+            return idx.is_live(d_id) && filter(d_id);
+        };
+    }
+    const auto& keep = live_filter ? live_filter : filter;
+
+    // start reading every term's postings at once, rather than waiting on
+    // each list in turn as scoring reaches it
+    auto impacts = strategy_ == evaluation_strategy::score_at_a_time
+                   && idx.has_impacts() && !stats;
+    for (const auto& term : query.terms)
+    {
+        if (impacts)
+            idx.prefetch_impacts(term.t_id);
+        else
+            idx.prefetch(term.t_id);
+    }
+
+    if (impacts)
+        return score_impacts(idx, query, num_results, keep, allowed,
+                             results.impacts);
+
+    auto pruned = (strategy_ == evaluation_strategy::wand
+                   || strategy_ == evaluation_strategy::block_max_wand)
+                  && supports_pruning() && idx.has_postings_cursors();
+
+    if (pool_ && idx.has_postings_cursors())
+        return score_partitioned(idx, query, num_results, keep, allowed,
+                                 pruned, results.scores, stats);
+
+    if (pruned)
+        return score_pruned(idx, query, num_results, keep, allowed, stats,
+                            doc_id{0}, doc_id{idx.num_docs()});
+
+    return score_exhaustive(idx, query, num_results, keep, allowed,
+                            results.scores, stats);
+}
+
+namespace
+{
+/**
+ * @param idx The index being scored
+ * @param query_length The length of the current query
+ * @param stats Collection statistics to use instead of the index's, if any
+ * @return a score_data with its general fields filled in
+ */
+score_data make_score_data(inverted_index& idx, uint64_t query_length,
+                           const ranker::collection_stats* stats)
+{
+    if (!stats)
+        return {idx, idx.avg_doc_length(), idx.num_docs(),
+                idx.total_corpus_terms(), query_length};
+
+    return {idx, static_cast<double>(stats->total_terms) / stats->num_docs,
+            stats->num_docs, stats->total_terms, query_length};
+}
+}
+
+namespace
+{
+/**
+ * Loads the per-term fields of a score_data.
+ */
+template <class QueryTerm>
+void set_term(score_data& sd, const QueryTerm& term)
+{
+    sd.t_id = term.t_id;
+    sd.query_term_weight = term.weight;
+    sd.doc_count = term.doc_count;
+    sd.corpus_term_count = term.corpus_count;
+}
+
+/**
+ * Sets the accumulators of the documents a query may score to the lowest
+ * double.
+ */
+void reset_scores(std::vector<double>& results, uint64_t num_docs,
+                  const doc_filter* allowed)
+{
+    if (!allowed)
+    {
+        results.assign(num_docs, std::numeric_limits<double>::lowest());
+        return;
+    }
+
+    // only allowed documents are ever accumulated, so theirs are the only
+    // ones that need resetting
+    results.resize(num_docs, std::numeric_limits<double>::lowest());
+    allowed->for_each(doc_id{0}, doc_id{num_docs}, [&](doc_id d_id)
+                      {
+        results[d_id] = std::numeric_limits<double>::lowest();
+    });
+}
+
+/**
+ * Collects the postings of the allowed documents from a postings list.
+ * @param counts The postings list
+ * @param allowed The allowed documents
+ * @param out Where to put the postings of the allowed documents
+ */
+void intersect(const std::vector<compact_posting>& counts,
+               const doc_filter& allowed, std::vector<compact_posting>& out)
+{
+    out.clear();
+    if (allowed.is_bitset())
+    {
+        for (const auto& count : counts)
+        {
+            if (allowed.contains(doc_id{count.first}))
+                out.push_back(count);
+        }
+        return;
+    }
+
+    // search the longer list for each element of the shorter one, never
+    // looking behind the last match
+    const auto& ids = allowed.ids();
+    if (ids.size() < counts.size())
+    {
+        auto by_doc = [](const compact_posting& count, doc_id d_id)
+        { return count.first < d_id; };
+        auto it = counts.begin();
+        for (const auto& id : ids)
+        {
+            it = std::lower_bound(it, counts.end(), id, by_doc);
+            if (it == counts.end())
+                break;
+            if (it->first == id)
+                out.push_back(*it);
+        }
+    }
+    else
+    {
+        auto it = ids.begin();
+        for (const auto& count : counts)
+        {
+            it = std::lower_bound(it, ids.end(), count.first);
+            if (it == ids.end())
+                break;
+            if (*it == count.first)
+                out.push_back(count);
+        }
+    }
+}
+
+/**
+ * Collects the postings of the allowed documents in a range from a
+ * postings cursor, leapfrogging between the cursor and the filter so that
+ * only the blocks that may hold an allowed document are decoded.
+ * @param cursor The postings cursor
+ * @param allowed The allowed documents
+ * @param first The first doc_id of the range
+ * @param last One past the last doc_id of the range
+ * @param out Where to put the postings of the allowed documents
+ */
+void intersect(postings_cursor& cursor, const doc_filter& allowed,
+               doc_id first, doc_id last, std::vector<compact_posting>& out)
+{
+    out.clear();
+    cursor.skip_to(allowed.next(first));
+    while (cursor.doc() < last)
+    {
+        auto next = allowed.next(cursor.doc());
+        if (next != cursor.doc())
+        {
+            cursor.skip_to(next);
+            continue;
+        }
+        out.emplace_back(next, cursor.freq());
+        cursor.next();
+    }
+}
+}
+
+std::vector<std::pair<doc_id, double>>
+ranker::score_exhaustive(inverted_index& idx, const query_terms& query,
+                         uint64_t num_results,
+                         const std::function<bool(doc_id d_id)>& filter,
+                         const doc_filter* allowed,
+                         std::vector<double>& results,
+                         const collection_stats* stats)
+{
+    auto sd = make_score_data(idx, query.length, stats);
 
     // zeros out elements and (if necessary) resizes the vector; this eliminates
     // constructing a new vector each query for the same index
-    results_.assign(sd.num_docs, std::numeric_limits<double>::lowest());
+    reset_scores(results, idx.num_docs(), allowed);
 
-    for (auto& tpair : query.counts())
+    std::vector<compact_posting> counts;
+    for (const auto& term : query.terms)
     {
-        term_id t_id{idx.get_term_id(tpair.first)};
-        auto pdata = idx.search_primary(t_id);
-        sd.doc_count = pdata->counts().size();
-        sd.t_id = t_id;
-        sd.query_term_weight = tpair.second;
-        sd.corpus_term_count = idx.total_num_occurences(sd.t_id);
-        for (auto& dpair : pdata->counts())
+        set_term(sd, term);
+        if (!allowed)
         {
-            sd.d_id = dpair.first;
-            sd.doc_term_count = dpair.second;
-            sd.doc_size = idx.doc_size(dpair.first);
-            sd.doc_unique_terms = idx.unique_terms(dpair.first);
+            auto pdata = idx.search_primary(term.t_id);
+            score_postings(sd, pdata->counts(), results);
+        }
+        else if (idx.has_postings_cursors())
+        {
+            auto cursor = idx.cursor(term.t_id);
+            intersect(cursor, *allowed, doc_id{0}, doc_id{idx.num_docs()},
+                      counts);
+            score_postings(sd, counts, results);
+        }
+        else
+        {
+            auto pdata = idx.search_primary(term.t_id);
+            intersect(pdata->counts(), *allowed, counts);
+            score_postings(sd, counts, results);
+        }
+    }
+
+    using doc_pair = std::pair<doc_id, double>;
+    auto doc_pair_comp = [](const doc_pair& a, const doc_pair& b)
+    { return a.second > b.second; };
+
+    std::priority_queue<doc_pair,
+                        std::vector<doc_pair>,
+                        decltype(doc_pair_comp)> pq{doc_pair_comp};
+    auto consider = [&](doc_id d_id)
+    {
+        if (!filter(d_id))
+            return;
+
+        pq.emplace(d_id, results[d_id]);
+        if (pq.size() > num_results)
+            pq.pop();
+    };
 
-            // if this is the first time we've seen this document, compute
-            // its initial score
-            if (results_[dpair.first] == std::numeric_limits<double>::lowest())
-                results_[dpair.first] = initial_score(sd);
+    if (allowed)
+        allowed->for_each(doc_id{0}, doc_id{idx.num_docs()}, consider);
+    else
+    {
+        for (uint64_t id = 0; id < results.size(); ++id)
+            consider(doc_id{id});
+    }
 
-            results_[dpair.first] += score_one(sd);
+    std::vector<doc_pair> sorted;
+    while (!pq.empty())
+    {
+        sorted.emplace_back(pq.top());
+        pq.pop();
+    }
+    std::reverse(sorted.begin(), sorted.end());
+
+    return sorted;
+}
+
+std::vector<std::pair<doc_id, double>>
+ranker::score_exhaustive(inverted_index& idx, const query_terms& query,
+                         uint64_t num_results,
+                         const std::function<bool(doc_id d_id)>& filter,
+                         const doc_filter* allowed,
+                         std::vector<double>& results,
+                         const collection_stats* stats, doc_id first,
+                         doc_id last)
+{
+    auto sd = make_score_data(idx, query.length, stats);
+
+    std::vector<compact_posting> counts;
+    for (const auto& term : query.terms)
+    {
+        auto cursor = idx.cursor(term.t_id);
+        set_term(sd, term);
+
+        // only the blocks that overlap the range are decoded
+        if (allowed)
+        {
+            intersect(cursor, *allowed, first, last, counts);
         }
+        else
+        {
+            counts.clear();
+            for (cursor.skip_to(first); cursor.doc() < last; cursor.next())
+                counts.emplace_back(cursor.doc(), cursor.freq());
+        }
+        score_postings(sd, counts, results);
     }
 
     using doc_pair = std::pair<doc_id, double>;
@@ -61,12 +473,402 @@ ranker::score(inverted_index& idx, corpus::document& query,
     std::priority_queue<doc_pair,
                         std::vector<doc_pair>,
                         decltype(doc_pair_comp)> pq{doc_pair_comp};
-    for (uint64_t id = 0; id < results_.size(); ++id)
+    auto consider = [&](doc_id d_id)
+    {
+        if (!filter(d_id))
+            return;
+
+        pq.emplace(d_id, results[d_id]);
+        if (pq.size() > num_results)
+            pq.pop();
+    };
+
+    if (allowed)
+        allowed->for_each(first, last, consider);
+    else
+    {
+        uint64_t end{last};
+        for (uint64_t id{first}; id < end; ++id)
+            consider(doc_id{id});
+    }
+
+    std::vector<doc_pair> sorted;
+    while (!pq.empty())
+    {
+        sorted.emplace_back(pq.top());
+        pq.pop();
+    }
+    std::reverse(sorted.begin(), sorted.end());
+
+    return sorted;
+}
+
+namespace
+{
+/**
+ * The state kept for each query term during pruned evaluation.
+ */
+struct term_cursor
+{
+    /// The postings of the term
+    postings_cursor cursor;
+    /// The term's id
+    term_id t_id;
+    /// The term's weight in the query
+    double weight;
+    /// The number of documents the term appears in
+    uint64_t doc_count;
+    /// The number of times the term appears in the corpus
+    uint64_t corpus_count;
+    /// An upper bound on the term's score_one over the whole list
+    double max_score;
+};
+
+/**
+ * Sets the per-document fields of a score_data to the most favorable
+ * values allowed by a set of bounds, so that scoring it yields an upper
+ * bound on the score of any posting within those bounds.
+ */
+void set_bound(score_data& sd, uint64_t max_count, uint64_t min_doc_size)
+{
+    sd.doc_term_count = max_count;
+    // a document containing a term has at least one term
+    sd.doc_size = std::max<uint64_t>(min_doc_size, 1);
+    sd.doc_unique_terms = 1;
+}
+}
+
+std::vector<std::pair<doc_id, double>>
+ranker::score_pruned(inverted_index& idx, const query_terms& query,
+                     uint64_t num_results,
+                     const std::function<bool(doc_id d_id)>& filter,
+                     const doc_filter* allowed, const collection_stats* stats,
+                     doc_id first, doc_id last)
+{
+    using doc_pair = std::pair<doc_id, double>;
+    if (num_results == 0)
+        return {};
+
+    auto sd = make_score_data(idx, query.length, stats);
+
+    std::vector<term_cursor> terms;
+    uint64_t min_doc_size = std::numeric_limits<uint64_t>::max();
+    for (const auto& qterm : query.terms)
+    {
+        auto cursor = idx.cursor(qterm.t_id);
+        if (!cursor.valid())
+            continue;
+
+        min_doc_size = std::min(min_doc_size, cursor.min_doc_size());
+        terms.push_back({std::move(cursor), qterm.t_id, qterm.weight,
+                         qterm.doc_count, qterm.corpus_count, 0.0});
+        auto& term = terms.back();
+        set_term(sd, term);
+        set_bound(sd, term.cursor.max_freq(), term.cursor.min_doc_size());
+        term.max_score = score_one(sd);
+    }
+
+    if (terms.empty())
+        return {};
+
+    if (allowed)
+        first = allowed->next(first);
+    for (auto& term : terms)
+        term.cursor.skip_to(first);
+
+    // every candidate contains a query term, so it is no shorter than the
+    // shortest document containing any of them
+    set_bound(sd, 0, min_doc_size);
+    auto initial_bound = initial_score(sd);
+
+    auto doc_pair_comp = [](const doc_pair& a, const doc_pair& b)
+    { return a.second > b.second; };
+    std::priority_queue<doc_pair, std::vector<doc_pair>,
+                        decltype(doc_pair_comp)> pq{doc_pair_comp};
+    auto threshold = [&]()
+    {
+        return pq.size() < num_results ? std::numeric_limits<double>::lowest()
+                                       : pq.top().second;
+    };
+
+    std::vector<term_cursor*> order;
+    for (auto& term : terms)
+        order.push_back(&term);
+    auto by_doc = [](const term_cursor* a, const term_cursor* b)
+    { return a->cursor.doc() < b->cursor.doc(); };
+
+    auto end_doc = postings_cursor::end_doc();
+    bool block_max = strategy_ == evaluation_strategy::block_max_wand;
+    while (true)
+    {
+        std::sort(order.begin(), order.end(), by_doc);
+
+        // find the first term whose bound, together with those of all the
+        // terms before it, could beat the current threshold; no document
+        // before its current doc_id can make it into the results
+        auto theta = threshold();
+        auto bound = initial_bound;
+        uint64_t pivot = 0;
+        for (; pivot < order.size(); ++pivot)
+        {
+            if (order[pivot]->cursor.doc() == end_doc)
+            {
+                pivot = order.size();
+                break;
+            }
+            bound += order[pivot]->max_score;
+            if (bound > theta)
+                break;
+        }
+        if (pivot == order.size())
+            break;
+
+        auto pivot_doc = order[pivot]->cursor.doc();
+        if (pivot_doc >= last)
+            break;
+        while (pivot + 1 < order.size()
+               && order[pivot + 1]->cursor.doc() == pivot_doc)
+            ++pivot;
+
+        if (allowed && !allowed->contains(pivot_doc))
+        {
+            // documents before pivot_doc can't beat the threshold, and
+            // those before the next allowed one can't be returned
+            auto next_doc = allowed->next(pivot_doc);
+            for (uint64_t i = 0; i <= pivot; ++i)
+                order[i]->cursor.skip_to(next_doc);
+            continue;
+        }
+
+        if (block_max)
+        {
+            // refine the bound using the blocks that could hold pivot_doc;
+            // if it still can't beat the threshold, nothing before the end
+            // of the first of those blocks can either
+            auto block_bound = initial_bound;
+            auto next_doc = pivot + 1 < order.size()
+                                ? order[pivot + 1]->cursor.doc()
+                                : end_doc;
+            for (uint64_t i = 0; i <= pivot; ++i)
+            {
+                auto& cursor = order[i]->cursor;
+                cursor.shallow_skip_to(pivot_doc);
+                if (cursor.block_last_doc() < pivot_doc)
+                    continue;
+
+                set_term(sd, *order[i]);
+                set_bound(sd, cursor.block_max_freq(),
+                          cursor.block_min_doc_size());
+                block_bound += score_one(sd);
+                next_doc = std::min(
+                    next_doc, doc_id{cursor.block_last_doc() + 1});
+            }
+
+            if (block_bound <= theta)
+            {
+                for (uint64_t i = 0; i <= pivot; ++i)
+                    order[i]->cursor.skip_to(next_doc);
+                continue;
+            }
+        }
+
+        if (order[0]->cursor.doc() != pivot_doc)
+        {
+            for (uint64_t i = 0; i < pivot; ++i)
+                order[i]->cursor.skip_to(pivot_doc);
+            continue;
+        }
+
+        // every term up to and including the pivot is at pivot_doc
+        if (filter(pivot_doc))
+        {
+            sd.d_id = pivot_doc;
+            sd.doc_size = idx.doc_size(pivot_doc);
+            sd.doc_unique_terms = idx.unique_terms(pivot_doc);
+            auto score = initial_score(sd);
+            for (uint64_t i = 0; i <= pivot; ++i)
+            {
+                set_term(sd, *order[i]);
+                sd.doc_term_count = order[i]->cursor.freq();
+                score += score_one(sd);
+            }
+
+            if (score > theta)
+            {
+                pq.emplace(pivot_doc, score);
+                if (pq.size() > num_results)
+                    pq.pop();
+            }
+        }
+
+        for (uint64_t i = 0; i <= pivot; ++i)
+            order[i]->cursor.next();
+    }
+
+    std::vector<doc_pair> sorted;
+    while (!pq.empty())
     {
+        sorted.emplace_back(pq.top());
+        pq.pop();
+    }
+    std::reverse(sorted.begin(), sorted.end());
+
+    return sorted;
+}
+
+std::vector<std::pair<doc_id, double>>
+ranker::score_partitioned(inverted_index& idx, const query_terms& query,
+                          uint64_t num_results,
+                          const std::function<bool(doc_id d_id)>& filter,
+                          const doc_filter* allowed, bool pruned,
+                          std::vector<double>& results,
+                          const collection_stats* stats)
+{
+    using doc_pair = std::pair<doc_id, double>;
+    if (!pruned)
+        reset_scores(results, idx.num_docs(), allowed);
+
+    // each range writes only its own accumulators, so they can be shared
+    auto num_ranges = std::max<uint64_t>(
+        1, std::min<uint64_t>(query_threads_, idx.num_docs()));
+    std::vector<std::future<std::vector<doc_pair>>> futures;
+    for (uint64_t i = 0; i < num_ranges; ++i)
+    {
+        doc_id first{idx.num_docs() * i / num_ranges};
+        doc_id last{idx.num_docs() * (i + 1) / num_ranges};
+        futures.emplace_back(pool_->submit_task([&, first, last]()
+        {
+            if (pruned)
+                return score_pruned(idx, query, num_results, filter, allowed,
+                                    stats, first, last);
+            return score_exhaustive(idx, query, num_results, filter, allowed,
+                                    results, stats, first, last);
+        }));
+    }
+
+    std::vector<doc_pair> merged;
+    for (auto& fut : futures)
+    {
+        auto ranking = fut.get();
+        merged.insert(merged.end(), ranking.begin(), ranking.end());
+    }
+
+    // break ties by doc_id so the results don't depend on the ranges
+    auto by_score = [](const doc_pair& a, const doc_pair& b)
+    {
+        return a.second > b.second
+               || (a.second == b.second && a.first < b.first);
+    };
+    auto size = std::min<uint64_t>(num_results, merged.size());
+    std::partial_sort(merged.begin(), merged.begin() + size, merged.end(),
+                      by_score);
+    merged.resize(size);
+    return merged;
+}
+
+std::vector<std::pair<doc_id, double>>
+ranker::score_impacts(inverted_index& idx, const query_terms& query,
+                      uint64_t num_results,
+                      const std::function<bool(doc_id d_id)>& filter,
+                      const doc_filter* allowed,
+                      std::vector<uint32_t>& results)
+{
+    using doc_pair = std::pair<doc_id, double>;
+    if (num_results == 0)
+        return {};
+
+    auto sd = make_score_data(idx, query.length, nullptr);
+
+    // the document fields only matter through the ratio below and the
+    // (constant) initial score, so a typical document stands in for all
+    sd.d_id = doc_id{0};
+    sd.doc_term_count = 1;
+    sd.doc_size = std::max<uint64_t>(1, std::lround(sd.avg_dl));
+    sd.doc_unique_terms = 1;
+
+    /**
+     * A segment of postings and the impact of each of them on this query.
+     */
+    struct weighted_segment
+    {
+        impact_list::segment seg;
+        uint64_t impact;
+    };
+
+    std::vector<weighted_segment> segments;
+    for (const auto& term : query.terms)
+    {
+        auto list = idx.impacts(term.t_id);
+        if (list.size() == 0)
+            continue;
+
+        // impacts were computed for a query weight of one, so scale them
+        // by how much the real weight changes score_one()
+        set_term(sd, term);
+        sd.query_term_weight = 1;
+        auto unit = score_one(sd);
+        sd.query_term_weight = term.weight;
+        auto weight = unit > 0 ? score_one(sd) / unit : term.weight;
+
+        for (const auto& seg : list.segments())
+        {
+            auto impact = std::round(seg.impact * weight);
+            if (impact >= 1)
+                segments.push_back({seg, static_cast<uint64_t>(impact)});
+        }
+    }
+
+    // visit the postings that matter most first, so that whatever part of
+    // the query fits in the budget does the most for the ranking
+    std::stable_sort(segments.begin(), segments.end(),
+                     [](const weighted_segment& a, const weighted_segment& b)
+                     { return a.impact > b.impact; });
+
+    // only the accumulators that are touched are zeroed afterwards, so the
+    // vector is all zeros between queries
+    results.resize(idx.num_docs());
+    std::vector<uint64_t> touched;
+    std::vector<uint64_t> docs;
+    auto budget = postings_budget_ == 0 ? std::numeric_limits<uint64_t>::max()
+                                        : postings_budget_;
+    auto start = std::chrono::steady_clock::now();
+    for (const auto& ws : segments)
+    {
+        if (budget == 0
+            || (time_budget_.count() > 0
+                && std::chrono::steady_clock::now() - start >= time_budget_))
+            break;
+
+        auto n = std::min(budget, ws.seg.size);
+        impact_list::decode(ws.seg, n, docs);
+        auto impact = static_cast<uint32_t>(ws.impact);
+        for (uint64_t i = 0; i < n; ++i)
+        {
+            if (allowed && !allowed->contains(doc_id{docs[i]}))
+                continue;
+
+            auto& acc = results[docs[i]];
+            if (acc == 0)
+                touched.push_back(docs[i]);
+            acc += impact;
+        }
+        budget -= n;
+    }
+
+    auto initial = initial_score(sd);
+    auto scale = idx.impact_scale();
+    auto doc_pair_comp = [](const doc_pair& a, const doc_pair& b)
+    { return a.second > b.second; };
+    std::priority_queue<doc_pair, std::vector<doc_pair>,
+                        decltype(doc_pair_comp)> pq{doc_pair_comp};
+    for (const auto& id : touched)
+    {
+        auto acc = results[id];
+        results[id] = 0;
         if (!filter(doc_id{id}))
             continue;
 
-        pq.emplace(doc_id{id}, results_[id]);
+        pq.emplace(doc_id{id}, initial + acc * scale);
         if (pq.size() > num_results)
             pq.pop();
     }
@@ -82,10 +884,102 @@ ranker::score(inverted_index& idx, corpus::document& query,
     return sorted;
 }
 
+void ranker::score_postings(score_data& sd,
+                            const std::vector<compact_posting>& counts,
+                            std::vector<double>& results)
+{
+    for (const auto& dpair : counts)
+    {
+        sd.d_id = dpair.first;
+        sd.doc_term_count = dpair.second;
+        sd.doc_size = sd.idx.doc_size(sd.d_id);
+        sd.doc_unique_terms = sd.idx.unique_terms(sd.d_id);
+
+        // if this is the first time we've seen this document, compute
+        // its initial score
+        if (results[dpair.first] == std::numeric_limits<double>::lowest())
+            results[dpair.first] = initial_score(sd);
+
+        results[dpair.first] += score_one(sd);
+    }
+}
+
 double ranker::initial_score(const score_data&) const
 {
     return 0.0;
 }
 
+bool ranker::supports_pruning() const
+{
+    return false;
+}
+
+std::string ranker::cache_key() const
+{
+    return {};
+}
+
+std::string ranker::make_cache_key(const std::string& id,
+                                   std::initializer_list<double> params) const
+{
+    auto append = [](std::string& key, uint64_t word)
+    {
+        char bytes[sizeof(word)];
+        std::memcpy(bytes, &word, sizeof(word));
+        key.append(bytes, sizeof(word));
+    };
+
+    // the id can't contain a null, so it ends where the parameters begin
+    std::string key = id;
+    key.push_back('\0');
+    for (const auto& param : params)
+    {
+        uint64_t bits;
+        std::memcpy(&bits, &param, sizeof(bits));
+        append(key, bits);
+    }
+
+    // pruned and exhaustive evaluation can break ties differently, and
+    // score-at-a-time evaluation is approximate
+    append(key, static_cast<uint64_t>(strategy_));
+    append(key, postings_budget_);
+    append(key, static_cast<uint64_t>(time_budget_.count()));
+    return key;
+}
+
+void ranker::strategy(evaluation_strategy strategy)
+{
+    strategy_ = strategy;
+}
+
+auto ranker::strategy() const -> evaluation_strategy
+{
+    return strategy_;
+}
+
+void ranker::postings_budget(uint64_t max_postings)
+{
+    postings_budget_ = max_postings;
+}
+
+void ranker::time_budget(std::chrono::microseconds max_time)
+{
+    time_budget_ = max_time;
+}
+
+void ranker::query_threads(uint64_t num_threads)
+{
+    query_threads_ = num_threads;
+    if (num_threads > 1)
+        pool_ = std::make_shared<parallel::thread_pool>(num_threads);
+    else
+        pool_ = nullptr;
+}
+
+uint64_t ranker::query_threads() const
+{
+    return query_threads_;
+}
+
 }
 }
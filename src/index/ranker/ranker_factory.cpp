@@ -34,7 +34,28 @@ std::unique_ptr<ranker> make_ranker(const cpptoml::table& config)
     if (!function)
         throw ranker_factory::exception{
             "ranking-function required to construct a ranker"};
-    return ranker_factory::get().create(*function, config);
+    auto ranker = ranker_factory::get().create(*function, config);
+
+    auto evaluation = config.get_as<std::string>("evaluation");
+    if (!evaluation || *evaluation == "exhaustive")
+        ranker->strategy(ranker::evaluation_strategy::exhaustive);
+    else if (*evaluation == "wand")
+        ranker->strategy(ranker::evaluation_strategy::wand);
+    else if (*evaluation == "block-max-wand")
+        ranker->strategy(ranker::evaluation_strategy::block_max_wand);
+    else if (*evaluation == "score-at-a-time")
+        ranker->strategy(ranker::evaluation_strategy::score_at_a_time);
+    else
+        throw ranker_factory::exception{"unknown ranker evaluation: "
+                                        + *evaluation};
+
+    if (auto budget = config.get_as<int64_t>("postings-budget"))
+        ranker->postings_budget(static_cast<uint64_t>(*budget));
+    if (auto budget = config.get_as<int64_t>("time-budget"))
+        ranker->time_budget(std::chrono::microseconds{*budget});
+    if (auto threads = config.get_as<int64_t>("query-threads"))
+        ranker->query_threads(static_cast<uint64_t>(*threads));
+    return ranker;
 }
 }
 }
@@ -0,0 +1,216 @@
+/**
+ * @file simd_score.cpp
+ */
+
+#include "index/ranker/simd_score.h"
+
+#if META_HAS_X86_AVX2
+#include <immintrin.h>
+#define META_AVX2 __attribute__((target("avx2")))
+#endif
+
+namespace meta
+{
+namespace index
+{
+namespace simd
+{
+
+#if META_HAS_X86_AVX2
+namespace
+{
+
+/**
+ * Four of simd::log(), with the same operations.
+ */
+META_AVX2 __m256d log_pd(__m256d x)
+{
+    auto bits = _mm256_castpd_si256(x);
+
+    auto e_bits = _mm256_or_si256(_mm256_srli_epi64(bits, 52),
+                                  _mm256_set1_epi64x(0x4330000000000000ll));
+    auto e = _mm256_sub_pd(_mm256_castsi256_pd(e_bits),
+                           _mm256_set1_pd(4503599627370496.0));
+    e = _mm256_sub_pd(e, _mm256_set1_pd(1023.0));
+
+    bits = _mm256_or_si256(
+        _mm256_and_si256(bits, _mm256_set1_epi64x(0x000FFFFFFFFFFFFFll)),
+        _mm256_set1_epi64x(0x3FF0000000000000ll));
+    auto m = _mm256_castsi256_pd(bits);
+    auto big = _mm256_cmp_pd(m, _mm256_set1_pd(1.4142135623730951),
+                             _CMP_GT_OQ);
+    m = _mm256_blendv_pd(m, _mm256_mul_pd(m, _mm256_set1_pd(0.5)), big);
+    e = _mm256_blendv_pd(e, _mm256_add_pd(e, _mm256_set1_pd(1.0)), big);
+
+    auto one = _mm256_set1_pd(1.0);
+    auto s = _mm256_div_pd(_mm256_sub_pd(m, one), _mm256_add_pd(m, one));
+    auto z = _mm256_mul_pd(s, s);
+    const double coeffs[] = {1.0 / 19, 1.0 / 17, 1.0 / 15, 1.0 / 13, 1.0 / 11,
+                             1.0 / 9,  1.0 / 7,  1.0 / 5,  1.0 / 3,  1.0};
+    auto p = _mm256_set1_pd(1.0 / 21);
+    for (auto c : coeffs)
+        p = _mm256_add_pd(_mm256_mul_pd(p, z), _mm256_set1_pd(c));
+
+    return _mm256_add_pd(
+        _mm256_mul_pd(e, _mm256_set1_pd(0.6931471805599453)),
+        _mm256_mul_pd(_mm256_mul_pd(_mm256_set1_pd(2.0), s), p));
+}
+
+/**
+ * Four of simd::log1p(), with the same operations.
+ */
+META_AVX2 __m256d log1p_pd(__m256d x)
+{
+    auto u = _mm256_add_pd(_mm256_set1_pd(1.0), x);
+    auto ratio = _mm256_div_pd(_mm256_mul_pd(log_pd(u), x),
+                               _mm256_sub_pd(u, _mm256_set1_pd(1.0)));
+    auto exact = _mm256_cmp_pd(u, _mm256_set1_pd(1.0), _CMP_EQ_OQ);
+    return _mm256_blendv_pd(ratio, x, exact);
+}
+
+/**
+ * @return four normalizers, widened to doubles
+ */
+META_AVX2 __m256d load_norms(const float* norms)
+{
+    return _mm256_cvtps_pd(_mm_loadu_ps(norms));
+}
+
+META_AVX2 uint64_t bm25_avx2(double weight, const double* counts,
+                             const float* norms, double* scores, uint64_t n)
+{
+    auto w = _mm256_set1_pd(weight);
+    uint64_t i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+        auto tf = _mm256_loadu_pd(counts + i);
+        auto norm = load_norms(norms + i);
+        _mm256_storeu_pd(scores + i,
+                         _mm256_div_pd(_mm256_mul_pd(w, tf),
+                                       _mm256_add_pd(norm, tf)));
+    }
+    return i;
+}
+
+META_AVX2 uint64_t pivoted_length_avx2(double weight, const double* counts,
+                                       const float* norms, double* scores,
+                                       uint64_t n)
+{
+    auto w = _mm256_set1_pd(weight);
+    auto one = _mm256_set1_pd(1.0);
+    uint64_t i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+        auto tf = _mm256_loadu_pd(counts + i);
+        auto norm = load_norms(norms + i);
+        auto tf_part
+            = _mm256_add_pd(one, log_pd(_mm256_add_pd(one, log_pd(tf))));
+        _mm256_storeu_pd(scores + i,
+                         _mm256_mul_pd(_mm256_div_pd(tf_part, norm), w));
+    }
+    return i;
+}
+
+META_AVX2 uint64_t dirichlet_prior_avx2(double weight, double scale,
+                                        const double* counts, double* scores,
+                                        uint64_t n)
+{
+    auto w = _mm256_set1_pd(weight);
+    auto c = _mm256_set1_pd(scale);
+    uint64_t i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+        auto tf = _mm256_loadu_pd(counts + i);
+        _mm256_storeu_pd(scores + i,
+                         _mm256_mul_pd(w, log1p_pd(_mm256_mul_pd(tf, c))));
+    }
+    return i;
+}
+
+META_AVX2 uint64_t jelinek_mercer_avx2(double weight, double scale,
+                                       const double* counts,
+                                       const float* norms, double* scores,
+                                       uint64_t n)
+{
+    auto w = _mm256_set1_pd(weight);
+    auto c = _mm256_set1_pd(scale);
+    uint64_t i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+        auto tf = _mm256_loadu_pd(counts + i);
+        auto norm = load_norms(norms + i);
+        auto x = _mm256_mul_pd(_mm256_mul_pd(tf, norm), c);
+        _mm256_storeu_pd(scores + i, _mm256_mul_pd(w, log1p_pd(x)));
+    }
+    return i;
+}
+}
+#endif
+
+bool has_avx2()
+{
+#if META_HAS_X86_AVX2
+    static const bool avx2 = []()
+    {
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2") != 0;
+    }();
+    return avx2;
+#else
+    return false;
+#endif
+}
+
+uint64_t bm25_block(double weight, const double* counts, const float* norms,
+                    double* scores, uint64_t n)
+{
+#if META_HAS_X86_AVX2
+    if (has_avx2())
+        return bm25_avx2(weight, counts, norms, scores, n);
+#else
+    (void)weight, (void)counts, (void)norms, (void)scores, (void)n;
+#endif
+    return 0;
+}
+
+uint64_t pivoted_length_block(double weight, const double* counts,
+                              const float* norms, double* scores, uint64_t n)
+{
+#if META_HAS_X86_AVX2
+    if (has_avx2())
+        return pivoted_length_avx2(weight, counts, norms, scores, n);
+#else
+    (void)weight, (void)counts, (void)norms, (void)scores, (void)n;
+#endif
+    return 0;
+}
+
+uint64_t dirichlet_prior_block(double weight, double scale,
+                               const double* counts, double* scores,
+                               uint64_t n)
+{
+#if META_HAS_X86_AVX2
+    if (has_avx2())
+        return dirichlet_prior_avx2(weight, scale, counts, scores, n);
+#else
+    (void)weight, (void)scale, (void)counts, (void)scores, (void)n;
+#endif
+    return 0;
+}
+
+uint64_t jelinek_mercer_block(double weight, double scale,
+                              const double* counts, const float* norms,
+                              double* scores, uint64_t n)
+{
+#if META_HAS_X86_AVX2
+    if (has_avx2())
+        return jelinek_mercer_avx2(weight, scale, counts, norms, scores, n);
+#else
+    (void)weight, (void)scale, (void)counts, (void)norms, (void)scores,
+        (void)n;
+#endif
+    return 0;
+}
+}
+}
+}
@@ -0,0 +1,373 @@
+/**
+ * @file reorder.cpp
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+
+#include "cpptoml.h"
+#include "index/forward_index.h"
+#include "index/inverted_index.h"
+#include "index/postings_data.h"
+#include "index/reorder.h"
+#include "logging/logger.h"
+#include "util/filesystem.h"
+#include "util/progress.h"
+
+namespace meta
+{
+namespace index
+{
+
+namespace
+{
+/**
+ * @param path A document's path
+ * @return the key the document is sorted by in path_order(): the path
+ * itself, or for a URL, its host with the labels reversed followed by
+ * the rest of the URL (without the scheme)
+ */
+std::string path_key(const std::string& path)
+{
+    auto scheme = path.find("://");
+    if (scheme == std::string::npos)
+        return path;
+
+    auto host_begin = scheme + 3;
+    auto host_end = std::min(path.find('/', host_begin), path.size());
+    auto host = path.substr(host_begin, host_end - host_begin);
+
+    std::string key;
+    auto end = host.size();
+    while (true)
+    {
+        auto dot = end == 0 ? std::string::npos : host.rfind('.', end - 1);
+        if (dot == std::string::npos)
+        {
+            key.append(host, 0, end);
+            break;
+        }
+        key.append(host, dot + 1, end - dot - 1);
+        key.push_back('.');
+        end = dot;
+    }
+    return key + path.substr(host_end);
+}
+
+/**
+ * Orders documents by recursive graph bisection (see bisection_order()).
+ * Documents and terms are numbered from zero, and the graph is stored as
+ * the list of terms of each document.
+ */
+class bisector
+{
+  public:
+    /**
+     * @param offsets Where each document's terms begin in terms, plus
+     * the end
+     * @param terms The terms of every document, one after another
+     * @param num_terms The number of distinct terms
+     * @param options How hard to try
+     */
+    bisector(std::vector<uint64_t> offsets, std::vector<uint32_t> terms,
+             uint64_t num_terms, const bisection_options& options)
+        : offsets_{std::move(offsets)},
+          terms_{std::move(terms)},
+          options_(options),
+          left_(num_terms, 0),
+          right_(num_terms, 0),
+          gains_(offsets_.size() - 1, 0.0),
+          log2_(offsets_.size() + 1, 0.0)
+    {
+        for (uint64_t i = 1; i < log2_.size(); ++i)
+            log2_[i] = std::log2(static_cast<double>(i));
+    }
+
+    /**
+     * Orders a range of documents.
+     * @param first The first document of the range
+     * @param last One past the last document of the range
+     */
+    void bisect(std::vector<uint64_t>::iterator first,
+                std::vector<uint64_t>::iterator last)
+    {
+        uint64_t size = last - first;
+        if (size <= std::max<uint64_t>(options_.min_partition_size, 1))
+        {
+            // documents that were never split apart keep their order
+            std::sort(first, last);
+            return;
+        }
+
+        auto middle = first + size / 2;
+        uint64_t left_size = middle - first;
+        uint64_t right_size = last - middle;
+        for (auto it = first; it != middle; ++it)
+            for_each_term(*it, [&](uint32_t t) { ++left_[t]; });
+        for (auto it = middle; it != last; ++it)
+            for_each_term(*it, [&](uint32_t t) { ++right_[t]; });
+
+        auto by_gain = [&](uint64_t a, uint64_t b)
+        { return gains_[a] > gains_[b]; };
+        for (uint64_t i = 0; i < options_.iterations; ++i)
+        {
+            for (auto it = first; it != middle; ++it)
+                gains_[*it] = move_gain(*it, left_, right_, left_size,
+                                        right_size);
+            for (auto it = middle; it != last; ++it)
+                gains_[*it] = move_gain(*it, right_, left_, right_size,
+                                        left_size);
+
+            // swap the documents that most want to move, for as long as
+            // a swap still helps
+            std::sort(first, middle, by_gain);
+            std::sort(middle, last, by_gain);
+            uint64_t swapped = 0;
+            for (auto l = first, r = middle; l != middle && r != last;
+                 ++l, ++r)
+            {
+                if (gains_[*l] + gains_[*r] <= 0)
+                    break;
+
+                for_each_term(*l, [&](uint32_t t)
+                              {
+                    --left_[t];
+                    ++right_[t];
+                });
+                for_each_term(*r, [&](uint32_t t)
+                              {
+                    ++left_[t];
+                    --right_[t];
+                });
+                std::swap(*l, *r);
+                ++swapped;
+            }
+
+            if (swapped == 0)
+                break;
+        }
+
+        for (auto it = first; it != last; ++it)
+            for_each_term(*it, [&](uint32_t t)
+                          {
+                left_[t] = 0;
+                right_[t] = 0;
+            });
+
+        bisect(first, middle);
+        bisect(middle, last);
+    }
+
+  private:
+    /**
+     * Calls a function with each of a document's terms.
+     */
+    template <class Function>
+    void for_each_term(uint64_t doc, Function&& fn) const
+    {
+        for (auto i = offsets_[doc]; i < offsets_[doc + 1]; ++i)
+            fn(terms_[i]);
+    }
+
+    /**
+     * @param degree The number of documents in a half containing a term
+     * @param size The number of documents in the half
+     * @return the estimated cost of coding the gaps of the term's
+     * postings in the half
+     */
+    double cost(uint64_t degree, uint64_t size) const
+    {
+        return degree * (log2_[size] - log2_[degree + 1]);
+    }
+
+    /**
+     * @param doc A document
+     * @param from The degrees of the terms in the document's half
+     * @param to The degrees of the terms in the other half
+     * @param from_size The number of documents in the document's half
+     * @param to_size The number of documents in the other half
+     * @return how much moving the document to the other half would lower
+     * the estimated cost
+     */
+    double move_gain(uint64_t doc, const std::vector<uint32_t>& from,
+                     const std::vector<uint32_t>& to, uint64_t from_size,
+                     uint64_t to_size) const
+    {
+        double gain = 0;
+        for_each_term(doc, [&](uint32_t t)
+                      {
+            gain += cost(from[t], from_size) + cost(to[t], to_size)
+                    - cost(from[t] - 1, from_size) - cost(to[t] + 1, to_size);
+        });
+        return gain;
+    }
+
+    /// Where each document's terms begin in terms_, plus the end
+    std::vector<uint64_t> offsets_;
+    /// The terms of every document
+    std::vector<uint32_t> terms_;
+    /// How hard to try
+    bisection_options options_;
+    /// The degree of each term in the left half being split
+    std::vector<uint32_t> left_;
+    /// The degree of each term in the right half being split
+    std::vector<uint32_t> right_;
+    /// The move gain of each document
+    std::vector<double> gains_;
+    /// The base-2 logarithm of each number up to the number of documents
+    /// plus one
+    std::vector<double> log2_;
+};
+}
+
+std::vector<doc_id> path_order(const disk_index& idx)
+{
+    auto docs = idx.docs();
+    std::vector<std::pair<std::string, doc_id>> keys;
+    keys.reserve(docs.size());
+    for (const auto& d_id : docs)
+        keys.emplace_back(path_key(idx.doc_path(d_id)), d_id);
+
+    // documents with the same path keep their order
+    std::sort(keys.begin(), keys.end());
+    for (uint64_t i = 0; i < keys.size(); ++i)
+        docs[i] = keys[i].second;
+    return docs;
+}
+
+std::vector<doc_id> bisection_order(inverted_index& idx,
+                                    const bisection_options& options
+                                    /* = bisection_options{} */)
+{
+    auto docs = idx.docs();
+    if (docs.size() < 2)
+        return docs;
+
+    // documents are numbered by their position among the live ones
+    const auto npos = std::numeric_limits<uint64_t>::max();
+    std::vector<uint64_t> local(idx.num_docs(), npos);
+    for (uint64_t i = 0; i < docs.size(); ++i)
+        local[docs[i]] = i;
+
+    std::vector<term_id> kept;
+    for (term_id t_id{0}; t_id < idx.unique_terms(); ++t_id)
+    {
+        if (idx.doc_freq(t_id) >= options.min_doc_freq)
+            kept.push_back(t_id);
+    }
+    if (kept.size() > std::numeric_limits<uint32_t>::max())
+        throw inverted_index::inverted_index_exception{
+            "too many terms to reorder by bisection"};
+
+    LOG(info) << "Ordering " << docs.size() << " documents by " << kept.size()
+              << " terms" << ENDLG;
+
+    // count each document's terms, then read the postings again to fill
+    // them in
+    std::vector<uint64_t> offsets(docs.size() + 1, 0);
+    {
+        printing::progress progress{" > Counting postings: ", kept.size()};
+        for (uint64_t i = 0; i < kept.size(); ++i)
+        {
+            progress(i);
+            auto pdata = idx.search_primary(kept[i]);
+            for (const auto& count : pdata->counts())
+            {
+                if (local[count.first] != npos)
+                    ++offsets[local[count.first] + 1];
+            }
+        }
+    }
+    std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+
+    std::vector<uint32_t> terms(offsets.back());
+    {
+        auto next = offsets;
+        printing::progress progress{" > Building document graph: ",
+                                    kept.size()};
+        for (uint64_t i = 0; i < kept.size(); ++i)
+        {
+            progress(i);
+            auto pdata = idx.search_primary(kept[i]);
+            for (const auto& count : pdata->counts())
+            {
+                if (local[count.first] != npos)
+                    terms[next[local[count.first]]++]
+                        = static_cast<uint32_t>(i);
+            }
+        }
+    }
+
+    std::vector<uint64_t> order(docs.size());
+    std::iota(order.begin(), order.end(), 0);
+    bisector{std::move(offsets), std::move(terms), kept.size(), options}
+        .bisect(order.begin(), order.end());
+
+    std::vector<doc_id> result;
+    result.reserve(order.size());
+    for (const auto& doc : order)
+        result.push_back(docs[doc]);
+    return result;
+}
+
+void reorder_docs(const std::string& config_file,
+                  const std::vector<doc_id>& order)
+{
+    auto config = cpptoml::parse_file(config_file);
+    auto inv_idx = make_index<inverted_index>(config_file);
+    auto inv_name = inv_idx->index_name();
+
+    std::vector<bool> seen(inv_idx->num_docs(), false);
+    for (const auto& d_id : order)
+    {
+        if (d_id >= inv_idx->num_docs() || !inv_idx->is_live(d_id)
+            || seen[d_id])
+            throw inverted_index::inverted_index_exception{
+                "doc_id " + std::to_string(d_id)
+                + " is not a live document or is ordered twice"};
+        seen[d_id] = true;
+    }
+
+    auto inv_temp = inv_name + ".reordered";
+    filesystem::remove_all(inv_temp);
+    filesystem::make_directory(inv_temp);
+    {
+        std::shared_ptr<inverted_index> reordered{
+            new inverted_index(config, inv_temp)};
+        std::vector<std::shared_ptr<inverted_index>> segments{inv_idx};
+        std::vector<std::vector<doc_id>> docs{order};
+        reordered->merge_segments(segments, docs);
+    }
+
+    // the forward index is only reordered if it has been built; it
+    // numbers the documents of the same corpus the same way
+    auto fwd_name = *config.get_as<std::string>("forward-index");
+    std::string fwd_temp;
+    if (filesystem::file_exists(fwd_name + "/config.toml"))
+    {
+        auto fwd_idx = make_index<forward_index>(config_file);
+        if (fwd_idx->num_docs() != inv_idx->num_docs())
+            throw forward_index::forward_index_exception{
+                "forward index " + fwd_name
+                + " does not have the inverted index's documents"};
+
+        fwd_temp = fwd_name + ".reordered";
+        filesystem::remove_all(fwd_temp);
+        filesystem::make_directory(fwd_temp);
+        forward_index reordered{config, fwd_temp};
+        reordered.permute_docs(*fwd_idx, order);
+    }
+
+    inv_idx = nullptr;
+    filesystem::remove_all(inv_name);
+    filesystem::rename_file(inv_temp, inv_name);
+    if (!fwd_temp.empty())
+    {
+        filesystem::remove_all(fwd_name);
+        filesystem::rename_file(fwd_temp, fwd_name);
+    }
+}
+}
+}
@@ -0,0 +1,384 @@
+/**
+ * @file segmented_index.cpp
+ */
+
+#include <algorithm>
+#include <fstream>
+
+#include "cpptoml.h"
+#include "corpus/document.h"
+#include "index/inverted_index.h"
+#include "index/ranker/ranker.h"
+#include "index/segmented_index.h"
+#include "logging/logger.h"
+#include "util/filesystem.h"
+
+namespace meta
+{
+namespace index
+{
+
+segmented_index::segmented_index(const std::string& config_file,
+                                 uint64_t merge_factor /* = 10 */)
+    : config_file_{config_file},
+      merge_factor_{merge_factor},
+      next_segment_{0},
+      epoch_{0},
+      merging_{false}
+{
+    if (merge_factor_ < 2)
+        throw exception{"segment merge factor must be at least 2"};
+
+    auto config = cpptoml::parse_file(config_file);
+    auto name = config.get_as<std::string>("inverted-index");
+    if (!name)
+        throw exception{"inverted-index missing from configuration file"};
+    name_ = *name;
+    filesystem::make_directory(name_);
+
+    std::ifstream manifest{name_ + "/segments"};
+    std::string segment;
+    while (std::getline(manifest, segment))
+    {
+        if (segment.empty())
+            continue;
+        segments_.push_back(open_segment(segment, config_file_));
+        segment_names_.push_back(segment);
+        auto number = std::stoull(segment.substr(segment.find('-') + 1));
+        next_segment_ = std::max<uint64_t>(next_segment_, number + 1);
+    }
+
+    // the index may have been closed before a merge could run
+    std::lock_guard<std::mutex> lock{mutex_};
+    schedule_merge();
+}
+
+segmented_index::~segmented_index()
+{
+    try
+    {
+        wait_for_merges();
+    }
+    catch (const std::exception& e)
+    {
+        LOG(error) << "Background segment merge failed: " << e.what()
+                   << ENDLG;
+    }
+}
+
+void segmented_index::add(const std::string& corpus_config)
+{
+    std::string name;
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+        name = "segment-" + std::to_string(next_segment_++);
+    }
+
+    // clear out anything left behind by an interrupted build
+    filesystem::remove_all(name_ + "/" + name);
+    auto segment = open_segment(name, corpus_config);
+
+    std::lock_guard<std::mutex> lock{mutex_};
+    segments_.push_back(segment);
+    segment_names_.push_back(name);
+    save_manifest();
+    schedule_merge();
+}
+
+void segmented_index::remove(doc_id d_id, uint64_t epoch)
+{
+    // hold the lock so a merge can't swap the segment out from under us
+    std::lock_guard<std::mutex> lock{mutex_};
+    if (epoch != epoch_)
+        throw exception{"doc_id "
+                        + std::to_string(static_cast<uint64_t>(d_id))
+                        + " is from epoch " + std::to_string(epoch)
+                        + ", but a merge has since renumbered documents"};
+
+    uint64_t id{d_id};
+    for (const auto& segment : segments_)
+    {
+        if (id < segment->num_docs())
+        {
+            segment->remove_doc(doc_id{id});
+            return;
+        }
+        id -= segment->num_docs();
+    }
+    throw exception{"doc_id out of range: "
+                    + std::to_string(static_cast<uint64_t>(d_id))};
+}
+
+std::vector<std::pair<doc_id, double>>
+segmented_index::score(ranker& r, corpus::document& query,
+                       uint64_t num_results /* = 10 */,
+                       const std::function<bool(doc_id d_id)>& filter
+                       /* return true */)
+{
+    auto segments = snapshot();
+    if (segments.empty())
+        return {};
+
+    if (query.counts().empty())
+        segments.front()->tokenize(query);
+
+    ranker::collection_stats stats{0, 0, {}};
+    for (const auto& segment : segments)
+    {
+        stats.num_docs += segment->num_docs();
+        stats.total_terms += segment->total_corpus_terms();
+    }
+    for (const auto& count : query.counts())
+    {
+        auto& term = stats.terms[count.first];
+        for (const auto& segment : segments)
+        {
+            auto t_id = segment->get_term_id(count.first);
+            term.first += segment->doc_freq(t_id);
+            term.second += segment->total_num_occurences(t_id);
+        }
+    }
+
+    std::vector<std::pair<doc_id, double>> results;
+    uint64_t base = 0;
+    for (const auto& segment : segments)
+    {
+        auto ranking = r.score(*segment, query, stats, num_results,
+                               [&](doc_id d_id)
+                               {
+            return filter(doc_id{base + d_id});
+        });
+        for (const auto& result : ranking)
+            results.emplace_back(doc_id{base + result.first}, result.second);
+        base += segment->num_docs();
+    }
+
+    std::stable_sort(results.begin(), results.end(),
+                     [](const std::pair<doc_id, double>& a,
+                        const std::pair<doc_id, double>& b)
+                     {
+        return a.second > b.second;
+    });
+    if (results.size() > num_results)
+        results.resize(num_results);
+    return results;
+}
+
+uint64_t segmented_index::num_docs() const
+{
+    uint64_t num_docs = 0;
+    for (const auto& segment : snapshot())
+        num_docs += segment->num_docs();
+    return num_docs;
+}
+
+uint64_t segmented_index::epoch() const
+{
+    std::lock_guard<std::mutex> lock{mutex_};
+    return epoch_;
+}
+
+uint64_t segmented_index::num_segments() const
+{
+    std::lock_guard<std::mutex> lock{mutex_};
+    return segments_.size();
+}
+
+std::string segmented_index::doc_path(doc_id d_id) const
+{
+    uint64_t id{d_id};
+    for (const auto& segment : snapshot())
+    {
+        if (id < segment->num_docs())
+            return segment->doc_path(doc_id{id});
+        id -= segment->num_docs();
+    }
+    throw exception{"doc_id out of range: "
+                    + std::to_string(static_cast<uint64_t>(d_id))};
+}
+
+void segmented_index::wait_for_merges()
+{
+    while (true)
+    {
+        std::future<void> task;
+        {
+            std::lock_guard<std::mutex> lock{mutex_};
+            if (!merge_task_.valid())
+                return;
+            task = std::move(merge_task_);
+        }
+        task.get();
+    }
+}
+
+auto segmented_index::snapshot() const
+    -> std::vector<std::shared_ptr<inverted_index>>
+{
+    std::lock_guard<std::mutex> lock{mutex_};
+    return segments_;
+}
+
+std::shared_ptr<inverted_index>
+    segmented_index::open_segment(const std::string& name,
+                                  const std::string& config_file)
+{
+    // existing segments are loaded with the configuration they were built
+    // with, as inverted_index::load_index does
+    auto path = name_ + "/" + name;
+    auto saved_config = path + "/config.toml";
+    auto config = cpptoml::parse_file(
+        filesystem::file_exists(saved_config) ? saved_config : config_file);
+
+    // can't use std::make_shared here since the constructor is protected
+    auto segment
+        = std::shared_ptr<inverted_index>{new inverted_index(config, path)};
+    if (filesystem::make_directory(path) && segment->valid())
+        segment->load_index();
+    else
+        segment->create_index(config_file);
+    return segment;
+}
+
+void segmented_index::schedule_merge()
+{
+    uint64_t first;
+    if (merging_ || !find_merge(first))
+        return;
+
+    // surface the failure of a previous merge, if there was one
+    if (merge_task_.valid())
+        merge_task_.get();
+
+    merging_ = true;
+    merge_task_ = std::async(std::launch::async, [this]()
+                             {
+                                 merge();
+                             });
+}
+
+bool segmented_index::find_merge(uint64_t& first) const
+{
+    auto level = [&](uint64_t size)
+    {
+        uint64_t level = 0;
+        for (; size >= merge_factor_; size /= merge_factor_)
+            ++level;
+        return level;
+    };
+
+    uint64_t run = 0;
+    for (uint64_t i = 0; i < segments_.size(); ++i)
+    {
+        if (i > 0 && level(segments_[i]->num_docs())
+                         == level(segments_[i - 1]->num_docs()))
+            ++run;
+        else
+            run = 1;
+
+        if (run == merge_factor_)
+        {
+            first = i + 1 - merge_factor_;
+            return true;
+        }
+    }
+    return false;
+}
+
+void segmented_index::merge()
+{
+    try
+    {
+        while (true)
+        {
+            uint64_t first;
+            std::vector<std::shared_ptr<inverted_index>> group;
+            std::vector<std::string> old_names;
+            std::vector<std::vector<doc_id>> docs;
+            std::string name;
+            {
+                std::lock_guard<std::mutex> lock{mutex_};
+                if (!find_merge(first))
+                {
+                    merging_ = false;
+                    return;
+                }
+                group.assign(segments_.begin() + first,
+                             segments_.begin() + first + merge_factor_);
+                old_names.assign(segment_names_.begin() + first,
+                                 segment_names_.begin() + first
+                                     + merge_factor_);
+                name = "segment-" + std::to_string(next_segment_++);
+                for (const auto& segment : group)
+                    docs.push_back(segment->docs());
+            }
+
+            auto path = name_ + "/" + name;
+            filesystem::remove_all(path);
+            filesystem::make_directory(path);
+            auto config = cpptoml::parse_file(group.front()->index_name()
+                                              + "/config.toml");
+            auto merged
+                = std::shared_ptr<inverted_index>{new inverted_index(config,
+                                                                     path)};
+            merged->merge_segments(group, docs);
+
+            // segments are only ever appended while a merge runs, so the
+            // group is still where it was found
+            {
+                std::lock_guard<std::mutex> lock{mutex_};
+
+                // carry over deletions made while the merge ran
+                uint64_t new_id = 0;
+                uint64_t old_docs = 0;
+                for (uint64_t i = 0; i < group.size(); ++i)
+                {
+                    for (const auto& d_id : docs[i])
+                    {
+                        if (!group[i]->is_live(d_id))
+                            merged->remove_doc(doc_id{new_id});
+                        ++new_id;
+                    }
+                    old_docs += group[i]->num_docs();
+                }
+
+                // dropping documents shifts the ids of those after them
+                if (new_id != old_docs)
+                    ++epoch_;
+
+                segments_.erase(segments_.begin() + first,
+                                segments_.begin() + first + merge_factor_);
+                segments_.insert(segments_.begin() + first, merged);
+                segment_names_.erase(segment_names_.begin() + first,
+                                     segment_names_.begin() + first
+                                         + merge_factor_);
+                segment_names_.insert(segment_names_.begin() + first, name);
+                save_manifest();
+            }
+
+            // queries still holding the old segments keep their files
+            // mapped, so they can safely be removed
+            for (const auto& old_name : old_names)
+                filesystem::remove_all(name_ + "/" + old_name);
+        }
+    }
+    catch (...)
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+        merging_ = false;
+        throw;
+    }
+}
+
+void segmented_index::save_manifest() const
+{
+    // write a new list and swap it in, so a crash leaves the old one
+    {
+        std::ofstream manifest{name_ + "/segments.tmp"};
+        for (const auto& name : segment_names_)
+            manifest << name << "\n";
+    }
+    filesystem::rename_file(name_ + "/segments.tmp", name_ + "/segments");
+}
+}
+}
@@ -0,0 +1,132 @@
+/**
+ * @file term_dictionary.cpp
+ */
+
+#include <algorithm>
+
+#include "index/term_dictionary.h"
+#include "io/block_codec.h"
+
+namespace meta
+{
+namespace index
+{
+
+const constexpr uint64_t term_dictionary::block_size;
+const constexpr uint64_t term_dictionary::shared_hash;
+
+term_dictionary::term_dictionary(const std::string& path)
+    : blocks_{path},
+      index_{path + ".index"},
+      hash_{path + ".hash"},
+      mphf_{&hash_[0]}
+{
+    // nothing
+}
+
+util::optional<term_id> term_dictionary::find(const std::string& term) const
+{
+    auto slot = mphf_(hash(term));
+    if (slot >= mphf_.size())
+        return util::nullopt;
+
+    auto entry = hash_[mphf_.num_words() + slot];
+    term_id t_id{entry & ~shared_hash};
+    if (entry & shared_hash)
+    {
+        t_id = lower_bound(term);
+        if (t_id == size())
+            return util::nullopt;
+    }
+    if (find_term(t_id) != term)
+        return util::nullopt;
+    return t_id;
+}
+
+std::string term_dictionary::find_term(term_id t_id) const
+{
+    uint64_t id{t_id};
+    auto in = reinterpret_cast<const uint8_t*>(blocks_.begin())
+              + index_[1 + id / block_size];
+
+    std::string term;
+    for (uint64_t i = 0; i <= id % block_size; ++i)
+    {
+        auto shared = i == 0 ? 0 : io::block_codec::read_varint(in);
+        auto length = io::block_codec::read_varint(in);
+        term.resize(shared);
+        term.append(reinterpret_cast<const char*>(in), length);
+        in += length;
+    }
+    return term;
+}
+
+term_id term_dictionary::lower_bound(const std::string& term) const
+{
+    // find the last block whose first term is not greater than term
+    uint64_t num_blocks = index_.size() - 1;
+    uint64_t low = 0;
+    uint64_t high = num_blocks;
+    while (high - low > 1)
+    {
+        auto mid = low + (high - low) / 2;
+        if (first_term(mid) <= term)
+            low = mid;
+        else
+            high = mid;
+    }
+
+    // then scan it
+    auto end = std::min(size(), (low + 1) * block_size);
+    for (auto id = low * block_size; id < end; ++id)
+    {
+        if (find_term(term_id{id}) >= term)
+            return term_id{id};
+    }
+    return term_id{end};
+}
+
+std::pair<term_id, term_id>
+    term_dictionary::prefix_range(const std::string& prefix) const
+{
+    auto first = lower_bound(prefix);
+
+    // the first string after every string with the prefix is the prefix
+    // with its last byte that can be incremented incremented
+    auto upper = prefix;
+    while (!upper.empty()
+           && static_cast<unsigned char>(upper.back()) == 0xFF)
+        upper.pop_back();
+    if (upper.empty())
+        return {first, term_id{size()}};
+    upper.back() = static_cast<char>(
+        static_cast<unsigned char>(upper.back()) + 1);
+    return {first, lower_bound(upper)};
+}
+
+uint64_t term_dictionary::size() const
+{
+    return index_[0];
+}
+
+uint64_t term_dictionary::hash(const std::string& term)
+{
+    // 64-bit FNV-1a; the minimal perfect hash mixes the bits further
+    uint64_t hash = 0xCBF29CE484222325ull;
+    for (const auto& c : term)
+    {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 0x100000001B3ull;
+    }
+    return hash;
+}
+
+std::string term_dictionary::first_term(uint64_t block) const
+{
+    auto in = reinterpret_cast<const uint8_t*>(blocks_.begin())
+              + index_[1 + block];
+    auto length = io::block_codec::read_varint(in);
+    return {reinterpret_cast<const char*>(in), length};
+}
+}
+}
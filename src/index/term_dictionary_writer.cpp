@@ -0,0 +1,105 @@
+/**
+ * @file term_dictionary_writer.cpp
+ */
+
+#include <algorithm>
+
+#include "index/term_dictionary.h"
+#include "index/term_dictionary_writer.h"
+#include "logging/logger.h"
+#include "util/disk_vector.h"
+#include "util/minimal_perfect_hash.h"
+
+namespace meta
+{
+namespace index
+{
+
+term_dictionary_writer::term_dictionary_writer(const std::string& path)
+    : path_{path}, file_{path}, index_{0}, finished_{false}
+{
+    // nothing
+}
+
+term_dictionary_writer::~term_dictionary_writer()
+{
+    if (finished_)
+        return;
+
+    try
+    {
+        finish();
+    }
+    catch (const std::exception& e)
+    {
+        LOG(error) << "Failed to finish term dictionary " << path_ << ": "
+                   << e.what() << ENDLG;
+    }
+}
+
+void term_dictionary_writer::insert(const std::string& term)
+{
+    auto t_id = hashes_.size();
+    if (t_id > 0 && !(last_ < term))
+        throw term_dictionary_writer_exception{
+            "terms must be inserted in sorted order: " + term};
+
+    uint64_t shared = 0;
+    if (t_id % term_dictionary::block_size == 0)
+    {
+        index_.push_back(file_.byte_location());
+    }
+    else
+    {
+        auto max = std::min(last_.size(), term.size());
+        while (shared < max && last_[shared] == term[shared])
+            ++shared;
+        file_.write(shared);
+    }
+
+    file_.write(term.size() - shared);
+    bytes_.assign(term.begin() + shared, term.end());
+    file_.write_bytes(bytes_);
+
+    hashes_.push_back(term_dictionary::hash(term));
+    last_ = term;
+    ++index_[0];
+}
+
+void term_dictionary_writer::finish()
+{
+    finished_ = true;
+    file_.close();
+
+    {
+        util::disk_vector<uint64_t> index{path_ + ".index", index_.size()};
+        for (uint64_t i = 0; i < index_.size(); ++i)
+            index[i] = index_[i];
+    }
+
+    // distinct terms can share a hash, so the function is built over the
+    // distinct hashes and a slot that several terms land in is marked
+    auto keys = hashes_;
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+    auto words = util::minimal_perfect_hash::build(keys);
+    util::disk_vector<uint64_t> hash{path_ + ".hash",
+                                     words.size() + keys.size()};
+    for (uint64_t i = 0; i < words.size(); ++i)
+        hash[i] = words[i];
+
+    util::minimal_perfect_hash mphf{words.data()};
+    std::vector<bool> filled(keys.size(), false);
+    for (uint64_t t_id = 0; t_id < hashes_.size(); ++t_id)
+    {
+        auto slot = mphf(hashes_[t_id]);
+        if (filled[slot])
+            hash[words.size() + slot] |= term_dictionary::shared_hash;
+        else
+            hash[words.size() + slot] = t_id;
+        filled[slot] = true;
+    }
+}
+}
+}
@@ -0,0 +1,40 @@
+/**
+ * @file export-libsvm.cpp
+ */
+
+#include <fstream>
+#include <iostream>
+
+#include "index/forward_index.h"
+#include "logging/logger.h"
+#include "util/progress.h"
+
+using namespace meta;
+
+/**
+ * Writes every document in a forward index to a file in libsvm format, one
+ * document per line, with each document's label_id as its label.
+ */
+int main(int argc, char* argv[])
+{
+    if (argc != 3)
+    {
+        std::cerr << "Usage:\t" << argv[0] << " config.toml output.dat"
+                  << std::endl;
+        return 1;
+    }
+
+    logging::set_cerr_logging();
+
+    auto idx = index::make_index<index::forward_index>(argv[1]);
+
+    std::ofstream out{argv[2]};
+    printing::progress progress{" > Exporting documents: ", idx->num_docs()};
+    for (const auto& d_id : idx->docs())
+    {
+        progress(d_id);
+        out << idx->liblinear_data(d_id) << '\n';
+    }
+
+    return 0;
+}
@@ -0,0 +1,136 @@
+/**
+ * @file postings-bench.cpp
+ */
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "index/inverted_index.h"
+#include "index/postings_data.h"
+#include "io/block_file_reader.h"
+#include "io/block_file_writer.h"
+#include "io/compressed_file_reader.h"
+#include "io/compressed_file_writer.h"
+#include "io/mmap_file.h"
+#include "util/filesystem.h"
+#include "util/printing.h"
+#include "util/time.h"
+
+using namespace meta;
+
+/**
+ * Prints the decoding throughput of one codec.
+ * @param name The name of the codec
+ * @param file The file the postings were written to
+ * @param num_ints The number of integers decoded per pass
+ * @param passes The number of passes over the postings that were timed
+ * @param elapsed The total time taken for all passes
+ */
+void report(const std::string& name, const std::string& file,
+            uint64_t num_ints, uint64_t passes,
+            std::chrono::microseconds elapsed)
+{
+    auto seconds = elapsed.count() / 1000000.0;
+    std::cout << name << ": "
+              << printing::bytes_to_units(filesystem::file_size(file))
+              << ", " << seconds / passes << "s per pass, "
+              << (num_ints * passes) / seconds / 1000000.0
+              << " million ints/sec" << std::endl;
+}
+
+/**
+ * Re-encodes the postings of an existing inverted index in both the gamma
+ * and block postings formats, then measures how fast each can be decoded.
+ */
+int main(int argc, char* argv[])
+{
+    if (argc < 2)
+    {
+        std::cerr << "Usage:\t" << argv[0] << " config.toml [passes]"
+                  << std::endl;
+        return 1;
+    }
+
+    logging::set_cerr_logging();
+
+    uint64_t passes = argc > 2 ? std::stoul(argv[2]) : 5;
+    auto idx = index::make_index<index::inverted_index>(argv[1]);
+
+    using pdata_t = index::inverted_index::postings_data_type;
+    std::string gamma_file{idx->index_name() + "/bench.gamma"};
+    std::string block_file{idx->index_name() + "/bench.block"};
+    std::vector<uint64_t> gamma_offsets;
+    std::vector<uint64_t> block_offsets;
+
+    uint64_t num_ints = 0;
+    {
+        io::compressed_file_writer gamma{gamma_file,
+                                         io::default_compression_writer_func};
+        io::block_file_writer block{block_file};
+        printing::progress progress{" > Encoding postings: ",
+                                    idx->unique_terms()};
+        for (term_id t_id{0}; t_id < idx->unique_terms(); ++t_id)
+        {
+            progress(t_id);
+            auto pdata = idx->search_primary(t_id);
+            if (pdata->counts().empty())
+                continue;
+
+            num_ints += 2 * pdata->counts().size();
+            gamma_offsets.push_back(gamma.bit_location());
+            pdata->write_compressed(gamma);
+            block_offsets.push_back(block.byte_location());
+            pdata->write_packed(block);
+        }
+    }
+
+    uint64_t checksum = 0;
+    auto gamma_time = common::time<std::chrono::microseconds>([&]()
+    {
+        io::mmap_file file{gamma_file};
+        for (uint64_t pass = 0; pass < passes; ++pass)
+        {
+            for (const auto& offset : gamma_offsets)
+            {
+                io::compressed_file_reader reader{
+                    file, io::default_compression_reader_func};
+                reader.seek(offset);
+                pdata_t pdata{term_id{0}};
+                pdata.read_compressed(reader);
+                checksum += pdata.counts().size();
+            }
+        }
+    });
+
+    auto block_time = common::time<std::chrono::microseconds>([&]()
+    {
+        io::mmap_file file{block_file};
+        io::block_file_reader reader{file};
+        for (uint64_t pass = 0; pass < passes; ++pass)
+        {
+            for (const auto& offset : block_offsets)
+            {
+                reader.seek(offset);
+                pdata_t pdata{term_id{0}};
+                pdata.read_packed(reader);
+                checksum -= pdata.counts().size();
+            }
+        }
+    });
+
+    if (checksum != 0)
+    {
+        std::cerr << "Codecs decoded different postings!" << std::endl;
+        return 1;
+    }
+
+    std::cout << gamma_offsets.size() << " postings lists, " << num_ints
+              << " integers" << std::endl;
+    report("gamma", gamma_file, num_ints, passes, gamma_time);
+    report("block", block_file, num_ints, passes, block_time);
+
+    filesystem::delete_file(gamma_file);
+    filesystem::delete_file(block_file);
+    return 0;
+}
@@ -1,4 +1,4 @@
-#include "index/vocabulary_map.h"
+#include "index/term_dictionary.h"
 
 using namespace meta;
 
@@ -6,12 +6,17 @@ int main(int argc, char** argv)
 {
     if (argc < 2)
     {
-        std::cout << "Usage: " << argv[0] << " filename" << std::endl;
+        std::cout << "Usage: " << argv[0] << " filename [prefix]" << std::endl;
         return 1;
     }
 
-    index::vocabulary_map map{argv[1]};
+    index::term_dictionary dict{argv[1]};
 
-    for (term_id tid{0}; tid < map.size(); ++tid)
-        std::cout << map.find_term(tid) << std::endl;
+    // with a prefix, print only the terms that start with it
+    auto range = std::make_pair(term_id{0}, term_id{dict.size()});
+    if (argc > 2)
+        range = dict.prefix_range(argv[2]);
+
+    for (auto tid = range.first; tid < range.second; ++tid)
+        std::cout << dict.find_term(tid) << std::endl;
 }
@@ -16,15 +16,37 @@
 
 using namespace meta;
 
+/**
+ * Prints the top results of a ranked query.
+ * @param idx The index the query was run on
+ * @param ranking The results of the query
+ */
+template <class Index>
+void print_ranking(Index& idx,
+                   const std::vector<std::pair<doc_id, double>>& ranking)
+{
+    std::cout << "Showing top 10 of " << ranking.size() << " results."
+              << std::endl;
+
+    for (size_t i = 0; i < ranking.size() && i < 10; ++i)
+    {
+        std::cout << (i + 1) << ". " << idx.doc_name(ranking[i].first) << " "
+                  << ranking[i].second << std::endl;
+    }
+    std::cout << std::endl;
+}
+
 /**
  * Demo app to read a file with one query per line and run each query on an
- * inverted index.
+ * inverted index. If a number of threads is given, the queries are scored
+ * concurrently as a batch instead of one after another.
  */
 int main(int argc, char* argv[])
 {
-    if (argc != 2)
+    if (argc != 2 && argc != 3)
     {
-        std::cerr << "Usage:\t" << argv[0] << " configFile" << std::endl;
+        std::cerr << "Usage:\t" << argv[0] << " configFile [numThreads]"
+                  << std::endl;
         return 1;
     }
 
@@ -56,6 +78,7 @@ int main(int argc, char* argv[])
     std::ifstream queries{*query_path + *config.get_as<std::string>("dataset")
                           + "-queries.txt"};
     std::string content;
+    std::vector<corpus::document> batch;
     auto elapsed_seconds = common::time([&]()
     {
         size_t i = 1;
@@ -64,22 +87,34 @@ int main(int argc, char* argv[])
             std::getline(queries, content);
             corpus::document query{"[user input]", doc_id{0}};
             query.content(content);
+
+            // in batch mode, collect the queries and score them all at once
+            if (argc == 3)
+            {
+                batch.push_back(std::move(query));
+                ++i;
+                continue;
+            }
+
             std::cout << "Ranking query " << i++ << ": " << query.path()
                       << std::endl;
 
             // Use the ranker to score the query over the index. By default, the
             //  ranker returns 10 documents, so we will display the "top 10 of
             //  10" docs.
-            auto ranking = ranker->score(*idx, query);
-            std::cout << "Showing top 10 of " << ranking.size() << " results."
-                      << std::endl;
+            print_ranking(*idx, ranker->score(*idx, query));
+        }
 
-            for (size_t i = 0; i < ranking.size() && i < 10; ++i)
+        if (argc == 3)
+        {
+            auto rankings = ranker->score_batch(*idx, batch, 10,
+                                                std::stoul(argv[2]));
+            for (size_t q = 0; q < rankings.size(); ++q)
             {
-                std::cout << (i + 1) << ". " << idx->doc_name(ranking[i].first)
-                          << " " << ranking[i].second << std::endl;
+                std::cout << "Ranking query " << q + 1 << ": "
+                          << batch[q].path() << std::endl;
+                print_ranking(*idx, rankings[q]);
             }
-            std::cout << std::endl;
         }
     });
 
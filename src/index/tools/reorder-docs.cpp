@@ -0,0 +1,71 @@
+/**
+ * @file reorder-docs.cpp
+ */
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "cpptoml.h"
+#include "index/inverted_index.h"
+#include "index/reorder.h"
+#include "logging/logger.h"
+#include "parser/analyzers/tree_analyzer.h"
+#include "sequence/analyzers/ngram_pos_analyzer.h"
+#include "util/filesystem.h"
+#include "util/printing.h"
+#include "util/time.h"
+
+using namespace meta;
+
+/**
+ * Renumbers the documents of an existing index (and its forward index, if
+ * it has been built) so that similar documents get nearby doc_ids, which
+ * shrinks the gaps in postings lists. Documents are ordered by recursive
+ * graph bisection, or more cheaply by their paths.
+ */
+int main(int argc, char* argv[])
+{
+    std::string method = argc > 2 ? argv[2] : "bisection";
+    if (argc < 2 || argc > 3 || (method != "bisection" && method != "path"))
+    {
+        std::cerr << "Usage:\t" << argv[0] << " config.toml [bisection|path]"
+                  << std::endl;
+        return 1;
+    }
+
+    logging::set_cerr_logging();
+    parser::register_analyzers();
+    sequence::register_analyzers();
+
+    auto config = cpptoml::parse_file(argv[1]);
+    auto postings = *config.get_as<std::string>("inverted-index")
+                    + "/postings.index";
+
+    std::vector<doc_id> order;
+    uint64_t before = 0;
+    auto time = common::time([&]()
+    {
+        auto idx = index::make_index<index::inverted_index>(argv[1]);
+        before = filesystem::file_size(postings);
+        if (method == "path")
+            order = index::path_order(*idx);
+        else
+            order = index::bisection_order(*idx);
+    });
+    std::cout << "Ordering took: " << time.count() / 1000.0 << " seconds"
+              << std::endl;
+
+    time = common::time([&]()
+    {
+        index::reorder_docs(argv[1], order);
+    });
+    std::cout << "Reordering took: " << time.count() / 1000.0 << " seconds"
+              << std::endl;
+
+    std::cout << "Postings: " << printing::bytes_to_units(before) << " -> "
+              << printing::bytes_to_units(filesystem::file_size(postings))
+              << std::endl;
+
+    return 0;
+}
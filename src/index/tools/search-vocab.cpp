@@ -1,6 +1,6 @@
 #include <memory>
 #include "util/optional.h"
-#include "index/vocabulary_map.h"
+#include "index/term_dictionary.h"
 
 int main(int argc, char** argv)
 {
@@ -11,7 +11,13 @@ int main(int argc, char** argv)
         return 1;
     }
 
-    index::vocabulary_map map{argv[1]};
+    index::term_dictionary dict{argv[1]};
 
-    std::cout << *map.find(argv[2]) << std::endl;
+    auto t_id = dict.find(argv[2]);
+    if (!t_id)
+    {
+        std::cout << "term not found" << std::endl;
+        return 1;
+    }
+    std::cout << *t_id << std::endl;
 }
@@ -0,0 +1,206 @@
+/**
+ * @file block_codec.cpp
+ */
+
+#include <array>
+#include <cstddef>
+#include <cstring>
+
+#include "io/block_codec.h"
+
+namespace meta
+{
+namespace io
+{
+namespace block_codec
+{
+
+namespace
+{
+/**
+ * @param in The position to load from
+ * @return the (possibly unaligned) 64-bit word starting at in
+ */
+inline uint64_t load_word(const uint8_t* in)
+{
+    uint64_t word;
+    std::memcpy(&word, in, sizeof(word));
+    return word;
+}
+
+/**
+ * Unpacks n values of a fixed bit width. Instantiating this once per width
+ * lets the compiler turn the shifts and masks into constants.
+ */
+template <uint8_t Width>
+void unpack_width(const uint8_t* in, uint64_t n, uint64_t* out)
+{
+    const uint64_t mask = Width == 64 ? ~uint64_t{0}
+                                      : (uint64_t{1} << (Width % 64)) - 1;
+    uint64_t bit = 0;
+    for (uint64_t i = 0; i < n; ++i, bit += Width)
+    {
+        auto word = bit / 64;
+        auto offset = bit % 64;
+        auto value = load_word(in + word * 8) >> offset;
+        if (offset + Width > 64)
+            value |= load_word(in + (word + 1) * 8) << (64 - offset);
+        out[i] = value & mask;
+    }
+}
+
+/**
+ * Specialization for blocks where every value is zero.
+ */
+template <>
+void unpack_width<0>(const uint8_t*, uint64_t n, uint64_t* out)
+{
+    std::memset(out, 0, n * sizeof(uint64_t));
+}
+
+/// Signature of the per-width unpacking routines
+using unpack_func = void (*)(const uint8_t*, uint64_t, uint64_t*);
+
+/**
+ * A list of bit widths (std::index_sequence is not available in C++11).
+ */
+template <std::size_t... Widths>
+struct width_list
+{
+};
+
+/**
+ * Builds width_list<0, 1, ..., N - 1> as its type member.
+ */
+template <std::size_t N, std::size_t... Widths>
+struct make_width_list : make_width_list<N - 1, N - 1, Widths...>
+{
+};
+
+/**
+ * The end of the recursion.
+ */
+template <std::size_t... Widths>
+struct make_width_list<0, Widths...>
+{
+    using type = width_list<Widths...>;
+};
+
+/**
+ * @return a table of unpacking routines, indexed by bit width
+ */
+template <std::size_t... Widths>
+constexpr std::array<unpack_func, sizeof...(Widths)>
+    make_unpackers(width_list<Widths...>)
+{
+    return {{&unpack_width<Widths>...}};
+}
+
+/// The unpacking routines for each bit width in [0, 64]
+const auto unpackers = make_unpackers(make_width_list<65>::type{});
+}
+
+uint8_t bit_width(uint64_t value)
+{
+    uint8_t width = 0;
+    while (value)
+    {
+        ++width;
+        value >>= 1;
+    }
+    return width;
+}
+
+uint8_t bit_width(const uint64_t* values, uint64_t n)
+{
+    uint64_t all = 0;
+    for (uint64_t i = 0; i < n; ++i)
+        all |= values[i];
+    return bit_width(all);
+}
+
+uint64_t packed_bytes(uint64_t n, uint8_t width)
+{
+    return (n * width + 63) / 64 * 8;
+}
+
+void write_varint(std::vector<uint8_t>& out, uint64_t value)
+{
+    while (value >= 0x80)
+    {
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+uint64_t read_varint(const uint8_t*& in)
+{
+    uint64_t value = 0;
+    uint8_t shift = 0;
+    while (*in & 0x80)
+    {
+        value |= static_cast<uint64_t>(*in++ & 0x7f) << shift;
+        shift += 7;
+    }
+    value |= static_cast<uint64_t>(*in++) << shift;
+    return value;
+}
+
+void pack(std::vector<uint8_t>& out, const uint64_t* values, uint64_t n)
+{
+    auto width = bit_width(values, n);
+    out.push_back(width);
+
+    auto start = out.size();
+    out.resize(start + packed_bytes(n, width), 0);
+    if (width == 0)
+        return;
+
+    // pack into a word-sized scratch value and spill it byte-wise so the
+    // result does not depend on the alignment of the output buffer
+    uint64_t bit = 0;
+    for (uint64_t i = 0; i < n; ++i, bit += width)
+    {
+        auto word = start + bit / 64 * 8;
+        auto offset = bit % 64;
+        auto low = load_word(&out[word]) | (values[i] << offset);
+        std::memcpy(&out[word], &low, sizeof(low));
+        if (offset + width > 64)
+        {
+            auto high = load_word(&out[word + 8]) | (values[i] >> (64 - offset));
+            std::memcpy(&out[word + 8], &high, sizeof(high));
+        }
+    }
+}
+
+const uint8_t* unpack(const uint8_t* in, uint64_t n, uint64_t* out)
+{
+    auto width = *in++;
+    unpackers[width](in, n, out);
+    return in + packed_bytes(n, width);
+}
+
+uint64_t packed_at(const uint8_t* in, uint64_t i)
+{
+    auto width = *in++;
+    if (width == 0)
+        return 0;
+
+    auto bit = i * width;
+    auto word = bit / 64;
+    auto offset = bit % 64;
+    auto value = load_word(in + word * 8) >> offset;
+    if (offset + width > 64)
+        value |= load_word(in + (word + 1) * 8) << (64 - offset);
+    return width == 64 ? value : value & ((uint64_t{1} << width) - 1);
+}
+
+const uint8_t* skip(const uint8_t* in, uint64_t n)
+{
+    auto width = *in++;
+    return in + packed_bytes(n, width);
+}
+}
+}
+}
@@ -0,0 +1,78 @@
+/**
+ * @file block_file_reader.cpp
+ */
+
+#include "io/block_codec.h"
+#include "io/block_file_reader.h"
+#include "io/mmap_file.h"
+#include "util/shim.h"
+
+namespace meta
+{
+namespace io
+{
+
+block_file_reader::block_file_reader(const std::string& filename)
+    : file_{make_unique<mmap_file>(filename)},
+      start_{reinterpret_cast<const uint8_t*>(file_->begin())},
+      size_{file_->size()},
+      cursor_{start_}
+{
+    // nothing
+}
+
+block_file_reader::block_file_reader(const mmap_file& file)
+    : file_{nullptr},
+      start_{reinterpret_cast<const uint8_t*>(file.begin())},
+      size_{file.size()},
+      cursor_{start_}
+{
+    // nothing
+}
+
+block_file_reader::~block_file_reader() = default;
+
+void block_file_reader::close()
+{
+    file_.reset(nullptr);
+}
+
+void block_file_reader::seek(uint64_t byte_offset)
+{
+    if (byte_offset > size_)
+        throw block_file_reader_exception{
+            "error seeking: parameter out of bounds"};
+    cursor_ = start_ + byte_offset;
+}
+
+bool block_file_reader::has_next() const
+{
+    return cursor_ < start_ + size_;
+}
+
+uint64_t block_file_reader::next()
+{
+    return block_codec::read_varint(cursor_);
+}
+
+void block_file_reader::next_block(uint64_t n, uint64_t* out)
+{
+    cursor_ = block_codec::unpack(cursor_, n, out);
+}
+
+void block_file_reader::skip_block(uint64_t n)
+{
+    cursor_ = block_codec::skip(cursor_, n);
+}
+
+void block_file_reader::skip_bytes(uint64_t bytes)
+{
+    cursor_ += bytes;
+}
+
+uint64_t block_file_reader::byte_location() const
+{
+    return static_cast<uint64_t>(cursor_ - start_);
+}
+}
+}
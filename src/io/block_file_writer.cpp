@@ -0,0 +1,91 @@
+/**
+ * @file block_file_writer.cpp
+ */
+
+#include "io/block_codec.h"
+#include "io/block_file_writer.h"
+
+namespace meta
+{
+namespace io
+{
+
+namespace
+{
+/// Flush the buffer to disk once it grows past this many bytes
+const uint64_t max_buffer_size = 1024 * 1024 * 16; // 16 MB
+}
+
+block_file_writer::block_file_writer(const std::string& filename)
+    : outfile_{fopen(filename.c_str(), "wb")}, byte_location_{0}
+{
+    if (!outfile_)
+        throw block_file_writer_exception{"error opening " + filename};
+    buffer_.reserve(max_buffer_size);
+}
+
+block_file_writer::block_file_writer(block_file_writer&& other)
+    : outfile_{other.outfile_},
+      buffer_{std::move(other.buffer_)},
+      byte_location_{other.byte_location_}
+{
+    other.outfile_ = nullptr;
+}
+
+block_file_writer::~block_file_writer()
+{
+    close();
+}
+
+uint64_t block_file_writer::byte_location() const
+{
+    return byte_location_;
+}
+
+void block_file_writer::write(uint64_t value)
+{
+    auto size = buffer_.size();
+    block_codec::write_varint(buffer_, value);
+    byte_location_ += buffer_.size() - size;
+    if (buffer_.size() >= max_buffer_size)
+        flush();
+}
+
+void block_file_writer::write_block(const uint64_t* values, uint64_t n)
+{
+    auto size = buffer_.size();
+    block_codec::pack(buffer_, values, n);
+    byte_location_ += buffer_.size() - size;
+    if (buffer_.size() >= max_buffer_size)
+        flush();
+}
+
+void block_file_writer::write_bytes(const std::vector<uint8_t>& bytes)
+{
+    buffer_.insert(buffer_.end(), bytes.begin(), bytes.end());
+    byte_location_ += bytes.size();
+    if (buffer_.size() >= max_buffer_size)
+        flush();
+}
+
+void block_file_writer::flush()
+{
+    if (buffer_.empty())
+        return;
+
+    if (fwrite(buffer_.data(), 1, buffer_.size(), outfile_) != buffer_.size())
+        throw block_file_writer_exception{"error writing to file"};
+    buffer_.clear();
+}
+
+void block_file_writer::close()
+{
+    if (!outfile_)
+        return;
+
+    flush();
+    fclose(outfile_);
+    outfile_ = nullptr;
+}
+}
+}
@@ -13,10 +13,10 @@ namespace meta
 namespace io
 {
 
-compressed_file_reader::compressed_file_reader(const std::string& filename,
-                                               std::function
-                                               <uint64_t(uint64_t)> mapping)
-    : file_{make_unique<mmap_file>(filename)},
+compressed_file_reader::compressed_file_reader(
+    const std::string& filename, std::function<uint64_t(uint64_t)> mapping,
+    access_policy policy /* = access_policy::normal */)
+    : file_{make_unique<mmap_file>(filename, policy)},
       start_{file_->begin()},
       size_{file_->size()},
       status_{notDone},
@@ -16,7 +16,9 @@ namespace meta
 namespace io
 {
 
-mmap_file::mmap_file(const std::string& path)
+mmap_file::mmap_file(const std::string& path,
+                     access_policy policy /* = access_policy::normal */,
+                     bool huge_pages /* = false */)
     : path_{path}, start_{nullptr}, size_{filesystem::file_size(path)}
 {
     file_descriptor_ = open(path_.c_str(), O_RDONLY);
@@ -24,13 +26,23 @@ mmap_file::mmap_file(const std::string& path)
         throw mmap_file_exception{"error obtaining file descriptor for "
                                   + path_};
 
-    start_ = (char*)mmap(nullptr, size_, PROT_READ, MAP_SHARED,
-                         file_descriptor_, 0);
-    if (start_ == nullptr)
+    // an empty file can't be mapped, and there is nothing to read anyway
+    if (size_ == 0)
+    {
+        close(file_descriptor_);
+        return;
+    }
+
+    auto start = mmap(nullptr, size_, PROT_READ,
+                      MAP_SHARED | mmap_advice::map_flags(policy),
+                      file_descriptor_, 0);
+    if (start == MAP_FAILED)
     {
         close(file_descriptor_);
         throw mmap_file_exception("error memory-mapping " + path_);
     }
+    start_ = static_cast<char*>(start);
+    mmap_advice::advise(start_, size_, policy, huge_pages);
 }
 
 mmap_file::mmap_file(mmap_file&& other)
@@ -55,6 +67,11 @@ char* mmap_file::begin() const
     return start_;
 }
 
+void mmap_file::prefetch(uint64_t offset, uint64_t length) const
+{
+    mmap_advice::prefetch(start_, size_, offset, length);
+}
+
 mmap_file& mmap_file::operator=(mmap_file&& other)
 {
     if (this != &other)
@@ -4,9 +4,12 @@
  */
 
 #include <algorithm>
+#include <limits>
 #include <numeric>
 #include <random>
 #include "util/filesystem.h"
+#include "io/block_file_reader.h"
+#include "io/block_file_writer.h"
 #include "io/compressed_file_reader.h"
 #include "io/compressed_file_writer.h"
 #include "test/compression_test.h"
@@ -48,6 +51,48 @@ int compression_tests()
         ASSERT_EQUAL(reader.next_string(), "some random string");
     });
 
+    if (filesystem::file_exists(filename))
+        filesystem::delete_file(filename);
+
+    // a block of mixed widths, one that needs the full 64 bits, and one
+    // that is all zeros
+    std::vector<uint64_t> wide(vec.begin(), vec.end());
+    wide.push_back(std::numeric_limits<uint64_t>::max());
+    std::vector<uint64_t> zeros(37, 0);
+
+    num_failed += testing::run_test("block-file-writer", [&]()
+    {
+        io::block_file_writer writer{filename};
+        writer.write(str.size());
+        for (auto& v : vec)
+            writer.write(v);
+        writer.write_block(vec.data(), vec.size());
+        writer.write_block(wide.data(), wide.size());
+        writer.write_block(zeros.data(), zeros.size());
+        writer.write(uint64_t{1} << 63);
+    });
+
+    num_failed += testing::run_test("block-file-reader", [&]()
+    {
+        io::block_file_reader reader{filename};
+        ASSERT_EQUAL(reader.next(), str.size());
+        for (auto& v : vec)
+            ASSERT_EQUAL(reader.next(), v);
+
+        std::vector<uint64_t> block(wide.size());
+        reader.next_block(vec.size(), block.data());
+        for (uint64_t i = 0; i < vec.size(); ++i)
+            ASSERT_EQUAL(block[i], vec[i]);
+
+        reader.next_block(wide.size(), block.data());
+        for (uint64_t i = 0; i < wide.size(); ++i)
+            ASSERT_EQUAL(block[i], wide[i]);
+
+        reader.skip_block(zeros.size());
+        ASSERT_EQUAL(reader.next(), uint64_t{1} << 63);
+        ASSERT(!reader.has_next());
+    });
+
     if (filesystem::file_exists(filename))
         filesystem::delete_file(filename);
 
@@ -4,6 +4,8 @@
  */
 
 #include "test/forward_index_test.h"
+#include "index/postings_data.h"
+#include "io/libsvm_parser.h"
 
 namespace meta
 {
@@ -97,12 +99,32 @@ void check_ceeaus_doc_id(Index& idx)
     }
 }
 
+template <class Index>
+void check_libsvm_export(Index& idx)
+{
+    for (const auto& d_id : idx.docs())
+    {
+        auto pdata = idx.search_primary(d_id);
+        auto exported = io::libsvm_parser::counts(idx.liblinear_data(d_id));
+        ASSERT_EQUAL(exported.size(), pdata->counts().size());
+
+        uint64_t i = 0;
+        for (const auto& count : pdata->counts())
+        {
+            ASSERT_EQUAL(exported[i].first, count.first);
+            ASSERT_APPROX_EQUAL(exported[i].second, count.second);
+            ++i;
+        }
+    }
+}
+
 void ceeaus_forward_test()
 {
     auto idx = index::make_index<index::forward_index, caching::splay_cache>(
         "test-config.toml", uint32_t{10000});
     check_ceeaus_expected_fwd(*idx);
     check_ceeaus_doc_id(*idx);
+    check_libsvm_export(*idx);
 }
 
 void bcancer_forward_test()
@@ -111,6 +133,7 @@ void bcancer_forward_test()
         "test-config.toml", uint32_t{10000});
     check_bcancer_expected(*idx);
     check_bcancer_doc_id(*idx);
+    check_libsvm_export(*idx);
 }
 
 int forward_index_tests()
@@ -145,6 +168,20 @@ int forward_index_tests()
         system("rm -rf ceeaus-* test-config.toml");
     });
 
+    create_config("line", "block", true);
+
+    num_failed += testing::run_test("forward-index-build-combined", [&]()
+    {
+        system("rm -rf ceeaus-*");
+        ceeaus_forward_test();
+    });
+
+    num_failed += testing::run_test("forward-index-read-combined", [&]()
+    {
+        ceeaus_forward_test();
+        system("rm -rf ceeaus-* test-config.toml");
+    });
+
     create_libsvm_config();
 
     num_failed += testing::run_test("forward-index-build-libsvm", [&]()
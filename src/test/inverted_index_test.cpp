@@ -3,6 +3,10 @@
  * @author Sean Massung
  */
 
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
 #include "test/inverted_index_test.h"
 
 namespace meta
@@ -10,7 +14,9 @@ namespace meta
 namespace testing
 {
 
-void create_config(const std::string& corpus_type)
+void create_config(const std::string& corpus_type,
+                   const std::string& postings_codec,
+                   bool combined_build, bool store_positions)
 {
     auto orig_config = cpptoml::parse_file("config.toml");
     std::string config_filename{"test-config.toml"};
@@ -54,6 +60,10 @@ void create_config(const std::string& corpus_type)
                 << "encoding = \"shift_jis\"\n"
                 << "forward-index = \"ceeaus-fwd\"\n"
                 << "inverted-index = \"ceeaus-inv\"\n"
+                << "postings-codec = \"" << postings_codec << "\"\n"
+                << "combined-build = " << std::boolalpha << combined_build
+                << "\n"
+                << "store-positions = " << store_positions << "\n"
                 << "[[analyzers]]\n"
                 << "method = \"ngram-word\"\n"
                 << "ngram = 1\n"
@@ -102,11 +112,340 @@ void check_term_id(Index& idx)
     }
 }
 
+template <class Index>
+void check_term_stats(Index& idx)
+{
+    uint64_t total = 0;
+    for (term_id t_id{0}; t_id < idx.unique_terms(); ++t_id)
+    {
+        auto pdata = idx.search_primary(t_id);
+        uint64_t corpus_freq = 0;
+        uint64_t max_freq = 0;
+        for (const auto& count : pdata->counts())
+        {
+            auto freq = static_cast<uint64_t>(count.second);
+            corpus_freq += freq;
+            max_freq = std::max(max_freq, freq);
+        }
+        ASSERT_EQUAL(idx.doc_freq(t_id), pdata->counts().size());
+        ASSERT_EQUAL(idx.total_num_occurences(t_id), corpus_freq);
+        ASSERT_EQUAL(idx.max_term_freq(t_id), max_freq);
+        total += corpus_freq;
+    }
+    ASSERT_EQUAL(idx.total_corpus_terms(), total);
+
+    term_id missing{idx.unique_terms()};
+    ASSERT_EQUAL(idx.doc_freq(missing), 0ul);
+    ASSERT_EQUAL(idx.total_num_occurences(missing), 0ul);
+    ASSERT_EQUAL(idx.max_term_freq(missing), 0ul);
+}
+
+template <class Index>
+void check_cursors(Index& idx)
+{
+    term_id most_common{0};
+    term_id second_most_common{0};
+    for (term_id t_id{0}; t_id < idx.unique_terms(); ++t_id)
+    {
+        auto pdata = idx.search_primary(t_id);
+        auto cursor = idx.cursor(t_id);
+        ASSERT_EQUAL(cursor.size(), pdata->counts().size());
+        for (const auto& count : pdata->counts())
+        {
+            ASSERT(cursor.valid());
+            ASSERT_EQUAL(cursor.doc(), count.first);
+            ASSERT_APPROX_EQUAL(static_cast<double>(cursor.freq()),
+                                count.second);
+            cursor.next();
+        }
+        ASSERT(!cursor.valid());
+
+        if (cursor.size() > idx.doc_freq(most_common))
+        {
+            second_most_common = most_common;
+            most_common = t_id;
+        }
+        else if (cursor.size() > idx.doc_freq(second_most_common))
+            second_most_common = t_id;
+    }
+
+    auto first = idx.search_primary(most_common);
+    auto second = idx.search_primary(second_most_common);
+    for (const auto& count : first->counts())
+        ASSERT_APPROX_EQUAL(static_cast<double>(idx.term_freq(
+                                most_common, doc_id{count.first})),
+                            count.second);
+
+    std::vector<doc_id> expected;
+    for (const auto& count : first->counts())
+    {
+        if (second->count(doc_id{count.first}) > 0)
+            expected.emplace_back(count.first);
+    }
+    ASSERT(idx.intersect({most_common, second_most_common}) == expected);
+}
+
+template <class Index>
+void check_positions(Index& idx)
+{
+    ASSERT(idx.has_positions());
+
+    // every posting has as many positions as its count
+    auto t_id = idx.get_term_id("japanes");
+    auto pdata = idx.search_primary(t_id);
+    for (const auto& count : pdata->counts())
+    {
+        auto positions = idx.positions(t_id, doc_id{count.first});
+        ASSERT_EQUAL(positions.size(), static_cast<uint64_t>(count.second));
+        ASSERT(std::is_sorted(positions.begin(), positions.end()));
+    }
+
+    // find the term after the first occurrence of t_id
+    doc_id d_id{pdata->counts().front().first};
+    auto start = idx.positions(t_id, d_id).front();
+    term_id next{idx.unique_terms()};
+    for (term_id other{0}; other < idx.unique_terms(); ++other)
+    {
+        auto positions = idx.positions(other, d_id);
+        if (std::binary_search(positions.begin(), positions.end(), start + 1))
+            next = other;
+    }
+    ASSERT(next < idx.unique_terms());
+
+    auto results = idx.phrase({t_id, next});
+    ASSERT(std::find(results.begin(), results.end(), d_id) != results.end());
+    for (const auto& result : results)
+    {
+        auto first = idx.positions(t_id, result);
+        auto second = idx.positions(next, result);
+        bool found = false;
+        for (const auto& pos : first)
+            found |= std::binary_search(second.begin(), second.end(), pos + 1);
+        ASSERT(found);
+    }
+
+    // a phrase is also a match for proximity, in either order
+    auto near = idx.near({next, t_id}, 2);
+    for (const auto& result : results)
+        ASSERT(std::binary_search(near.begin(), near.end(), result));
+    if (next != t_id)
+        ASSERT(idx.near({t_id, next}, 1).empty());
+}
+
+template <class FeatureValue>
+void check_postings_accumulator()
+{
+    using accumulator_type
+        = index::postings_accumulator<std::string, doc_id, FeatureValue>;
+    accumulator_type acc;
+
+    // "a" gets enough postings to chain slices of every level, "b" a
+    // few, and "c" one; secondary keys arrive out of order and repeat
+    std::map<std::string, std::map<doc_id, FeatureValue>> expected;
+    auto fill = [&]()
+    {
+        expected.clear();
+        for (uint64_t i = 0; i < 5000; ++i)
+        {
+            doc_id d_id{(i * 7919) % 1000};
+            auto count = static_cast<FeatureValue>(1 + i % 3);
+            acc.add("a", d_id, count);
+            expected["a"][d_id] += count;
+            if (i % 3 == 0)
+            {
+                acc.add("b", d_id, count);
+                expected["b"][d_id] += count;
+            }
+        }
+        acc.add("c", doc_id{7}, FeatureValue{2});
+        expected["c"][doc_id{7}] += FeatureValue{2};
+    };
+
+    auto check = [&]()
+    {
+        auto next = expected.begin();
+        acc.drain([&](const typename accumulator_type::postings_data_type& pd)
+                  {
+            ASSERT(next != expected.end());
+            ASSERT_EQUAL(pd.primary_key(), next->first);
+            ASSERT_EQUAL(pd.counts().size(), next->second.size());
+            auto count = pd.counts().begin();
+            for (const auto& exp : next->second)
+            {
+                ASSERT_EQUAL(doc_id{count->first}, exp.first);
+                ASSERT_APPROX_EQUAL(static_cast<double>(count->second),
+                                    static_cast<double>(exp.second));
+                ++count;
+            }
+            ++next;
+        });
+        ASSERT(next == expected.end());
+        ASSERT(acc.empty());
+    };
+
+    fill();
+    auto bytes = acc.bytes_used();
+    check();
+
+    // the same postings again fit in the pages kept from the first round
+    fill();
+    ASSERT_EQUAL(acc.bytes_used(), bytes);
+    check();
+}
+
+template <class FeatureValue>
+void check_packed_counts(const std::vector<FeatureValue>& values)
+{
+    using pdata_type = index::postings_data<term_id, doc_id, FeatureValue>;
+    const std::string filename = "meta-tmp-packed-counts.bin";
+
+    pdata_type pdata{term_id{0}};
+    typename pdata_type::count_t counts;
+    for (uint64_t i = 0; i < values.size(); ++i)
+        counts.emplace_back(doc_id{3 * i + 1}, values[i]);
+    pdata.set_counts(counts);
+    {
+        io::block_file_writer writer{filename};
+        pdata.write_packed_counts(writer);
+    }
+
+    pdata_type read{term_id{0}};
+    {
+        io::block_file_reader reader{filename};
+        read.read_packed_counts(reader);
+    }
+    ASSERT_EQUAL(read.counts().size(), values.size());
+    for (uint64_t i = 0; i < values.size(); ++i)
+    {
+        ASSERT_EQUAL(doc_id{read.counts()[i].first}, doc_id{3 * i + 1});
+        ASSERT_EQUAL(read.counts()[i].second, values[i]);
+    }
+
+    // the block format stores count - 1, so it can only take positive
+    // integers
+    bool positive_integers
+        = std::all_of(values.begin(), values.end(), [](FeatureValue v)
+                      {
+            return v >= 1 && v == std::floor(v);
+        });
+    try
+    {
+        io::block_file_writer writer{filename};
+        pdata.write_packed(writer);
+        ASSERT(positive_integers);
+    }
+    catch (const typename pdata_type::postings_data_exception&)
+    {
+        ASSERT(!positive_integers);
+    }
+    std::remove(filename.c_str());
+}
+
+void check_tinylfu_cache()
+{
+    using pdata_type = index::postings_data<term_id, doc_id, uint32_t>;
+    using cache_type
+        = caching::tinylfu_cache<term_id, std::shared_ptr<pdata_type>>;
+
+    // one stripe, so the whole budget is shared by every key
+    const uint64_t budget = 16 * 1024;
+    cache_type cache{budget, 1};
+    auto make_value = [](term_id t_id)
+    {
+        auto pdata = std::make_shared<pdata_type>(t_id);
+        pdata_type::count_t counts;
+        for (uint64_t i = 0; i < 128; ++i)
+            counts.emplace_back(doc_id{i}, 1);
+        pdata->set_counts(counts);
+        return pdata;
+    };
+
+    // more frequently requested keys than fit in the budget
+    for (term_id t_id{0}; t_id < 40; ++t_id)
+    {
+        for (uint64_t i = 0; i < 5; ++i)
+            cache.find(t_id);
+        cache.insert(t_id, make_value(t_id));
+        ASSERT_LESS(cache.bytes(), budget + 1);
+    }
+    auto size = cache.size();
+    ASSERT_GREATER(size, 0ul);
+    ASSERT_LESS(size, 40ul);
+
+    // keys requested once may not push out keys requested five times
+    for (term_id t_id{1000}; t_id < 1100; ++t_id)
+    {
+        ASSERT(!cache.find(t_id));
+        cache.insert(t_id, make_value(t_id));
+        ASSERT_LESS(cache.bytes(), budget + 1);
+    }
+    ASSERT_EQUAL(cache.size(), size);
+    for (term_id t_id{1000}; t_id < 1100; ++t_id)
+        ASSERT(!cache.find(t_id));
+
+    // but a key requested more often than they were is admitted
+    term_id hot{2000};
+    for (uint64_t i = 0; i < 10; ++i)
+        cache.find(hot);
+    cache.insert(hot, make_value(hot));
+    ASSERT(cache.find(hot));
+    ASSERT_LESS(cache.bytes(), budget + 1);
+
+    // re-inserting a present key is an update, which skips admission: it
+    // keeps its entry however much more popular other keys are
+    std::vector<term_id> present;
+    for (term_id t_id{0}; t_id < 40; ++t_id)
+    {
+        if (cache.find(t_id))
+            present.push_back(t_id);
+    }
+    present.push_back(hot);
+    for (term_id t_id{3000}; t_id < 3100; ++t_id)
+    {
+        for (uint64_t i = 0; i < 50; ++i)
+            cache.find(t_id);
+    }
+    size = cache.size();
+    for (const auto& t_id : present)
+    {
+        cache.insert(t_id, make_value(t_id));
+        ASSERT(cache.find(t_id));
+    }
+    ASSERT_EQUAL(cache.size(), size);
+
+    // and an update too large to keep leaves the old value in place
+    auto old_value = *cache.find(hot);
+    auto large = std::make_shared<pdata_type>(hot);
+    pdata_type::count_t counts(budget, {doc_id{0}, 1});
+    large->set_counts(counts);
+    cache.insert(hot, large);
+    auto found = cache.find(hot);
+    ASSERT(found);
+    ASSERT(*found == old_value);
+    ASSERT_EQUAL(cache.size(), size);
+    ASSERT_LESS(cache.bytes(), budget + 1);
+}
+
 int inverted_index_tests()
 {
+    int num_failed = 0;
+    num_failed += testing::run_test("inverted-index-postings-accumulator",
+                                    [&]()
+                                    {
+        check_postings_accumulator<uint32_t>();
+        check_postings_accumulator<double>();
+    });
+
+    num_failed += testing::run_test("inverted-index-packed-counts", [&]()
+    {
+        check_packed_counts<uint32_t>({1, 2, 7, 1});
+        check_packed_counts<uint32_t>({3, 0, 5});
+        check_packed_counts<double>({1.0, 4.0, 2.0});
+        check_packed_counts<double>({0.3, 2.0, 0.0, 1.5});
+    });
+
     create_config("file");
 
-    int num_failed = 0;
     num_failed += testing::run_test("inverted-index-build-file-corpus", [&]()
                                     {
         system("rm -rf ceeaus-inv");
@@ -149,6 +488,70 @@ int inverted_index_tests()
         check_term_id(*idx); // twice to check splay_caching
     });
 
+    num_failed += testing::run_test("inverted-index-term-stats", [&]()
+                                    {
+        {
+            auto idx = index::make_index<index::inverted_index>(
+                "test-config.toml");
+            check_term_stats(*idx);
+        }
+
+        // indexes without the table compute it when they are loaded
+        system("rm -f ceeaus-inv/termstats.index");
+        auto idx = index::make_index<index::inverted_index>("test-config.toml");
+        check_term_stats(*idx);
+    });
+
+    num_failed += testing::run_test("inverted-index-bounded-fan-in", [&]()
+                                    {
+        // a budget of zero writes a chunk for every document, so with a
+        // fan-in of two the chunks are reduced over many rounds
+        std::string config;
+        {
+            std::ifstream in{"test-config.toml"};
+            std::ostringstream contents;
+            contents << in.rdbuf();
+            config = contents.str();
+        }
+        std::string name{"\"ceeaus-inv\""};
+        config.replace(config.find(name), name.size(),
+                       "\"ceeaus-inv-chunked\"");
+        {
+            std::ofstream out{"chunked-config.toml"};
+            out << "merge-fan-in = 2\n"
+                << "indexer-ram-budget = 0\n" << config;
+        }
+        system("rm -rf ceeaus-inv-chunked");
+
+        auto idx = index::make_index<index::inverted_index>("test-config.toml");
+        auto chunked
+            = index::make_index<index::inverted_index>("chunked-config.toml");
+        ASSERT_EQUAL(chunked->num_docs(), idx->num_docs());
+        ASSERT_EQUAL(chunked->unique_terms(), idx->unique_terms());
+        ASSERT_EQUAL(chunked->total_corpus_terms(), idx->total_corpus_terms());
+        for (term_id t_id{0}; t_id < idx->unique_terms(); ++t_id)
+        {
+            auto expected = idx->search_primary(t_id);
+            auto actual = chunked->search_primary(t_id);
+            ASSERT_EQUAL(actual->counts().size(), expected->counts().size());
+            for (uint64_t i = 0; i < expected->counts().size(); ++i)
+            {
+                ASSERT_EQUAL(actual->counts()[i].first,
+                             expected->counts()[i].first);
+                ASSERT_EQUAL(actual->counts()[i].second,
+                             expected->counts()[i].second);
+            }
+            ASSERT_EQUAL(chunked->doc_freq(t_id), idx->doc_freq(t_id));
+            ASSERT_EQUAL(chunked->total_num_occurences(t_id),
+                         idx->total_num_occurences(t_id));
+            ASSERT_EQUAL(chunked->max_term_freq(t_id),
+                         idx->max_term_freq(t_id));
+        }
+        check_term_stats(*chunked);
+    });
+
+    system("rm -rf ceeaus-inv-chunked chunked-config.toml");
+
 #if META_HAS_ZLIB
     create_config("gz");
     system("rm -rf ceeaus-inv");
@@ -191,6 +594,29 @@ int inverted_index_tests()
         check_term_id(*idx);
     });
 
+    num_failed += testing::run_test("inverted-index-clock-cache", [&]()
+                                    {
+        auto idx = index::make_index<index::inverted_index,
+                                     caching::clock_cache>(
+            "test-config.toml", uint64_t{1000});
+        check_term_id(*idx);
+        check_term_id(*idx);
+    });
+
+    num_failed += testing::run_test("inverted-index-tinylfu-cache", [&]()
+                                    {
+        auto idx = index::make_index<index::inverted_index,
+                                     caching::tinylfu_cache>(
+            "test-config.toml", uint64_t{1024 * 1024});
+        check_term_id(*idx);
+        check_term_id(*idx);
+    });
+
+    num_failed += testing::run_test("tinylfu-cache-admission", [&]()
+                                    {
+        check_tinylfu_cache();
+    });
+
     num_failed += testing::run_test("inverted-index-shard-cache", [&]()
                                     {
         auto idx = index::make_index<index::inverted_index,
@@ -200,7 +626,308 @@ int inverted_index_tests()
         check_term_id(*idx);
     });
 
-    system("rm -rf ceeaus-inv test-config.toml");
+    create_config("line", "block");
+    system("rm -rf ceeaus-inv");
+
+    num_failed += testing::run_test("inverted-index-build-block-codec", [&]()
+                                    {
+        auto idx
+            = index::make_index<index::inverted_index, caching::splay_cache>(
+                "test-config.toml", uint32_t{10000});
+        check_ceeaus_expected(*idx);
+        check_term_id(*idx);
+    });
+
+    num_failed += testing::run_test("inverted-index-read-block-codec", [&]()
+                                    {
+        auto idx = index::make_index<index::inverted_index,
+                                     caching::default_dblru_cache>(
+            "test-config.toml", uint64_t{1000});
+        check_ceeaus_expected(*idx);
+        check_term_id(*idx);
+        check_term_id(*idx);
+        check_cursors(*idx);
+    });
+
+    num_failed += testing::run_test("inverted-index-mmap-policies", [&]()
+                                    {
+        {
+            std::ofstream config_file{"test-config.toml", std::ios::app};
+            config_file << "\n[mmap]\n"
+                        << "postings = \"sequential\"\n"
+                        << "metadata = \"normal\"\n"
+                        << "huge-pages = true\n";
+        }
+        auto idx
+            = index::make_index<index::inverted_index>("test-config.toml");
+        for (term_id t_id{0}; t_id <= idx->unique_terms(); ++t_id)
+        {
+            idx->prefetch(t_id);
+            idx->prefetch_impacts(t_id);
+        }
+        check_ceeaus_expected(*idx);
+        check_cursors(*idx);
+
+        try
+        {
+            io::access_policy_from_string("sideways");
+            FAIL("unknown access policies should throw");
+        }
+        catch (const io::access_policy_exception&)
+        {
+            // nothing, this is the expected behavior
+        }
+    });
+
+    create_config("line", "block", false, true);
+    system("rm -rf ceeaus-inv");
+
+    num_failed += testing::run_test("inverted-index-build-positions", [&]()
+                                    {
+        auto idx
+            = index::make_index<index::inverted_index>("test-config.toml");
+        check_ceeaus_expected(*idx);
+        check_positions(*idx);
+    });
+
+    num_failed += testing::run_test("inverted-index-read-positions", [&]()
+                                    {
+        auto idx
+            = index::make_index<index::inverted_index>("test-config.toml");
+        check_positions(*idx);
+    });
+
+    create_config("file");
+    system("rm -rf ceeaus-inv");
+
+    num_failed += testing::run_test("inverted-index-delete-docs", [&]()
+                                    {
+        {
+            auto idx = index::make_index<index::inverted_index>(
+                "test-config.toml");
+            ASSERT_EQUAL(idx->num_deleted(), 0ul);
+            idx->remove_doc(doc_id{5});
+            idx->remove_doc(doc_id{5});
+            ASSERT_EQUAL(idx->num_deleted(), 1ul);
+        }
+
+        // deletions are saved with the index
+        auto idx = index::make_index<index::inverted_index>("test-config.toml");
+        ASSERT_EQUAL(idx->num_deleted(), 1ul);
+        ASSERT(!idx->is_live(doc_id{5}));
+        ASSERT(idx->is_live(doc_id{6}));
+        auto docs = idx->docs();
+        ASSERT_EQUAL(docs.size(), idx->num_docs() - 1);
+        ASSERT(std::find(docs.begin(), docs.end(), doc_id{5}) == docs.end());
+
+        index::okapi_bm25 ranker;
+        corpus::document query{idx->doc_path(doc_id{5}), doc_id{5}};
+        for (const auto& result : ranker.score(*idx, query, 10))
+            ASSERT(result.first != doc_id{5});
+    });
+
+    system("rm -rf ceeaus-inv");
+
+    num_failed += testing::run_test("inverted-index-segments", [&]()
+                                    {
+        uint64_t num_docs = 0;
+        {
+            index::segmented_index idx{"test-config.toml", 2};
+            for (int i = 0; i < 3; ++i)
+                idx.add("test-config.toml");
+            idx.wait_for_merges();
+
+            // two segments merged into one, plus the third on its own
+            ASSERT_EQUAL(idx.num_segments(), 2ul);
+            num_docs = idx.num_docs() / 3;
+            ASSERT_EQUAL(idx.num_docs(), 3 * num_docs);
+        }
+
+        // reopen from the manifest
+        index::segmented_index idx{"test-config.toml", 2};
+        ASSERT_EQUAL(idx.num_segments(), 2ul);
+        index::okapi_bm25 ranker;
+        for (uint64_t i = 0; i < num_docs; i += 100)
+        {
+            corpus::document query{idx.doc_path(doc_id{i}), doc_id{i}};
+            auto ranking = idx.score(ranker, query, 3);
+            ASSERT_EQUAL(ranking.size(), 3ul);
+
+            // every copy of the document scores the same, since the scores
+            // use the statistics of the whole index
+            for (const auto& result : ranking)
+                ASSERT_APPROX_EQUAL(result.second, ranking[0].second);
+        }
+
+        // deleting the first copy of document 0 and merging everything into
+        // one segment should drop it and shift every other id down by one
+        auto path = idx.doc_path(doc_id{1});
+        idx.remove(doc_id{0}, idx.epoch());
+        idx.add("test-config.toml");
+        idx.wait_for_merges();
+        ASSERT_EQUAL(idx.num_segments(), 1ul);
+        ASSERT_EQUAL(idx.num_docs(), 4 * num_docs - 1);
+        ASSERT_EQUAL(idx.doc_path(doc_id{0}), path);
+    });
+
+    system("rm -rf ceeaus-inv");
+
+    num_failed += testing::run_test("inverted-index-segments-stale-ids", [&]()
+                                    {
+        index::segmented_index idx{"test-config.toml", 2};
+        idx.add("test-config.toml");
+
+        // score a query, then let a merge renumber the documents before
+        // deleting what it returned
+        auto epoch = idx.epoch();
+        auto last = doc_id{idx.num_docs() - 1};
+        corpus::document query{idx.doc_path(last), last};
+        index::okapi_bm25 ranker;
+        auto ranking = idx.score(ranker, query, 1);
+        ASSERT_EQUAL(ranking.size(), 1ul);
+        ASSERT_GREATER(uint64_t{ranking[0].first}, 0ul);
+        auto path = idx.doc_path(ranking[0].first);
+
+        idx.remove(doc_id{0}, epoch);
+        idx.add("test-config.toml");
+        idx.wait_for_merges();
+        ASSERT_EQUAL(idx.num_segments(), 1ul);
+        ASSERT(idx.epoch() != epoch);
+        try
+        {
+            idx.remove(ranking[0].first, epoch);
+            FAIL("deleting a doc_id from before a renumbering should throw");
+        }
+        catch (const index::segmented_index::segmented_index_exception&)
+        {
+            // nothing, this is the expected behavior
+        }
+
+        // the document it named has moved down by one, and can be deleted
+        // by its new id
+        ASSERT_EQUAL(idx.num_docs(), 2 * (uint64_t{last} + 1) - 1);
+        doc_id moved{uint64_t{ranking[0].first} - 1};
+        ASSERT_EQUAL(idx.doc_path(moved), path);
+        idx.remove(moved, idx.epoch());
+    });
+
+    system("rm -rf ceeaus-inv");
+
+    num_failed += testing::run_test("inverted-index-reorder", [&]()
+                                    {
+        system("rm -rf ceeaus-fwd");
+        std::vector<std::string> paths;
+        std::vector<std::vector<std::pair<term_id, double>>> vectors;
+        std::vector<doc_id> order;
+        {
+            auto idx = index::make_index<index::inverted_index>(
+                "test-config.toml");
+            auto fwd_idx = index::make_index<index::forward_index>(
+                "test-config.toml");
+            for (doc_id d_id{0}; d_id < idx->num_docs(); ++d_id)
+            {
+                paths.push_back(idx->doc_path(d_id));
+                vectors.push_back(fwd_idx->query_terms(d_id));
+            }
+
+            auto by_path = index::path_order(*idx);
+            ASSERT_EQUAL(by_path.size(), idx->num_docs());
+            for (uint64_t i = 1; i < by_path.size(); ++i)
+                ASSERT(paths[by_path[i - 1]] <= paths[by_path[i]]);
+
+            order = index::bisection_order(*idx);
+            auto sorted = order;
+            std::sort(sorted.begin(), sorted.end());
+            ASSERT(sorted == idx->docs());
+        }
+
+        index::reorder_docs("test-config.toml", order);
+
+        auto idx = index::make_index<index::inverted_index>("test-config.toml");
+        auto fwd_idx = index::make_index<index::forward_index>(
+            "test-config.toml");
+        ASSERT_EQUAL(idx->num_docs(), order.size());
+        ASSERT_EQUAL(fwd_idx->num_docs(), order.size());
+        check_term_stats(*idx);
+        for (uint64_t i = 0; i < idx->num_docs(); i += 7)
+        {
+            doc_id d_id{i};
+            ASSERT_EQUAL(idx->doc_path(d_id), paths[order[d_id]]);
+            ASSERT_EQUAL(fwd_idx->doc_path(d_id), paths[order[d_id]]);
+            auto terms = fwd_idx->query_terms(d_id);
+            ASSERT(terms == vectors[order[d_id]]);
+            for (const auto& term : terms)
+                ASSERT_EQUAL(idx->term_freq(term.first, d_id),
+                             static_cast<uint64_t>(term.second));
+        }
+    });
+
+    system("rm -rf ceeaus-inv ceeaus-fwd test-config.toml");
+
+    num_failed += testing::run_test("inverted-index-build-libsvm", [&]()
+    {
+        auto write_corpus = [](const std::vector<std::string>& lines)
+        {
+            system("rm -rf svm-test svm-test-inv");
+            filesystem::make_directory("svm-test");
+            std::ofstream data{"svm-test/svm-test.dat"};
+            for (const auto& line : lines)
+                data << line << "\n";
+        };
+
+        {
+            std::ofstream config{"svm-config.toml"};
+            config << "prefix = \".\"\n"
+                   << "corpus-type = \"line-corpus\"\n"
+                   << "dataset = \"svm-test\"\n"
+                   << "forward-index = \"svm-test-fwd\"\n"
+                   << "inverted-index = \"svm-test-inv\"\n"
+                   << "[[analyzers]]\n"
+                   << "method = \"libsvm\"\n";
+        }
+
+        // integral feature values are stored as they are
+        std::vector<std::string> lines = {"1 1:3 4:1 7:12", "2 1:1 2:5",
+                                          "1 4:2 7:1 9:40000"};
+        write_corpus(lines);
+        {
+            auto idx = index::make_index<index::inverted_index>(
+                "svm-config.toml");
+            ASSERT_EQUAL(idx->num_docs(), lines.size());
+            std::map<std::string, std::map<uint64_t, uint32_t>> expected;
+            for (uint64_t d = 0; d < lines.size(); ++d)
+            {
+                for (const auto& count :
+                     io::libsvm_parser::counts(lines[d], false))
+                    expected[std::to_string(count.first)][d]
+                        = static_cast<uint32_t>(count.second);
+            }
+            ASSERT_EQUAL(idx->unique_terms(), expected.size());
+            for (const auto& term : expected)
+            {
+                auto pdata = idx->search_primary(
+                    idx->get_term_id(term.first));
+                ASSERT_EQUAL(pdata->counts().size(), term.second.size());
+                for (const auto& count : pdata->counts())
+                    ASSERT_EQUAL(count.second, term.second.at(count.first));
+            }
+        }
+
+        // but truncating fractional ones would change them
+        write_corpus({"1 1:3 4:1", "2 1:0.3 2:5"});
+        try
+        {
+            index::make_index<index::inverted_index>("svm-config.toml");
+            FAIL("fractional counts in an inverted index should throw");
+        }
+        catch (const index::chunk_handler<index::inverted_index>::
+                   chunk_handler_exception&)
+        {
+            // nothing, this is the expected behavior
+        }
+    });
+
+    system("rm -rf svm-test svm-test-inv svm-config.toml");
     return num_failed;
 }
 }
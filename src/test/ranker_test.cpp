@@ -3,6 +3,9 @@
  * @author Sean Massung
  */
 
+#include <algorithm>
+#include <cmath>
+
 #include "test/ranker_test.h"
 #include "corpus/document.h"
 
@@ -34,6 +37,220 @@ void test_rank(Ranker& r, Index& idx, const std::string& encoding)
     }
 }
 
+template <class Ranker, class Index>
+void test_pruned_rank(Ranker& r, Index& idx, const std::string& encoding)
+{
+    using strategy = index::ranker::evaluation_strategy;
+    for (size_t i = 0; i < idx.num_docs(); ++i)
+    {
+        auto d_id = idx.docs()[i];
+        corpus::document query{idx.doc_path(d_id), doc_id{i}};
+        query.encoding(encoding);
+
+        r.strategy(strategy::exhaustive);
+        auto expected = r.score(idx, query);
+        for (auto s : {strategy::wand, strategy::block_max_wand})
+        {
+            r.strategy(s);
+            auto ranking = r.score(idx, query);
+            ASSERT_EQUAL(ranking.size(), expected.size());
+            for (size_t j = 0; j < ranking.size(); ++j)
+                ASSERT_APPROX_EQUAL(ranking[j].second, expected[j].second);
+        }
+    }
+}
+
+template <class Ranker, class Index>
+void test_impact_rank(Ranker& r, Index& idx, const std::string& encoding)
+{
+    using strategy = index::ranker::evaluation_strategy;
+    idx.build_impacts(r, 16);
+    for (size_t i = 0; i < idx.num_docs(); ++i)
+    {
+        auto d_id = idx.docs()[i];
+        corpus::document query{idx.doc_path(d_id), doc_id{i}};
+        query.encoding(encoding);
+
+        r.strategy(strategy::exhaustive);
+        auto expected = r.score(idx, query);
+
+        // each term's contribution may be off by a unit of impact for each
+        // unit of query weight, plus one when it is scaled by the weight
+        double tolerance = 0;
+        for (const auto& count : query.counts())
+            tolerance += (count.second + 1) * idx.impact_scale();
+
+        r.strategy(strategy::score_at_a_time);
+        auto ranking = r.score(idx, query);
+        ASSERT_LESS(ranking.size(), expected.size() + 1);
+        for (size_t j = 0; j < ranking.size(); ++j)
+            ASSERT_LESS(std::abs(ranking[j].second - expected[j].second),
+                        tolerance);
+
+        // with a budget of one posting, only one document can be scored
+        r.postings_budget(1);
+        ASSERT_EQUAL(r.score(idx, query).size(), 1ul);
+        r.postings_budget(0);
+    }
+}
+
+template <class Ranker, class Index>
+void test_batch_rank(Ranker& r, Index& idx, const std::string& encoding)
+{
+    std::vector<corpus::document> queries;
+    for (size_t i = 0; i < idx.num_docs(); ++i)
+    {
+        auto d_id = idx.docs()[i];
+        queries.emplace_back(idx.doc_path(d_id), doc_id{i});
+        queries.back().encoding(encoding);
+    }
+
+    auto rankings = r.score_batch(idx, queries, 10, 4);
+    ASSERT_EQUAL(rankings.size(), queries.size());
+    for (size_t i = 0; i < queries.size(); ++i)
+    {
+        auto expected = r.score(idx, queries[i]);
+        ASSERT_EQUAL(rankings[i].size(), expected.size());
+        for (size_t j = 0; j < expected.size(); ++j)
+            ASSERT_APPROX_EQUAL(rankings[i][j].second, expected[j].second);
+    }
+}
+
+template <class Ranker, class Index>
+void test_partitioned_rank(Ranker& r, Index& idx, const std::string& encoding)
+{
+    using strategy = index::ranker::evaluation_strategy;
+    for (size_t i = 0; i < idx.num_docs(); i += 10)
+    {
+        auto d_id = idx.docs()[i];
+        corpus::document query{idx.doc_path(d_id), doc_id{i}};
+        query.encoding(encoding);
+
+        for (auto s : {strategy::exhaustive, strategy::block_max_wand})
+        {
+            r.strategy(s);
+            r.query_threads(0);
+            auto expected = r.score(idx, query, 20);
+            r.query_threads(4);
+            auto ranking = r.score(idx, query, 20);
+            ASSERT_EQUAL(ranking.size(), expected.size());
+            for (size_t j = 0; j < ranking.size(); ++j)
+                ASSERT_APPROX_EQUAL(ranking[j].second, expected[j].second);
+        }
+    }
+    r.query_threads(0);
+}
+
+template <class Ranker, class Index>
+void test_term_id_rank(Ranker& r, Index& idx, const std::string& encoding)
+{
+    for (size_t i = 0; i < idx.num_docs(); i += 10)
+    {
+        auto d_id = idx.docs()[i];
+        corpus::document query{idx.doc_path(d_id), doc_id{i}};
+        query.encoding(encoding);
+        idx.tokenize(query);
+
+        std::vector<std::pair<term_id, double>> terms;
+        for (const auto& count : query.counts())
+            terms.emplace_back(idx.get_term_id(count.first), count.second);
+
+        auto expected = r.score(idx, query);
+        auto ranking = r.score(idx, terms);
+        ASSERT_EQUAL(ranking.size(), expected.size());
+        for (size_t j = 0; j < expected.size(); ++j)
+            ASSERT_APPROX_EQUAL(ranking[j].second, expected[j].second);
+    }
+}
+
+template <class Ranker, class Index>
+void test_filtered_rank(Ranker& r, Index& idx, const std::string& encoding)
+{
+    std::vector<doc_id> ids;
+    for (uint64_t i = 0; i < idx.num_docs(); i += 7)
+        ids.push_back(doc_id{i});
+
+    auto sorted = index::doc_filter::sorted_ids(ids);
+    auto bits = index::doc_filter::bitset(idx.num_docs(), ids);
+    ASSERT_EQUAL(sorted.size(), ids.size());
+    ASSERT_EQUAL(bits.size(), ids.size());
+    ASSERT(!sorted.is_bitset() && bits.is_bitset());
+    ASSERT_EQUAL(sorted.next(doc_id{1}), doc_id{7});
+    ASSERT_EQUAL(bits.next(doc_id{1}), doc_id{7});
+    ASSERT(bits.contains(doc_id{14}) && !bits.contains(doc_id{15}));
+
+    for (size_t i = 0; i < idx.num_docs(); i += 10)
+    {
+        auto d_id = idx.docs()[i];
+        corpus::document query{idx.doc_path(d_id), doc_id{i}};
+        query.encoding(encoding);
+
+        auto expected = r.score(idx, query, 10, [](doc_id d_id)
+                                {
+            return d_id % 7 == 0;
+        });
+        for (const auto& filter : {sorted, bits})
+        {
+            auto ranking = r.score(idx, query, filter);
+            ASSERT_EQUAL(ranking.size(), expected.size());
+            for (size_t j = 0; j < ranking.size(); ++j)
+            {
+                ASSERT(filter.contains(ranking[j].first));
+                ASSERT_APPROX_EQUAL(ranking[j].second, expected[j].second);
+            }
+        }
+    }
+}
+
+template <class Ranker, class Index>
+void test_cached_rank(Ranker& r, Index& idx, const std::string& encoding)
+{
+    index::query_cache cache;
+    for (size_t round = 0; round < 2; ++round)
+    {
+        for (size_t i = 0; i < idx.num_docs(); i += 10)
+        {
+            auto d_id = idx.docs()[i];
+            corpus::document query{idx.doc_path(d_id), doc_id{i}};
+            query.encoding(encoding);
+
+            auto expected = r.score(idx, query);
+            auto ranking = cache.score(r, idx, query);
+            ASSERT_EQUAL(ranking.size(), expected.size());
+            for (size_t j = 0; j < expected.size(); ++j)
+            {
+                ASSERT_EQUAL(ranking[j].first, expected[j].first);
+                ASSERT_APPROX_EQUAL(ranking[j].second, expected[j].second);
+            }
+        }
+    }
+
+    // duplicate documents share an entry, so there may be more hits than
+    // the second round's queries
+    auto queries = (idx.num_docs() + 9) / 10;
+    auto stats = cache.stats();
+    ASSERT_EQUAL(stats.hits + stats.misses, 2 * queries);
+    ASSERT(stats.hits >= queries);
+    ASSERT_EQUAL(cache.size(), stats.misses);
+    ASSERT(stats.hit_rate() >= 0.5);
+
+    // asking for a different number of results is a different query, as
+    // is scoring with different parameters
+    corpus::document query{idx.doc_path(idx.docs()[0]), doc_id{0}};
+    query.encoding(encoding);
+    ASSERT_EQUAL(cache.score(r, idx, query, 5).size(), 5ul);
+    Ranker other{0.5};
+    auto expected = other.score(idx, query);
+    auto ranking = cache.score(other, idx, query);
+    for (size_t j = 0; j < expected.size(); ++j)
+        ASSERT_APPROX_EQUAL(ranking[j].second, expected[j].second);
+    ASSERT_EQUAL(cache.stats().misses, stats.misses + 2);
+
+    cache.clear();
+    ASSERT_EQUAL(cache.size(), 0ul);
+    ASSERT_EQUAL(cache.bytes(), 0ul);
+}
+
 int ranker_tests()
 {
     create_config("file");
@@ -77,7 +294,185 @@ int ranker_tests()
         test_rank(r, *idx, encoding);
     });
 
+    num_failed += testing::run_test("ranker-simd-blocks", [&]()
+    {
+        for (double x : {1e-300, 0.5, 0.70710678, 1.0, 1.41421357, 2.0,
+                         3.75, 1000.0, 1e300})
+            ASSERT_APPROX_EQUAL(index::simd::log(x), std::log(x));
+
+        // the vector code must agree exactly with the scalar kernels, as
+        // pruned evaluation relies on score_one()
+        std::vector<double> counts;
+        std::vector<float> norms;
+        for (uint64_t i = 1; i <= 37; ++i)
+        {
+            counts.push_back(i % 7 + 1);
+            norms.push_back(0.25f * i);
+        }
+        std::vector<double> scores(counts.size());
+
+        auto n = index::simd::bm25_block(2.5, counts.data(), norms.data(),
+                                         scores.data(), counts.size());
+        index::okapi_bm25::kernel bm25{2.5};
+        for (uint64_t i = 0; i < n; ++i)
+            ASSERT_EQUAL(scores[i], bm25(counts[i], norms[i]));
+
+        n = index::simd::pivoted_length_block(
+            2.5, counts.data(), norms.data(), scores.data(), counts.size());
+        index::pivoted_length::kernel pivoted{2.5};
+        for (uint64_t i = 0; i < n; ++i)
+            ASSERT_EQUAL(scores[i], pivoted(counts[i], norms[i]));
+
+        n = index::simd::dirichlet_prior_block(0.5, 3.25, counts.data(),
+                                               scores.data(), counts.size());
+        index::dirichlet_prior::kernel dirichlet{0.5, 3.25, 1};
+        for (uint64_t i = 0; i < n; ++i)
+            ASSERT_EQUAL(scores[i], dirichlet(counts[i], norms[i]));
+
+        n = index::simd::jelinek_mercer_block(
+            0.5, 1e-9, counts.data(), norms.data(), scores.data(),
+            counts.size());
+        index::jelinek_mercer::kernel jm{0.5, 1e-9, 0};
+        for (uint64_t i = 0; i < n; ++i)
+            ASSERT_EQUAL(scores[i], jm(counts[i], norms[i]));
+    });
+
+    num_failed += testing::run_test("ranker-batch", [&]()
+    {
+        index::okapi_bm25 r;
+        test_batch_rank(r, *idx, encoding);
+    });
+
+    num_failed += testing::run_test("ranker-term-ids", [&]()
+    {
+        index::okapi_bm25 bm25;
+        test_term_id_rank(bm25, *idx, encoding);
+        index::dirichlet_prior dp;
+        test_term_id_rank(dp, *idx, encoding);
+    });
+
+    num_failed += testing::run_test("ranker-doc-filter", [&]()
+    {
+        index::okapi_bm25 r;
+        test_filtered_rank(r, *idx, encoding);
+    });
+
+    num_failed += testing::run_test("ranker-query-cache", [&]()
+    {
+        index::okapi_bm25 r;
+        test_cached_rank(r, *idx, encoding);
+    });
+
     idx = nullptr;
+    system("rm -rf ceeaus-inv test-config.toml");
+
+    create_config("file", "block");
+    auto block_idx = index::make_index<index::inverted_index>(
+        "test-config.toml");
+
+    num_failed += testing::run_test("ranker-pruned-okapi-bm25", [&]()
+    {
+        index::okapi_bm25 r;
+        test_pruned_rank(r, *block_idx, encoding);
+    });
+
+    num_failed += testing::run_test("ranker-pruned-dirichlet-prior", [&]()
+    {
+        index::dirichlet_prior r;
+        test_pruned_rank(r, *block_idx, encoding);
+    });
+
+    num_failed += testing::run_test("ranker-pruned-pivoted-length", [&]()
+    {
+        index::pivoted_length r;
+        test_pruned_rank(r, *block_idx, encoding);
+    });
+
+    num_failed += testing::run_test("ranker-pruned-jelinek-mercer", [&]()
+    {
+        index::jelinek_mercer r;
+        test_pruned_rank(r, *block_idx, encoding);
+    });
+
+    num_failed += testing::run_test("ranker-batch-pruned", [&]()
+    {
+        index::okapi_bm25 r;
+        r.strategy(index::ranker::evaluation_strategy::block_max_wand);
+        test_batch_rank(r, *block_idx, encoding);
+    });
+
+    num_failed += testing::run_test("ranker-doc-filter-pruned", [&]()
+    {
+        index::okapi_bm25 r;
+        r.strategy(index::ranker::evaluation_strategy::block_max_wand);
+        test_filtered_rank(r, *block_idx, encoding);
+    });
+
+    num_failed += testing::run_test("ranker-query-threads", [&]()
+    {
+        index::okapi_bm25 r;
+        test_partitioned_rank(r, *block_idx, encoding);
+    });
+
+    num_failed += testing::run_test("ranker-score-at-a-time", [&]()
+    {
+        index::okapi_bm25 r;
+        test_impact_rank(r, *block_idx, encoding);
+    });
+
+    num_failed += testing::run_test("ranker-kernel-reorder", [&]()
+    {
+        // the same rankers must not reuse the normalizers of the index
+        // they scored before it was reordered under the same name
+        index::okapi_bm25 bm25;
+        index::pivoted_length pivoted;
+        index::dirichlet_prior dirichlet;
+        index::jelinek_mercer jm;
+        auto check = [&]()
+        {
+            test_pruned_rank(bm25, *block_idx, encoding);
+            test_pruned_rank(pivoted, *block_idx, encoding);
+            test_pruned_rank(dirichlet, *block_idx, encoding);
+            test_pruned_rank(jm, *block_idx, encoding);
+        };
+        check();
+
+        // reversing the documents keeps the average length the same
+        auto order = block_idx->docs();
+        std::reverse(order.begin(), order.end());
+        block_idx = nullptr;
+        index::reorder_docs("test-config.toml", order);
+        block_idx = index::make_index<index::inverted_index>(
+            "test-config.toml");
+        check();
+    });
+
+    num_failed += testing::run_test("ranker-query-cache-reorder", [&]()
+    {
+        // entries for an index must not answer queries against the index
+        // reordered in its place under the same name
+        index::okapi_bm25 r;
+        index::query_cache cache;
+        corpus::document query{block_idx->doc_path(doc_id{0}), doc_id{0}};
+        query.encoding(encoding);
+        cache.score(r, *block_idx, query);
+
+        auto order = block_idx->docs();
+        std::reverse(order.begin(), order.end());
+        block_idx = nullptr;
+        index::reorder_docs("test-config.toml", order);
+        block_idx = index::make_index<index::inverted_index>(
+            "test-config.toml");
+
+        auto expected = r.score(*block_idx, query);
+        auto ranking = cache.score(r, *block_idx, query);
+        ASSERT_EQUAL(cache.stats().misses, 2ul);
+        ASSERT_EQUAL(ranking.size(), expected.size());
+        for (size_t j = 0; j < expected.size(); ++j)
+            ASSERT_EQUAL(ranking[j].first, expected[j].first);
+    });
+
+    block_idx = nullptr;
 
     system("rm -rf ceeaus-inv test-config.toml");
     return num_failed;
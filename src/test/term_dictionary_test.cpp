@@ -0,0 +1,154 @@
+/**
+ * @file term_dictionary_test.cpp
+ */
+
+#include <algorithm>
+#include <cstdio>
+
+#include "test/term_dictionary_test.h"
+
+namespace meta
+{
+namespace testing
+{
+
+namespace
+{
+/// Where the test dictionary is written
+const std::string dict_path = "meta-tmp-test.dict";
+
+/**
+ * @return a sorted list of terms, many sharing long prefixes
+ */
+std::vector<std::string> make_terms()
+{
+    std::vector<std::string> terms;
+    for (const auto& stem : {"apple", "applet", "application", "banana", "b"})
+    {
+        for (uint64_t i = 0; i < 100; ++i)
+            terms.push_back(stem + std::to_string(i));
+    }
+    std::sort(terms.begin(), terms.end());
+    return terms;
+}
+
+void remove_files()
+{
+    for (const auto& suffix : {"", ".index", ".hash"})
+        std::remove((dict_path + suffix).c_str());
+}
+}
+
+int term_dictionary_tests()
+{
+    int num_failed = 0;
+    auto terms = make_terms();
+    {
+        index::term_dictionary_writer writer{dict_path};
+        for (const auto& term : terms)
+            writer.insert(term);
+    }
+
+    num_failed += testing::run_test("term-dictionary-lookup", [&]()
+    {
+        index::term_dictionary dict{dict_path};
+        ASSERT_EQUAL(dict.size(), terms.size());
+        for (uint64_t i = 0; i < terms.size(); ++i)
+        {
+            auto t_id = dict.find(terms[i]);
+            ASSERT(t_id);
+            ASSERT_EQUAL(*t_id, i);
+            ASSERT_EQUAL(dict.find_term(term_id{i}), terms[i]);
+        }
+        ASSERT(!dict.find(""));
+        ASSERT(!dict.find("apple"));
+        ASSERT(!dict.find("zebra"));
+        ASSERT(!dict.find("apple1000"));
+    });
+
+    num_failed += testing::run_test("term-dictionary-ordered", [&]()
+    {
+        index::term_dictionary dict{dict_path};
+        for (const auto& query : {"", "a", "apple5", "applet", "b", "b99",
+                                  "banana", "c"})
+        {
+            auto expected = std::lower_bound(terms.begin(), terms.end(),
+                                             std::string{query})
+                            - terms.begin();
+            ASSERT_EQUAL(dict.lower_bound(query),
+                         static_cast<uint64_t>(expected));
+        }
+
+        auto range = dict.prefix_range("applet");
+        ASSERT_EQUAL(range.second - range.first, 100ul);
+        for (auto t_id = range.first; t_id < range.second; ++t_id)
+            ASSERT_EQUAL(dict.find_term(t_id).substr(0, 6), "applet");
+
+        range = dict.prefix_range("apple");
+        ASSERT_EQUAL(range.second - range.first, 200ul);
+        range = dict.prefix_range("cherry");
+        ASSERT_EQUAL(range.first, range.second);
+    });
+
+    num_failed += testing::run_test("term-dictionary-shared-hash", [&]()
+    {
+        // these two strings have the same 64-bit FNV-1a hash
+        std::string first = "a1a9a9bf38687075";
+        std::string second = "c5bde799c2362419";
+        ASSERT_EQUAL(index::term_dictionary::hash(first),
+                     index::term_dictionary::hash(second));
+
+        auto shared = terms;
+        shared.push_back(first);
+        shared.push_back(second);
+        std::sort(shared.begin(), shared.end());
+        {
+            index::term_dictionary_writer writer{dict_path};
+            for (const auto& term : shared)
+                writer.insert(term);
+        }
+
+        index::term_dictionary dict{dict_path};
+        ASSERT_EQUAL(dict.size(), shared.size());
+        for (uint64_t i = 0; i < shared.size(); ++i)
+        {
+            auto t_id = dict.find(shared[i]);
+            ASSERT(t_id);
+            ASSERT_EQUAL(*t_id, i);
+        }
+        ASSERT(!dict.find("a1a9a9bf3868707"));
+        ASSERT(!dict.find("c5bde799c2362419a"));
+
+        try
+        {
+            util::minimal_perfect_hash::build({1, 2, 3, 2});
+            FAIL("building over equal keys should throw");
+        }
+        catch (const util::minimal_perfect_hash::
+                   minimal_perfect_hash_exception&)
+        {
+            // nothing, this is the expected behavior
+        }
+    });
+
+    num_failed += testing::run_test("term-dictionary-unsorted", [&]()
+    {
+        index::term_dictionary_writer writer{dict_path};
+        writer.insert("b");
+        try
+        {
+            writer.insert("a");
+            FAIL("inserting terms out of order should throw");
+        }
+        catch (const index::term_dictionary_writer::
+                   term_dictionary_writer_exception&)
+        {
+            // nothing, this is the expected behavior
+        }
+    });
+
+    remove_files();
+    return num_failed;
+}
+}
+}
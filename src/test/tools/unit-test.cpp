@@ -14,6 +14,7 @@
 #include "test/forward_index_test.h"
 #include "test/string_list_test.h"
 #include "test/vocabulary_map_test.h"
+#include "test/term_dictionary_test.h"
 #include "test/libsvm_parser_test.h"
 #include "test/classifier_test.h"
 #include "test/parallel_test.h"
@@ -41,6 +42,7 @@ int main(int argc, char* argv[])
         std::cerr << " \"forward-index\": runs forward index tests" << std::endl;
         std::cerr << " \"string-list\": runs string list tests" << std::endl;
         std::cerr << " \"vocabulary-map\": runs vocabulary map tests" << std::endl;
+        std::cerr << " \"term-dictionary\": runs term dictionary tests" << std::endl;
         std::cerr << " \"libsvm-parser\": runs libsvm parser tests" << std::endl;
         std::cerr << " \"classifiers\": runs classifier tests" << std::endl;
         std::cerr << " \"rankers\": runs ranker tests" << std::endl;
@@ -72,6 +74,8 @@ int main(int argc, char* argv[])
         num_failed += testing::string_list_tests();
     if (all || args.find("vocabulary-map") != args.end())
         num_failed += testing::vocabulary_map_tests();
+    if (all || args.find("term-dictionary") != args.end())
+        num_failed += testing::term_dictionary_tests();
     if (all || args.find("libsvm-parser") != args.end())
         num_failed += testing::libsvm_parser_tests();
     if (all || args.find("classifiers") != args.end())
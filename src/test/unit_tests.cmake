@@ -26,6 +26,10 @@ add_test(vocabulary-map ${UNIT_TEST_EXE} vocabulary-map)
 set_tests_properties(vocabulary-map PROPERTIES TIMEOUT 10 WORKING_DIRECTORY
                          ${CMAKE_RUNTIME_OUTPUT_DIRECTORY})
 
+add_test(term-dictionary ${UNIT_TEST_EXE} term-dictionary)
+set_tests_properties(term-dictionary PROPERTIES TIMEOUT 10 WORKING_DIRECTORY
+                         ${CMAKE_RUNTIME_OUTPUT_DIRECTORY})
+
 add_test(libsvm-parser ${UNIT_TEST_EXE} libsvm-parser)
 set_tests_properties(libsvm-parser PROPERTIES TIMEOUT 10 WORKING_DIRECTORY
                          ${CMAKE_RUNTIME_OUTPUT_DIRECTORY})
@@ -0,0 +1,150 @@
+/**
+ * @file cache-bench.cpp
+ */
+
+#include <algorithm>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "caching/all.h"
+#include "parallel/thread_pool.h"
+#include "util/time.h"
+
+using namespace meta;
+
+/// The value type cached by the benchmark, mirroring cached_index
+using value_type = std::shared_ptr<uint64_t>;
+
+/// The number of distinct keys looked up
+const uint64_t num_keys = 1000000;
+
+/// The number of entries each cache may hold
+const uint64_t cache_size = 50000;
+
+/**
+ * Builds the cumulative distribution of a Zipfian distribution over the
+ * keys, which is roughly how query terms are distributed.
+ * @return the cumulative probability of each key
+ */
+std::vector<double> zipf_cdf()
+{
+    std::vector<double> cdf(num_keys);
+    double sum = 0;
+    for (uint64_t i = 0; i < num_keys; ++i)
+    {
+        sum += 1.0 / (i + 1);
+        cdf[i] = sum;
+    }
+    for (auto& p : cdf)
+        p /= sum;
+    return cdf;
+}
+
+/**
+ * Runs a read-mostly workload against a cache from several threads at
+ * once and prints its throughput and hit rate. Every miss inserts the
+ * key, as cached_index::search_primary does.
+ * @param name The name of the cache
+ * @param cache The cache to benchmark
+ * @param cdf The key distribution
+ * @param num_threads The number of threads
+ * @param ops The number of lookups each thread performs
+ */
+template <class Cache>
+void run(const std::string& name, Cache& cache, const std::vector<double>& cdf,
+         uint64_t num_threads, uint64_t ops)
+{
+    parallel::thread_pool pool{num_threads};
+    std::vector<std::future<uint64_t>> futures;
+    uint64_t hits = 0;
+    auto elapsed = common::time<std::chrono::microseconds>([&]()
+    {
+        for (uint64_t t = 0; t < num_threads; ++t)
+        {
+            futures.emplace_back(pool.submit_task([&, t]()
+            {
+                std::mt19937_64 rng{t + 1};
+                std::uniform_real_distribution<double> dist;
+                uint64_t hits = 0;
+                for (uint64_t i = 0; i < ops; ++i)
+                {
+                    uint64_t key = std::lower_bound(cdf.begin(), cdf.end(),
+                                                    dist(rng))
+                                   - cdf.begin();
+                    if (cache.find(key))
+                        ++hits;
+                    else
+                        cache.insert(key, std::make_shared<uint64_t>(key));
+                }
+                return hits;
+            }));
+        }
+
+        for (auto& fut : futures)
+            hits += fut.get();
+    });
+
+    auto seconds = elapsed.count() / 1000000.0;
+    auto total = num_threads * ops;
+    std::cout << "  " << name << ": " << total / seconds / 1000000.0
+              << " million ops/sec, " << 100.0 * hits / total << "% hits"
+              << std::endl;
+}
+
+/**
+ * Measures how well each cache scales as concurrent lookups are added.
+ */
+int main(int argc, char* argv[])
+{
+    uint64_t max_threads = argc > 1 ? std::stoul(argv[1])
+                                    : std::thread::hardware_concurrency();
+    uint64_t ops = argc > 2 ? std::stoul(argv[2]) : 1000000;
+    if (max_threads == 0 || ops == 0)
+    {
+        std::cerr << "Usage:\t" << argv[0] << " [max-threads] [ops-per-thread]"
+                  << std::endl;
+        return 1;
+    }
+
+    // double the number of threads each round, always finishing with
+    // exactly max_threads
+    std::vector<uint64_t> thread_counts;
+    for (uint64_t threads = 1; threads < max_threads; threads *= 2)
+        thread_counts.push_back(threads);
+    thread_counts.push_back(max_threads);
+
+    auto cdf = zipf_cdf();
+    for (const auto& threads : thread_counts)
+    {
+        std::cout << threads << " thread(s):" << std::endl;
+        {
+            caching::default_dblru_cache<uint64_t, value_type> cache{
+                cache_size};
+            run("dblru_cache", cache, cdf, threads, ops);
+        }
+        {
+            caching::splay_cache<uint64_t, value_type> cache{cache_size};
+            run("splay_cache", cache, cdf, threads, ops);
+        }
+        {
+            caching::splay_shard_cache<uint64_t, value_type> cache{
+                uint8_t{32}, cache_size / 32};
+            run("splay_shard_cache", cache, cdf, threads, ops);
+        }
+        {
+            caching::dblru_shard_cache<uint64_t, value_type> cache{
+                uint8_t{32}, cache_size / 32};
+            run("dblru_shard_cache", cache, cdf, threads, ops);
+        }
+        {
+            caching::clock_cache<uint64_t, value_type> cache{cache_size};
+            run("clock_cache", cache, cdf, threads, ops);
+        }
+    }
+
+    return 0;
+}
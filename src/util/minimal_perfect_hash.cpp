@@ -0,0 +1,147 @@
+/**
+ * @file minimal_perfect_hash.cpp
+ */
+
+#include <algorithm>
+#include <bitset>
+#include <cmath>
+
+#include "util/minimal_perfect_hash.h"
+
+namespace meta
+{
+namespace util
+{
+
+namespace
+{
+/// The most levels a function may have; distinct keys run out long before
+const uint64_t max_levels = 64;
+
+/**
+ * @param word A word of bits
+ * @return the number of bits set in it
+ */
+uint64_t popcount(uint64_t word)
+{
+    return std::bitset<64>{word}.count();
+}
+}
+
+const constexpr uint64_t minimal_perfect_hash::rank_stride;
+
+std::vector<uint64_t> minimal_perfect_hash::build(std::vector<uint64_t> keys,
+                                                  double gamma /* = 2.0 */)
+{
+    // equal keys collide at every level, so find them before building
+    std::sort(keys.begin(), keys.end());
+    if (std::adjacent_find(keys.begin(), keys.end()) != keys.end())
+        throw minimal_perfect_hash_exception{
+            "keys of a minimal perfect hash must be distinct"};
+
+    std::vector<uint64_t> data{keys.size(), 0};
+    std::vector<uint64_t> bits;
+    std::vector<uint64_t> collisions;
+    std::vector<uint64_t> next;
+    while (!keys.empty())
+    {
+        auto level = data[1];
+        if (level == max_levels)
+            throw minimal_perfect_hash_exception{
+                "too many levels in minimal perfect hash"};
+
+        auto words = static_cast<uint64_t>(
+            std::ceil(gamma * keys.size() / 64.0));
+        auto size = words * 64;
+        bits.assign(words, 0);
+        collisions.assign(words, 0);
+        for (const auto& key : keys)
+        {
+            auto pos = position(key, level, size);
+            auto mask = uint64_t{1} << (pos % 64);
+            if (bits[pos / 64] & mask)
+                collisions[pos / 64] |= mask;
+            else
+                bits[pos / 64] |= mask;
+        }
+
+        // keys that collided move on to the next level
+        next.clear();
+        for (const auto& key : keys)
+        {
+            auto pos = position(key, level, size);
+            if (collisions[pos / 64] & (uint64_t{1} << (pos % 64)))
+                next.push_back(key);
+        }
+        for (uint64_t i = 0; i < words; ++i)
+            bits[i] &= ~collisions[i];
+
+        data.insert(data.begin() + 2 + level, words);
+        data.insert(data.end(), bits.begin(), bits.end());
+        ++data[1];
+        keys.swap(next);
+    }
+    return data;
+}
+
+minimal_perfect_hash::minimal_perfect_hash(const uint64_t* data)
+    : size_{data[0]}
+{
+    auto num_levels = data[1];
+    bits_ = data + 2 + num_levels;
+
+    level_starts_.push_back(0);
+    for (uint64_t level = 0; level < num_levels; ++level)
+        level_starts_.push_back(level_starts_.back() + data[2 + level]);
+
+    uint64_t rank = 0;
+    for (uint64_t i = 0; i < level_starts_.back(); ++i)
+    {
+        if (i % rank_stride == 0)
+            ranks_.push_back(rank);
+        rank += popcount(bits_[i]);
+    }
+}
+
+uint64_t minimal_perfect_hash::operator()(uint64_t key) const
+{
+    for (uint64_t level = 0; level + 1 < level_starts_.size(); ++level)
+    {
+        auto start = level_starts_[level];
+        auto size = (level_starts_[level + 1] - start) * 64;
+        auto pos = position(key, level, size);
+        auto word = start + pos / 64;
+        auto offset = pos % 64;
+        if (!(bits_[word] & (uint64_t{1} << offset)))
+            continue;
+
+        auto rank = ranks_[word / rank_stride];
+        for (auto i = word - word % rank_stride; i < word; ++i)
+            rank += popcount(bits_[i]);
+        return rank + popcount(bits_[word] & ((uint64_t{1} << offset) - 1));
+    }
+    return size_;
+}
+
+uint64_t minimal_perfect_hash::size() const
+{
+    return size_;
+}
+
+uint64_t minimal_perfect_hash::num_words() const
+{
+    return 2 + (level_starts_.size() - 1) + level_starts_.back();
+}
+
+uint64_t minimal_perfect_hash::position(uint64_t key, uint64_t level,
+                                        uint64_t bits)
+{
+    // the splitmix64 finalizer, seeded by the level
+    key += (level + 1) * 0x9E3779B97F4A7C15ull;
+    key = (key ^ (key >> 30)) * 0xBF58476D1CE4E5B9ull;
+    key = (key ^ (key >> 27)) * 0x94D049BB133111EBull;
+    key ^= key >> 31;
+    return key % bits;
+}
+}
+}